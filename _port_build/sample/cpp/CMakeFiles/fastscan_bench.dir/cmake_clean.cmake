@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/fastscan_bench"
+  "/root/repo/bin/fastscan_bench.pdb"
+  "CMakeFiles/fastscan_bench.dir/fastscan_bench.cpp.o"
+  "CMakeFiles/fastscan_bench.dir/fastscan_bench.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/fastscan_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
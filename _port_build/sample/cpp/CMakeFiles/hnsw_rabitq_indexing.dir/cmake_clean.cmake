@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/hnsw_rabitq_indexing"
+  "/root/repo/bin/hnsw_rabitq_indexing.pdb"
+  "CMakeFiles/hnsw_rabitq_indexing.dir/hnsw_rabitq_indexing.cpp.o"
+  "CMakeFiles/hnsw_rabitq_indexing.dir/hnsw_rabitq_indexing.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/hnsw_rabitq_indexing.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/ivf_rabitq_querying"
+  "/root/repo/bin/ivf_rabitq_querying.pdb"
+  "CMakeFiles/ivf_rabitq_querying.dir/ivf_rabitq_querying.cpp.o"
+  "CMakeFiles/ivf_rabitq_querying.dir/ivf_rabitq_querying.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/ivf_rabitq_querying.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/symqg_compress"
+  "/root/repo/bin/symqg_compress.pdb"
+  "CMakeFiles/symqg_compress.dir/symqg_compress.cpp.o"
+  "CMakeFiles/symqg_compress.dir/symqg_compress.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/symqg_compress.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
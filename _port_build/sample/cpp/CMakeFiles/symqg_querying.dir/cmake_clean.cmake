@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/symqg_querying"
+  "/root/repo/bin/symqg_querying.pdb"
+  "CMakeFiles/symqg_querying.dir/symqg_querying.cpp.o"
+  "CMakeFiles/symqg_querying.dir/symqg_querying.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/symqg_querying.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
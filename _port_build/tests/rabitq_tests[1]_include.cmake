@@ -0,0 +1,5 @@
+if(EXISTS "/root/repo/_port_build/tests/rabitq_tests[1]_tests.cmake")
+  include("/root/repo/_port_build/tests/rabitq_tests[1]_tests.cmake")
+else()
+  add_test(rabitq_tests_NOT_BUILT rabitq_tests_NOT_BUILT)
+endif()
@@ -0,0 +1,105 @@
+add_test([=[CpuFeatures.simd_level]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=CpuFeatures.simd_level]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[CpuFeatures.simd_level]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[CpuFeatures.env_caps_level]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=CpuFeatures.env_caps_level]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[CpuFeatures.env_caps_level]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[LowPrecision.half_conversion_round_trip]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=LowPrecision.half_conversion_round_trip]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[LowPrecision.half_conversion_round_trip]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[LowPrecision.bf16_conversion_round_trip]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=LowPrecision.bf16_conversion_round_trip]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[LowPrecision.bf16_conversion_round_trip]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[LowPrecision.int8_encoding_error_is_bounded]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=LowPrecision.int8_encoding_error_is_bounded]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[LowPrecision.int8_encoding_error_is_bounded]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[LowPrecision.dist_funcs_match_decoded_vectors]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=LowPrecision.dist_funcs_match_decoded_vectors]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[LowPrecision.dist_funcs_match_decoded_vectors]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[RotatorTest.DefaultRotatorType]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=RotatorTest.DefaultRotatorType]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[RotatorTest.DefaultRotatorType]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[FlipSignTest.FlipWorks]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=FlipSignTest.FlipWorks]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[FlipSignTest.FlipWorks]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[SimdKernels.accumulate]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=SimdKernels.accumulate]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[SimdKernels.accumulate]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[SimdKernels.accumulate_matches_packed_codes]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=SimdKernels.accumulate_matches_packed_codes]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[SimdKernels.accumulate_matches_packed_codes]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[SimdKernels.accumulate_hacc]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=SimdKernels.accumulate_hacc]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[SimdKernels.accumulate_hacc]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[SimdKernels.accumulate_multi]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=SimdKernels.accumulate_multi]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[SimdKernels.accumulate_multi]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[SimdKernels.fused_estdist]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=SimdKernels.fused_estdist]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[SimdKernels.fused_estdist]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[SimdKernels.warmup_ip_x0_q_512]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=SimdKernels.warmup_ip_x0_q_512]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[SimdKernels.warmup_ip_x0_q_512]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[SimdKernels.transpose_bin_512_matches_warmup_ip]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=SimdKernels.transpose_bin_512_matches_warmup_ip]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[SimdKernels.transpose_bin_512_matches_warmup_ip]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[SimdKernels.transpose_bin]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=SimdKernels.transpose_bin]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[SimdKernels.transpose_bin]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[SimdKernels.mask_ip_x0_q]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=SimdKernels.mask_ip_x0_q]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[SimdKernels.mask_ip_x0_q]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[SimdKernels.excode_ip]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=SimdKernels.excode_ip]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[SimdKernels.excode_ip]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[SimdKernels.excode_ip_i8]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=SimdKernels.excode_ip_i8]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[SimdKernels.excode_ip_i8]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[SimdKernels.quantize_int8_symmetric]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=SimdKernels.quantize_int8_symmetric]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[SimdKernels.quantize_int8_symmetric]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[SimdKernels.quantize_lut]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=SimdKernels.quantize_lut]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[SimdKernels.quantize_lut]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[SimdKernels.kacs_walk_and_flip_sign]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=SimdKernels.kacs_walk_and_flip_sign]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[SimdKernels.kacs_walk_and_flip_sign]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[SimdKernels.fht]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=SimdKernels.fht]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[SimdKernels.fht]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[Select_IP_Func.returns_correct_function_pointer]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=Select_IP_Func.returns_correct_function_pointer]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[Select_IP_Func.returns_correct_function_pointer]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[ip16_fxu1_avx.ip_works]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=ip16_fxu1_avx.ip_works]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[ip16_fxu1_avx.ip_works]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[ip64_fxu2_avx.ip_works]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=ip64_fxu2_avx.ip_works]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[ip64_fxu2_avx.ip_works]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[BatchWidth.wide_batch_matches_narrow_batches]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=BatchWidth.wide_batch_matches_narrow_batches]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[BatchWidth.wide_batch_matches_narrow_batches]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[BitPackUnpackTest.ExCode1Bit]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=BitPackUnpackTest.ExCode1Bit]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[BitPackUnpackTest.ExCode1Bit]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[BitPackUnpackTest.ExCode2Bit]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=BitPackUnpackTest.ExCode2Bit]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[BitPackUnpackTest.ExCode2Bit]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[BitPackUnpackTest.ExCode3Bit]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=BitPackUnpackTest.ExCode3Bit]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[BitPackUnpackTest.ExCode3Bit]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[BitPackUnpackTest.ExCode4Bit]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=BitPackUnpackTest.ExCode4Bit]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[BitPackUnpackTest.ExCode4Bit]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[BitPackUnpackTest.ExCode5Bit]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=BitPackUnpackTest.ExCode5Bit]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[BitPackUnpackTest.ExCode5Bit]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[BitPackUnpackTest.ExCode6Bit]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=BitPackUnpackTest.ExCode6Bit]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[BitPackUnpackTest.ExCode6Bit]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[BitPackUnpackTest.ExCode7Bit]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=BitPackUnpackTest.ExCode7Bit]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[BitPackUnpackTest.ExCode7Bit]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[HNSW.save_load_search]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=HNSW.save_load_search]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[HNSW.save_load_search]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[HNSW.load_old_layout]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=HNSW.load_old_layout]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[HNSW.load_old_layout]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[HNSW.reorder_keeps_results]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=HNSW.reorder_keeps_results]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[HNSW.reorder_keeps_results]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[HNSW.label_out_of_range]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=HNSW.label_out_of_range]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[HNSW.label_out_of_range]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[HNSW.seed_from_clusters]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=HNSW.seed_from_clusters]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[HNSW.seed_from_clusters]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[HNSW.search_batches_and_threads]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=HNSW.search_batches_and_threads]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[HNSW.search_batches_and_threads]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[MultiQuery.batch_estdist_matches_single_query]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=MultiQuery.batch_estdist_matches_single_query]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[MultiQuery.batch_estdist_matches_single_query]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[QGBuilder.cluster_init_with_duplicates]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=QGBuilder.cluster_init_with_duplicates]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[QGBuilder.cluster_init_with_duplicates]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[QGBuilder.insert_into_built_graph]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=QGBuilder.insert_into_built_graph]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[QGBuilder.insert_into_built_graph]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[QGBuilder.partitioned_build]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=QGBuilder.partitioned_build]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[QGBuilder.partitioned_build]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[QGSearch.search_batch_matches_search]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=QGSearch.search_batch_matches_search]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[QGSearch.search_batch_matches_search]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[QGSearch.early_stop]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=QGSearch.early_stop]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[QGSearch.early_stop]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[DiskQG.save_load_search]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=DiskQG.save_load_search]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[DiskQG.save_load_search]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[DiskQG.search_with_ex_bits]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=DiskQG.search_with_ex_bits]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[DiskQG.search_with_ex_bits]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[QueryBits.single_estdist_accuracy]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=QueryBits.single_estdist_accuracy]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[QueryBits.single_estdist_accuracy]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[TwoBitFastScan.boosted_distance_matches_one_bit_stage]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=TwoBitFastScan.boosted_distance_matches_one_bit_stage]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[TwoBitFastScan.boosted_distance_matches_one_bit_stage]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[TwoBitFastScan.ivf_save_load_round_trip]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=TwoBitFastScan.ivf_save_load_round_trip]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[TwoBitFastScan.ivf_save_load_round_trip]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+add_test([=[TwoBitFastScan.zero_residual]=]  /root/repo/_port_build/tests/rabitq_tests [==[--gtest_filter=TwoBitFastScan.zero_residual]==] --gtest_also_run_disabled_tests)
+set_tests_properties([=[TwoBitFastScan.zero_residual]=]  PROPERTIES WORKING_DIRECTORY /root/repo/_port_build/tests SKIP_REGULAR_EXPRESSION [==[\[  SKIPPED \]]==])
+set(  rabitq_tests_TESTS CpuFeatures.simd_level CpuFeatures.env_caps_level LowPrecision.half_conversion_round_trip LowPrecision.bf16_conversion_round_trip LowPrecision.int8_encoding_error_is_bounded LowPrecision.dist_funcs_match_decoded_vectors RotatorTest.DefaultRotatorType FlipSignTest.FlipWorks SimdKernels.accumulate SimdKernels.accumulate_matches_packed_codes SimdKernels.accumulate_hacc SimdKernels.accumulate_multi SimdKernels.fused_estdist SimdKernels.warmup_ip_x0_q_512 SimdKernels.transpose_bin_512_matches_warmup_ip SimdKernels.transpose_bin SimdKernels.mask_ip_x0_q SimdKernels.excode_ip SimdKernels.excode_ip_i8 SimdKernels.quantize_int8_symmetric SimdKernels.quantize_lut SimdKernels.kacs_walk_and_flip_sign SimdKernels.fht Select_IP_Func.returns_correct_function_pointer ip16_fxu1_avx.ip_works ip64_fxu2_avx.ip_works BatchWidth.wide_batch_matches_narrow_batches BitPackUnpackTest.ExCode1Bit BitPackUnpackTest.ExCode2Bit BitPackUnpackTest.ExCode3Bit BitPackUnpackTest.ExCode4Bit BitPackUnpackTest.ExCode5Bit BitPackUnpackTest.ExCode6Bit BitPackUnpackTest.ExCode7Bit HNSW.save_load_search HNSW.load_old_layout HNSW.reorder_keeps_results HNSW.label_out_of_range HNSW.seed_from_clusters HNSW.search_batches_and_threads MultiQuery.batch_estdist_matches_single_query QGBuilder.cluster_init_with_duplicates QGBuilder.insert_into_built_graph QGBuilder.partitioned_build QGSearch.search_batch_matches_search QGSearch.early_stop DiskQG.save_load_search DiskQG.search_with_ex_bits QueryBits.single_estdist_accuracy TwoBitFastScan.boosted_distance_matches_one_bit_stage TwoBitFastScan.ivf_save_load_round_trip TwoBitFastScan.zero_residual)
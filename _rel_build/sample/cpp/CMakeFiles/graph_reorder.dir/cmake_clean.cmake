@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/graph_reorder"
+  "/root/repo/bin/graph_reorder.pdb"
+  "CMakeFiles/graph_reorder.dir/graph_reorder.cpp.o"
+  "CMakeFiles/graph_reorder.dir/graph_reorder.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/graph_reorder.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/hnsw_rabitq_querying"
+  "/root/repo/bin/hnsw_rabitq_querying.pdb"
+  "CMakeFiles/hnsw_rabitq_querying.dir/hnsw_rabitq_querying.cpp.o"
+  "CMakeFiles/hnsw_rabitq_querying.dir/hnsw_rabitq_querying.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/hnsw_rabitq_querying.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
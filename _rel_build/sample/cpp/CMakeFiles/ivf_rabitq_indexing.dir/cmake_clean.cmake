@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/ivf_rabitq_indexing"
+  "/root/repo/bin/ivf_rabitq_indexing.pdb"
+  "CMakeFiles/ivf_rabitq_indexing.dir/ivf_rabitq_indexing.cpp.o"
+  "CMakeFiles/ivf_rabitq_indexing.dir/ivf_rabitq_indexing.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/ivf_rabitq_indexing.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/symqg_build_bench"
+  "/root/repo/bin/symqg_build_bench.pdb"
+  "CMakeFiles/symqg_build_bench.dir/symqg_build_bench.cpp.o"
+  "CMakeFiles/symqg_build_bench.dir/symqg_build_bench.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/symqg_build_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/symqg_disk"
+  "/root/repo/bin/symqg_disk.pdb"
+  "CMakeFiles/symqg_disk.dir/symqg_disk.cpp.o"
+  "CMakeFiles/symqg_disk.dir/symqg_disk.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/symqg_disk.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/symqg_indexing"
+  "/root/repo/bin/symqg_indexing.pdb"
+  "CMakeFiles/symqg_indexing.dir/symqg_indexing.cpp.o"
+  "CMakeFiles/symqg_indexing.dir/symqg_indexing.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/symqg_indexing.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
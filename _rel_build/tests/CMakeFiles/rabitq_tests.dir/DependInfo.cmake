@@ -0,0 +1,34 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/tests/common/test_data.cpp" "tests/CMakeFiles/rabitq_tests.dir/common/test_data.cpp.o" "gcc" "tests/CMakeFiles/rabitq_tests.dir/common/test_data.cpp.o.d"
+  "/root/repo/tests/integration/batch_width_test.cpp" "tests/CMakeFiles/rabitq_tests.dir/integration/batch_width_test.cpp.o" "gcc" "tests/CMakeFiles/rabitq_tests.dir/integration/batch_width_test.cpp.o.d"
+  "/root/repo/tests/integration/bit_pack_unpack_test.cpp" "tests/CMakeFiles/rabitq_tests.dir/integration/bit_pack_unpack_test.cpp.o" "gcc" "tests/CMakeFiles/rabitq_tests.dir/integration/bit_pack_unpack_test.cpp.o.d"
+  "/root/repo/tests/integration/hnsw_test.cpp" "tests/CMakeFiles/rabitq_tests.dir/integration/hnsw_test.cpp.o" "gcc" "tests/CMakeFiles/rabitq_tests.dir/integration/hnsw_test.cpp.o.d"
+  "/root/repo/tests/integration/multi_query_test.cpp" "tests/CMakeFiles/rabitq_tests.dir/integration/multi_query_test.cpp.o" "gcc" "tests/CMakeFiles/rabitq_tests.dir/integration/multi_query_test.cpp.o.d"
+  "/root/repo/tests/integration/qg_builder_test.cpp" "tests/CMakeFiles/rabitq_tests.dir/integration/qg_builder_test.cpp.o" "gcc" "tests/CMakeFiles/rabitq_tests.dir/integration/qg_builder_test.cpp.o.d"
+  "/root/repo/tests/integration/qg_disk_test.cpp" "tests/CMakeFiles/rabitq_tests.dir/integration/qg_disk_test.cpp.o" "gcc" "tests/CMakeFiles/rabitq_tests.dir/integration/qg_disk_test.cpp.o.d"
+  "/root/repo/tests/integration/query_bits_test.cpp" "tests/CMakeFiles/rabitq_tests.dir/integration/query_bits_test.cpp.o" "gcc" "tests/CMakeFiles/rabitq_tests.dir/integration/query_bits_test.cpp.o.d"
+  "/root/repo/tests/integration/two_bit_fastscan_test.cpp" "tests/CMakeFiles/rabitq_tests.dir/integration/two_bit_fastscan_test.cpp.o" "gcc" "tests/CMakeFiles/rabitq_tests.dir/integration/two_bit_fastscan_test.cpp.o.d"
+  "/root/repo/tests/unit/rabitqlib/utils/cpu_features_test.cpp" "tests/CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/cpu_features_test.cpp.o" "gcc" "tests/CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/cpu_features_test.cpp.o.d"
+  "/root/repo/tests/unit/rabitqlib/utils/low_precision_test.cpp" "tests/CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/low_precision_test.cpp.o" "gcc" "tests/CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/low_precision_test.cpp.o.d"
+  "/root/repo/tests/unit/rabitqlib/utils/rotator_test.cpp" "tests/CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/rotator_test.cpp.o" "gcc" "tests/CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/rotator_test.cpp.o.d"
+  "/root/repo/tests/unit/rabitqlib/utils/simd_kernels_test.cpp" "tests/CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/simd_kernels_test.cpp.o" "gcc" "tests/CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/simd_kernels_test.cpp.o.d"
+  "/root/repo/tests/unit/rabitqlib/utils/space_test.cpp" "tests/CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/space_test.cpp.o" "gcc" "tests/CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/space_test.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_rel_build/_deps/googletest-build/googletest/CMakeFiles/gtest.dir/DependInfo.cmake"
+  "/root/repo/_rel_build/_deps/googletest-build/googletest/CMakeFiles/gtest_main.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,38 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/rabitq_tests.dir/common/test_data.cpp.o"
+  "CMakeFiles/rabitq_tests.dir/common/test_data.cpp.o.d"
+  "CMakeFiles/rabitq_tests.dir/integration/batch_width_test.cpp.o"
+  "CMakeFiles/rabitq_tests.dir/integration/batch_width_test.cpp.o.d"
+  "CMakeFiles/rabitq_tests.dir/integration/bit_pack_unpack_test.cpp.o"
+  "CMakeFiles/rabitq_tests.dir/integration/bit_pack_unpack_test.cpp.o.d"
+  "CMakeFiles/rabitq_tests.dir/integration/hnsw_test.cpp.o"
+  "CMakeFiles/rabitq_tests.dir/integration/hnsw_test.cpp.o.d"
+  "CMakeFiles/rabitq_tests.dir/integration/multi_query_test.cpp.o"
+  "CMakeFiles/rabitq_tests.dir/integration/multi_query_test.cpp.o.d"
+  "CMakeFiles/rabitq_tests.dir/integration/qg_builder_test.cpp.o"
+  "CMakeFiles/rabitq_tests.dir/integration/qg_builder_test.cpp.o.d"
+  "CMakeFiles/rabitq_tests.dir/integration/qg_disk_test.cpp.o"
+  "CMakeFiles/rabitq_tests.dir/integration/qg_disk_test.cpp.o.d"
+  "CMakeFiles/rabitq_tests.dir/integration/query_bits_test.cpp.o"
+  "CMakeFiles/rabitq_tests.dir/integration/query_bits_test.cpp.o.d"
+  "CMakeFiles/rabitq_tests.dir/integration/two_bit_fastscan_test.cpp.o"
+  "CMakeFiles/rabitq_tests.dir/integration/two_bit_fastscan_test.cpp.o.d"
+  "CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/cpu_features_test.cpp.o"
+  "CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/cpu_features_test.cpp.o.d"
+  "CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/low_precision_test.cpp.o"
+  "CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/low_precision_test.cpp.o.d"
+  "CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/rotator_test.cpp.o"
+  "CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/rotator_test.cpp.o.d"
+  "CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/simd_kernels_test.cpp.o"
+  "CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/simd_kernels_test.cpp.o.d"
+  "CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/space_test.cpp.o"
+  "CMakeFiles/rabitq_tests.dir/unit/rabitqlib/utils/space_test.cpp.o.d"
+  "rabitq_tests"
+  "rabitq_tests.pdb"
+  "rabitq_tests[1]_tests.cmake"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/rabitq_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -5,19 +5,30 @@
 
 #include <immintrin.h>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <iostream>
 
 #include "rabitqlib/defines.hpp"
+#include "rabitqlib/utils/cpu_features.hpp"
 
 namespace rabitqlib::fastscan {
 
 constexpr static size_t kBatchSize = 32;  // number of vectors in each batch
 
+// Batches can also hold kWideBatchSize vectors. A wide batch interleaves 32-vector groups
+// every 4 codebooks (16 dims), so one load of the lut serves all groups. Kernels and
+// layouts take the batch width as the template parameter kWidth (a multiple of 32).
+constexpr static size_t kWideBatchSize = 64;
+
+// bytes of packed codes of 4 codebooks (16 dims) for a group of 32 vectors
+constexpr static size_t kBlockBytes = 64;
+
 constexpr static std::array<int, 16> kPos = {
     3 /*0000*/,
     3 /*0001*/,
@@ -47,7 +58,7 @@ static inline void get_column(
     const T* src, size_t rows, size_t cols, size_t row, size_t col, TA& dest
 ) {
     size_t k = 0;
-    size_t max_k = std::min(rows - row, dest.size());
+    size_t max_k = row < rows ? std::min(rows - row, dest.size()) : 0;
     for (; k < max_k; ++k) {
         dest[k] = src[((k + row) * cols) + col];
     }
@@ -58,18 +69,22 @@ static inline void get_column(
 
 /**
  * @brief Pack quantization codes, store in blocks, the data orgnization is illustrated in
- * the link and kPerm0. Since we pack codes as 32-sized groups, if the num is not a multiple
- * of 32, we have to use some space for these absent data
+ * the link and kPerm0. Since we pack codes as kWidth-sized groups, if the num is not a
+ * multiple of kWidth, we have to use some space for these absent data
  *
- * @param padded_dim dimension of quantized data (i.e., quantization code)
+ * @tparam kWidth   number of vectors in each batch, kBatchSize or kWideBatchSize
+ * @param padded_dim dimension of quantized data (i.e., quantization code), % 16 == 0
  * @param quantization_code quantizaiton code, stored as uint8
  * @param num   number of quantization code
  * @param blocks packed quantization code
  */
+template <size_t kWidth = kBatchSize>
 inline void pack_codes(
     size_t padded_dim, const uint8_t* quantization_code, size_t num, uint8_t* blocks
 ) {
-    size_t num_rd = (num + 31) & ~31;  // round up num of vecs to multiple of batch size(32)
+    static_assert(kWidth % kBatchSize == 0, "batch width must be a multiple of 32");
+    // round up num of vecs to multiple of batch size
+    size_t num_rd = (num + kWidth - 1) / kWidth * kWidth;
 
     // consider codes is a matrix
     // rows = number of vectors
@@ -81,90 +96,85 @@ inline void pack_codes(
     std::array<uint8_t, 32> col_1;  // lower 4 bits
 
     // pack codes batch by batch
-    // each batch contain codes for 32 vectors
-    for (size_t row = 0; row < num_rd; row += kBatchSize) {
-        // get quantization codes for each column for each batch
+    // each batch contain codes for kWidth vectors, in groups of 32 vectors interleaved
+    // every 2 columns (4 codebooks)
+    for (size_t row = 0; row < num_rd; row += kWidth) {
+        // get quantization codes for each column for each group
         // i.e., we get the codes for 8 dims of 32 vectors and re-orgnize the data layout
         // based on the shuffle SIMD instruction used during quering
-        for (size_t i = 0; i < cols; ++i) {
-            get_column(quantization_code, num, cols, row, i, col);
-            for (size_t j = 0; j < 32; ++j) {
-                col_0[j] = col[j] >> 4;
-                col_1[j] = col[j] & 15;
+        for (size_t i = 0; i < cols; i += 2) {
+            for (size_t group = row; group < row + kWidth; group += kBatchSize) {
+                for (size_t c = i; c < i + 2; ++c) {
+                    get_column(quantization_code, num, cols, group, c, col);
+                    for (size_t j = 0; j < 32; ++j) {
+                        col_0[j] = col[j] >> 4;
+                        col_1[j] = col[j] & 15;
+                    }
+                    for (size_t j = 0; j < 16; ++j) {
+                        // the lower 4 bits represent vector 0 to 15
+                        // the upper 4 bits represent vector 16 to 31
+                        uint8_t val0 = col_0[kPerm0[j]] | (col_0[kPerm0[j] + 16] << 4);
+                        uint8_t val1 = col_1[kPerm0[j]] | (col_1[kPerm0[j] + 16] << 4);
+                        blocks[j] = val0;
+                        blocks[j + 16] = val1;
+                    }
+                    blocks += 32;
+                }
             }
-            for (size_t j = 0; j < 16; ++j) {
-                // the lower 4 bits represent vector 0 to 15
-                // the upper 4 bits represent vector 16 to 31
-                uint8_t val0 = col_0[kPerm0[j]] | (col_0[kPerm0[j] + 16] << 4);
-                uint8_t val1 = col_1[kPerm0[j]] | (col_1[kPerm0[j] + 16] << 4);
-                blocks[j] = val0;
-                blocks[j + 16] = val1;
-            }
-            blocks += 32;
         }
     }
 }
 
-// use fast scan to accumulate one block, dim % 16 == 0
-inline void accumulate(
+/**
+ * @brief Scalar reference of accumulate. Codes of each 4 dims of a group of 32 vectors take
+ * 16 bytes, the lower and upper 4 bits of the j-th byte are codes of vector kPerm0[j] and
+ * kPerm0[j] + 16 (see pack_codes). Sums wrap around as u16, the same as the SIMD kernels.
+ */
+template <size_t kWidth = kBatchSize>
+inline void accumulate_scalar(
     const uint8_t* __restrict__ codes,
     const uint8_t* __restrict__ lp_table,
     uint16_t* __restrict__ result,
     size_t dim
 ) {
-    size_t code_length = dim << 2;
-#if defined(__AVX512BW__)
-    __m512i c;
-    __m512i lo;
-    __m512i hi;
-    __m512i lut;
-    __m512i res_lo;
-    __m512i res_hi;
-
-    const __m512i lo_mask = _mm512_set1_epi8(0x0f);
-    __m512i accu0 = _mm512_setzero_si512();
-    __m512i accu1 = _mm512_setzero_si512();
-    __m512i accu2 = _mm512_setzero_si512();
-    __m512i accu3 = _mm512_setzero_si512();
+    size_t num_codebook = dim >> 2;
+    std::fill(result, result + kWidth, 0);
+    for (size_t m = 0; m < num_codebook; m += 4) {
+        for (size_t group = 0; group < kWidth; group += kBatchSize) {
+            uint16_t* group_result = result + group;
+            for (size_t k = 0; k < 4; ++k) {
+                const uint8_t* lut = lp_table + (k * 16);
+                for (size_t j = 0; j < 16; ++j) {
+                    uint8_t code = codes[j];
+                    group_result[kPerm0[j]] += lut[code & 15];
+                    group_result[kPerm0[j] + 16] += lut[code >> 4];
+                }
+                codes += 16;
+            }
+        }
+        lp_table += 64;
+    }
+}
 
-    // ! here, we assume the code_length is a multiple of 64, thus the dim must be a
-    // ! multiple of 16
-    for (size_t i = 0; i < code_length; i += 64) {
-        c = _mm512_loadu_si512(&codes[i]);
-        lut = _mm512_loadu_si512(&lp_table[i]);
-        lo = _mm512_and_si512(c, lo_mask);                        // code of vector 0 to 15
-        hi = _mm512_and_si512(_mm512_srli_epi16(c, 4), lo_mask);  // code of vector 16 to 31
-
-        res_lo = _mm512_shuffle_epi8(lut, lo);  // get the target value in lookup table
-        res_hi = _mm512_shuffle_epi8(lut, hi);
-
-        // since values in lookup table are represented as i8, we add them as i16 to avoid
-        // overflow. Since the data order is 0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14,
-        // 7, 15, accu0 accumulates for vec 8 to 15 (the upper 8 bits need to be updated
-        // since they stored useless info of vec 0 to 7) accu1 accumulates for vec 0 to 7
-        // similar for accu2 and accu3
-        accu0 = _mm512_add_epi16(accu0, res_lo);
-        accu1 = _mm512_add_epi16(accu1, _mm512_srli_epi16(res_lo, 8));
-        accu2 = _mm512_add_epi16(accu2, res_hi);
-        accu3 = _mm512_add_epi16(accu3, _mm512_srli_epi16(res_hi, 8));
-    }
-    // remove the influence of upper 8 bits for accu0 and accu2
-    accu0 = _mm512_sub_epi16(accu0, _mm512_slli_epi16(accu1, 8));
-    accu2 = _mm512_sub_epi16(accu2, _mm512_slli_epi16(accu3, 8));
-
-    // At this point, we already have the correct accumulating result (accu0: 8-15, accu1:
-    // 0-7, accu2: 16-23, accu3: 24-31), but we still need to write them back to RAM. Also,
-    // each accu contains 4 lines of __m128i and we need to sum them together to get the
-    // final results. 512/16=32, so we can use one __m512i to contain all results. The
-    // following codes are designed for this purpose. For detailed information, please check
-    // the SIMD documentation.
+// sum the 4 accumulators of a group of 32 vectors (see accumulate_avx512) into result
+RABITQ_TARGET_AVX512 inline void reduce_accu_avx512(__m512i (&a)[4], uint16_t* result) {
+    // remove the influence of upper 8 bits for a[0] and a[2]
+    a[0] = _mm512_sub_epi16(a[0], _mm512_slli_epi16(a[1], 8));
+    a[2] = _mm512_sub_epi16(a[2], _mm512_slli_epi16(a[3], 8));
+
+    // At this point, we already have the correct accumulating result (a[0]: 8-15,
+    // a[1]: 0-7, a[2]: 16-23, a[3]: 24-31), but we still need to write them back to
+    // RAM. Also, each accu contains 4 lines of __m128i and we need to sum them together
+    // to get the final results. 512/16=32, so we can use one __m512i to contain all
+    // results of a group. The following codes are designed for this purpose. For
+    // detailed information, please check the SIMD documentation.
     __m512i ret1 = _mm512_add_epi16(
-        _mm512_mask_blend_epi64(0b11110000, accu0, accu1),
-        _mm512_shuffle_i64x2(accu0, accu1, 0b01001110)
+        _mm512_mask_blend_epi64(0b11110000, a[0], a[1]),
+        _mm512_shuffle_i64x2(a[0], a[1], 0b01001110)
     );
     __m512i ret2 = _mm512_add_epi16(
-        _mm512_mask_blend_epi64(0b11110000, accu2, accu3),
-        _mm512_shuffle_i64x2(accu2, accu3, 0b01001110)
+        _mm512_mask_blend_epi64(0b11110000, a[2], a[3]),
+        _mm512_shuffle_i64x2(a[2], a[3], 0b01001110)
     );
     __m512i ret = _mm512_setzero_si512();
 
@@ -172,61 +182,275 @@ inline void accumulate(
     ret = _mm512_add_epi16(ret, _mm512_shuffle_i64x2(ret1, ret2, 0b11011101));
 
     _mm512_storeu_si512(result, ret);
+}
+
+// use fast scan to accumulate one block with avx512, dim % 16 == 0
+template <size_t kWidth = kBatchSize>
+RABITQ_TARGET_AVX512 inline void accumulate_avx512(
+    const uint8_t* __restrict__ codes,
+    const uint8_t* __restrict__ lp_table,
+    uint16_t* __restrict__ result,
+    size_t dim
+) {
+    constexpr size_t kGroups = kWidth / kBatchSize;
+    size_t code_length = dim << 2;  // bytes of codes of a group
+
+    const __m512i lo_mask = _mm512_set1_epi8(0x0f);
+    __m512i accu[kGroups][4];
+    for (auto& a : accu) {
+        for (auto& reg : a) {
+            reg = _mm512_setzero_si512();
+        }
+    }
 
-#elif defined(__AVX2__)
-    __m256i c, lo, hi, lut, res_lo, res_hi;
+    // ! here, we assume the code_length is a multiple of 64, thus the dim must be a
+    // ! multiple of 16
+    for (size_t i = 0; i < code_length; i += kBlockBytes) {
+        // the lut of 4 codebooks is shared by all groups
+        __m512i lut = _mm512_loadu_si512(&lp_table[i]);
+        for (auto& a : accu) {
+            __m512i c = _mm512_loadu_si512(codes);
+            codes += kBlockBytes;
+            __m512i lo = _mm512_and_si512(c, lo_mask);  // code of vector 0 to 15
+            __m512i hi =
+                _mm512_and_si512(_mm512_srli_epi16(c, 4), lo_mask);  // vector 16 to 31
+
+            // get the target value in lookup table
+            __m512i res_lo = _mm512_shuffle_epi8(lut, lo);
+            __m512i res_hi = _mm512_shuffle_epi8(lut, hi);
+
+            // since values in lookup table are represented as i8, we add them as i16 to
+            // avoid overflow. Since the data order is 0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5,
+            // 13, 6, 14, 7, 15, a[0] accumulates for vec 8 to 15 (the upper 8 bits need to
+            // be updated since they stored useless info of vec 0 to 7) a[1] accumulates for
+            // vec 0 to 7 similar for a[2] and a[3]
+            a[0] = _mm512_add_epi16(a[0], res_lo);
+            a[1] = _mm512_add_epi16(a[1], _mm512_srli_epi16(res_lo, 8));
+            a[2] = _mm512_add_epi16(a[2], res_hi);
+            a[3] = _mm512_add_epi16(a[3], _mm512_srli_epi16(res_hi, 8));
+        }
+    }
+
+    for (auto& a : accu) {
+        reduce_accu_avx512(a, result);
+        result += kBatchSize;
+    }
+}
+
+// use fast scan to accumulate one block with avx2, dim % 16 == 0
+template <size_t kWidth = kBatchSize>
+RABITQ_TARGET_AVX2 inline void accumulate_avx2(
+    const uint8_t* __restrict__ codes,
+    const uint8_t* __restrict__ lp_table,
+    uint16_t* __restrict__ result,
+    size_t dim
+) {
+    constexpr size_t kGroups = kWidth / kBatchSize;
+    size_t code_length = dim << 2;  // bytes of codes of a group
 
     __m256i low_mask = _mm256_set1_epi8(0xf);
-    __m256i accu0 = _mm256_setzero_si256();
-    __m256i accu1 = _mm256_setzero_si256();
-    __m256i accu2 = _mm256_setzero_si256();
-    __m256i accu3 = _mm256_setzero_si256();
-
-    for (size_t i = 0; i < code_length; i += 64) {
-        c = _mm256_loadu_si256((__m256i*)&codes[i]);
-        lut = _mm256_loadu_si256((__m256i*)&lp_table[i]);
-        lo = _mm256_and_si256(c, low_mask);
-        hi = _mm256_and_si256(_mm256_srli_epi16(c, 4), low_mask);
-
-        res_lo = _mm256_shuffle_epi8(lut, lo);
-        res_hi = _mm256_shuffle_epi8(lut, hi);
-
-        accu0 = _mm256_add_epi16(accu0, res_lo);
-        accu1 = _mm256_add_epi16(accu1, _mm256_srli_epi16(res_lo, 8));
-        accu2 = _mm256_add_epi16(accu2, res_hi);
-        accu3 = _mm256_add_epi16(accu3, _mm256_srli_epi16(res_hi, 8));
-
-        c = _mm256_loadu_si256((__m256i*)&codes[i + 32]);
-        lut = _mm256_loadu_si256((__m256i*)&lp_table[i + 32]);
-        lo = _mm256_and_si256(c, low_mask);
-        hi = _mm256_and_si256(_mm256_srli_epi16(c, 4), low_mask);
-
-        res_lo = _mm256_shuffle_epi8(lut, lo);
-        res_hi = _mm256_shuffle_epi8(lut, hi);
-
-        accu0 = _mm256_add_epi16(accu0, res_lo);
-        accu1 = _mm256_add_epi16(accu1, _mm256_srli_epi16(res_lo, 8));
-        accu2 = _mm256_add_epi16(accu2, res_hi);
-        accu3 = _mm256_add_epi16(accu3, _mm256_srli_epi16(res_hi, 8));
-    }
-
-    accu0 = _mm256_sub_epi16(accu0, _mm256_slli_epi16(accu1, 8));
-    __m256i dis0 = _mm256_add_epi16(
-        _mm256_permute2f128_si256(accu0, accu1, 0x21),
-        _mm256_blend_epi32(accu0, accu1, 0xF0)
-    );
-    _mm256_storeu_si256((__m256i*)result, dis0);
+    __m256i accu[kGroups][4];
+    for (auto& a : accu) {
+        for (auto& reg : a) {
+            reg = _mm256_setzero_si256();
+        }
+    }
 
-    accu2 = _mm256_sub_epi16(accu2, _mm256_slli_epi16(accu3, 8));
-    __m256i dis1 = _mm256_add_epi16(
-        _mm256_permute2f128_si256(accu2, accu3, 0x21),
-        _mm256_blend_epi32(accu2, accu3, 0xF0)
-    );
-    _mm256_storeu_si256((__m256i*)&result[16], dis1);
-#else
-    std::cerr << "no avx simd supported!\n";
-    exit(1);
-#endif
+    for (size_t i = 0; i < code_length; i += kBlockBytes) {
+        // the lut of 4 codebooks is shared by all groups
+        const __m256i luts[2] = {
+            _mm256_loadu_si256((__m256i*)&lp_table[i]),
+            _mm256_loadu_si256((__m256i*)&lp_table[i + 32])
+        };
+        for (auto& a : accu) {
+            for (const auto& lut : luts) {
+                __m256i c = _mm256_loadu_si256((__m256i*)codes);
+                codes += 32;
+                __m256i lo = _mm256_and_si256(c, low_mask);
+                __m256i hi = _mm256_and_si256(_mm256_srli_epi16(c, 4), low_mask);
+
+                __m256i res_lo = _mm256_shuffle_epi8(lut, lo);
+                __m256i res_hi = _mm256_shuffle_epi8(lut, hi);
+
+                a[0] = _mm256_add_epi16(a[0], res_lo);
+                a[1] = _mm256_add_epi16(a[1], _mm256_srli_epi16(res_lo, 8));
+                a[2] = _mm256_add_epi16(a[2], res_hi);
+                a[3] = _mm256_add_epi16(a[3], _mm256_srli_epi16(res_hi, 8));
+            }
+        }
+    }
+
+    for (auto& a : accu) {
+        a[0] = _mm256_sub_epi16(a[0], _mm256_slli_epi16(a[1], 8));
+        __m256i dis0 = _mm256_add_epi16(
+            _mm256_permute2f128_si256(a[0], a[1], 0x21),
+            _mm256_blend_epi32(a[0], a[1], 0xF0)
+        );
+        _mm256_storeu_si256((__m256i*)result, dis0);
+
+        a[2] = _mm256_sub_epi16(a[2], _mm256_slli_epi16(a[3], 8));
+        __m256i dis1 = _mm256_add_epi16(
+            _mm256_permute2f128_si256(a[2], a[3], 0x21),
+            _mm256_blend_epi32(a[2], a[3], 0xF0)
+        );
+        _mm256_storeu_si256((__m256i*)&result[16], dis1);
+        result += kBatchSize;
+    }
+}
+
+// The kernels above with a compile-time dim, whose loops are then fully unrolled. The
+// compiler only does so up to 16 blocks of codes, i.e., 256 dims, larger dims gain
+// nothing from it and use the kernels with a runtime dim.
+template <size_t kWidth, size_t kDim>
+RABITQ_TARGET_AVX512 inline void accumulate_avx512_fixed(
+    const uint8_t* __restrict__ codes,
+    const uint8_t* __restrict__ lp_table,
+    uint16_t* __restrict__ result
+) {
+    accumulate_avx512<kWidth>(codes, lp_table, result, kDim);
+}
+
+template <size_t kWidth, size_t kDim>
+RABITQ_TARGET_AVX2 inline void accumulate_avx2_fixed(
+    const uint8_t* __restrict__ codes,
+    const uint8_t* __restrict__ lp_table,
+    uint16_t* __restrict__ result
+) {
+    accumulate_avx2<kWidth>(codes, lp_table, result, kDim);
+}
+
+// use fast scan to accumulate one block of kWidth vectors, dim % 16 == 0
+template <size_t kWidth = kBatchSize>
+inline void accumulate(
+    const uint8_t* __restrict__ codes,
+    const uint8_t* __restrict__ lp_table,
+    uint16_t* __restrict__ result,
+    size_t dim
+) {
+    // the dim is fixed per index, so the switch is always predicted
+    if (simd_level() >= SimdLevel::AVX512) {
+        switch (dim) {
+            case 128:
+                accumulate_avx512_fixed<kWidth, 128>(codes, lp_table, result);
+                break;
+            case 256:
+                accumulate_avx512_fixed<kWidth, 256>(codes, lp_table, result);
+                break;
+            default:
+                accumulate_avx512<kWidth>(codes, lp_table, result, dim);
+        }
+    } else if (simd_level() >= SimdLevel::AVX2) {
+        switch (dim) {
+            case 128:
+                accumulate_avx2_fixed<kWidth, 128>(codes, lp_table, result);
+                break;
+            case 256:
+                accumulate_avx2_fixed<kWidth, 256>(codes, lp_table, result);
+                break;
+            default:
+                accumulate_avx2<kWidth>(codes, lp_table, result, dim);
+        }
+    } else {
+        accumulate_scalar<kWidth>(codes, lp_table, result, dim);
+    }
+}
+
+// queries scanned together by the multi-query kernels, 4 x 4 accumulators plus the codes
+// and luts fit in the 32 AVX-512 registers
+constexpr static size_t kMultiQueries = 4;
+
+/**
+ * @brief Accumulate one block of 32 vectors for kQueries luts with avx512. Each block of
+ * codes is loaded and split into 4-bit indices once and looked up in all luts.
+ *
+ * @param luts   luts of the queries, same layout as the lut of accumulate
+ * @param result kQueries rows of kBatchSize results
+ */
+template <size_t kQueries>
+RABITQ_TARGET_AVX512 inline void accumulate_multi_avx512(
+    const uint8_t* __restrict__ codes,
+    const uint8_t* const* luts,
+    uint16_t* __restrict__ result,
+    size_t dim
+) {
+    size_t code_length = dim << 2;
+
+    const __m512i lo_mask = _mm512_set1_epi8(0x0f);
+    __m512i accu[kQueries][4];
+    for (auto& a : accu) {
+        for (auto& reg : a) {
+            reg = _mm512_setzero_si512();
+        }
+    }
+
+    for (size_t i = 0; i < code_length; i += kBlockBytes) {
+        __m512i c = _mm512_loadu_si512(&codes[i]);
+        __m512i lo = _mm512_and_si512(c, lo_mask);
+        __m512i hi = _mm512_and_si512(_mm512_srli_epi16(c, 4), lo_mask);
+
+        for (size_t q = 0; q < kQueries; ++q) {
+            __m512i lut = _mm512_loadu_si512(&luts[q][i]);
+            __m512i res_lo = _mm512_shuffle_epi8(lut, lo);
+            __m512i res_hi = _mm512_shuffle_epi8(lut, hi);
+
+            // same as accumulate_avx512
+            accu[q][0] = _mm512_add_epi16(accu[q][0], res_lo);
+            accu[q][1] = _mm512_add_epi16(accu[q][1], _mm512_srli_epi16(res_lo, 8));
+            accu[q][2] = _mm512_add_epi16(accu[q][2], res_hi);
+            accu[q][3] = _mm512_add_epi16(accu[q][3], _mm512_srli_epi16(res_hi, 8));
+        }
+    }
+
+    for (auto& a : accu) {
+        reduce_accu_avx512(a, result);
+        result += kBatchSize;
+    }
+}
+
+/**
+ * @brief Accumulate one block of 32 vectors for num_queries luts, so that queries scanning
+ * the same cluster share the loads of codes. Results are identical to calling accumulate
+ * per lut. Without AVX-512 it does exactly that, since the codes stay in L1 anyway.
+ *
+ * @param codes  packed codes of 32 vectors, see pack_codes
+ * @param luts   num_queries luts, see pack_lut
+ * @param num_queries number of luts
+ * @param result num_queries rows of kBatchSize results
+ * @param dim    dim % 16 == 0
+ */
+inline void accumulate_multi(
+    const uint8_t* __restrict__ codes,
+    const uint8_t* const* luts,
+    size_t num_queries,
+    uint16_t* __restrict__ result,
+    size_t dim
+) {
+    if (simd_level() < SimdLevel::AVX512) {
+        for (size_t q = 0; q < num_queries; ++q) {
+            accumulate(codes, luts[q], result + (q * kBatchSize), dim);
+        }
+        return;
+    }
+
+    size_t q = 0;
+    for (; q + kMultiQueries <= num_queries; q += kMultiQueries) {
+        accumulate_multi_avx512<kMultiQueries>(
+            codes, luts + q, result + (q * kBatchSize), dim
+        );
+    }
+    switch (num_queries - q) {
+        case 3:
+            accumulate_multi_avx512<3>(codes, luts + q, result + (q * kBatchSize), dim);
+            break;
+        case 2:
+            accumulate_multi_avx512<2>(codes, luts + q, result + (q * kBatchSize), dim);
+            break;
+        case 1:
+            accumulate_avx512(codes, luts[q], result + (q * kBatchSize), dim);
+            break;
+        default:
+            break;
+    }
 }
 
 // pack lookup table for fastscan, for each 4 dim, we have 16 (2^4) different results
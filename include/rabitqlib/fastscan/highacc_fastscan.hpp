@@ -2,44 +2,44 @@
 
 #include <immintrin.h>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <iostream>
+#include <limits>
+
+#include "rabitqlib/fastscan/fastscan.hpp"
+#include "rabitqlib/utils/cpu_features.hpp"
 
 namespace rabitqlib::fastscan {
-/**
- * @brief Change u16 lookup table to u8. Since we use more bits (higher accuracy)
- * to quantize data vector by rabitq+, we also needs to increase the accuracy of data in
- * lut.
- * We split the higher & lower 8 bits of a u16 into two sub luts.
- **/
-inline void transfer_lut_hacc(const uint16_t* lut, size_t dim, uint8_t* hc_lut) {
+// position of the i-th sub lut in hc_lut when registers of kRegBits are used
+template <size_t kRegBits>
+inline uint8_t* hacc_lut_slot(uint8_t* hc_lut, size_t i) {
+    constexpr size_t kLaneBits = 128;
+    constexpr size_t kByteBits = 8;
+
+    constexpr size_t kLutPerIter = kRegBits / kLaneBits;
+    constexpr size_t kCodePerIter = 2 * kRegBits / kByteBits;
+    constexpr size_t kCodePerLine = kLaneBits / kByteBits;
+
+    return hc_lut + (i / kLutPerIter * kCodePerIter) + ((i % kLutPerIter) * kCodePerLine);
+}
+
+// the layout of hc_lut for accumulate_hacc_avx512
+RABITQ_TARGET_AVX512 inline void transfer_lut_hacc_avx512(
+    const uint16_t* lut, size_t dim, uint8_t* hc_lut
+) {
     size_t num_codebook = dim >> 2;
 
     for (size_t i = 0; i < num_codebook; i++) {
-        // avx2 - 256, avx512 - 512
-#if defined(__AVX512BW__)
-        constexpr size_t kRegBits = 512;
-#elif defined(__AVX2__)
-        constexpr size_t kRegBits = 256;
-#else
-        static_assert(false, "At least requried AVX2 for using fastscan\n");
-        exit(1);
-#endif
-        constexpr size_t kLaneBits = 128;
-        constexpr size_t kByteBits = 8;
-
-        constexpr size_t kLutPerIter = kRegBits / kLaneBits;
-        constexpr size_t kCodePerIter = 2 * kRegBits / kByteBits;
-        constexpr size_t kCodePerLine = kLaneBits / kByteBits;
-
-        uint8_t* fill_lo =
-            hc_lut + (i / kLutPerIter * kCodePerIter) + ((i % kLutPerIter) * kCodePerLine);
-        uint8_t* fill_hi = fill_lo + (kRegBits / kByteBits);
-
-#if defined(__AVX512BW__)
+        uint8_t* fill_lo = hacc_lut_slot<512>(hc_lut, i);
+        uint8_t* fill_hi = fill_lo + 64;
+
         __m512i tmp = _mm512_cvtepi16_epi32(
             _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lut))
         );
@@ -47,7 +47,18 @@ inline void transfer_lut_hacc(const uint16_t* lut, size_t dim, uint8_t* hc_lut)
         __m128i hi = _mm512_cvtepi32_epi8(_mm512_srli_epi32(tmp, 8));
         _mm_store_si128(reinterpret_cast<__m128i*>(fill_lo), lo);
         _mm_store_si128(reinterpret_cast<__m128i*>(fill_hi), hi);
-#else
+        lut += 16;
+    }
+}
+
+// the layout of hc_lut for accumulate_hacc_avx2
+inline void transfer_lut_hacc_avx2(const uint16_t* lut, size_t dim, uint8_t* hc_lut) {
+    size_t num_codebook = dim >> 2;
+
+    for (size_t i = 0; i < num_codebook; i++) {
+        uint8_t* fill_lo = hacc_lut_slot<256>(hc_lut, i);
+        uint8_t* fill_hi = fill_lo + 32;
+
         for (size_t j = 0; j < 16; ++j) {
             int tmp = lut[j];
             uint8_t lo = static_cast<uint8_t>(tmp);
@@ -55,67 +66,287 @@ inline void transfer_lut_hacc(const uint16_t* lut, size_t dim, uint8_t* hc_lut)
             fill_lo[j] = lo;
             fill_hi[j] = hi;
         }
-#endif
         lut += 16;
     }
 }
 
-inline void accumulate_hacc(
-    const uint8_t* __restrict__ codes,
-    const uint8_t* __restrict__ hc_lut,
-    int32_t* accu_res,
-    size_t dim
-) {
-#if defined(__AVX512BW__)
-    __m512i low_mask = _mm512_set1_epi8(0xf);
-    __m512i accu[2][4];
+// the layout of hc_lut for accumulate_hacc_scalar, lower then upper 8 bits of each sub lut
+inline void transfer_lut_hacc_scalar(const uint16_t* lut, size_t dim, uint8_t* hc_lut) {
+    size_t num_codebook = dim >> 2;
 
-    for (auto& a : accu) {
-        for (auto& reg : a) {
-            reg = _mm512_setzero_si512();
+    for (size_t i = 0; i < num_codebook; i++) {
+        for (size_t j = 0; j < 16; ++j) {
+            hc_lut[j] = static_cast<uint8_t>(lut[j]);
+            hc_lut[j + 16] = static_cast<uint8_t>(lut[j] >> 8);
         }
+        hc_lut += 32;
+        lut += 16;
     }
+}
 
-    size_t num_codebook = dim >> 2;
+/**
+ * @brief Change u16 lookup table to u8. Since we use more bits (higher accuracy)
+ * to quantize data vector by rabitq+, we also needs to increase the accuracy of data in
+ * lut.
+ * We split the higher & lower 8 bits of a u16 into two sub luts. The layout depends on
+ * the register width of accumulate_hacc, both follow simd_level().
+ **/
+inline void transfer_lut_hacc(const uint16_t* lut, size_t dim, uint8_t* hc_lut) {
+    if (simd_level() >= SimdLevel::AVX512) {
+        transfer_lut_hacc_avx512(lut, dim, hc_lut);
+    } else if (simd_level() >= SimdLevel::AVX2) {
+        transfer_lut_hacc_avx2(lut, dim, hc_lut);
+    } else {
+        transfer_lut_hacc_scalar(lut, dim, hc_lut);
+    }
+}
 
-    // std::cerr << "FastScan YES!" << std::endl;
-    for (size_t m = 0; m < num_codebook; m += 4) {
-        __m512i c = _mm512_loadu_si512(codes);
-        __m512i lo = _mm512_and_si512(c, low_mask);
-        __m512i hi = _mm512_and_si512(_mm512_srli_epi16(c, 4), low_mask);
+// entries of the sub lut of pack_lut for the 4 dims of query, entry j sums the dims of
+// its set bits, from bit 3 (query[0]) down to bit 0 (query[3])
+inline void codebook_lut_scalar(const float* query, float* sub_lut) {
+    for (size_t j = 0; j < 16; ++j) {
+        float sum = 0;
+        for (size_t k = 0; k < 4; ++k) {
+            if (((j >> (3 - k)) & 1) != 0) {
+                sum += query[k];
+            }
+        }
+        sub_lut[j] = sum;
+    }
+}
 
-        // accumulate lower & upper results respectively
-        // accu[0][0-3] for lower 8-bit result
-        // accu[1][0-3] for upper 8-bit result
-        for (auto& i : accu) {
-            __m512i lut = _mm512_loadu_si512(hc_lut);
+/**
+ * @brief Scalar reference of quantize_lut, sub luts are stored in the layout of
+ * accumulate_scalar or transfer_lut_hacc_scalar.
+ */
+inline float quantize_lut_scalar(
+    const float* query, size_t dim, bool use_hacc, uint8_t* lut, float& delta
+) {
+    size_t num_codebook = dim >> 2;
+    float sub_lut[16];
+    float lo = std::numeric_limits<float>::max();
+    float hi = std::numeric_limits<float>::lowest();
+    for (size_t i = 0; i < num_codebook; ++i) {
+        codebook_lut_scalar(query + (i * 4), sub_lut);
+        for (float v : sub_lut) {
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+        }
+    }
 
-            __m512i res_lo = _mm512_shuffle_epi8(lut, lo);
-            __m512i res_hi = _mm512_shuffle_epi8(lut, hi);
+    delta = (hi - lo) / static_cast<float>(use_hacc ? 65535 : 255);
+    float one_over_delta = 1 / delta;
+    for (size_t i = 0; i < num_codebook; ++i) {
+        codebook_lut_scalar(query + (i * 4), sub_lut);
+        for (size_t j = 0; j < 16; ++j) {
+            // round half to even, the same as the SIMD conversions
+            float scaled = (sub_lut[j] - lo) * one_over_delta;
+            auto v = static_cast<uint32_t>(std::nearbyint(scaled));
+            if (use_hacc) {
+                lut[(i * 32) + j] = static_cast<uint8_t>(v);
+                lut[(i * 32) + j + 16] = static_cast<uint8_t>(v >> 8);
+            } else {
+                lut[(i * 16) + j] = static_cast<uint8_t>(v);
+            }
+        }
+    }
+    return lo;
+}
 
-            i[0] = _mm512_add_epi16(i[0], res_lo);
-            i[1] = _mm512_add_epi16(i[1], _mm512_srli_epi16(res_lo, 8));
+// the sub lut of codebook_lut_scalar in a register, added in the same order
+RABITQ_TARGET_AVX512 inline __m512 codebook_lut_avx512(const float* query) {
+    __m512 sub_lut = _mm512_setzero_ps();
+    sub_lut = _mm512_mask_add_ps(sub_lut, 0xFF00, sub_lut, _mm512_set1_ps(query[0]));
+    sub_lut = _mm512_mask_add_ps(sub_lut, 0xF0F0, sub_lut, _mm512_set1_ps(query[1]));
+    sub_lut = _mm512_mask_add_ps(sub_lut, 0xCCCC, sub_lut, _mm512_set1_ps(query[2]));
+    sub_lut = _mm512_mask_add_ps(sub_lut, 0xAAAA, sub_lut, _mm512_set1_ps(query[3]));
+    return sub_lut;
+}
 
-            i[2] = _mm512_add_epi16(i[2], res_hi);
-            i[3] = _mm512_add_epi16(i[3], _mm512_srli_epi16(res_hi, 8));
+RABITQ_TARGET_AVX512 inline float quantize_lut_avx512(
+    const float* query, size_t dim, bool use_hacc, uint8_t* lut, float& delta
+) {
+    size_t num_codebook = dim >> 2;
+    __m512 lo_vec = _mm512_set1_ps(std::numeric_limits<float>::max());
+    __m512 hi_vec = _mm512_set1_ps(std::numeric_limits<float>::lowest());
+    for (size_t i = 0; i < num_codebook; ++i) {
+        __m512 sub_lut = codebook_lut_avx512(query + (i * 4));
+        lo_vec = _mm512_min_ps(lo_vec, sub_lut);
+        hi_vec = _mm512_max_ps(hi_vec, sub_lut);
+    }
+    float lo = _mm512_reduce_min_ps(lo_vec);
+    float hi = _mm512_reduce_max_ps(hi_vec);
+
+    delta = (hi - lo) / static_cast<float>(use_hacc ? 65535 : 255);
+    const __m512 lo512 = _mm512_set1_ps(lo);
+    const __m512 od512 = _mm512_set1_ps(1 / delta);
+    for (size_t i = 0; i < num_codebook; ++i) {
+        __m512 sub_lut = codebook_lut_avx512(query + (i * 4));
+        __m512i v = _mm512_cvtps_epi32(_mm512_mul_ps(_mm512_sub_ps(sub_lut, lo512), od512));
+        if (use_hacc) {
+            uint8_t* fill_lo = hacc_lut_slot<512>(lut, i);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(fill_lo), _mm512_cvtepi32_epi8(v));
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(fill_lo + 64),
+                _mm512_cvtepi32_epi8(_mm512_srli_epi32(v, 8))
+            );
+        } else {
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(lut + (i * 16)), _mm512_cvtepi32_epi8(v)
+            );
+        }
+    }
+    return lo;
+}
+
+// the sub lut of codebook_lut_scalar in two registers (entries 0-7 and 8-15)
+RABITQ_TARGET_AVX2 inline void codebook_lut_avx2(const float* query, __m256 (&sub_lut)[2]) {
+    // lanes of entries whose bit 2, 1 and 0 are set
+    const __m256 bit2 = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, 0, -1, -1, -1, -1));
+    const __m256 bit1 = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, -1, -1, 0, 0, -1, -1));
+    const __m256 bit0 = _mm256_castsi256_ps(_mm256_setr_epi32(0, -1, 0, -1, 0, -1, 0, -1));
+    __m256 q1 = _mm256_set1_ps(query[1]);
+    __m256 q2 = _mm256_set1_ps(query[2]);
+    __m256 q3 = _mm256_set1_ps(query[3]);
+
+    // entries 8-15 start from query[0], adding +0 to the other lanes keeps them exact
+    sub_lut[0] = _mm256_setzero_ps();
+    sub_lut[1] = _mm256_add_ps(_mm256_setzero_ps(), _mm256_set1_ps(query[0]));
+    for (auto& half : sub_lut) {
+        half = _mm256_add_ps(half, _mm256_and_ps(q1, bit2));
+        half = _mm256_add_ps(half, _mm256_and_ps(q2, bit1));
+        half = _mm256_add_ps(half, _mm256_and_ps(q3, bit0));
+    }
+}
 
-            hc_lut += 64;
+RABITQ_TARGET_AVX2 inline float quantize_lut_avx2(
+    const float* query, size_t dim, bool use_hacc, uint8_t* lut, float& delta
+) {
+    size_t num_codebook = dim >> 2;
+    __m256 lo_vec = _mm256_set1_ps(std::numeric_limits<float>::max());
+    __m256 hi_vec = _mm256_set1_ps(std::numeric_limits<float>::lowest());
+    __m256 sub_lut[2];
+    for (size_t i = 0; i < num_codebook; ++i) {
+        codebook_lut_avx2(query + (i * 4), sub_lut);
+        lo_vec = _mm256_min_ps(lo_vec, _mm256_min_ps(sub_lut[0], sub_lut[1]));
+        hi_vec = _mm256_max_ps(hi_vec, _mm256_max_ps(sub_lut[0], sub_lut[1]));
+    }
+    alignas(32) float lo_arr[8];
+    alignas(32) float hi_arr[8];
+    _mm256_store_ps(lo_arr, lo_vec);
+    _mm256_store_ps(hi_arr, hi_vec);
+    float lo = *std::min_element(lo_arr, lo_arr + 8);
+    float hi = *std::max_element(hi_arr, hi_arr + 8);
+
+    delta = (hi - lo) / static_cast<float>(use_hacc ? 65535 : 255);
+    const __m256 lo256 = _mm256_set1_ps(lo);
+    const __m256 od256 = _mm256_set1_ps(1 / delta);
+    const __m128i low_byte = _mm_set1_epi16(0xff);
+    for (size_t i = 0; i < num_codebook; ++i) {
+        codebook_lut_avx2(query + (i * 4), sub_lut);
+        __m128i u16[2];
+        for (size_t h = 0; h < 2; ++h) {
+            __m256i v =
+                _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_sub_ps(sub_lut[h], lo256), od256));
+            u16[h] =
+                _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        }
+        if (use_hacc) {
+            uint8_t* fill_lo = hacc_lut_slot<256>(lut, i);
+            __m128i lo8 = _mm_packus_epi16(
+                _mm_and_si128(u16[0], low_byte), _mm_and_si128(u16[1], low_byte)
+            );
+            __m128i hi8 =
+                _mm_packus_epi16(_mm_srli_epi16(u16[0], 8), _mm_srli_epi16(u16[1], 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(fill_lo), lo8);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(fill_lo + 32), hi8);
+        } else {
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(lut + (i * 16)), _mm_packus_epi16(u16[0], u16[1])
+            );
         }
-        codes += 64;
     }
+    return lo;
+}
 
-    // std::cerr << "FastScan YES!" << std::endl;
+/**
+ * @brief Build the lut of pack_lut for query and quantize it to 8 bits (16 bits in the
+ * layout of transfer_lut_hacc if use_hacc) straight into lut, without materializing the
+ * float or u16 tables. Sub luts are computed in registers from broadcast dims, once for
+ * their range and once to quantize them.
+ *
+ * @param lut    dim * 4 bytes (dim * 8 if use_hacc)
+ * @param delta  quantization step of the lut
+ * @return the lowest entry of the float lut
+ */
+inline float quantize_lut(
+    const float* query, size_t dim, bool use_hacc, uint8_t* lut, float& delta
+) {
+    if (simd_level() >= SimdLevel::AVX512) {
+        return quantize_lut_avx512(query, dim, use_hacc, lut, delta);
+    }
+    if (simd_level() >= SimdLevel::AVX2) {
+        return quantize_lut_avx2(query, dim, use_hacc, lut, delta);
+    }
+    return quantize_lut_scalar(query, dim, use_hacc, lut, delta);
+}
 
+/**
+ * @brief Scalar reference of accumulate_hacc with the lut of transfer_lut_hacc_scalar.
+ * Sums of the lower and upper 8 bits wrap around as u16 before they are combined, the
+ * same as the SIMD kernels.
+ */
+template <size_t kWidth = kBatchSize>
+inline void accumulate_hacc_scalar(
+    const uint8_t* __restrict__ codes,
+    const uint8_t* __restrict__ hc_lut,
+    int32_t* accu_res,
+    size_t dim
+) {
+    std::array<uint16_t, kWidth> lo_sum{};
+    std::array<uint16_t, kWidth> hi_sum{};
+
+    size_t num_codebook = dim >> 2;
+    for (size_t m = 0; m < num_codebook; m += 4) {
+        for (size_t group = 0; group < kWidth; group += kBatchSize) {
+            for (size_t k = 0; k < 4; ++k) {
+                const uint8_t* lut = hc_lut + (k * 32);
+                for (size_t j = 0; j < 16; ++j) {
+                    uint8_t code = codes[j];
+                    size_t v = group + kPerm0[j];
+                    lo_sum[v] += lut[code & 15];
+                    hi_sum[v] += lut[16 + (code & 15)];
+                    lo_sum[v + 16] += lut[code >> 4];
+                    hi_sum[v + 16] += lut[16 + (code >> 4)];
+                }
+                codes += 16;
+            }
+        }
+        hc_lut += 128;
+    }
+    for (size_t i = 0; i < kWidth; ++i) {
+        accu_res[i] =
+            static_cast<int32_t>(lo_sum[i]) + (static_cast<int32_t>(hi_sum[i]) << 8);
+    }
+}
+
+// combine the lower and upper 8-bit accumulators of a group of 32 vectors (see
+// accumulate_hacc_avx512) into 32-bit results
+RABITQ_TARGET_AVX512 inline void reduce_accu_hacc_avx512(
+    __m512i (&group)[2][4], int32_t* accu_res
+) {
     __m512i res[2];
     __m512i dis0[2];
     __m512i dis1[2];
 
     for (size_t i = 0; i < 2; ++i) {
         __m256i tmp0 = _mm256_add_epi16(
-            _mm512_castsi512_si256(accu[i][0]), _mm512_extracti64x4_epi64(accu[i][0], 1)
+            _mm512_castsi512_si256(group[i][0]),
+            _mm512_extracti64x4_epi64(group[i][0], 1)
         );
         __m256i tmp1 = _mm256_add_epi16(
-            _mm512_castsi512_si256(accu[i][1]), _mm512_extracti64x4_epi64(accu[i][1], 1)
+            _mm512_castsi512_si256(group[i][1]),
+            _mm512_extracti64x4_epi64(group[i][1], 1)
         );
         tmp0 = _mm256_sub_epi16(tmp0, _mm256_slli_epi16(tmp1, 8));
 
@@ -125,10 +356,12 @@ inline void accumulate_hacc(
         );
 
         __m256i tmp2 = _mm256_add_epi16(
-            _mm512_castsi512_si256(accu[i][2]), _mm512_extracti64x4_epi64(accu[i][2], 1)
+            _mm512_castsi512_si256(group[i][2]),
+            _mm512_extracti64x4_epi64(group[i][2], 1)
         );
         __m256i tmp3 = _mm256_add_epi16(
-            _mm512_castsi512_si256(accu[i][3]), _mm512_extracti64x4_epi64(accu[i][3], 1)
+            _mm512_castsi512_si256(group[i][3]),
+            _mm512_extracti64x4_epi64(group[i][3], 1)
         );
         tmp2 = _mm256_sub_epi16(tmp2, _mm256_slli_epi16(tmp3, 8));
 
@@ -138,85 +371,262 @@ inline void accumulate_hacc(
         );
     }
     // shift res of high, add res of low
-    res[0] =
-        _mm512_add_epi32(dis0[0], _mm512_slli_epi32(dis0[1], 8));  // res for vec 0 to 15
-    res[1] =
-        _mm512_add_epi32(dis1[0], _mm512_slli_epi32(dis1[1], 8));  // res for vec 16 to 31
+    res[0] = _mm512_add_epi32(dis0[0], _mm512_slli_epi32(dis0[1], 8));  // vec 0 to 15
+    res[1] = _mm512_add_epi32(dis1[0], _mm512_slli_epi32(dis1[1], 8));  // vec 16 to 31
 
     _mm512_storeu_epi32(accu_res, res[0]);
     _mm512_storeu_epi32(accu_res + 16, res[1]);
-#elif defined(__AVX2__)
-    __m256i low_mask = _mm256_set1_epi8(0xf);
-    __m256i accu[2][4];
+}
+
+template <size_t kWidth = kBatchSize>
+RABITQ_TARGET_AVX512 inline void accumulate_hacc_avx512(
+    const uint8_t* __restrict__ codes,
+    const uint8_t* __restrict__ hc_lut,
+    int32_t* accu_res,
+    size_t dim
+) {
+    constexpr size_t kGroups = kWidth / kBatchSize;
+    __m512i low_mask = _mm512_set1_epi8(0xf);
+    __m512i accu[kGroups][2][4];
 
-    for (auto& a : accu) {
-        for (auto& reg : a) {
-            reg = _mm256_setzero_si256();
+    for (auto& group : accu) {
+        for (auto& a : group) {
+            for (auto& reg : a) {
+                reg = _mm512_setzero_si512();
+            }
         }
     }
 
     size_t num_codebook = dim >> 2;
 
-    for (size_t m = 0; m < num_codebook; m += 2) {
-        __m256i c = _mm256_loadu_si256((__m256i*)codes);
-        codes += 32;
+    for (size_t m = 0; m < num_codebook; m += 4) {
+        // the sub luts of 4 codebooks are shared by all groups
+        const __m512i luts[2] = {
+            _mm512_loadu_si512(hc_lut), _mm512_loadu_si512(hc_lut + 64)
+        };
+        hc_lut += 128;
+
+        for (auto& group : accu) {
+            __m512i c = _mm512_loadu_si512(codes);
+            __m512i lo = _mm512_and_si512(c, low_mask);
+            __m512i hi = _mm512_and_si512(_mm512_srli_epi16(c, 4), low_mask);
+            codes += 64;
+
+            // accumulate lower & upper results respectively
+            // group[0][0-3] for lower 8-bit result
+            // group[1][0-3] for upper 8-bit result
+            for (size_t i = 0; i < 2; ++i) {
+                __m512i res_lo = _mm512_shuffle_epi8(luts[i], lo);
+                __m512i res_hi = _mm512_shuffle_epi8(luts[i], hi);
+
+                group[i][0] = _mm512_add_epi16(group[i][0], res_lo);
+                group[i][1] = _mm512_add_epi16(group[i][1], _mm512_srli_epi16(res_lo, 8));
+
+                group[i][2] = _mm512_add_epi16(group[i][2], res_hi);
+                group[i][3] = _mm512_add_epi16(group[i][3], _mm512_srli_epi16(res_hi, 8));
+            }
+        }
+    }
+
+    for (auto& group : accu) {
+        reduce_accu_hacc_avx512(group, accu_res);
+        accu_res += kBatchSize;
+    }
+}
+
+// horizontal sum of a and b, combining low/high bytes
+RABITQ_TARGET_AVX2 inline __m256i combine2x2_avx2(__m256i a, __m256i b) {
+    __m256i a1b0 = _mm256_permute2f128_si256(a, b, 0x21);
+    __m256i a0b1 = _mm256_blend_epi32(a, b, 0xF0);
+    return _mm256_add_epi16(a1b0, a0b1);
+}
 
-        __m256i lo = _mm256_and_si256(c, low_mask);
-        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(c, 4), low_mask);
+// widen a and b to u32, r = a + (b << 8)
+RABITQ_TARGET_AVX2 inline void add_shiftl8_avx2(
+    __m256i a, __m256i b, __m256i& r0, __m256i& r1
+) {
+    __m256i a0 = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(a));
+    __m256i a1 = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(a, 1));
+    __m256i b0 = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(b));
+    __m256i b1 = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(b, 1));
+    r0 = _mm256_add_epi32(a0, _mm256_slli_epi32(b0, 8));
+    r1 = _mm256_add_epi32(a1, _mm256_slli_epi32(b1, 8));
+}
+
+template <size_t kWidth = kBatchSize>
+RABITQ_TARGET_AVX2 inline void accumulate_hacc_avx2(
+    const uint8_t* __restrict__ codes,
+    const uint8_t* __restrict__ hc_lut,
+    int32_t* accu_res,
+    size_t dim
+) {
+    constexpr size_t kGroups = kWidth / kBatchSize;
+    __m256i low_mask = _mm256_set1_epi8(0xf);
+    __m256i accu[kGroups][2][4];
 
-        for (int q = 0; q < 2; ++q) {
-            __m256i lut = _mm256_loadu_si256((__m256i*)hc_lut);
-            hc_lut += 32;
+    for (auto& group : accu) {
+        for (auto& a : group) {
+            for (auto& reg : a) {
+                reg = _mm256_setzero_si256();
+            }
+        }
+    }
 
-            __m256i res_lo = _mm256_shuffle_epi8(lut, lo);
-            __m256i res_hi = _mm256_shuffle_epi8(lut, hi);
+    size_t num_codebook = dim >> 2;
 
-            accu[q][0] = _mm256_add_epi16(accu[q][0], res_lo);
-            accu[q][1] = _mm256_add_epi16(accu[q][1], _mm256_srli_epi16(res_lo, 8));
-            accu[q][2] = _mm256_add_epi16(accu[q][2], res_hi);
-            accu[q][3] = _mm256_add_epi16(accu[q][3], _mm256_srli_epi16(res_hi, 8));
+    for (size_t m = 0; m < num_codebook; m += 4) {
+        // the sub luts of 4 codebooks (2 per register) are shared by all groups
+        const __m256i luts[2][2] = {
+            {_mm256_loadu_si256((__m256i*)hc_lut),
+             _mm256_loadu_si256((__m256i*)(hc_lut + 32))},
+            {_mm256_loadu_si256((__m256i*)(hc_lut + 64)),
+             _mm256_loadu_si256((__m256i*)(hc_lut + 96))}
+        };
+        hc_lut += 128;
+
+        for (auto& group : accu) {
+            for (const auto& lut_pair : luts) {
+                __m256i c = _mm256_loadu_si256((__m256i*)codes);
+                codes += 32;
+
+                __m256i lo = _mm256_and_si256(c, low_mask);
+                __m256i hi = _mm256_and_si256(_mm256_srli_epi16(c, 4), low_mask);
+
+                for (int q = 0; q < 2; ++q) {
+                    __m256i res_lo = _mm256_shuffle_epi8(lut_pair[q], lo);
+                    __m256i res_hi = _mm256_shuffle_epi8(lut_pair[q], hi);
+
+                    auto& a = group[q];
+                    a[0] = _mm256_add_epi16(a[0], res_lo);
+                    a[1] = _mm256_add_epi16(a[1], _mm256_srli_epi16(res_lo, 8));
+                    a[2] = _mm256_add_epi16(a[2], res_hi);
+                    a[3] = _mm256_add_epi16(a[3], _mm256_srli_epi16(res_hi, 8));
+                }
+            }
         }
     }
 
-    __m256i res[4];
-    __m256i dis0[2];
-    __m256i dis1[2];
+    for (auto& group : accu) {
+        __m256i res[4];
+        __m256i dis0[2];
+        __m256i dis1[2];
 
-    // lamda function to horizontal sum and combine low/high bytes
-    auto combine2x2 = [&](__m256i a, __m256i b) -> __m256i {
-        __m256i a1b0 = _mm256_permute2f128_si256(a, b, 0x21);
-        __m256i a0b1 = _mm256_blend_epi32(a, b, 0xF0);
-        return _mm256_add_epi16(a1b0, a0b1);
-    };
+        for (size_t i = 0; i < 2; i++) {
+            group[i][0] = _mm256_sub_epi16(group[i][0], _mm256_slli_epi16(group[i][1], 8));
+            dis0[i] = combine2x2_avx2(group[i][0], group[i][1]);
 
-    for (size_t i = 0; i < 2; i++) {
-        accu[i][0] = _mm256_sub_epi16(accu[i][0], _mm256_slli_epi16(accu[i][1], 8));
-        dis0[i] = combine2x2(accu[i][0], accu[i][1]);
+            group[i][2] = _mm256_sub_epi16(group[i][2], _mm256_slli_epi16(group[i][3], 8));
+            dis1[i] = combine2x2_avx2(group[i][2], group[i][3]);
+        }
 
-        accu[i][2] = _mm256_sub_epi16(accu[i][2], _mm256_slli_epi16(accu[i][3], 8));
-        dis1[i] = combine2x2(accu[i][2], accu[i][3]);
+        // shift res of high, add res of low
+        add_shiftl8_avx2(dis0[0], dis0[1], res[0], res[1]);  // res for vec 0 to 15
+        add_shiftl8_avx2(dis1[0], dis1[1], res[2], res[3]);  // res for vec 16 to 31
+
+        _mm256_storeu_si256((__m256i*)(accu_res), res[0]);
+        _mm256_storeu_si256((__m256i*)(accu_res + 8), res[1]);
+        _mm256_storeu_si256((__m256i*)(accu_res + 16), res[2]);
+        _mm256_storeu_si256((__m256i*)(accu_res + 24), res[3]);
+        accu_res += kBatchSize;
+    }
+}
+
+// accumulate one block of kWidth vectors with the lut from transfer_lut_hacc,
+// dim % 16 == 0
+template <size_t kWidth = kBatchSize>
+inline void accumulate_hacc(
+    const uint8_t* __restrict__ codes,
+    const uint8_t* __restrict__ hc_lut,
+    int32_t* accu_res,
+    size_t dim
+) {
+    if (simd_level() >= SimdLevel::AVX512) {
+        accumulate_hacc_avx512<kWidth>(codes, hc_lut, accu_res, dim);
+    } else if (simd_level() >= SimdLevel::AVX2) {
+        accumulate_hacc_avx2<kWidth>(codes, hc_lut, accu_res, dim);
+    } else {
+        accumulate_hacc_scalar<kWidth>(codes, hc_lut, accu_res, dim);
     }
+}
 
-    auto add_shiftl8 = [&](__m256i a, __m256i b, __m256i& r0, __m256i& r1) {
-        __m256i a0 = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(a));
-        __m256i a1 = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(a, 1));
-        __m256i b0 = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(b));
-        __m256i b1 = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(b, 1));
-        r0 = _mm256_add_epi32(a0, _mm256_slli_epi32(b0, 8));
-        r1 = _mm256_add_epi32(a1, _mm256_slli_epi32(b1, 8));
-    };
+// queries scanned together by accumulate_hacc_multi, each query takes 8 accumulators
+constexpr static size_t kMultiQueriesHacc = 2;
 
-    // shift res of high, add res of low
-    add_shiftl8(dis0[0], dis0[1], res[0], res[1]);  // res for vec 0 to 15
-    add_shiftl8(dis1[0], dis1[1], res[2], res[3]);  // res for vec 16 to 31
-
-    _mm256_storeu_si256((__m256i*)(accu_res), res[0]);
-    _mm256_storeu_si256((__m256i*)(accu_res + 8), res[1]);
-    _mm256_storeu_si256((__m256i*)(accu_res + 16), res[2]);
-    _mm256_storeu_si256((__m256i*)(accu_res + 24), res[3]);
-#else
-    std::cerr << "AVX512 or AVX2 required for using fastscan\n";
-    exit(1);
-#endif
+// accumulate_hacc of one block of 32 vectors for kQueries luts, see accumulate_multi_avx512
+template <size_t kQueries>
+RABITQ_TARGET_AVX512 inline void accumulate_hacc_multi_avx512(
+    const uint8_t* __restrict__ codes,
+    const uint8_t* const* hc_luts,
+    int32_t* accu_res,
+    size_t dim
+) {
+    __m512i low_mask = _mm512_set1_epi8(0xf);
+    __m512i accu[kQueries][2][4];
+    for (auto& group : accu) {
+        for (auto& a : group) {
+            for (auto& reg : a) {
+                reg = _mm512_setzero_si512();
+            }
+        }
+    }
+
+    size_t code_length = dim << 2;
+    for (size_t i = 0; i < code_length; i += kBlockBytes) {
+        __m512i c = _mm512_loadu_si512(&codes[i]);
+        __m512i lo = _mm512_and_si512(c, low_mask);
+        __m512i hi = _mm512_and_si512(_mm512_srli_epi16(c, 4), low_mask);
+
+        for (size_t q = 0; q < kQueries; ++q) {
+            // the hc_lut takes 128 bytes per 64 bytes of codes
+            const uint8_t* hc_lut = hc_luts[q] + (i << 1);
+            for (size_t j = 0; j < 2; ++j) {
+                __m512i lut = _mm512_loadu_si512(hc_lut + (j * 64));
+                __m512i res_lo = _mm512_shuffle_epi8(lut, lo);
+                __m512i res_hi = _mm512_shuffle_epi8(lut, hi);
+
+                auto& a = accu[q][j];
+                a[0] = _mm512_add_epi16(a[0], res_lo);
+                a[1] = _mm512_add_epi16(a[1], _mm512_srli_epi16(res_lo, 8));
+                a[2] = _mm512_add_epi16(a[2], res_hi);
+                a[3] = _mm512_add_epi16(a[3], _mm512_srli_epi16(res_hi, 8));
+            }
+        }
+    }
+
+    for (auto& group : accu) {
+        reduce_accu_hacc_avx512(group, accu_res);
+        accu_res += kBatchSize;
+    }
+}
+
+/**
+ * @brief accumulate_hacc of one block of 32 vectors for num_queries luts from
+ * transfer_lut_hacc, see accumulate_multi
+ *
+ * @param accu_res num_queries rows of kBatchSize results
+ */
+inline void accumulate_hacc_multi(
+    const uint8_t* __restrict__ codes,
+    const uint8_t* const* hc_luts,
+    size_t num_queries,
+    int32_t* accu_res,
+    size_t dim
+) {
+    if (simd_level() < SimdLevel::AVX512) {
+        for (size_t q = 0; q < num_queries; ++q) {
+            accumulate_hacc(codes, hc_luts[q], accu_res + (q * kBatchSize), dim);
+        }
+        return;
+    }
+
+    size_t q = 0;
+    for (; q + kMultiQueriesHacc <= num_queries; q += kMultiQueriesHacc) {
+        accumulate_hacc_multi_avx512<kMultiQueriesHacc>(
+            codes, hc_luts + q, accu_res + (q * kBatchSize), dim
+        );
+    }
+    if (q < num_queries) {
+        accumulate_hacc_avx512(codes, hc_luts[q], accu_res + (q * kBatchSize), dim);
+    }
 }
 }  // namespace rabitqlib::fastscan
\ No newline at end of file
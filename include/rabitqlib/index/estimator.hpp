@@ -1,16 +1,300 @@
 #pragma once
 
+#include <immintrin.h>
+
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <limits>
+#include <type_traits>
 
 #include "rabitqlib/defines.hpp"
 #include "rabitqlib/fastscan/fastscan.hpp"
 #include "rabitqlib/fastscan/highacc_fastscan.hpp"
 #include "rabitqlib/index/query.hpp"
 #include "rabitqlib/quantization/data_layout.hpp"
+#include "rabitqlib/utils/cpu_features.hpp"
 #include "rabitqlib/utils/space.hpp"
 #include "rabitqlib/utils/warmup_space.hpp"
 
 namespace rabitqlib {
+// per-query constants of the epilogue turning FastScan accumulators into distances
+struct EstdistConsts {
+    float delta;       // accumulator -> inner product scale
+    float sum_vl_lut;  // accumulator -> inner product offset
+    float k1xsumq;
+    float g_add;
+    float g_error;
+};
+
+/**
+ * @brief Fused epilogue of batch estimation. For num vectors,
+ *      ip_x0_qr = delta * accu + sum_vl_lut
+ *      est = f_add + g_add + f_rescale * (ip_x0_qr + k1xsumq)
+ *      low = est - f_error * g_error
+ * ip_x0_qr, f_error and low_distance may be null (nothing to store, no lower bound).
+ *
+ * @return bit i is set if the lower bound (or est without one) of vector i is below
+ * threshold, num <= 64
+ */
+template <typename TA>
+inline uint64_t fused_estdist_scalar(
+    const TA* accu,
+    const float* f_add,
+    const float* f_rescale,
+    const float* f_error,
+    size_t num,
+    const EstdistConsts& consts,
+    float threshold,
+    float* est_distance,
+    float* low_distance,
+    float* ip_x0_qr
+) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < num; ++i) {
+        float ip = (consts.delta * static_cast<float>(accu[i])) + consts.sum_vl_lut;
+        float est = f_add[i] + consts.g_add + (f_rescale[i] * (ip + consts.k1xsumq));
+        float low = f_error == nullptr ? est : est - (f_error[i] * consts.g_error);
+        if (ip_x0_qr != nullptr) {
+            ip_x0_qr[i] = ip;
+        }
+        est_distance[i] = est;
+        if (low_distance != nullptr) {
+            low_distance[i] = low;
+        }
+        mask |= static_cast<uint64_t>(low < threshold) << i;
+    }
+    return mask;
+}
+
+template <typename TA>
+RABITQ_TARGET_AVX512 inline __m512 load_accu_avx512(const TA* accu) {
+    if constexpr (sizeof(TA) == 2) {
+        __m256i accu16 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(accu));
+        return _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(accu16));
+    } else {
+        return _mm512_cvtepi32_ps(_mm512_loadu_si512(accu));
+    }
+}
+
+template <typename TA>
+RABITQ_TARGET_AVX512 inline uint64_t fused_estdist_avx512(
+    const TA* accu,
+    const float* f_add,
+    const float* f_rescale,
+    const float* f_error,
+    size_t num,
+    const EstdistConsts& consts,
+    float threshold,
+    float* est_distance,
+    float* low_distance,
+    float* ip_x0_qr
+) {
+    const __m512 delta = _mm512_set1_ps(consts.delta);
+    const __m512 sum_vl = _mm512_set1_ps(consts.sum_vl_lut);
+    const __m512 k1xsumq = _mm512_set1_ps(consts.k1xsumq);
+    const __m512 g_add = _mm512_set1_ps(consts.g_add);
+    const __m512 g_error = _mm512_set1_ps(consts.g_error);
+    const __m512 thres = _mm512_set1_ps(threshold);
+
+    uint64_t mask = 0;
+    size_t i = 0;
+    for (; i + 16 <= num; i += 16) {
+        __m512 ip = _mm512_fmadd_ps(delta, load_accu_avx512(accu + i), sum_vl);
+        __m512 est = _mm512_fmadd_ps(
+            _mm512_loadu_ps(f_rescale + i),
+            _mm512_add_ps(ip, k1xsumq),
+            _mm512_add_ps(_mm512_loadu_ps(f_add + i), g_add)
+        );
+        __m512 low = est;
+        if (f_error != nullptr) {
+            low = _mm512_fnmadd_ps(_mm512_loadu_ps(f_error + i), g_error, est);
+        }
+        if (ip_x0_qr != nullptr) {
+            _mm512_storeu_ps(ip_x0_qr + i, ip);
+        }
+        _mm512_storeu_ps(est_distance + i, est);
+        if (low_distance != nullptr) {
+            _mm512_storeu_ps(low_distance + i, low);
+        }
+        mask |= static_cast<uint64_t>(_mm512_cmp_ps_mask(low, thres, _CMP_LT_OQ)) << i;
+    }
+    if (i < num) {
+        mask |= fused_estdist_scalar(
+                    accu + i,
+                    f_add + i,
+                    f_rescale + i,
+                    f_error == nullptr ? nullptr : f_error + i,
+                    num - i,
+                    consts,
+                    threshold,
+                    est_distance + i,
+                    low_distance == nullptr ? nullptr : low_distance + i,
+                    ip_x0_qr == nullptr ? nullptr : ip_x0_qr + i
+                )
+                << i;
+    }
+    return mask;
+}
+
+template <typename TA>
+RABITQ_TARGET_AVX2 inline __m256 load_accu_avx2(const TA* accu) {
+    if constexpr (sizeof(TA) == 2) {
+        __m128i accu16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(accu));
+        return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(accu16));
+    } else {
+        __m256i accu32 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(accu));
+        return _mm256_cvtepi32_ps(accu32);
+    }
+}
+
+template <typename TA>
+RABITQ_TARGET_AVX2 inline uint64_t fused_estdist_avx2(
+    const TA* accu,
+    const float* f_add,
+    const float* f_rescale,
+    const float* f_error,
+    size_t num,
+    const EstdistConsts& consts,
+    float threshold,
+    float* est_distance,
+    float* low_distance,
+    float* ip_x0_qr
+) {
+    const __m256 delta = _mm256_set1_ps(consts.delta);
+    const __m256 sum_vl = _mm256_set1_ps(consts.sum_vl_lut);
+    const __m256 k1xsumq = _mm256_set1_ps(consts.k1xsumq);
+    const __m256 g_add = _mm256_set1_ps(consts.g_add);
+    const __m256 g_error = _mm256_set1_ps(consts.g_error);
+    const __m256 thres = _mm256_set1_ps(threshold);
+
+    uint64_t mask = 0;
+    size_t i = 0;
+    for (; i + 8 <= num; i += 8) {
+        __m256 ip = _mm256_fmadd_ps(delta, load_accu_avx2(accu + i), sum_vl);
+        __m256 est = _mm256_fmadd_ps(
+            _mm256_loadu_ps(f_rescale + i),
+            _mm256_add_ps(ip, k1xsumq),
+            _mm256_add_ps(_mm256_loadu_ps(f_add + i), g_add)
+        );
+        __m256 low = est;
+        if (f_error != nullptr) {
+            low = _mm256_fnmadd_ps(_mm256_loadu_ps(f_error + i), g_error, est);
+        }
+        if (ip_x0_qr != nullptr) {
+            _mm256_storeu_ps(ip_x0_qr + i, ip);
+        }
+        _mm256_storeu_ps(est_distance + i, est);
+        if (low_distance != nullptr) {
+            _mm256_storeu_ps(low_distance + i, low);
+        }
+        auto lt = static_cast<uint32_t>(
+            _mm256_movemask_ps(_mm256_cmp_ps(low, thres, _CMP_LT_OQ))
+        );
+        mask |= static_cast<uint64_t>(lt) << i;
+    }
+    if (i < num) {
+        mask |= fused_estdist_scalar(
+                    accu + i,
+                    f_add + i,
+                    f_rescale + i,
+                    f_error == nullptr ? nullptr : f_error + i,
+                    num - i,
+                    consts,
+                    threshold,
+                    est_distance + i,
+                    low_distance == nullptr ? nullptr : low_distance + i,
+                    ip_x0_qr == nullptr ? nullptr : ip_x0_qr + i
+                )
+                << i;
+    }
+    return mask;
+}
+
+template <typename TA>
+inline uint64_t fused_estdist(
+    const TA* accu,
+    const float* f_add,
+    const float* f_rescale,
+    const float* f_error,
+    size_t num,
+    const EstdistConsts& consts,
+    float threshold,
+    float* est_distance,
+    float* low_distance,
+    float* ip_x0_qr
+) {
+    if (simd_level() >= SimdLevel::AVX512) {
+        return fused_estdist_avx512(
+            accu,
+            f_add,
+            f_rescale,
+            f_error,
+            num,
+            consts,
+            threshold,
+            est_distance,
+            low_distance,
+            ip_x0_qr
+        );
+    }
+    if (simd_level() >= SimdLevel::AVX2) {
+        return fused_estdist_avx2(
+            accu,
+            f_add,
+            f_rescale,
+            f_error,
+            num,
+            consts,
+            threshold,
+            est_distance,
+            low_distance,
+            ip_x0_qr
+        );
+    }
+    return fused_estdist_scalar(
+        accu,
+        f_add,
+        f_rescale,
+        f_error,
+        num,
+        consts,
+        threshold,
+        est_distance,
+        low_distance,
+        ip_x0_qr
+    );
+}
+
+// estimated distances of a batch from the inner products accumulated by FastScan, see
+// fused_estdist for the returned candidate mask
+template <size_t kWidth, typename TA = int32_t>
+inline uint64_t split_batch_estdist_from_accu(
+    const ConstBatchDataMap<float, kWidth>& cur_batch,
+    const SplitBatchQuery<float>& q_obj,
+    const TA* accu,
+    float* est_distance,
+    float* low_distance,
+    float* ip_x0_qr,
+    float threshold = std::numeric_limits<float>::infinity()
+) {
+    EstdistConsts consts{
+        q_obj.delta(), q_obj.sum_vl_lut(), q_obj.k1xsumq(), q_obj.g_add(), q_obj.g_error()
+    };
+    return fused_estdist(
+        accu,
+        cur_batch.f_add(),
+        cur_batch.f_rescale(),
+        cur_batch.f_error(),
+        kWidth,
+        consts,
+        threshold,
+        est_distance,
+        low_distance,
+        ip_x0_qr
+    );
+}
+
 /**
  * @brief Use FastScan to estimate batch distance
  *
@@ -21,79 +305,152 @@ namespace rabitqlib {
  * @param low_distance lower bound of distance
  * @param ip_x0_qr  intermediate result for re-ranking
  * @param use_hacc  if use high accuracy fastscan
+ * @param threshold distance threshold of candidates, e.g., the current k-th distance
+ * @tparam kWidth   vectors per batch, the output arrays hold kWidth values
+ * @return bit i is set if low_distance[i] < threshold
  */
-inline void split_batch_estdist(
+template <size_t kWidth = fastscan::kBatchSize>
+inline uint64_t split_batch_estdist(
     const char* batch_data,
     const SplitBatchQuery<float>& q_obj,
     size_t padded_dim,
     float* est_distance,
     float* low_distance,
     float* ip_x0_qr,
-    bool use_hacc
+    bool use_hacc,
+    float threshold = std::numeric_limits<float>::infinity()
 ) {
     constexpr size_t kSafeChunkDim = 1024;
-    ConstBatchDataMap<float> cur_batch(batch_data, padded_dim);
-    RowMajorArray<int32_t> accu_arr(1, fastscan::kBatchSize);
+    ConstBatchDataMap<float, kWidth> cur_batch(batch_data, padded_dim);
     const auto* codes_ptr = cur_batch.bin_code();
     const auto* lut_ptr = q_obj.lut();
-    for (size_t i = 0; i < fastscan::kBatchSize; ++i) {
-        accu_arr.data()[i] = 0;
-    }
 
+    // all on the stack, and no chunking (nor summing of chunks) for common dims
     if (use_hacc) {
-        std::array<int32_t, fastscan::kBatchSize> accu_res;
-        size_t remaining_dim = padded_dim;
-
-        while (remaining_dim > kSafeChunkDim) {
-            fastscan::accumulate_hacc(codes_ptr, lut_ptr, accu_res.data(), kSafeChunkDim);
-            codes_ptr += kSafeChunkDim << 2;
-            lut_ptr += kSafeChunkDim << 3;
-            for (size_t i = 0; i < fastscan::kBatchSize; ++i) {
-                accu_arr.data()[i] += accu_res[i];
+        std::array<int32_t, kWidth> accu;
+        if (padded_dim <= kSafeChunkDim) {
+            fastscan::accumulate_hacc<kWidth>(codes_ptr, lut_ptr, accu.data(), padded_dim);
+        } else {
+            std::array<int32_t, kWidth> accu_res;
+            accu.fill(0);
+            for (size_t remaining_dim = padded_dim; remaining_dim > 0;) {
+                size_t chunk_dim = std::min(remaining_dim, kSafeChunkDim);
+                fastscan::accumulate_hacc<kWidth>(
+                    codes_ptr, lut_ptr, accu_res.data(), chunk_dim
+                );
+                codes_ptr += chunk_dim * kWidth / 8;
+                lut_ptr += chunk_dim << 3;
+                for (size_t i = 0; i < kWidth; ++i) {
+                    accu[i] += accu_res[i];
+                }
+                remaining_dim -= chunk_dim;
             }
-            remaining_dim -= kSafeChunkDim;
-        }
-
-        fastscan::accumulate_hacc(codes_ptr, lut_ptr, accu_res.data(), remaining_dim);
-        for (size_t i = 0; i < fastscan::kBatchSize; ++i) {
-            accu_arr.data()[i] += accu_res[i];
         }
-    } else {
-        std::array<uint16_t, fastscan::kBatchSize> accu_res;
-        size_t remaining_dim = padded_dim;
+        return split_batch_estdist_from_accu<kWidth>(
+            cur_batch, q_obj, accu.data(), est_distance, low_distance, ip_x0_qr, threshold
+        );
+    }
 
-        while (remaining_dim > kSafeChunkDim) {
-            fastscan::accumulate(codes_ptr, lut_ptr, accu_res.data(), kSafeChunkDim);
-            codes_ptr += kSafeChunkDim << 2;
-            lut_ptr += kSafeChunkDim << 2;
-            for (size_t i = 0; i < fastscan::kBatchSize; ++i) {
-                accu_arr.data()[i] += accu_res[i];
-            }
-            remaining_dim -= kSafeChunkDim;
-        }
+    std::array<uint16_t, kWidth> accu_res;
+    if (padded_dim <= kSafeChunkDim) {
+        fastscan::accumulate<kWidth>(codes_ptr, lut_ptr, accu_res.data(), padded_dim);
+        return split_batch_estdist_from_accu<kWidth>(
+            cur_batch,
+            q_obj,
+            accu_res.data(),
+            est_distance,
+            low_distance,
+            ip_x0_qr,
+            threshold
+        );
+    }
 
-        fastscan::accumulate(codes_ptr, lut_ptr, accu_res.data(), remaining_dim);
-        for (size_t i = 0; i < fastscan::kBatchSize; ++i) {
-            accu_arr.data()[i] += accu_res[i];
+    std::array<int32_t, kWidth> accu{};
+    for (size_t remaining_dim = padded_dim; remaining_dim > 0;) {
+        size_t chunk_dim = std::min(remaining_dim, kSafeChunkDim);
+        fastscan::accumulate<kWidth>(codes_ptr, lut_ptr, accu_res.data(), chunk_dim);
+        codes_ptr += chunk_dim * kWidth / 8;
+        lut_ptr += chunk_dim << 2;
+        for (size_t i = 0; i < kWidth; ++i) {
+            accu[i] += accu_res[i];
         }
+        remaining_dim -= chunk_dim;
     }
-
-    ConstRowMajorArrayMap<float> f_add_arr(cur_batch.f_add(), 1, fastscan::kBatchSize);
-    ConstRowMajorArrayMap<float> f_rescale_arr(
-        cur_batch.f_rescale(), 1, fastscan::kBatchSize
+    return split_batch_estdist_from_accu<kWidth>(
+        cur_batch, q_obj, accu.data(), est_distance, low_distance, ip_x0_qr, threshold
     );
-    ConstRowMajorArrayMap<float> f_error_arr(cur_batch.f_error(), 1, fastscan::kBatchSize);
+}
 
-    RowMajorArrayMap<float> est_dist_arr(est_distance, 1, fastscan::kBatchSize);
-    RowMajorArrayMap<float> ip_x0_qr_arr(ip_x0_qr, 1, fastscan::kBatchSize);
-    RowMajorArrayMap<float> low_dist_arr(low_distance, 1, fastscan::kBatchSize);
+/**
+ * @brief FastScan for several queries on the same batch, e.g., queries probing the same
+ * cluster. Codes are loaded once per group of queries (see fastscan::accumulate_multi),
+ * results are the same as split_batch_estdist per query.
+ *
+ * @param q_objs  num_queries query objects, all with or all without hacc luts
+ * @param est_distance, low_distance, ip_x0_qr  num_queries rows of kBatchSize results
+ */
+inline void split_batch_estdist_multi(
+    const char* batch_data,
+    const SplitBatchQuery<float>* const* q_objs,
+    size_t num_queries,
+    size_t padded_dim,
+    float* est_distance,
+    float* low_distance,
+    float* ip_x0_qr,
+    bool use_hacc
+) {
+    constexpr size_t kSafeChunkDim = 1024;
+    constexpr size_t kQueries = fastscan::kMultiQueries;
+    ConstBatchDataMap<float> cur_batch(batch_data, padded_dim);
 
-    ip_x0_qr_arr = q_obj.delta() * (accu_arr.template cast<float>()) + q_obj.sum_vl_lut();
+    for (size_t q0 = 0; q0 < num_queries; q0 += kQueries) {
+        size_t nq = std::min(kQueries, num_queries - q0);
+        std::array<const uint8_t*, kQueries> lut_ptrs;
+        std::array<int32_t, kQueries * fastscan::kBatchSize> accu{};
+        for (size_t q = 0; q < nq; ++q) {
+            lut_ptrs[q] = q_objs[q0 + q]->lut();
+        }
 
-    est_dist_arr =
-        f_add_arr + q_obj.g_add() + f_rescale_arr * (ip_x0_qr_arr + q_obj.k1xsumq());
+        const auto* codes_ptr = cur_batch.bin_code();
+        size_t remaining_dim = padded_dim;
+        while (remaining_dim > 0) {
+            size_t chunk_dim = std::min(remaining_dim, kSafeChunkDim);
+            if (use_hacc) {
+                std::array<int32_t, kQueries * fastscan::kBatchSize> accu_res;
+                fastscan::accumulate_hacc_multi(
+                    codes_ptr, lut_ptrs.data(), nq, accu_res.data(), chunk_dim
+                );
+                for (size_t i = 0; i < nq * fastscan::kBatchSize; ++i) {
+                    accu[i] += accu_res[i];
+                }
+            } else {
+                std::array<uint16_t, kQueries * fastscan::kBatchSize> accu_res;
+                fastscan::accumulate_multi(
+                    codes_ptr, lut_ptrs.data(), nq, accu_res.data(), chunk_dim
+                );
+                for (size_t i = 0; i < nq * fastscan::kBatchSize; ++i) {
+                    accu[i] += accu_res[i];
+                }
+            }
+            codes_ptr += chunk_dim * fastscan::kBatchSize / 8;
+            for (size_t q = 0; q < nq; ++q) {
+                lut_ptrs[q] += use_hacc ? (chunk_dim << 3) : (chunk_dim << 2);
+            }
+            remaining_dim -= chunk_dim;
+        }
 
-    low_dist_arr = est_dist_arr - f_error_arr * q_obj.g_error();
+        for (size_t q = 0; q < nq; ++q) {
+            size_t offset = (q0 + q) * fastscan::kBatchSize;
+            split_batch_estdist_from_accu<fastscan::kBatchSize>(
+                cur_batch,
+                *q_objs[q0 + q],
+                accu.data() + (q * fastscan::kBatchSize),
+                est_distance + offset,
+                low_distance + offset,
+                ip_x0_qr + offset
+            );
+        }
+    }
 }
 
 /**
@@ -123,31 +480,63 @@ inline float split_distance_boosting(
         cur_ex.f_add_ex() + q_obj.g_add() +
         (cur_ex.f_rescale_ex() *
          (static_cast<float>(1 << ex_bits) * ip_x0_qr +
-          ip_func_(q_obj.rotated_query(), cur_ex.ex_code(), padded_dim) + q_obj.kbxsumq()));
+          q_obj.ex_ip(ip_func_, cur_ex.ex_code(), padded_dim) + q_obj.kbxsumq()));
 
     return ex_dist;
 }
 
 /**
- * @brief Batch distance estimation for qg. Here, we do not need intermediate results and
- * lower bound
+ * @brief Batch distance estimation for qg. Here, we do not need lower bound. The
+ * intermediate results are only needed if neighbors have ex-bits codes.
  */
 template <typename T, typename TA = uint16_t>
 inline void qg_batch_estdist(
-    const char* batch_data, const BatchQuery<T>& q_obj, size_t padded_dim, T* est_distance
+    const char* batch_data,
+    const BatchQuery<T>& q_obj,
+    size_t padded_dim,
+    T* est_distance,
+    T* ip_x0_qr = nullptr
 ) {
-    std::vector<TA> accu_res(fastscan::kBatchSize);
+    std::array<TA, fastscan::kBatchSize> accu_res;
 
     ConstQGBatchDataMap<T> cur_batch(batch_data, padded_dim);
 
     fastscan::accumulate(cur_batch.bin_code(), q_obj.lut(), accu_res.data(), padded_dim);
 
+    // no lower bound for qg
+    if constexpr (std::is_same_v<T, float>) {
+        EstdistConsts consts{
+            q_obj.delta(), q_obj.sum_vl_lut(), q_obj.k1xsumq(), q_obj.g_add(), 0
+        };
+        fused_estdist(
+            accu_res.data(),
+            cur_batch.f_add(),
+            cur_batch.f_rescale(),
+            nullptr,
+            fastscan::kBatchSize,
+            consts,
+            std::numeric_limits<float>::infinity(),
+            est_distance,
+            nullptr,
+            ip_x0_qr
+        );
+        return;
+    }
+
     ConstRowMajorArrayMap<TA> ip_arr(accu_res.data(), 1, fastscan::kBatchSize);
     ConstRowMajorArrayMap<T> f_add_arr(cur_batch.f_add(), 1, fastscan::kBatchSize);
     ConstRowMajorArrayMap<T> f_rescale_arr(cur_batch.f_rescale(), 1, fastscan::kBatchSize);
 
     RowMajorArrayMap<T> est_dist_arr(est_distance, 1, fastscan::kBatchSize);
 
+    if (ip_x0_qr != nullptr) {
+        RowMajorArrayMap<T> ip_x0_qr_arr(ip_x0_qr, 1, fastscan::kBatchSize);
+        ip_x0_qr_arr = q_obj.delta() * (ip_arr.template cast<T>()) + q_obj.sum_vl_lut();
+        est_dist_arr =
+            f_add_arr + q_obj.g_add() + (f_rescale_arr * (ip_x0_qr_arr + q_obj.k1xsumq()));
+        return;
+    }
+
     est_dist_arr = f_add_arr + q_obj.g_add() +
                    (f_rescale_arr * (q_obj.delta() * (ip_arr.template cast<T>()) +
                                      q_obj.sum_vl_lut() + q_obj.k1xsumq()));
@@ -179,7 +568,7 @@ inline void split_single_fulldist(
         cur_ex.f_add_ex() + g_add +
         (cur_ex.f_rescale_ex() *
          (static_cast<float>(1 << ex_bits) * ip_x0_qr +
-          ip_func_(q_obj.rotated_query(), cur_ex.ex_code(), padded_dim) + q_obj.kbxsumq()));
+          q_obj.ex_ip(ip_func_, cur_ex.ex_code(), padded_dim) + q_obj.kbxsumq()));
 
     low_dist = est_dist - (cur_bin.f_error() * g_error / static_cast<float>(1 << ex_bits));
 }
@@ -4,6 +4,7 @@
 #include <immintrin.h>
 #include <omp.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <cstddef>
@@ -12,7 +13,7 @@
 #include <iostream>
 #include <memory>
 #include <mutex>
-#include <unordered_map>
+#include <thread>
 #include <vector>
 
 #include "rabitqlib/defines.hpp"
@@ -22,8 +23,12 @@
 #include "rabitqlib/quantization/data_layout.hpp"
 #include "rabitqlib/quantization/rabitq.hpp"
 #include "rabitqlib/utils/buffer.hpp"
+#include "rabitqlib/utils/early_stop.hpp"
+#include "rabitqlib/utils/memory.hpp"
+#include "rabitqlib/utils/reorder.hpp"
 #include "rabitqlib/utils/rotator.hpp"
 #include "rabitqlib/utils/space.hpp"
+#include "rabitqlib/utils/stopw.hpp"
 #include "rabitqlib/utils/tools.hpp"
 #include "rabitqlib/utils/visited_pool.hpp"
 
@@ -56,9 +61,56 @@ class HierarchicalNSW {
 
     void construct(size_t, const float*, size_t, const float*, PID*, size_t, bool);
     std::vector<std::vector<std::pair<float, PID>>> search(
-        const float*, size_t, size_t, size_t, size_t
+        const float*, size_t, size_t, size_t, size_t, size_t = 0, uint32_t* = nullptr
     );
 
+    // Free the upper layers of the graph. Afterwards, queries should be seeded from
+    // clusters (num_seed_clusters > 0 in search) instead of the global entry point.
+    void drop_upper_layers();
+
+    // Permute internal ids in BFS order of the base layer for better cache locality.
+    // External labels are stored with each element and thus are not affected.
+    void reorder();
+
+    [[nodiscard]] bool has_cluster_entries() const { return !cluster_entries_.empty(); }
+
+    // Number of queries whose distances to centroids are computed together by one GEMM
+    void set_query_batch_size(size_t batch_size) {
+        query_batch_size_ = std::max<size_t>(batch_size, 1);
+    }
+
+    // Number of queries interleaved by one thread in the base layer, 1 to disable
+    void set_search_interleave(size_t num_interleave) {
+        search_interleave_ = std::max<size_t>(num_interleave, 1);
+    }
+
+    // Adaptive termination of the base layer search (see EarlyStopParams), disabled by
+    // default. For error_gap, the estimation error is given by the lower bounds of
+    // estimated distances.
+    void set_early_stop(const EarlyStopParams& params) { early_stop_ = params; }
+
+    // Bits per dim of quantized queries for the estimated distances by binary codes, 1 to
+    // 8, SplitSingleQuery::kNumBits by default. Fewer bits are faster, more bits give more
+    // accurate estimates and thus fewer candidates re-ranked by ex codes.
+    void set_query_bits(size_t num_bits) {
+        query_bits_ = std::clamp<size_t>(num_bits, 1, kMaxQueryBits);
+        query_config_ = quant::faster_config(padded_dim_, query_bits_);
+    }
+
+    // Accumulated wall time of search(), split into query preprocessing (rotation and
+    // distances to centroids) and graph search, and num of nodes expanded in the base
+    // layer
+    struct SearchStats {
+        double preprocess_us = 0;
+        double search_us = 0;
+        size_t num_queries = 0;
+        size_t num_hops = 0;
+    };
+
+    [[nodiscard]] const SearchStats& search_stats() const { return search_stats_; }
+
+    void reset_search_stats() { search_stats_ = SearchStats(); }
+
     const float* rawDataPtr_{nullptr};
 
     struct ResultRecord {
@@ -106,6 +158,8 @@ class HierarchicalNSW {
 
         [[nodiscard]] const std::vector<Candidate>& candidates() const { return queue_; }
 
+        void clear() { queue_.clear(); }
+
        private:
         size_t capacity_;
         // Sorted in ascending order by record.est_dist so that the worst is at the back.
@@ -114,6 +168,11 @@ class HierarchicalNSW {
 
    private:
     static constexpr PID kMaxLabelOperationLock = 65536;
+    // Written in place of the first link list size to mark that upper-level link lists
+    // are saved as one block
+    static constexpr unsigned int kLinkListBlockMarker = 0xFFFFFFFF;
+    // max num of floats of rotated queries and distances to centroids held by search()
+    static constexpr size_t kMaxChunkFloats = 1 << 24;
     size_t max_elements_{0};
     mutable std::atomic<size_t> cur_element_count_{0};  // current number of elements
     size_t size_data_per_element_{0};
@@ -145,6 +204,7 @@ class HierarchicalNSW {
     // Layout: (# of edges + edges) + (cluster_id) + (External_id) + (BinData) + (ExData)
     char* data_level0_memory_{nullptr};
     char** linkLists_{nullptr};
+    memory::Arena link_list_arena_;  // memory of upper-level link lists
     std::vector<int> element_levels_;  // keeps level of each element
 
     size_t num_cluster_{0};
@@ -152,9 +212,15 @@ class HierarchicalNSW {
     size_t padded_dim_{0};
 
     char* centroids_memory_{nullptr};
+    std::vector<float> centroid_sqr_norms_;  // squared norms of rotated centroids
 
-    mutable std::mutex label_lookup_lock_;  // lock for label_lookup_
-    std::unordered_map<PID, PID> label_lookup_;
+    // Representative element (internal id) of each cluster, i.e., the element closest to
+    // its centroid. kPidMax for empty clusters.
+    std::vector<PID> cluster_entries_;
+
+    // internal id of each label, kPidMax if absent. Labels are row ids of the data, so a
+    // dense array suffices. Each slot is written once under the label's op lock.
+    std::vector<PID> label_lookup_;
 
     std::default_random_engine level_generator_;
     std::default_random_engine update_probability_generator_;
@@ -169,6 +235,12 @@ class HierarchicalNSW {
     Rotator<float>* rotator_ = nullptr;
 
     quant::RabitqConfig query_config_;
+    size_t query_bits_ = SplitSingleQuery<float>::kNumBits;
+
+    size_t query_batch_size_ = 64;
+    size_t search_interleave_ = 1;
+    EarlyStopParams early_stop_;
+    SearchStats search_stats_;
 
     struct EstimateRecord {
         float ip_x0_qr;
@@ -185,16 +257,14 @@ class HierarchicalNSW {
     void free_memory() {
         free(data_level0_memory_);
         data_level0_memory_ = nullptr;
-        for (PID i = 0; i < cur_element_count_; i++) {
-            if (element_levels_[i] > 0) {
-                free(linkLists_[i]);
-            }
-        }
+        link_list_arena_.reset();
         free(reinterpret_cast<void*>(linkLists_));
         linkLists_ = nullptr;
         cur_element_count_ = 0;
 
         free(centroids_memory_);
+        centroids_memory_ = nullptr;
+        cluster_entries_.clear();
 
         delete rotator_;
         rotator_ = nullptr;
@@ -290,29 +360,127 @@ class HierarchicalNSW {
 
     // ANN Search
     void get_bin_est(
-        std::vector<float>&, SplitSingleQuery<float>&, PID, HierarchicalNSW::EstimateRecord&
+        const float*, SplitSingleQuery<float>&, PID, HierarchicalNSW::EstimateRecord&
     );
 
     void get_ex_est(
-        std::vector<float>&, SplitSingleQuery<float>&, PID, HierarchicalNSW::EstimateRecord&
+        const float*, SplitSingleQuery<float>&, PID, HierarchicalNSW::EstimateRecord&
     ) const;
 
     void get_full_est(
-        std::vector<float>&, SplitSingleQuery<float>&, PID, HierarchicalNSW::EstimateRecord&
+        const float*, SplitSingleQuery<float>&, PID, HierarchicalNSW::EstimateRecord&
     ) const;
 
-    maxheap<std::pair<float, PID>> search_knn(const float*, size_t);
+    void init_centroid_norms();
+
+    [[nodiscard]] size_t centroid_dist_width() const {
+        return metric_type_ == METRIC_IP ? 2 * num_cluster_ : num_cluster_;
+    }
+
+    void query_to_centroids(const float*, size_t, float*) const;
+
+    maxheap<std::pair<float, PID>> search_knn(
+        const float*, const float*, size_t, size_t, SplitSingleQuery<float>&, size_t&
+    );
+
+    maxheap<std::pair<float, PID>> collect_results(const BoundedKNN&) const;
+
+    std::vector<PID> get_entries(const float*, SplitSingleQuery<float>&, size_t);
+
+    PID search_upper_layers(const float*, SplitSingleQuery<float>&);
+
+    std::vector<PID> select_cluster_entries(const float*, size_t) const;
 
-    void searchBaseLayerST_AdaptiveRerankOpt(
-        PID ep_id,
+    size_t searchBaseLayerST_AdaptiveRerankOpt(
+        const std::vector<PID>& ep_ids,
         size_t ef,
         size_t TOPK,
         SplitSingleQuery<float>& query_wrapper,
-        std::vector<float>& q_to_centroids,  // preprocess
+        const float* q_to_centroids,  // preprocess
         const float* query,
         BoundedKNN& boundedKNN
     );
 
+    float init_base_layer(
+        const std::vector<PID>&,
+        SplitSingleQuery<float>&,
+        const float*,
+        HashBasedBooleanSet&,
+        buffer::SearchBuffer<float>&,
+        BoundedKNN&
+    ) const;
+
+    bool visit_candidate(
+        PID,
+        size_t,
+        SplitSingleQuery<float>&,
+        const float*,
+        buffer::SearchBuffer<float>&,
+        BoundedKNN&,
+        float&
+    );
+
+    // State of one query in interleaved base layer search, reused by the following queries
+    struct BaseLayerState {
+        SplitSingleQuery<float> query_wrapper;
+        const float* q_to_centroids = nullptr;
+        buffer::SearchBuffer<float> candidate_set;
+        BoundedKNN bounded_knn;
+        HashBasedBooleanSet* vl = nullptr;
+        EarlyStop<float> stop;
+        float distk = 1e10;
+        PID cur_node = kPidMax;    // popped node whose link list is being prefetched
+        std::vector<PID> pending;  // unvisited neighbors whose codes are being prefetched
+
+        BaseLayerState(size_t ef, size_t topk, const EarlyStopParams& early_stop)
+            : candidate_set(ef), bounded_knn(topk), stop(early_stop) {}
+
+        // start a new query, the query object is reset by the caller
+        void reset(const float* q_to_c, const EarlyStopParams& early_stop) {
+            q_to_centroids = q_to_c;
+            candidate_set.clear();
+            bounded_knn.clear();
+            stop = EarlyStop<float>(early_stop);
+            distk = 1e10;
+            cur_node = kPidMax;
+            pending.clear();
+        }
+    };
+
+    void search_knn_interleaved(
+        const float*,
+        const float*,
+        size_t,
+        size_t,
+        size_t,
+        std::vector<std::unique_ptr<BaseLayerState>>&,
+        std::vector<std::pair<float, PID>>*,
+        uint32_t*
+    );
+
+    // whether the base layer search should stop before expanding the next candidate, the
+    // lower bound of the candidate comes from the error factor of its 1-bit code
+    [[nodiscard]] bool stop_base_layer(
+        const EarlyStop<float>& stop,
+        const float* q_to_centroids,
+        const buffer::SearchBuffer<float>& candidate_set,
+        const BoundedKNN& bounded_knn,
+        size_t topk
+    ) const {
+        float kth_dist = bounded_knn.size() < topk ? std::numeric_limits<float>::max()
+                                                   : bounded_knn.worst().record.est_dist;
+        PID next_id = candidate_set.next_id();
+        PID cluster_id = get_clusterid_by_internalid(next_id);
+        float g_error = metric_type_ == METRIC_IP
+                            ? q_to_centroids[cluster_id + num_cluster_]
+                            : q_to_centroids[cluster_id];
+        ConstBinDataMap<float> next_bin(get_bindata_by_internalid(next_id), padded_dim_);
+        float next_low = candidate_set.next_dist() - (next_bin.f_error() * g_error);
+        return stop.stop(next_low, kth_dist);
+    }
+
+    bool base_layer_step(BaseLayerState&, size_t);
+
     // Construction
     // Currently only support index construction with non-quantized vectors
     float get_data_dist(PID obj1, PID obj2) {
@@ -325,6 +493,8 @@ class HierarchicalNSW {
 
     void add_point(PID, PID, const quant::RabitqConfig&);
 
+    void init_cluster_entries(const float*, size_t);
+
     maxheap<std::pair<float, PID>> search_base_layer(PID, PID, int);
 
     PID mutually_connect_new_element(PID, maxheap<std::pair<float, PID>>&, int);
@@ -345,6 +515,7 @@ inline HierarchicalNSW::HierarchicalNSW(
     , label_op_locks_(kMaxLabelOperationLock)
     , link_list_locks_(max_elements)
     , element_levels_(max_elements)
+    , label_lookup_(max_elements, kPidMax)
     , raw_dist_func_(
           (metric_type == METRIC_IP) ? dot_product_dis<float> : euclidean_sqr<float>
       ) {
@@ -422,8 +593,7 @@ inline HierarchicalNSW::HierarchicalNSW(
     mult_ = 1 / log(1.0 * static_cast<double>(M_));
     revSize_ = 1.0 / mult_;
 
-    this->query_config_ =
-        quant::faster_config(padded_dim_, SplitSingleQuery<float>::kNumBits);
+    this->query_config_ = quant::faster_config(padded_dim_, query_bits_);
 }
 
 inline HierarchicalNSW::~HierarchicalNSW() { free_memory(); }
@@ -470,16 +640,38 @@ inline void HierarchicalNSW::save(const char* filename) const {
         cur_element_count_ * size_data_per_element_
     );
 
-    for (size_t i = 0; i < cur_element_count_; i++) {
-        unsigned int link_list_size =
-            element_levels_[i] > 0 ? size_links_per_element_ * element_levels_[i] : 0;
-        output.write(reinterpret_cast<const char*>(&link_list_size), sizeof(unsigned int));
-        if (link_list_size != 0) {
-            output.write(reinterpret_cast<const char*>(linkLists_[i]), link_list_size);
+    // Upper-level link lists: levels of all elements followed by all lists in one block
+    if (cur_element_count_ > 0) {
+        output.write(
+            reinterpret_cast<const char*>(&kLinkListBlockMarker), sizeof(unsigned int)
+        );
+        output.write(
+            reinterpret_cast<const char*>(element_levels_.data()),
+            cur_element_count_ * sizeof(int)
+        );
+        size_t upper_bytes = 0;
+        for (size_t i = 0; i < cur_element_count_; i++) {
+            upper_bytes += size_links_per_element_ * element_levels_[i];
+        }
+        output.write(reinterpret_cast<const char*>(&upper_bytes), sizeof(size_t));
+        for (size_t i = 0; i < cur_element_count_; i++) {
+            if (element_levels_[i] > 0) {
+                output.write(
+                    reinterpret_cast<const char*>(linkLists_[i]),
+                    size_links_per_element_ * element_levels_[i]
+                );
+            }
         }
     }
 
     rotator_->save(output);
+
+    // Appended after the rotator so that indices saved without it remain loadable
+    size_t num_entries = cluster_entries_.size();
+    output.write(reinterpret_cast<const char*>(&num_entries), sizeof(size_t));
+    output.write(
+        reinterpret_cast<const char*>(cluster_entries_.data()), num_entries * sizeof(PID)
+    );
     output.close();
 }
 
@@ -527,6 +719,7 @@ inline void HierarchicalNSW::load(const char* filename) {
         reinterpret_cast<char*>(malloc(num_cluster_ * padded_dim_ * sizeof(float)));
 
     input.read(centroids_memory_, num_cluster_ * padded_dim_ * sizeof(float));
+    init_centroid_norms();
 
     data_level0_memory_ =
         reinterpret_cast<char*>(malloc(max_elements_ * size_data_per_element_));
@@ -546,25 +739,51 @@ inline void HierarchicalNSW::load(const char* filename) {
     }
 
     element_levels_ = std::vector<int>(max_elements_);
+    label_lookup_.assign(max_elements_, kPidMax);
     revSize_ = 1.0 / mult_;
     ef_ = 10;
 
     for (size_t i = 0; i < cur_element_count_; i++) {
         label_lookup_[get_external_label(i)] = i;
-        unsigned int link_list_size;
-        input.read(reinterpret_cast<char*>(&link_list_size), sizeof(unsigned int));
-        if (link_list_size == 0) {
-            element_levels_[i] = 0;
-            linkLists_[i] = nullptr;
-        } else {
-            element_levels_[i] = static_cast<int>(link_list_size / size_links_per_element_);
-            linkLists_[i] = reinterpret_cast<char*>(malloc(link_list_size));
-            if (linkLists_[i] == nullptr) {
-                throw std::runtime_error(
-                    "Not enough memory: loadIndex failed to allocate linklist"
-                );
+    }
+
+    unsigned int first_size = 0;
+    if (cur_element_count_ > 0) {
+        input.read(reinterpret_cast<char*>(&first_size), sizeof(unsigned int));
+    }
+    if (first_size == kLinkListBlockMarker) {
+        input.read(
+            reinterpret_cast<char*>(element_levels_.data()),
+            cur_element_count_ * sizeof(int)
+        );
+        size_t upper_bytes = 0;
+        input.read(reinterpret_cast<char*>(&upper_bytes), sizeof(size_t));
+        char* block = link_list_arena_.allocate(upper_bytes);
+        input.read(block, static_cast<std::streamsize>(upper_bytes));
+        for (size_t i = 0; i < cur_element_count_; i++) {
+            if (element_levels_[i] > 0) {
+                linkLists_[i] = block;
+                block += size_links_per_element_ * element_levels_[i];
+            } else {
+                linkLists_[i] = nullptr;
+            }
+        }
+    } else {
+        // Index saved with one size + list per element
+        for (size_t i = 0; i < cur_element_count_; i++) {
+            unsigned int link_list_size = first_size;
+            if (i > 0) {
+                input.read(reinterpret_cast<char*>(&link_list_size), sizeof(unsigned int));
+            }
+            if (link_list_size == 0) {
+                element_levels_[i] = 0;
+                linkLists_[i] = nullptr;
+            } else {
+                element_levels_[i] =
+                    static_cast<int>(link_list_size / size_links_per_element_);
+                linkLists_[i] = link_list_arena_.allocate(link_list_size);
+                input.read(linkLists_[i], link_list_size);
             }
-            input.read(linkLists_[i], link_list_size);
         }
     }
 
@@ -578,10 +797,18 @@ inline void HierarchicalNSW::load(const char* filename) {
         exit(1);
     }
     rotator_->load(input);
+
+    size_t num_entries = 0;
+    if (input.read(reinterpret_cast<char*>(&num_entries), sizeof(size_t)) &&
+        num_entries == num_cluster_) {
+        cluster_entries_.resize(num_entries);
+        input.read(
+            reinterpret_cast<char*>(cluster_entries_.data()), num_entries * sizeof(PID)
+        );
+    }
     input.close();
 
-    this->query_config_ =
-        quant::faster_config(padded_dim_, SplitSingleQuery<float>::kNumBits);
+    this->query_config_ = quant::faster_config(padded_dim_, query_bits_);
 }
 
 inline void HierarchicalNSW::construct(
@@ -606,6 +833,7 @@ inline void HierarchicalNSW::construct(
             reinterpret_cast<float*>(centroids_memory_) + (i * padded_dim_)
         );
     }
+    init_centroid_norms();
 
     quant::RabitqConfig config;
     if (faster) {
@@ -621,32 +849,133 @@ inline void HierarchicalNSW::construct(
         num_threads,
         [&](size_t idx, size_t /*threadId*/) { add_point(idx, cluster_ids[idx], config); }
     );
+
+    init_cluster_entries(centroids, num_threads);
 }
 
-inline void HierarchicalNSW::add_point(
-    PID label, PID cluster_id, const quant::RabitqConfig& config
+inline void HierarchicalNSW::init_cluster_entries(
+    const float* centroids, size_t num_threads
 ) {
-    std::unique_lock<std::mutex> lock_label(get_lable_op_mutex(label));
+    size_t num_points = cur_element_count_;
+    std::vector<float> dist_to_centroid(num_points);
+    rabitqlib::ivf::parallel_for(
+        0,
+        num_points,
+        num_threads,
+        [&](size_t idx, size_t /*threadId*/) {
+            dist_to_centroid[idx] = euclidean_sqr(
+                rawDataPtr_ + (get_external_label(idx) * dim_),
+                centroids + (get_clusterid_by_internalid(idx) * dim_),
+                dim_
+            );
+        }
+    );
 
-    int level = -1;
-    PID cur_c = 0;
-    {
-        std::unique_lock<std::mutex> lock_table(label_lookup_lock_);
-        if (label_lookup_.find(label) != label_lookup_.end()) {
-            throw std::runtime_error(
-                "Currently not support replacement of existing elements, only support "
-                "inserting elements with distinct labels"
+    cluster_entries_.assign(num_cluster_, kPidMax);
+    std::vector<float> best_dist(num_cluster_, std::numeric_limits<float>::max());
+    for (PID i = 0; i < num_points; ++i) {
+        PID cid = get_clusterid_by_internalid(i);
+        if (dist_to_centroid[i] < best_dist[cid]) {
+            best_dist[cid] = dist_to_centroid[i];
+            cluster_entries_[cid] = i;
+        }
+    }
+}
+
+inline void HierarchicalNSW::drop_upper_layers() {
+    if (cluster_entries_.empty()) {
+        std::cerr << "Warning: dropping upper layers of an index without cluster entries, "
+                     "search will start from a single global entry point\n";
+    }
+    for (PID i = 0; i < cur_element_count_; ++i) {
+        linkLists_[i] = nullptr;
+        element_levels_[i] = 0;
+    }
+    link_list_arena_.reset();
+    maxlevel_ = 0;
+}
+
+inline void HierarchicalNSW::reorder() {
+    size_t num_points = cur_element_count_;
+    std::vector<PID> new_to_old = bfs_order(num_points, enterpoint_node_, [&](PID id) {
+        const PID* ll = get_linklist0(id);
+        return std::make_pair(ll + 1, static_cast<size_t>(get_list_count(ll)));
+    });
+    std::vector<PID> old_to_new = inverse_permutation(new_to_old);
+
+    char* new_level0 =
+        reinterpret_cast<char*>(malloc(max_elements_ * size_data_per_element_));
+    if (new_level0 == nullptr) {
+        throw std::runtime_error("Not enough memory: HNSW failed to reorder");
+    }
+    std::vector<char*> new_link_lists(num_points);
+    std::vector<int> new_levels(num_points);
+
+    for (PID i = 0; i < num_points; ++i) {
+        PID old_id = new_to_old[i];
+        char* row = new_level0 + (i * size_data_per_element_);
+        memcpy(
+            row,
+            data_level0_memory_ + (old_id * size_data_per_element_),
+            size_data_per_element_
+        );
+
+        auto* ll0 = reinterpret_cast<PID*>(row);
+        for (size_t j = 1; j <= get_list_count(ll0); ++j) {
+            ll0[j] = old_to_new[ll0[j]];
+        }
+
+        new_levels[i] = element_levels_[old_id];
+        new_link_lists[i] = new_levels[i] > 0 ? linkLists_[old_id] : nullptr;
+        for (int level = 1; level <= new_levels[i]; ++level) {
+            auto* ll = reinterpret_cast<PID*>(
+                new_link_lists[i] + ((level - 1) * size_links_per_element_)
             );
+            for (size_t j = 1; j <= get_list_count(ll); ++j) {
+                ll[j] = old_to_new[ll[j]];
+            }
         }
+    }
+
+    free(data_level0_memory_);
+    data_level0_memory_ = new_level0;
+    std::copy(new_link_lists.begin(), new_link_lists.end(), linkLists_);
+    std::copy(new_levels.begin(), new_levels.end(), element_levels_.begin());
 
-        if (cur_element_count_ >= max_elements_) {
-            throw std::runtime_error("The number of elements exceeds the specified limit");
+    enterpoint_node_ = old_to_new[enterpoint_node_];
+    for (auto& entry : cluster_entries_) {
+        if (entry != kPidMax) {
+            entry = old_to_new[entry];
         }
+    }
+    for (PID i = 0; i < num_points; ++i) {
+        label_lookup_[get_external_label(i)] = i;
+    }
+}
+
+inline void HierarchicalNSW::add_point(
+    PID label, PID cluster_id, const quant::RabitqConfig& config
+) {
+    std::unique_lock<std::mutex> lock_label(get_lable_op_mutex(label));
 
-        cur_c = cur_element_count_;
-        cur_element_count_++;
-        label_lookup_[label] = cur_c;
+    int level = -1;
+    if (label >= max_elements_) {
+        throw std::runtime_error("The label exceeds the specified number of elements");
     }
+    // Duplicated labels are serialized by lock_label
+    if (label_lookup_[label] != kPidMax) {
+        throw std::runtime_error(
+            "Currently not support replacement of existing elements, only support "
+            "inserting elements with distinct labels"
+        );
+    }
+
+    PID cur_c = cur_element_count_.fetch_add(1);
+    if (cur_c >= max_elements_) {
+        cur_element_count_--;
+        throw std::runtime_error("The number of elements exceeds the specified limit");
+    }
+    label_lookup_[label] = cur_c;
 
     std::unique_lock<std::mutex> lock_el(link_list_locks_[cur_c]);
     int curlevel = get_random_level(mult_);
@@ -688,12 +1017,7 @@ inline void HierarchicalNSW::add_point(
     // If the current vertex is at level >0, it needs some space to store the extra edges.
     if (curlevel > 0) {
         linkLists_[cur_c] =
-            static_cast<char*>(malloc((size_links_per_element_ * curlevel) + 1));
-        if (linkLists_[cur_c] == nullptr) {
-            throw std::runtime_error(
-                "Not enough memory: add_point failed to allocate linklist"
-            );
-        }
+            link_list_arena_.allocate((size_links_per_element_ * curlevel) + 1);
         memset(linkLists_[cur_c], 0, (size_links_per_element_ * curlevel) + 1);
     }
 
@@ -974,7 +1298,7 @@ inline void HierarchicalNSW::get_neighbors_by_heuristic2(
 }
 
 inline void HierarchicalNSW::get_bin_est(
-    std::vector<float>& q_to_centroids,
+    const float* q_to_centroids,
     SplitSingleQuery<float>& query_wrapper,
     PID currObj,
     HierarchicalNSW::EstimateRecord& res
@@ -1009,7 +1333,7 @@ inline void HierarchicalNSW::get_bin_est(
 }
 
 inline void HierarchicalNSW::get_ex_est(
-    std::vector<float>& q_to_centroids,
+    const float* q_to_centroids,
     SplitSingleQuery<float>& query_wrapper,
     PID currObj,
     HierarchicalNSW::EstimateRecord& res
@@ -1030,7 +1354,7 @@ inline void HierarchicalNSW::get_ex_est(
 }
 
 inline void HierarchicalNSW::get_full_est(
-    std::vector<float>& q_to_centroids,
+    const float* q_to_centroids,
     SplitSingleQuery<float>& query_wrapper,
     PID currObj,
     HierarchicalNSW::EstimateRecord& res
@@ -1071,68 +1395,165 @@ inline void HierarchicalNSW::get_full_est(
 }
 
 inline std::vector<std::vector<std::pair<float, PID>>> HierarchicalNSW::search(
-    const float* queries, size_t query_num, size_t TOPK, size_t efSearch, size_t thread_num
+    const float* queries,
+    size_t query_num,
+    size_t TOPK,
+    size_t efSearch,
+    size_t thread_num,
+    size_t num_seed_clusters,
+    uint32_t* hops
 ) {
     set_ef(efSearch);
     std::vector<std::vector<std::pair<float, PID>>> results(query_num);
-    rabitqlib::ivf::parallel_for(
-        0,
-        query_num,
-        thread_num,
-        [&](size_t idx, size_t /*threadId*/) {
-            std::vector<float> rotated_query(padded_dim_);
-            this->rotator_->rotate(queries + (idx * dim_), rotated_query.data());
-            maxheap<std::pair<float, PID>> knn = search_knn(rotated_query.data(), TOPK);
-            while (knn.size()) {
-                results[idx].emplace_back(knn.top());
-                knn.pop();
+    std::vector<uint32_t> query_hops(query_num, 0);
+
+    // Queries are processed in chunks of whole batches. All queries of a chunk are
+    // rotated, the distances from each batch of queries to all centroids are computed
+    // together, then the chunk is searched by one parallel loop. A chunk takes as many
+    // batches as fit in kMaxChunkFloats, so that threads are not started and joined for
+    // every batch.
+    size_t batch_size = std::max<size_t>(std::min(query_batch_size_, query_num), 1);
+    size_t width = centroid_dist_width();
+    size_t chunk_size = std::max<size_t>(
+        batch_size, kMaxChunkFloats / (padded_dim_ + width) / batch_size * batch_size
+    );
+    chunk_size = std::min(chunk_size, query_num);
+    std::vector<float> rotated_queries(chunk_size * padded_dim_);
+    std::vector<float> q_to_centroids(chunk_size * width);
+    StopW stopw;
+
+    // query objects and interleaved states of each thread, reused across queries
+    size_t num_workers = thread_num > 0 ? thread_num : std::thread::hardware_concurrency();
+    std::vector<SplitSingleQuery<float>> query_wrappers(num_workers);
+    std::vector<std::vector<std::unique_ptr<BaseLayerState>>> thread_states(num_workers);
+
+    for (size_t begin = 0; begin < query_num; begin += chunk_size) {
+        size_t num = std::min(chunk_size, query_num - begin);
+
+        stopw.reset();
+        rabitqlib::ivf::parallel_for(
+            0,
+            num,
+            thread_num,
+            [&](size_t idx, size_t /*threadId*/) {
+                this->rotator_->rotate(
+                    queries + ((begin + idx) * dim_), &rotated_queries[idx * padded_dim_]
+                );
             }
-            std::reverse(results[idx].begin(), results[idx].end());
+        );
+        for (size_t first = 0; first < num; first += batch_size) {
+            query_to_centroids(
+                &rotated_queries[first * padded_dim_],
+                std::min(batch_size, num - first),
+                &q_to_centroids[first * width]
+            );
         }
-    );
+        search_stats_.preprocess_us += stopw.get_elapsed_micro();
+
+        stopw.reset();
+        if (search_interleave_ > 1) {
+            size_t num_groups = div_round_up(num, search_interleave_);
+            rabitqlib::ivf::parallel_for(
+                0,
+                num_groups,
+                thread_num,
+                [&](size_t group, size_t threadId) {
+                    size_t first = group * search_interleave_;
+                    search_knn_interleaved(
+                        &rotated_queries[first * padded_dim_],
+                        &q_to_centroids[first * width],
+                        std::min(search_interleave_, num - first),
+                        TOPK,
+                        num_seed_clusters,
+                        thread_states[threadId],
+                        &results[begin + first],
+                        &query_hops[begin + first]
+                    );
+                }
+            );
+            search_stats_.search_us += stopw.get_elapsed_micro();
+            continue;
+        }
+        rabitqlib::ivf::parallel_for(
+            0,
+            num,
+            thread_num,
+            [&](size_t idx, size_t threadId) {
+                size_t num_hops = 0;
+                maxheap<std::pair<float, PID>> knn = search_knn(
+                    &rotated_queries[idx * padded_dim_],
+                    &q_to_centroids[idx * width],
+                    TOPK,
+                    num_seed_clusters,
+                    query_wrappers[threadId],
+                    num_hops
+                );
+                query_hops[begin + idx] = static_cast<uint32_t>(num_hops);
+                auto& res = results[begin + idx];
+                while (knn.size()) {
+                    res.emplace_back(knn.top());
+                    knn.pop();
+                }
+                std::reverse(res.begin(), res.end());
+            }
+        );
+        search_stats_.search_us += stopw.get_elapsed_micro();
+    }
+    search_stats_.num_queries += query_num;
+    for (uint32_t num_hops : query_hops) {
+        search_stats_.num_hops += num_hops;
+    }
+    if (hops != nullptr) {
+        std::copy(query_hops.begin(), query_hops.end(), hops);
+    }
     return results;
 }
 
-inline maxheap<std::pair<float, PID>> HierarchicalNSW::search_knn(
-    const float* rotated_query, size_t TOPK
-) {
-    maxheap<std::pair<float, PID>> result;
-    if (cur_element_count_ == 0) {
-        return result;
+inline void HierarchicalNSW::init_centroid_norms() {
+    centroid_sqr_norms_.resize(num_cluster_);
+    const auto* centroids = reinterpret_cast<const float*>(centroids_memory_);
+    for (size_t i = 0; i < num_cluster_; ++i) {
+        centroid_sqr_norms_[i] = dot_product(
+            centroids + (i * padded_dim_), centroids + (i * padded_dim_), padded_dim_
+        );
     }
+}
 
-    SplitSingleQuery<float> query_wrapper(
-        rotated_query, padded_dim_, ex_bits_, query_config_, metric_type_
+/**
+ * @brief Distances from num rotated queries to all centroids, the inner products are
+ * computed by one GEMM. Each row of results has centroid_dist_width() elements: for L2,
+ * ||q - c||; for IP, <q, c> in the first half and ||q - c|| in the second half.
+ */
+inline void HierarchicalNSW::query_to_centroids(
+    const float* rotated_queries, size_t num, float* results
+) const {
+    size_t width = centroid_dist_width();
+    ConstRowMajorMatrixMap<float> queries(rotated_queries, num, padded_dim_);
+    ConstRowMajorMatrixMap<float> centroids(
+        reinterpret_cast<const float*>(centroids_memory_), num_cluster_, padded_dim_
     );
-
-    // Preprocess - get the distance from query to all centroids
-    std::vector<float> q_to_centroids(num_cluster_);
-
-    if (metric_type_ == METRIC_L2) {
-        for (size_t i = 0; i < num_cluster_; i++) {
-            q_to_centroids[i] = std::sqrt(raw_dist_func_(
-                rotated_query,
-                reinterpret_cast<float*>(centroids_memory_) + (i * padded_dim_),
-                padded_dim_
-            ));
-        }
-    } else if (metric_type_ == METRIC_IP) {
-        q_to_centroids.resize(2 * num_cluster_);
-        // first half as g_add, second half as g_error
-        for (size_t i = 0; i < num_cluster_; i++) {
-            q_to_centroids[i] = dot_product(
-                rotated_query,
-                reinterpret_cast<float*>(centroids_memory_) + (i * padded_dim_),
-                padded_dim_
-            );
-            q_to_centroids[i + num_cluster_] = std::sqrt(euclidean_sqr(
-                rotated_query,
-                reinterpret_cast<float*>(centroids_memory_) + (i * padded_dim_),
-                padded_dim_
-            ));
+    Eigen::Map<RowMajorMatrix<float>, 0, Eigen::OuterStride<>> ip(
+        results, num, num_cluster_, Eigen::OuterStride<>(width)
+    );
+    ip.noalias() = queries * centroids.transpose();
+
+    // L2 distances go to the first half for L2, second half for IP
+    size_t l2_offset = metric_type_ == METRIC_IP ? num_cluster_ : 0;
+    for (size_t i = 0; i < num; ++i) {
+        const float* query = rotated_queries + (i * padded_dim_);
+        float q_sqr_norm = dot_product(query, query, padded_dim_);
+        float* row = results + (i * width);
+        for (size_t j = 0; j < num_cluster_; ++j) {
+            float sqr_dist = q_sqr_norm + centroid_sqr_norms_[j] - (2 * row[j]);
+            row[j + l2_offset] = std::sqrt(std::max(sqr_dist, 0.0F));
         }
     }
+}
 
+// Greedy descent on the upper layers with 1-bit estimates, return the base-layer entry
+inline PID HierarchicalNSW::search_upper_layers(
+    const float* q_to_centroids, SplitSingleQuery<float>& query_wrapper
+) {
     PID curr_obj = enterpoint_node_;
     EstimateRecord curest;
 
@@ -1166,9 +1587,29 @@ inline maxheap<std::pair<float, PID>> HierarchicalNSW::search_knn(
         }
     }
 
+    return curr_obj;
+}
+
+inline maxheap<std::pair<float, PID>> HierarchicalNSW::search_knn(
+    const float* rotated_query,
+    const float* q_to_centroids,
+    size_t TOPK,
+    size_t num_seed_clusters,
+    SplitSingleQuery<float>& query_wrapper,
+    size_t& hops
+) {
+    maxheap<std::pair<float, PID>> result;
+    if (cur_element_count_ == 0) {
+        return result;
+    }
+
+    query_wrapper.reset(
+        rotated_query, padded_dim_, ex_bits_, query_config_, metric_type_, query_bits_
+    );
+
     BoundedKNN boundedKnn(TOPK);
-    searchBaseLayerST_AdaptiveRerankOpt(
-        curr_obj,
+    hops = searchBaseLayerST_AdaptiveRerankOpt(
+        get_entries(q_to_centroids, query_wrapper, num_seed_clusters),
         std::max(ef_, TOPK),
         TOPK,
         query_wrapper,
@@ -1176,24 +1617,197 @@ inline maxheap<std::pair<float, PID>> HierarchicalNSW::search_knn(
         rotated_query,
         boundedKnn
     );
-    for (auto& candidate : boundedKnn.candidates()) {
+    return collect_results(boundedKnn);
+}
+
+inline maxheap<std::pair<float, PID>> HierarchicalNSW::collect_results(
+    const BoundedKNN& bounded_knn
+) const {
+    maxheap<std::pair<float, PID>> result;
+    for (const auto& candidate : bounded_knn.candidates()) {
         result.emplace(candidate.record.est_dist, get_external_label(candidate.id));
     }
     return result;
 }
 
+// Entry points of the base layer
+inline std::vector<PID> HierarchicalNSW::get_entries(
+    const float* q_to_centroids,
+    SplitSingleQuery<float>& query_wrapper,
+    size_t num_seed_clusters
+) {
+    if (num_seed_clusters > 0 && !cluster_entries_.empty()) {
+        // Seed the base layer from the nearest clusters, skipping the upper layers
+        return select_cluster_entries(q_to_centroids, num_seed_clusters);
+    }
+    return {search_upper_layers(q_to_centroids, query_wrapper)};
+}
+
+/**
+ * @brief Search a group of queries in one thread. The base layer search of each query is
+ * split into steps, and each step prefetches the memory needed by the next step of the
+ * same query (the link list of the next node, or the codes of its neighbors). Queries
+ * take turns, so that the latency of these loads is hidden by the work of the others.
+ * Results are identical to search_knn(). states belong to the calling thread and are
+ * reused by its following groups.
+ */
+inline void HierarchicalNSW::search_knn_interleaved(
+    const float* rotated_queries,
+    const float* q_to_centroids,
+    size_t num,
+    size_t TOPK,
+    size_t num_seed_clusters,
+    std::vector<std::unique_ptr<BaseLayerState>>& states,
+    std::vector<std::pair<float, PID>>* results,
+    uint32_t* hops
+) {
+    if (cur_element_count_ == 0) {
+        return;
+    }
+    size_t width = centroid_dist_width();
+    // states of the last group are reused, ef and TOPK are the same in one search()
+    while (states.size() < num) {
+        states.emplace_back(
+            std::make_unique<BaseLayerState>(std::max(ef_, TOPK), TOPK, early_stop_)
+        );
+    }
+    for (size_t i = 0; i < num; ++i) {
+        const float* q_to_c = q_to_centroids + (i * width);
+        auto& state = *states[i];
+        state.reset(q_to_c, early_stop_);
+        state.query_wrapper.reset(
+            rotated_queries + (i * padded_dim_),
+            padded_dim_,
+            ex_bits_,
+            query_config_,
+            metric_type_,
+            query_bits_
+        );
+        state.vl = visited_list_pool_->get_free_vislist();
+        state.distk = init_base_layer(
+            get_entries(q_to_c, state.query_wrapper, num_seed_clusters),
+            state.query_wrapper,
+            q_to_c,
+            *state.vl,
+            state.candidate_set,
+            state.bounded_knn
+        );
+        base_layer_step(state, TOPK);
+    }
+
+    // round robin until all queries finish
+    size_t num_active = num;
+    while (num_active > 0) {
+        num_active = 0;
+        for (size_t i = 0; i < num; ++i) {
+            auto& state = *states[i];
+            if (state.cur_node != kPidMax || !state.pending.empty()) {
+                num_active += static_cast<size_t>(base_layer_step(state, TOPK));
+            }
+        }
+    }
+
+    for (size_t i = 0; i < num; ++i) {
+        visited_list_pool_->release_vis_list(states[i]->vl);
+        hops[i] = static_cast<uint32_t>(states[i]->stop.hops());
+        maxheap<std::pair<float, PID>> knn = collect_results(states[i]->bounded_knn);
+        while (knn.size()) {
+            results[i].emplace_back(knn.top());
+            knn.pop();
+        }
+        std::reverse(results[i].begin(), results[i].end());
+    }
+}
+
+// One step of interleaved base layer search. Return false if the search finishes.
+inline bool HierarchicalNSW::base_layer_step(BaseLayerState& state, size_t TOPK) {
+    if (!state.pending.empty()) {
+        // codes of these neighbors were prefetched in the last step
+        bool improved = false;
+        for (PID candidate_id : state.pending) {
+            improved |= visit_candidate(
+                candidate_id,
+                TOPK,
+                state.query_wrapper,
+                state.q_to_centroids,
+                state.candidate_set,
+                state.bounded_knn,
+                state.distk
+            );
+        }
+        state.pending.clear();
+        state.stop.expand(improved);
+    } else if (state.cur_node != kPidMax) {
+        // link list of cur_node was prefetched in the last step
+        const size_t prefetch_size = (((padded_dim_ / 8) + 63) / 64) + 1;
+        const PID* data = get_linklist0(state.cur_node);
+        size_t size = get_list_count(data);
+        for (size_t j = 1; j <= size; j++) {
+            PID candidate_id = data[j];
+            if (state.vl->get(candidate_id)) {
+                continue;
+            }
+            state.vl->set(candidate_id);
+            state.pending.push_back(candidate_id);
+            memory::mem_prefetch_l1(get_bindata_by_internalid(candidate_id), prefetch_size);
+        }
+        state.cur_node = kPidMax;
+        if (!state.pending.empty()) {
+            return true;
+        }
+        state.stop.expand(false);
+    }
+
+    if (state.candidate_set.has_next() &&
+        !stop_base_layer(
+            state.stop, state.q_to_centroids, state.candidate_set, state.bounded_knn, TOPK
+        )) {
+        state.cur_node = state.candidate_set.pop();
+        memory::mem_prefetch_l1(reinterpret_cast<char*>(get_linklist0(state.cur_node)), 2);
+        return true;
+    }
+    return false;
+}
+
 struct EstimateRecord {
     float est_dist;
     float low_dist;
 };
 
-// Optimized search function.
-void HierarchicalNSW::searchBaseLayerST_AdaptiveRerankOpt(
-    PID ep_id,
+// Representatives of the num_seeds clusters nearest to the query
+inline std::vector<PID> HierarchicalNSW::select_cluster_entries(
+    const float* q_to_centroids, size_t num_seeds
+) const {
+    std::vector<std::pair<float, PID>> order;
+    order.reserve(num_cluster_);
+    for (PID i = 0; i < num_cluster_; ++i) {
+        if (cluster_entries_[i] == kPidMax) {
+            continue;
+        }
+        // for IP, q_to_centroids holds <q, c> in the first half
+        float key = metric_type_ == METRIC_IP ? -q_to_centroids[i] : q_to_centroids[i];
+        order.emplace_back(key, i);
+    }
+    num_seeds = std::min(num_seeds, order.size());
+    std::partial_sort(order.begin(), order.begin() + num_seeds, order.end());
+
+    std::vector<PID> entries(num_seeds);
+    for (size_t i = 0; i < num_seeds; ++i) {
+        entries[i] = cluster_entries_[order[i].second];
+    }
+    if (entries.empty()) {
+        entries.push_back(enterpoint_node_);
+    }
+    return entries;
+}
+
+// Optimized search function, return num of expanded nodes.
+inline size_t HierarchicalNSW::searchBaseLayerST_AdaptiveRerankOpt(
+    const std::vector<PID>& ep_ids,
     size_t ef,
     size_t TOPK,
     SplitSingleQuery<float>& query_wrapper,
-    std::vector<float>& q_to_centroids,  // preprocess
+    const float* q_to_centroids,  // preprocess
     [[maybe_unused]] const float* query,
     BoundedKNN& boundedKNN
 ) {
@@ -1202,27 +1816,21 @@ void HierarchicalNSW::searchBaseLayerST_AdaptiveRerankOpt(
     // Use our bounded priority queue instead of the maxheap.
     buffer::SearchBuffer<float> candidate_set(ef);
 
-    float distk = 1e10;
-
-    EstimateRecord start_estimate_record;
-    get_full_est(q_to_centroids, query_wrapper, ep_id, start_estimate_record);
-    float est_dist = start_estimate_record.est_dist;
-    float low_dist = start_estimate_record.low_dist;
-
-    // Insert initial candidate.
-    boundedKNN.insert({ResultRecord(est_dist, low_dist), ep_id});
-    candidate_set.insert(ep_id, est_dist);
-
-    distk = est_dist;
-
-    vl->set(ep_id);
+    float distk = init_base_layer(
+        ep_ids, query_wrapper, q_to_centroids, *vl, candidate_set, boundedKNN
+    );
 
     const size_t prefetch_size = (((padded_dim_ / 8) + 63) / 64) + 1;
     const size_t prefetch_lookahead = 4;  // Number of neighbors to prefetch in advance.
+    EarlyStop<float> stop(early_stop_);
 
     while (candidate_set.has_next()) {
+        if (stop_base_layer(stop, q_to_centroids, candidate_set, boundedKNN, TOPK)) {
+            break;
+        }
         // Step 1 - get the next node to explore.
         PID current_node_id = candidate_set.pop();
+        bool improved = false;
         int* data = (int*)get_linklist0(current_node_id);
         size_t size = get_list_count((PID*)data);
 
@@ -1242,35 +1850,87 @@ void HierarchicalNSW::searchBaseLayerST_AdaptiveRerankOpt(
             }
             vl->set(candidate_id);
 
-            EstimateRecord candest;
-            get_bin_est(q_to_centroids, query_wrapper, candidate_id, candest);
-
-            bool flag_update_KNNs = boundedKNN.size() < TOPK || candest.low_dist < distk;
-
-            if (flag_update_KNNs) {
-                // Compute the full estimate if promising.
-                if (ex_bits_ > 0) {
-                    get_full_est(q_to_centroids, query_wrapper, candidate_id, candest);
-                }
-                Candidate cand{
-                    ResultRecord(candest.est_dist, candest.low_dist),
-                    static_cast<PID>(candidate_id)
-                };
-                boundedKNN.insert(cand);
-                distk = boundedKNN.worst().record.est_dist;
-            }
-
-            if (!candidate_set.is_full(candest.est_dist)) {
-                candidate_set.insert(candidate_id, candest.est_dist);
-            }
+            improved |= visit_candidate(
+                candidate_id,
+                TOPK,
+                query_wrapper,
+                q_to_centroids,
+                candidate_set,
+                boundedKNN,
+                distk
+            );
 
             rabitqlib::memory::mem_prefetch_l2(
                 (char*)get_linklist0(candidate_set.next_id()), 2
             );
         }
+        stop.expand(improved);
     }
 
     visited_list_pool_->release_vis_list(vl);
+    return stop.hops();
+}
+
+// Insert entry points into the candidate set and the result set, return distk
+inline float HierarchicalNSW::init_base_layer(
+    const std::vector<PID>& ep_ids,
+    SplitSingleQuery<float>& query_wrapper,
+    const float* q_to_centroids,
+    HashBasedBooleanSet& vl,
+    buffer::SearchBuffer<float>& candidate_set,
+    BoundedKNN& boundedKNN
+) const {
+    for (PID ep_id : ep_ids) {
+        if (vl.get(ep_id)) {
+            continue;
+        }
+        vl.set(ep_id);
+
+        EstimateRecord start_estimate_record;
+        get_full_est(q_to_centroids, query_wrapper, ep_id, start_estimate_record);
+        float est_dist = start_estimate_record.est_dist;
+        float low_dist = start_estimate_record.low_dist;
+
+        boundedKNN.insert({ResultRecord(est_dist, low_dist), ep_id});
+        if (!candidate_set.is_full(est_dist)) {
+            candidate_set.insert(ep_id, est_dist);
+        }
+    }
+    return boundedKNN.worst().record.est_dist;
+}
+
+// Estimate the distance of an unvisited node and update the candidate and result sets,
+// return if the node enters the results
+inline bool HierarchicalNSW::visit_candidate(
+    PID candidate_id,
+    size_t TOPK,
+    SplitSingleQuery<float>& query_wrapper,
+    const float* q_to_centroids,
+    buffer::SearchBuffer<float>& candidate_set,
+    BoundedKNN& boundedKNN,
+    float& distk
+) {
+    EstimateRecord candest;
+    get_bin_est(q_to_centroids, query_wrapper, candidate_id, candest);
+
+    bool flag_update_KNNs = boundedKNN.size() < TOPK || candest.low_dist < distk;
+    bool improved = false;
+
+    if (flag_update_KNNs) {
+        // Compute the full estimate if promising.
+        if (ex_bits_ > 0) {
+            get_full_est(q_to_centroids, query_wrapper, candidate_id, candest);
+        }
+        improved = boundedKNN.size() < TOPK || candest.est_dist < distk;
+        Candidate cand{ResultRecord(candest.est_dist, candest.low_dist), candidate_id};
+        boundedKNN.insert(cand);
+        distk = boundedKNN.worst().record.est_dist;
+    }
+
+    if (!candidate_set.is_full(candest.est_dist)) {
+        candidate_set.insert(candidate_id, candest.est_dist);
+    }
+    return improved;
 }
 
 }  // namespace rabitqlib::hnsw
\ No newline at end of file
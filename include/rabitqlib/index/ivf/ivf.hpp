@@ -9,6 +9,7 @@
 #include <cstddef>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <vector>
 
 #include "rabitqlib/defines.hpp"
@@ -28,7 +29,7 @@ namespace rabitqlib::ivf {
 class IVF {
    private:
     Initializer* initer_ = nullptr;      // initializer for find candidate cluster
-    char* batch_data_ = nullptr;         // 1-bit code and factors
+    char* batch_data_ = nullptr;         // FastScan codes (top 1 or 2 bits) and factors
     char* ex_data_ = nullptr;            // code for remaining bits
     PID* ids_ = nullptr;                 // PID of vectors (orgnized by clusters)
     size_t num_;                         // num of data points
@@ -36,12 +37,16 @@ class IVF {
     size_t padded_dim_;                  // dimension after padding,
     size_t num_cluster_;                 // num of centroids (clusters)
     size_t ex_bits_;                     // total bits = ex_bits_ + 1
+    size_t fastscan_bits_ = 1;           // bits per dim scanned by FastScan, 1 or 2
     RotatorType type_;                   // type of rotator
     Rotator<float>* rotator_ = nullptr;  // Data Rotator
     std::vector<Cluster> cluster_lst_;   // List of clusters in ivf
     MetricType metric_type_ = rabitqlib::METRIC_L2;  // metric type
     float (*ip_func_)(const float*, const uint8_t*, size_t) = nullptr;
 
+    // Leading marker in saved files of ivf with 2-bit FastScan codes
+    static constexpr size_t kExtendedMarker = std::numeric_limits<size_t>::max();
+
     void quantize_cluster(
         Cluster&,
         const std::vector<PID>&,
@@ -53,19 +58,29 @@ class IVF {
 
     [[nodiscard]] size_t ids_bytes() const { return sizeof(PID) * num_; }
 
-    // get num of bytes used for 1-bit code and corresponding factors
+    // bits per dim of ex codes, i.e., the bits not scanned by FastScan
+    [[nodiscard]] size_t ex_code_bits() const { return ex_bits_ + 1 - fastscan_bits_; }
+
+    // bytes of a batch, whose codes have fastscan_bits_ bits per dim
+    [[nodiscard]] size_t batch_bytes() const {
+        return BatchDataMap<float>::data_bytes(padded_dim_ * fastscan_bits_);
+    }
+
+    [[nodiscard]] size_t ex_bytes() const {
+        return ExDataMap<float>::data_bytes(padded_dim_, ex_code_bits());
+    }
+
+    // get num of bytes used for FastScan codes and corresponding factors
     [[nodiscard]] size_t batch_data_bytes(const std::vector<size_t>& cluster_sizes) const {
         assert(cluster_sizes.size() == num_cluster_);  // num of clusters
         size_t total_blocks = 0;
         for (auto size : cluster_sizes) {
             total_blocks += div_round_up(size, fastscan::kBatchSize);
         }
-        return total_blocks * BatchDataMap<float>::data_bytes(padded_dim_);
+        return total_blocks * batch_bytes();
     }
 
-    [[nodiscard]] size_t ex_data_bytes() const {
-        return ExDataMap<float>::data_bytes(padded_dim_, ex_bits_) * num_;
-    }
+    [[nodiscard]] size_t ex_data_bytes() const { return ex_bytes() * num_; }
 
     void allocate_memory(const std::vector<size_t>&);
 
@@ -100,7 +115,8 @@ class IVF {
         size_t,
         size_t,
         MetricType metric_type = rabitqlib::METRIC_L2,
-        RotatorType type = RotatorType::FhtKacRotator
+        RotatorType type = RotatorType::FhtKacRotator,
+        size_t fastscan_bits = 1
     );
 
     ~IVF();
@@ -108,6 +124,7 @@ class IVF {
     [[nodiscard]] size_t max_elements() const { return num_; }
     [[nodiscard]] size_t dimension() const { return dim_; }
     [[nodiscard]] size_t nbits() const { return ex_bits_ + 1; }
+    [[nodiscard]] size_t fastscan_bits() const { return fastscan_bits_; }
     [[nodiscard]] MetricType metric_type() const { return metric_type_; }
     [[nodiscard]] RotatorType rotator_type() const { return type_; }
 
@@ -126,19 +143,26 @@ class IVF {
     [[nodiscard]] size_t num_clusters() const { return this->num_cluster_; }
 };
 
+/**
+ * @param fastscan_bits bits per dim scanned by FastScan, 1 or 2 (requires bits >= 2). With
+ * 2 bits, batches hold the top 2 bits of each dim, which gives tighter estimated distances
+ * and lower bounds, and ex codes hold the remaining bits - 2 bits.
+ */
 inline IVF::IVF(
     size_t n,
     size_t dim,
     size_t cluster_num,
     size_t bits,
     MetricType metric_type,
-    RotatorType type
+    RotatorType type,
+    size_t fastscan_bits
 )
     : num_(n)
     , dim_(dim)
     , padded_dim_(dim)
     , num_cluster_(cluster_num)
     , ex_bits_(bits - 1)
+    , fastscan_bits_(fastscan_bits)
     , type_(type)
     , metric_type_(metric_type) {
     if (bits < 1 || bits > 9) {
@@ -147,6 +171,13 @@ inline IVF::IVF(
         std::cerr.flush();
         exit(1);
     };
+    if (fastscan_bits < 1 || fastscan_bits > 2 || fastscan_bits > bits) {
+        std::cerr << "Invalid number of FastScan bits in IVF::IVF\n";
+        std::cerr << "Expected: 1 or 2, at most " << bits << "  Input:" << fastscan_bits
+                  << '\n';
+        std::cerr.flush();
+        exit(1);
+    }
     rotator_ = choose_rotator<float>(dim, type, round_up_to_multiple(dim_, 64));
     padded_dim_ = rotator_->size();
     /* check size */
@@ -219,12 +250,12 @@ inline void IVF::allocate_memory(const std::vector<size_t>& cluster_sizes) {
     }
     this->batch_data_ =
         memory::align_allocate<64, char, true>(batch_data_bytes(cluster_sizes));
-    if (ex_bits_ > 0) {
+    if (ex_code_bits() > 0) {
         this->ex_data_ = memory::align_allocate<64, char, true>(ex_data_bytes());
     }
     this->ids_ = memory::align_allocate<64, PID, true>(ids_bytes());
 
-    this->ip_func_ = select_excode_ipfunc(ex_bits_);
+    this->ip_func_ = select_excode_ipfunc(ex_code_bits());
 }
 
 /**
@@ -239,11 +270,8 @@ inline void IVF::init_clusters(const std::vector<size_t>& cluster_sizes) {
         size_t num = cluster_sizes[i];
         size_t num_batches = div_round_up(num, fastscan::kBatchSize);
 
-        char* current_batch_data =
-            batch_data_ + (BatchDataMap<float>::data_bytes(padded_dim_) * added_batches);
-        char* current_ex_data =
-            ex_data_ +
-            (added_vectors * ExDataMap<float>::data_bytes(padded_dim_, ex_bits_));
+        char* current_batch_data = batch_data_ + (batch_bytes() * added_batches);
+        char* current_ex_data = ex_data_ + (added_vectors * ex_bytes());
         PID* ids = ids_ + added_vectors;
 
         Cluster cur_cluster(num, current_batch_data, current_ex_data, ids);
@@ -286,20 +314,34 @@ inline void IVF::quantize_cluster(
     for (size_t i = 0; i < num_points; i += fastscan::kBatchSize) {
         size_t n = std::min(fastscan::kBatchSize, num_points - i);
 
-        quant::quantize_split_batch(
-            rotated_data.data() + (i * padded_dim_),
-            rotated_centroid,
-            n,
-            padded_dim_,
-            ex_bits_,
-            batch_data,
-            ex_data,
-            metric_type_,
-            config
-        );
+        if (fastscan_bits_ == 2) {
+            quant::quantize_split_batch_2bit(
+                rotated_data.data() + (i * padded_dim_),
+                rotated_centroid,
+                n,
+                padded_dim_,
+                ex_bits_,
+                batch_data,
+                ex_data,
+                metric_type_,
+                config
+            );
+        } else {
+            quant::quantize_split_batch(
+                rotated_data.data() + (i * padded_dim_),
+                rotated_centroid,
+                n,
+                padded_dim_,
+                ex_bits_,
+                batch_data,
+                ex_data,
+                metric_type_,
+                config
+            );
+        }
 
-        batch_data += BatchDataMap<float>::data_bytes(padded_dim_);
-        ex_data += ExDataMap<float>::data_bytes(padded_dim_, ex_bits_) * n;
+        batch_data += batch_bytes();
+        ex_data += ex_bytes() * n;
     }
 }
 
@@ -311,6 +353,14 @@ inline void IVF::save(const char* filename) const {
 
     std::ofstream output(filename, std::ios::binary);
 
+    /* 2-bit FastScan codes are marked before the meta data, other indices keep the old
+     * format */
+    if (fastscan_bits_ != 1) {
+        size_t marker = kExtendedMarker;
+        output.write(reinterpret_cast<const char*>(&marker), sizeof(size_t));
+        output.write(reinterpret_cast<const char*>(&fastscan_bits_), sizeof(size_t));
+    }
+
     /* Save meta data */
     output.write(reinterpret_cast<const char*>(&num_), sizeof(size_t));
     output.write(reinterpret_cast<const char*>(&dim_), sizeof(size_t));
@@ -354,7 +404,12 @@ inline void IVF::load(const char* filename) {
 
     /* Load meta data */
     std::cout << "\tLoading meta data...\n";
+    fastscan_bits_ = 1;
     input.read(reinterpret_cast<char*>(&this->num_), sizeof(size_t));
+    if (num_ == kExtendedMarker) {
+        input.read(reinterpret_cast<char*>(&fastscan_bits_), sizeof(size_t));
+        input.read(reinterpret_cast<char*>(&this->num_), sizeof(size_t));
+    }
     input.read(reinterpret_cast<char*>(&this->dim_), sizeof(size_t));
     input.read(reinterpret_cast<char*>(&this->num_cluster_), sizeof(size_t));
     input.read(reinterpret_cast<char*>(&this->ex_bits_), sizeof(size_t));
@@ -425,7 +480,7 @@ inline void IVF::search(
     buffer::SearchBuffer knns(k);
 
     SplitBatchQuery<float> q_obj(
-        rotated_query.data(), padded_dim_, ex_bits_, metric_type_, use_hacc
+        rotated_query.data(), padded_dim_, ex_bits_, metric_type_, use_hacc, fastscan_bits_
     );
 
     for (size_t i = 0; i < nprobe; ++i) {
@@ -476,9 +531,8 @@ inline void IVF::search_cluster(
             batch_data, ex_data, ids, q_obj, knns, fastscan::kBatchSize, use_hacc
         );
 
-        batch_data += BatchDataMap<float>::data_bytes(padded_dim_);
-        ex_data +=
-            ExDataMap<float>::data_bytes(padded_dim_, ex_bits_) * fastscan::kBatchSize;
+        batch_data += batch_bytes();
+        ex_data += ex_bytes() * fastscan::kBatchSize;
         ids += fastscan::kBatchSize;
     }
 
@@ -499,22 +553,26 @@ inline void IVF::scan_one_batch(
 ) const {
     std::array<float, fastscan::kBatchSize> est_distance;  // estimated distance
     std::array<float, fastscan::kBatchSize> low_distance;  // lower distance
-    std::array<float, fastscan::kBatchSize> ip_x0_qr;      // inner product of the 1st bit
+    std::array<float, fastscan::kBatchSize> ip_x0_qr;      // inner product of top bits
 
-    split_batch_estdist(
+    float distk = knns.top_dist();
+    // vectors whose lower bounds are below the current k-th distance
+    uint64_t candidates = split_batch_estdist(
         batch_data,
         q_obj,
-        padded_dim_,
+        padded_dim_ * fastscan_bits_,
         est_distance.data(),
         low_distance.data(),
         ip_x0_qr.data(),
-        use_hacc
+        use_hacc,
+        distk
     );
+    if (num_points < fastscan::kBatchSize) {
+        candidates &= (1ULL << num_points) - 1;
+    }
 
-    float distk = knns.top_dist();
-
-    // if only use 1-bit code, directly return
-    if (ex_bits_ == 0) {
+    // if FastScan codes hold all bits, directly return
+    if (ex_code_bits() == 0) {
         for (size_t i = 0; i < num_points; ++i) {
             PID id = ids[i];
             float ex_dist = est_distance[i];
@@ -524,19 +582,22 @@ inline void IVF::scan_one_batch(
         return;
     }
 
-    // incremental distance computation - V2
-    for (size_t i = 0; i < num_points; ++i) {
-        float lower_dist = low_distance[i];
-        if (lower_dist < distk) {
-            PID id = ids[i];
-            ConstExDataMap<float> cur_ex(ex_data, padded_dim_, ex_bits_);
+    // incremental distance computation - V2, only visit candidates, distk may have
+    // decreased since the mask was computed
+    for (; candidates != 0; candidates &= candidates - 1) {
+        auto i = static_cast<size_t>(__builtin_ctzll(candidates));
+        if (low_distance[i] < distk) {
             float ex_dist = split_distance_boosting(
-                ex_data, ip_func_, q_obj, padded_dim_, ex_bits_, ip_x0_qr[i]
+                ex_data + (i * ex_bytes()),
+                ip_func_,
+                q_obj,
+                padded_dim_,
+                ex_code_bits(),
+                ip_x0_qr[i]
             );
-            knns.insert(id, ex_dist);
+            knns.insert(ids[i], ex_dist);
             distk = knns.top_dist();
         }
-        ex_data += ExDataMap<float>::data_bytes(padded_dim_, ex_bits_);
     }
 }
 }  // namespace rabitqlib::ivf
\ No newline at end of file
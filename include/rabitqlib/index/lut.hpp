@@ -24,34 +24,27 @@ class Lut {
 
    public:
     explicit Lut() = default;
-    explicit Lut(const T* rotated_query, size_t padded_dim, bool use_hacc = false)
-        : table_length_(padded_dim << 2)
-        , lut_(table_length_ * (static_cast<int>(use_hacc) + 1)) {
-        // quantize float lut
-        std::vector<float> lut_float(table_length_);
-        fastscan::pack_lut(padded_dim, rotated_query, lut_float.data());
-        T vl_lut;
-        T vr_lut;
-        data_range(lut_float.data(), table_length_, vl_lut, vr_lut);
+    explicit Lut(const T* rotated_query, size_t padded_dim, bool use_hacc = false) {
+        build(rotated_query, padded_dim, use_hacc);
+    }
 
-        if (use_hacc) {
-            delta_ = (vr_lut - vl_lut) / ((1 << kNumBitsHacc) - 1);
+    // build the lut of a new query, the table is reused if it is large enough
+    void build(const T* rotated_query, size_t padded_dim, bool use_hacc = false) {
+        table_length_ = padded_dim << 2;
+        lut_.resize(table_length_ * (static_cast<int>(use_hacc) + 1));
 
-            // quantize float lut into uint16 then change to split table
-            std::vector<uint16_t> lut_u16(table_length_);
-            scalar_quantize(
-                lut_u16.data(), lut_float.data(), table_length_, vl_lut, delta_
-            );
-            fastscan::transfer_lut_hacc(lut_u16.data(), padded_dim, lut_.data());
-        } else {
-            delta_ = (vr_lut - vl_lut) / ((1 << kNumBits) - 1);
-            scalar_quantize(lut_.data(), lut_float.data(), table_length_, vl_lut, delta_);
-        }
+        // build and quantize the float lut in one go, kNumBits or kNumBitsHacc bits
+        float delta;
+        float vl_lut = fastscan::quantize_lut(
+            rotated_query, padded_dim, use_hacc, lut_.data(), delta
+        );
+        delta_ = delta;
 
         size_t num_table = table_length_ / 16;
         sum_vl_lut_ = vl_lut * static_cast<float>(num_table);
     }
     Lut& operator=(Lut&& other) noexcept {
+        table_length_ = other.table_length_;
         lut_ = std::move(other.lut_);
         delta_ = other.delta_;
         sum_vl_lut_ = other.sum_vl_lut_;
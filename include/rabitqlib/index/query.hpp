@@ -3,7 +3,9 @@
 #include <cmath>
 #include <cstdint>
 #include <numeric>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "rabitqlib/defines.hpp"
 #include "rabitqlib/index/lut.hpp"
@@ -11,26 +13,97 @@
 #include "rabitqlib/utils/space.hpp"
 
 namespace rabitqlib {
+/**
+ * @brief The rotated query quantized to int8 for inner products with ex codes by integer
+ * kernels (select_excode_ipfunc_i8). It stays empty if the cpu has no such kernels, then
+ * ex codes use the float query.
+ */
+class ExQueryI8 {
+   private:
+    std::vector<int8_t> query_;
+    float delta_ = 0;
+    ex_ipfunc_i8 ip_func_ = nullptr;
+
+   public:
+    ExQueryI8() = default;
+
+    template <typename T>
+    explicit ExQueryI8(const T* rotated_query, size_t padded_dim, size_t ex_bits) {
+        reset(rotated_query, padded_dim, ex_bits);
+    }
+
+    // quantize a new query, the buffer is reused if it is large enough
+    template <typename T>
+    void reset(const T* rotated_query, size_t padded_dim, size_t ex_bits) {
+        ip_func_ = select_excode_ipfunc_i8(ex_bits);
+        if (ip_func_ == nullptr) {
+            return;
+        }
+        query_.resize(padded_dim);
+        if constexpr (std::is_same_v<T, float>) {
+            delta_ = quantize_int8_symmetric(rotated_query, padded_dim, query_.data());
+        } else {
+            std::vector<float> query(rotated_query, rotated_query + padded_dim);
+            delta_ = quantize_int8_symmetric(query.data(), padded_dim, query_.data());
+        }
+    }
+
+    [[nodiscard]] bool empty() const { return ip_func_ == nullptr; }
+
+    // approximate inner product of the rotated query and compact ex codes
+    [[nodiscard]] float ip(const uint8_t* ex_code, size_t padded_dim) const {
+        return delta_ * static_cast<float>(ip_func_(query_.data(), ex_code, padded_dim));
+    }
+};
+
 /**
  * @brief use an object to store data used for searching on symphonyqg for a given query
  */
 template <typename T>
 class BatchQuery {
    private:
+    const T* rotated_query_ = nullptr;
     Lut<T> lookup_table_;
+    ExQueryI8 ex_query_;
     T G_add_ = 0;
     T G_k1xSumq_ = 0;  // G_k1xSumq
+    T G_kbxSumq_ = 0;  // only used if neighbors have ex-bits codes
 
    public:
-    explicit BatchQuery(const T* rotated_query, size_t padded_dim) {
-        lookup_table_ = std::move(Lut<T>(rotated_query, padded_dim));
+    BatchQuery() = default;
+
+    explicit BatchQuery(const T* rotated_query, size_t padded_dim, size_t ex_bits = 0) {
+        reset(rotated_query, padded_dim, ex_bits);
+    }
+
+    // init the object for a new query, buffers of the last one are reused
+    void reset(const T* rotated_query, size_t padded_dim, size_t ex_bits = 0) {
+        rotated_query_ = rotated_query;
+        ex_query_.reset(rotated_query, padded_dim, ex_bits);
+        lookup_table_.build(rotated_query, padded_dim);
+        G_add_ = 0;
 
         float c_1 = -((1 << 1) - 1) / 2.F;
+        float c_b = -static_cast<float>((1 << (ex_bits + 1)) - 1) / 2.F;
 
         T sumq =
             std::accumulate(rotated_query, rotated_query + padded_dim, static_cast<T>(0));
 
         G_k1xSumq_ = sumq * c_1;
+        G_kbxSumq_ = sumq * c_b;
+    }
+
+    [[nodiscard]] const T* rotated_query() const { return rotated_query_; }
+
+    // inner product of the rotated query and compact ex codes, by integer kernels if the
+    // cpu has them
+    [[nodiscard]] T ex_ip(
+        ex_ipfunc ip_func, const uint8_t* ex_code, size_t padded_dim
+    ) const {
+        if (ex_query_.empty()) {
+            return ip_func(rotated_query_, ex_code, padded_dim);
+        }
+        return ex_query_.ip(ex_code, padded_dim);
     }
 
     [[nodiscard]] T delta() const { return lookup_table_.delta(); }
@@ -39,6 +112,8 @@ class BatchQuery {
 
     [[nodiscard]] T k1xsumq() const { return G_k1xSumq_; }
 
+    [[nodiscard]] T kbxsumq() const { return G_kbxSumq_; }
+
     [[nodiscard]] T g_add() const { return G_add_; }
 
     void set_g_add(T dist) {
@@ -53,8 +128,10 @@ class BatchQuery {
 template <typename T>
 class SplitBatchQuery {
    private:
-    const T* rotated_query_;
+    const T* rotated_query_ = nullptr;
     Lut<T> lookup_table_;
+    std::vector<T> two_bit_query_;  // scratch of the query over 2 bits per dim
+    ExQueryI8 ex_query_;
     T G_add_ = 0;
     T G_error_ = 0;
     T G_k1xSumq_ = 0;
@@ -62,19 +139,53 @@ class SplitBatchQuery {
     MetricType metric_type_ = METRIC_L2;
 
    public:
+    /**
+     * @param fastscan_bits bits per dimension of codes in batches, 1 or 2. With 2 bits
+     * (see quant::quantize_split_batch_2bit) the lut is built over 2 * padded_dim dims
+     * and ex codes hold the remaining ex_bits - 1 bits.
+     */
+    SplitBatchQuery() = default;
+
     explicit SplitBatchQuery(
         const T* rotated_query,
         size_t padded_dim,
         size_t ex_bits,
         MetricType metric_type = METRIC_L2,
-        bool use_hacc = true
-    )
-        : rotated_query_(rotated_query) {
-        lookup_table_ = std::move(Lut<T>(rotated_query, padded_dim, use_hacc));
+        bool use_hacc = true,
+        size_t fastscan_bits = 1
+    ) {
+        reset(rotated_query, padded_dim, ex_bits, metric_type, use_hacc, fastscan_bits);
+    }
+
+    // init the object for a new query, buffers of the last one are reused
+    void reset(
+        const T* rotated_query,
+        size_t padded_dim,
+        size_t ex_bits,
+        MetricType metric_type = METRIC_L2,
+        bool use_hacc = true,
+        size_t fastscan_bits = 1
+    ) {
+        rotated_query_ = rotated_query;
+        ex_query_.reset(rotated_query, padded_dim, ex_bits + 1 - fastscan_bits);
+        G_add_ = 0;
+        G_error_ = 0;
+        if (fastscan_bits == 2) {
+            // the higher bit of each dim weighs 2, the lower one 1
+            two_bit_query_.resize(padded_dim * 2);
+            for (size_t i = 0; i < padded_dim; ++i) {
+                two_bit_query_[2 * i] = 2 * rotated_query[i];
+                two_bit_query_[(2 * i) + 1] = rotated_query[i];
+            }
+            lookup_table_.build(two_bit_query_.data(), padded_dim * 2, use_hacc);
+        } else {
+            lookup_table_.build(rotated_query, padded_dim, use_hacc);
+        }
 
         metric_type_ = (metric_type == METRIC_IP) ? METRIC_IP : METRIC_L2;
 
-        float c_1 = -static_cast<float>((1 << 1) - 1) / 2.F;
+        // G_k1xSumq_ centers the codes in batches
+        float c_1 = -static_cast<float>((1 << fastscan_bits) - 1) / 2.F;
         float c_b = -static_cast<float>((1 << (ex_bits + 1)) - 1) / 2.F;
         T sumq =
             std::accumulate(rotated_query, rotated_query + padded_dim, static_cast<T>(0));
@@ -82,8 +193,20 @@ class SplitBatchQuery {
         G_k1xSumq_ = sumq * c_1;
         G_kbxSumq_ = sumq * c_b;
     }
+
     [[nodiscard]] const T* rotated_query() const { return rotated_query_; }
 
+    // inner product of the rotated query and compact ex codes, by integer kernels if the
+    // cpu has them
+    [[nodiscard]] T ex_ip(
+        ex_ipfunc ip_func, const uint8_t* ex_code, size_t padded_dim
+    ) const {
+        if (ex_query_.empty()) {
+            return ip_func(rotated_query_, ex_code, padded_dim);
+        }
+        return ex_query_.ip(ex_code, padded_dim);
+    }
+
     [[nodiscard]] T delta() const { return lookup_table_.delta(); }
 
     [[nodiscard]] T sum_vl_lut() const { return lookup_table_.sum_vl(); }
@@ -112,26 +235,57 @@ class SplitBatchQuery {
 template <typename T>
 class SplitSingleQuery {
    private:
-    const T* rotated_query_;
+    const T* rotated_query_ = nullptr;
     std::vector<uint64_t> QueryBin_;
-    T G_add_;
-    T G_k1xSumq_;
-    T G_kbxSumq_;
-    T G_error_;
-    T delta_;
-    T vl_;
+    std::vector<uint8_t> quant_query_;  // scratch of the scalar quantized query
+    ExQueryI8 ex_query_;
+    T G_add_ = 0;
+    T G_k1xSumq_ = 0;
+    T G_kbxSumq_ = 0;
+    T G_error_ = 0;
+    T delta_ = 0;
+    T vl_ = 0;
     MetricType metric_type_ = METRIC_L2;
+    size_t num_bits_ = kNumBits;
 
    public:
+    // default bits per dim of the quantized query
     static constexpr size_t kNumBits = 4;
+
+    /**
+     * @param config should be quant::faster_config(padded_dim, num_bits)
+     * @param num_bits bits per dim of the quantized query, 1 to 8 (kMaxQueryBits). Fewer
+     * bits make warmup_ip_x0_q_512 faster and the estimated distances less accurate,
+     * kernels are unrolled for 2, 4, 6 and 8 bits.
+     */
+    SplitSingleQuery() = default;
+
     explicit SplitSingleQuery(
         const T* rotated_query,
         size_t padded_dim,
         size_t ex_bits,
         quant::RabitqConfig config,
-        size_t metric_type = METRIC_L2
-    )
-        : rotated_query_(rotated_query), QueryBin_(padded_dim * kNumBits / 64, 0) {
+        size_t metric_type = METRIC_L2,
+        size_t num_bits = kNumBits
+    ) {
+        reset(rotated_query, padded_dim, ex_bits, config, metric_type, num_bits);
+    }
+
+    // init the object for a new query, buffers of the last one are reused
+    void reset(
+        const T* rotated_query,
+        size_t padded_dim,
+        size_t ex_bits,
+        quant::RabitqConfig config,
+        size_t metric_type = METRIC_L2,
+        size_t num_bits = kNumBits
+    ) {
+        rotated_query_ = rotated_query;
+        num_bits_ = num_bits;
+        ex_query_.reset(rotated_query, padded_dim, ex_bits);
+        G_add_ = 0;
+        G_error_ = 0;
+
         float c_1 = -static_cast<float>((1 << 1) - 1) / 2.F;
         float c_b = -static_cast<float>((1 << (ex_bits + 1)) - 1) / 2.F;
         T sumq =
@@ -142,28 +296,38 @@ class SplitSingleQuery {
 
         metric_type_ = (metric_type == METRIC_IP) ? METRIC_IP : METRIC_L2;
 
-        std::vector<uint8_t> quant_query(padded_dim);
+        quant_query_.resize(padded_dim);
 
         // quantize query by rabitq
         quant::quantize_scalar<float, uint8_t>(
-            rotated_query, padded_dim, kNumBits, quant_query.data(), delta_, vl_, config
+            rotated_query, padded_dim, num_bits_, quant_query_.data(), delta_, vl_, config
         );
 
-        // represent quantized query as u64
+        // represent quantized query as u64, new_transpose_bin_512 stores it in the
+        // bit-plane/chunk layout consumed by warmup_ip_x0_q_512
+        QueryBin_.assign(padded_dim * num_bits_ / 64, 0);
         rabitqlib::new_transpose_bin_512(
-            quant_query.data(), QueryBin_.data(), padded_dim, kNumBits
+            quant_query_.data(), QueryBin_.data(), padded_dim, num_bits_
         );
-
-        // new_transpose_bin_512 already stores the query in the bit-plane/chunk
-        // layout consumed by warmup_ip_x0_q_512.
     }
 
-    [[nodiscard]] size_t num_bits() const { return kNumBits; }
+    [[nodiscard]] size_t num_bits() const { return num_bits_; }
 
     [[nodiscard]] const uint64_t* query_bin() const { return QueryBin_.data(); }
 
     [[nodiscard]] const T* rotated_query() const { return rotated_query_; }
 
+    // inner product of the rotated query and compact ex codes, by integer kernels if the
+    // cpu has them
+    [[nodiscard]] T ex_ip(
+        ex_ipfunc ip_func, const uint8_t* ex_code, size_t padded_dim
+    ) const {
+        if (ex_query_.empty()) {
+            return ip_func(rotated_query_, ex_code, padded_dim);
+        }
+        return ex_query_.ip(ex_code, padded_dim);
+    }
+
     [[nodiscard]] T delta() const { return delta_; }
 
     [[nodiscard]] T vl() const { return vl_; }
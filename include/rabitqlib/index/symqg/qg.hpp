@@ -2,13 +2,17 @@
 
 #include <omp.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <ostream>
 #include <vector>
 
@@ -20,21 +24,30 @@
 #include "rabitqlib/quantization/rabitq.hpp"
 #include "rabitqlib/utils/array.hpp"
 #include "rabitqlib/utils/buffer.hpp"
+#include "rabitqlib/utils/early_stop.hpp"
 #include "rabitqlib/utils/hashset.hpp"
 #include "rabitqlib/utils/io.hpp"
+#include "rabitqlib/utils/low_precision.hpp"
 #include "rabitqlib/utils/memory.hpp"
+#include "rabitqlib/utils/reorder.hpp"
 #include "rabitqlib/utils/rotator.hpp"
 #include "rabitqlib/utils/space.hpp"
 #include "rabitqlib/utils/visited_pool.hpp"
 
 namespace rabitqlib::symqg {
 
+template <typename T>
+class DiskQuantizedGraph;
+
 template <typename T = float>
 class QuantizedGraph {
     friend class QGBuilder;
+    friend class QGPartitionBuilder;
+    friend class DiskQuantizedGraph<T>;
 
    private:
     size_t num_points_ = 0;                           // num points
+    size_t capacity_ = 0;                             // num of allocated rows (add_rows())
     size_t degree_bound_ = 0;                         // degree bound
     size_t dim_ = 0;                                  // dimension
     size_t padded_dim_ = 0;                           // padded dimension
@@ -42,6 +55,13 @@ class QuantizedGraph {
     PID entry_point_ = 0;                             // Entry point of graph
     MetricType metric_type_ = MetricType::METRIC_L2;
     RotatorType rotator_type_ = RotatorType::FhtKacRotator;
+    RawDataType raw_type_ = RAW_FP32;        // storage type of raw vectors in rows
+    RawDistFunc query_dist_func_ = nullptr;  // dist func for query and stored vector
+    size_t ex_bits_ = 0;                     // num of ex-bits in codes of neighbors
+    float (*ip_func_)(const float*, const uint8_t*, size_t) = nullptr;  // ip on ex codes
+    quant::RabitqConfig config_;             // config for quantizing ex-bits codes
+    bool use_raw_dist_ = true;  // if false, search only uses estimated distances
+    EarlyStopParams early_stop_;  // adaptive termination of search, disabled by default
 
     Array<
         char,
@@ -54,14 +74,22 @@ class QuantizedGraph {
     Rotator<T>* rotator_ = nullptr;  // data rotator
     std::unique_ptr<VisitedListPool> visited_list_pool_ = nullptr;
 
-    // Position of different data in each row (RawData + QuantizationCodes + Factors +
-    // neighborIDs) Since we guarantee the degree for each vertex equals degree_bound
-    // (multiple of 32), we do not need to store the degree for each vertex
+    // Position of different data in each row (RawData + SelfCodes + QuantizationCodes +
+    // Factors + ExCodes + neighborIDs) Since we guarantee the degree for each vertex equals
+    // degree_bound (multiple of 32), we do not need to store the degree for each vertex
+    size_t self_data_offset_ = 0;   // offset of codes of the vertex itself
     size_t batch_data_offset_ = 0;  // offset of qg batch data
+    size_t ex_data_offset_ = 0;     // offset of ex-bits codes of neighbors
     size_t neighbor_offset_ = 0;    // offset of neighbors
     size_t row_offset_ = 0;         // length of entire row
     size_t ef_ = 0;
 
+    // Leading marker in saved files of qg with compressed raw vectors or ex-bits codes
+    static constexpr size_t kExtendedMarker = std::numeric_limits<size_t>::max();
+
+    // Original id of each vertex after reorder(), empty if vertices were never permuted
+    std::vector<PID> external_ids_;
+
     void initialize();
 
     void copy_vectors(const T*);
@@ -74,6 +102,20 @@ class QuantizedGraph {
         return reinterpret_cast<const T*>(&data_.at(row_offset_ * data_id));
     }
 
+    // exact distance between a query and the (possibly compressed) vector of a vertex
+    [[nodiscard]] T raw_dist(const T* query, PID data_id) const {
+        return query_dist_func_(query, &data_.at(row_offset_ * data_id), dim_);
+    }
+
+    // codes of the vertex itself with the entry point as centroid, only if ex_bits_ > 0
+    [[nodiscard]] char* get_self_data(PID data_id) {
+        return &data_.at((row_offset_ * data_id) + self_data_offset_);
+    }
+
+    [[nodiscard]] const char* get_self_data(PID data_id) const {
+        return &data_.at((row_offset_ * data_id) + self_data_offset_);
+    }
+
     [[nodiscard]] char* get_batch_data(PID data_id) {
         return &data_.at((row_offset_ * data_id) + batch_data_offset_);
     }
@@ -82,14 +124,16 @@ class QuantizedGraph {
         return &data_.at((row_offset_ * data_id) + batch_data_offset_);
     }
 
-    [[nodiscard]] PID* get_neighbors(PID data_id) {
-        return reinterpret_cast<PID*>(
-            &data_.at((row_offset_ * data_id) + neighbor_offset_)
-        );
+    [[nodiscard]] char* get_ex_data(PID data_id) {
+        return &data_.at((row_offset_ * data_id) + ex_data_offset_);
     }
 
-    [[nodiscard]] const PID* get_neighbors(PID data_id) const {
-        return reinterpret_cast<const PID*>(
+    [[nodiscard]] const char* get_ex_data(PID data_id) const {
+        return &data_.at((row_offset_ * data_id) + ex_data_offset_);
+    }
+
+    [[nodiscard]] PID* get_neighbors(PID data_id) {
+        return reinterpret_cast<PID*>(
             &data_.at((row_offset_ * data_id) + neighbor_offset_)
         );
     }
@@ -104,12 +148,115 @@ class QuantizedGraph {
 
     void update_qg(PID, const std::vector<AnnCandidate<T>>&);
 
-    void update_results(buffer::SearchBuffer<T>&, HashBasedBooleanSet&, const T*);
+    void set_neighbors(PID, const std::vector<AnnCandidate<T>>&);
+
+    void update_codes(PID, size_t);
+
+    void add_rows(size_t);
+
+    // set by builders before quantization, since ex-bits codes are quantized with the
+    // entry point as centroid and would be invalidated by a later change
+    void set_ep(PID entry) { this->entry_point_ = entry; };
+
+    void update_results(buffer::SearchBuffer<T>&, HashBasedBooleanSet&, const T*) const;
+
+    void map_to_external(PID*, size_t) const;
+
+    // prefetch the whole row of a vertex
+    void prefetch_row(PID data_id) const {
+        const char* row = &data_.at(row_offset_ * data_id);
+        for (size_t i = 0; i < row_offset_; i += 64) {
+            memory::prefetch_l1(row + i);
+        }
+    }
+
+    // Scratch buffers of one searching thread, reused across queries
+    struct SearchContext {
+        std::vector<T> rotated_query;
+        BatchQuery<T> q_obj;  // lut and quantized query, rebuilt for each query
+        std::vector<T> est_dist;
+        std::vector<T> ip_x0_qr;
+        buffer::SearchBuffer<T> search_pool;
+        buffer::SearchBuffer<T> res_pool;
+        HashBasedBooleanSet* vis;
+
+        SearchContext(
+            size_t padded_dim, size_t degree, size_t ef, size_t k, HashBasedBooleanSet* v
+        )
+            : rotated_query(padded_dim)
+            , est_dist(degree)
+            , ip_x0_qr(degree)
+            , search_pool(ef)
+            , res_pool(k)
+            , vis(v) {}
+    };
+
+    size_t search_with_context(const T*, SearchContext&, uint32_t*, T*) const;
+
+    // record a visited vertex for early stop, est is the distance it was popped with
+    void record_visit(EarlyStop<T>& stop, T est, T dist, bool improved) const {
+        if (est != std::numeric_limits<T>::max()) {
+            stop.add_error(std::abs(est - dist));
+        }
+        stop.expand(improved);
+    }
+
+    // whether to stop before expanding the next candidate. Codes of QG store no error
+    // factor, so the lower bound of a candidate takes off the largest error observed in
+    // this query.
+    [[nodiscard]] static bool stop_search(
+        const EarlyStop<T>& stop,
+        const buffer::SearchBuffer<T>& search_pool,
+        const buffer::SearchBuffer<T>& res_pool
+    ) {
+        return stop.stop(search_pool.next_dist() - stop.max_error(), res_pool.top_dist());
+    }
+
+    // State of one query in interleaved search, reused by the following queries
+    struct SearchState {
+        const T* query = nullptr;
+        std::vector<T> rotated_query;
+        BatchQuery<T> q_obj;
+        buffer::SearchBuffer<T> search_pool;
+        buffer::SearchBuffer<T> res_pool;
+        HashBasedBooleanSet* vis = nullptr;
+        EarlyStop<T> stop;
+        PID cur_node = kPidMax;  // popped vertex whose row is being prefetched
+        T cur_est = 0;           // estimated distance cur_node was popped with
+        T ep_dist = 0;           // distance to entry point, used without raw distances
+
+        SearchState(size_t padded_dim, size_t ef, size_t k, const EarlyStopParams& params)
+            : rotated_query(padded_dim), search_pool(ef), res_pool(k), stop(params) {}
+
+        // start a new query, rotated_query is filled by the caller
+        void reset(const T* q, size_t ex_bits, const EarlyStopParams& params) {
+            query = q;
+            q_obj.reset(rotated_query.data(), rotated_query.size(), ex_bits);
+            search_pool.clear();
+            res_pool.clear();
+            stop = EarlyStop<T>(params);
+            cur_node = kPidMax;
+            cur_est = 0;
+        }
+    };
+
+    bool search_step(SearchState&, T*, T*);
+
+    T self_dist(const BatchQuery<T>&, PID, T) const;
+
+    // distance to the visited vertex, used as g_add for estimating its neighbors
+    [[nodiscard]] T visit_dist(
+        const T* query, const BatchQuery<T>& q_obj, PID data_id, T ep_dist
+    ) const {
+        return use_raw_dist_ ? raw_dist(query, data_id)
+                             : self_dist(q_obj, data_id, ep_dist);
+    }
 
     void scan_neighbors(
         const BatchQuery<T>&,
         PID,
         T*,
+        T*,
         buffer::SearchBuffer<T>&,
         HashBasedBooleanSet&,
         size_t
@@ -121,7 +268,8 @@ class QuantizedGraph {
         size_t dim,
         size_t max_deg,
         MetricType metric_type = METRIC_L2,
-        RotatorType rotator_type = RotatorType::FhtKacRotator
+        RotatorType rotator_type = RotatorType::FhtKacRotator,
+        size_t ex_bits = 0
     );
 
     explicit QuantizedGraph() = default;
@@ -138,7 +286,40 @@ class QuantizedGraph {
 
     [[nodiscard]] auto metric_type() const { return this->metric_type_; }
 
-    void set_ep(PID entry) { this->entry_point_ = entry; };
+    [[nodiscard]] auto raw_data_type() const { return this->raw_type_; }
+
+    [[nodiscard]] auto ex_bits() const { return this->ex_bits_; }
+
+    // ids of the degree_bound() neighbors of a vertex
+    [[nodiscard]] const PID* get_neighbors(PID data_id) const {
+        return reinterpret_cast<const PID*>(
+            &data_.at((row_offset_ * data_id) + neighbor_offset_)
+        );
+    }
+
+
+    /**
+     * @brief If false, search only uses estimated distances. Visited vertices are
+     * estimated by their own codes and their neighbors by ex-bits codes of neighbors, so
+     * that only the raw vector of the entry point is read per query. Distances of results
+     * are estimated too. Requires ex_bits > 0, true by default. These codes are quantized
+     * with the entry point as centroid, which is fixed by the builders, so the entry point
+     * can not be changed once the index is built.
+     */
+    void set_use_raw_dist(bool use_raw_dist) {
+        if (!use_raw_dist && ex_bits_ == 0) {
+            std::cerr << "Searching qg without raw vectors requires ex-bits codes\n";
+            exit(1);
+        }
+        this->use_raw_dist_ = use_raw_dist;
+    }
+
+    /**
+     * @brief Adaptive termination of search (see EarlyStopParams), disabled by default.
+     * For error_gap, the estimation error is measured by the difference between the
+     * estimated and exact distances of visited vertices.
+     */
+    void set_early_stop(const EarlyStopParams& params) { this->early_stop_ = params; }
 
     void save(const char*) const;
 
@@ -146,19 +327,50 @@ class QuantizedGraph {
 
     void set_ef(size_t);
 
-    /* search and copy results to KNN */
-    void search(const T* __restrict__ query, uint32_t knn, uint32_t* __restrict__ results);
-    void search(
+    void reorder();
+
+    void compress_raw_vectors(RawDataType);
+
+    /* search and copy results to KNN, return num of expanded vertices */
+    size_t search(
+        const T* __restrict__ query, uint32_t knn, uint32_t* __restrict__ results
+    );
+    size_t search(
         const T* __restrict__ query,
         uint32_t knn,
         uint32_t* __restrict__ results,
         T* __restrict__ dists
     );
+
+    void search_batch(
+        const T* __restrict__ queries,
+        size_t num_queries,
+        uint32_t k,
+        size_t ef,
+        size_t num_threads,
+        uint32_t* __restrict__ results,
+        T* __restrict__ dists = nullptr,
+        uint32_t* __restrict__ hops = nullptr
+    ) const;
+
+    void search_interleaved(
+        const T* __restrict__ queries,
+        size_t num_queries,
+        uint32_t k,
+        uint32_t* __restrict__ results,
+        size_t num_interleave = 8,
+        uint32_t* __restrict__ hops = nullptr
+    );
 };
 
 template <typename T>
 inline QuantizedGraph<T>::QuantizedGraph(
-    size_t num, size_t dim, size_t max_deg, MetricType metric_type, RotatorType rotator_type
+    size_t num,
+    size_t dim,
+    size_t max_deg,
+    MetricType metric_type,
+    RotatorType rotator_type,
+    size_t ex_bits
 )
     : num_points_(num)
     , degree_bound_(max_deg)
@@ -166,7 +378,12 @@ inline QuantizedGraph<T>::QuantizedGraph(
     , padded_dim_(dim)
     , raw_dist_func_((metric_type == METRIC_IP) ? dot_product_dis<T> : euclidean_sqr<T>)
     , metric_type_(metric_type)
-    , rotator_type_(rotator_type) {
+    , rotator_type_(rotator_type)
+    , ex_bits_(ex_bits) {
+    if (ex_bits_ > 8) {
+        std::cerr << "Invalid number of ex-bits for qg: " << ex_bits_ << '\n';
+        exit(1);
+    }
     initialize();
 }
 
@@ -192,6 +409,15 @@ inline void QuantizedGraph<T>::save(const char* filename) const {
     std::ofstream output(filename, std::ios::binary);
     assert(output.is_open());
 
+    /* Compressed raw vectors and ex-bits codes are marked before the header, other
+     * indices keep the old format */
+    if (raw_type_ != RAW_FP32 || ex_bits_ > 0) {
+        size_t marker = kExtendedMarker;
+        output.write(reinterpret_cast<const char*>(&marker), sizeof(size_t));
+        output.write(reinterpret_cast<const char*>(&raw_type_), sizeof(RawDataType));
+        output.write(reinterpret_cast<const char*>(&ex_bits_), sizeof(size_t));
+    }
+
     /* Basic variants */
     output.write(reinterpret_cast<const char*>(&num_points_), sizeof(size_t));
     output.write(reinterpret_cast<const char*>(&degree_bound_), sizeof(size_t));
@@ -202,11 +428,18 @@ inline void QuantizedGraph<T>::save(const char* filename) const {
     output.write(reinterpret_cast<const char*>(&metric_type_), sizeof(MetricType));
 
     /* Data */
-    data_.save(output);
+    output.write(data_.data(), static_cast<long>(num_points_ * row_offset_));
 
     /* Rotator */
     this->rotator_->save(output);
 
+    /* Permutation from reorder(), appended so that older indices remain loadable */
+    size_t num_ids = external_ids_.size();
+    output.write(reinterpret_cast<const char*>(&num_ids), sizeof(size_t));
+    output.write(
+        reinterpret_cast<const char*>(external_ids_.data()), num_ids * sizeof(PID)
+    );
+
     output.close();
     std::cout << "\tQuantized graph saved!\n";
 }
@@ -225,7 +458,14 @@ inline void QuantizedGraph<T>::load(const char* filename) {
     assert(input.is_open());
 
     /* Basic variants */
+    raw_type_ = RAW_FP32;
+    ex_bits_ = 0;
     input.read(reinterpret_cast<char*>(&num_points_), sizeof(size_t));
+    if (num_points_ == kExtendedMarker) {
+        input.read(reinterpret_cast<char*>(&raw_type_), sizeof(RawDataType));
+        input.read(reinterpret_cast<char*>(&ex_bits_), sizeof(size_t));
+        input.read(reinterpret_cast<char*>(&num_points_), sizeof(size_t));
+    }
     input.read(reinterpret_cast<char*>(&degree_bound_), sizeof(size_t));
     input.read(reinterpret_cast<char*>(&dim_), sizeof(size_t));
     input.read(reinterpret_cast<char*>(&padded_dim_), sizeof(size_t));
@@ -247,6 +487,15 @@ inline void QuantizedGraph<T>::load(const char* filename) {
         exit(1);
     }
 
+    /* Permutation */
+    external_ids_.clear();
+    size_t num_ids = 0;
+    if (input.read(reinterpret_cast<char*>(&num_ids), sizeof(size_t)) &&
+        num_ids == num_points_) {
+        external_ids_.resize(num_ids);
+        input.read(reinterpret_cast<char*>(external_ids_.data()), num_ids * sizeof(PID));
+    }
+
     input.close();
     std::cout << "Quantized graph loaded!\n";
 }
@@ -262,111 +511,421 @@ inline void QuantizedGraph<T>::set_ef(size_t cur_ef) {
  * @param query     unrotated query vector, dimension_ elements
  * @param knn       num of nearest neighbors
  * @param results   search result
+ * @return num of expanded vertices (hops)
  */
 template <typename T>
-inline void QuantizedGraph<T>::search(
+inline size_t QuantizedGraph<T>::search(
     const T* __restrict__ query, uint32_t k, uint32_t* __restrict__ results
 ) {
-    std::vector<T> rotated_query(padded_dim_);
-    rotator_->rotate(query, rotated_query.data());
+    return search(query, k, results, nullptr);
+}
+
+// dists of results are optional, return num of expanded vertices (hops)
+template <typename T>
+inline size_t QuantizedGraph<T>::search(
+    const T* __restrict__ query,
+    uint32_t k,
+    uint32_t* __restrict__ results,
+    T* __restrict__ dists
+) {
+    SearchContext ctx(
+        padded_dim_, degree_bound_, ef_, k, visited_list_pool_->get_free_vislist()
+    );
+    size_t hops = search_with_context(query, ctx, results, dists);
+    visited_list_pool_->release_vis_list(ctx.vis);
+    return hops;
+}
+
+/**
+ * @brief search a batch of queries on qg with multiple threads. Unlike search(), it does
+ * not modify the index, so it can be called concurrently. Each thread takes a visited
+ * set from the pool and allocates its buffers once, and then reuses them for all the
+ * queries it processes. Threads come from the OpenMP runtime, which keeps them alive
+ * across calls.
+ *
+ * @param queries       unrotated query vectors, num_queries * dimension_ elements
+ * @param num_queries   num of queries
+ * @param k             num of nearest neighbors
+ * @param ef            size of search window
+ * @param num_threads   num of threads
+ * @param results       search results, num_queries * k elements
+ * @param dists         distances of results, num_queries * k elements (optional)
+ * @param hops          num of expanded vertices of each query (optional)
+ */
+template <typename T>
+inline void QuantizedGraph<T>::search_batch(
+    const T* __restrict__ queries,
+    size_t num_queries,
+    uint32_t k,
+    size_t ef,
+    size_t num_threads,
+    uint32_t* __restrict__ results,
+    T* __restrict__ dists,
+    uint32_t* __restrict__ hops
+) const {
+    ef = std::max<size_t>(ef, k);
+    num_threads = std::max<size_t>(std::min(num_threads, num_queries), 1);
+#pragma omp parallel num_threads(static_cast<int>(num_threads))
+    {
+        SearchContext ctx(
+            padded_dim_, degree_bound_, ef, k, visited_list_pool_->get_free_vislist()
+        );
+#pragma omp for schedule(dynamic, 8)
+        for (size_t i = 0; i < num_queries; ++i) {
+            size_t num_hops = search_with_context(
+                queries + (i * dim_),
+                ctx,
+                results + (i * k),
+                dists == nullptr ? nullptr : dists + (i * k)
+            );
+            if (hops != nullptr) {
+                hops[i] = static_cast<uint32_t>(num_hops);
+            }
+        }
+        visited_list_pool_->release_vis_list(ctx.vis);
+    }
+}
+
+// search a single query with given scratch buffers, dists is optional, return num of
+// expanded vertices
+template <typename T>
+inline size_t QuantizedGraph<T>::search_with_context(
+    const T* __restrict__ query,
+    SearchContext& ctx,
+    uint32_t* __restrict__ results,
+    T* __restrict__ dists
+) const {
+    rotator_->rotate(query, ctx.rotated_query.data());
 
     // init query
-    BatchQuery<T> q_obj(rotated_query.data(), padded_dim_);
+    auto& q_obj = ctx.q_obj;
+    q_obj.reset(ctx.rotated_query.data(), padded_dim_, ex_bits_);
+
+    auto& search_pool = ctx.search_pool;
+    auto& res_pool = ctx.res_pool;
+    auto& vis = *ctx.vis;
+    search_pool.clear();
+    res_pool.clear();
+    vis.clear();
 
-    buffer::SearchBuffer<T> search_pool(ef_);
     // init search buffer
     search_pool.insert(this->entry_point_, std::numeric_limits<T>::max());
-
-    buffer::SearchBuffer res_pool(k);  // result buffer
-    auto* vis = visited_list_pool_->get_free_vislist();
-
-    std::vector<T> est_dist(degree_bound_);  // estimated distances
+    T ep_dist = use_raw_dist_ ? 0 : raw_dist(query, this->entry_point_);
+    EarlyStop<T> stop(early_stop_);
 
     while (search_pool.has_next()) {
+        if (stop_search(stop, search_pool, res_pool)) {
+            break;
+        }
+        T est = search_pool.next_dist();
         PID cur_node = search_pool.pop();
-        if (vis->get(cur_node)) {
+        if (vis.get(cur_node)) {
             continue;
         }
-        vis->set(cur_node);
+        vis.set(cur_node);
 
-        q_obj.set_g_add(raw_dist_func_(query, get_vector(cur_node), dim_));
+        q_obj.set_g_add(visit_dist(query, q_obj, cur_node, ep_dist));
 
         scan_neighbors(
-            q_obj, cur_node, est_dist.data(), search_pool, *vis, this->degree_bound_
+            q_obj,
+            cur_node,
+            ctx.est_dist.data(),
+            ctx.ip_x0_qr.data(),
+            search_pool,
+            vis,
+            this->degree_bound_
         );
+        record_visit(stop, est, q_obj.g_add(), q_obj.g_add() < res_pool.top_dist());
         res_pool.insert(cur_node, q_obj.g_add());
     }
 
-    update_results(res_pool, *vis, query);
-    visited_list_pool_->release_vis_list(vis);
-    res_pool.copy_results(results);
+    update_results(res_pool, vis, query);
+    if (dists == nullptr) {
+        res_pool.copy_results(results);
+    } else {
+        res_pool.copy_results(results, dists);
+    }
+    map_to_external(results, res_pool.size());
+    return stop.hops();
 }
 
 template <typename T>
-inline void QuantizedGraph<T>::search(
-    const T* __restrict__ query,
-    uint32_t k,
-    uint32_t* __restrict__ results,
-    T* __restrict__ dists
-) {
-    std::vector<T> rotated_query(padded_dim_);
-    rotator_->rotate(query, rotated_query.data());
+inline void QuantizedGraph<T>::map_to_external(PID* results, size_t num) const {
+    if (external_ids_.empty()) {
+        return;
+    }
+    for (size_t i = 0; i < num; ++i) {
+        results[i] = external_ids_[results[i]];
+    }
+}
 
-    // init query
-    BatchQuery<T> q_obj(rotated_query.data(), padded_dim_);
+/**
+ * @brief Permute vertices in BFS order from the entry point so that neighboring rows
+ * are stored close to each other. Search results are still reported with the original
+ * ids. Should be called after the graph is built.
+ */
+template <typename T>
+inline void QuantizedGraph<T>::reorder() {
+    std::vector<PID> new_to_old = bfs_order(num_points_, entry_point_, [&](PID id) {
+        return std::make_pair(get_neighbors(id), degree_bound_);
+    });
+    std::vector<PID> old_to_new = inverse_permutation(new_to_old);
 
-    buffer::SearchBuffer<T> search_pool(ef_);
-    // init search buffer
-    search_pool.insert(this->entry_point_, std::numeric_limits<T>::max());
+    Array<char, std::vector<size_t>, memory::AlignedAllocator<char, 1 << 22, true>>
+        new_data(std::vector<size_t>{num_points_, row_offset_});
 
-    buffer::SearchBuffer res_pool(k);  // result buffer
-    auto* vis = visited_list_pool_->get_free_vislist();
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < num_points_; ++i) {
+        char* dst = &new_data.at(row_offset_ * i);
+        std::memcpy(dst, &data_.at(row_offset_ * new_to_old[i]), row_offset_);
+        // neighbor order is kept, so the packed codes of neighbors stay valid
+        auto* neighbors = reinterpret_cast<PID*>(dst + neighbor_offset_);
+        for (size_t j = 0; j < degree_bound_; ++j) {
+            neighbors[j] = old_to_new[neighbors[j]];
+        }
+    }
+    data_ = std::move(new_data);
+    capacity_ = num_points_;
+    entry_point_ = old_to_new[entry_point_];
+
+    if (external_ids_.empty()) {
+        external_ids_ = std::move(new_to_old);
+    } else {
+        std::vector<PID> ids(num_points_);
+        for (size_t i = 0; i < num_points_; ++i) {
+            ids[i] = external_ids_[new_to_old[i]];
+        }
+        external_ids_ = std::move(ids);
+    }
+}
 
-    std::vector<T> est_dist(degree_bound_);  // estimated distances
+/**
+ * @brief Store raw vectors in rows with a lower precision (fp16, bf16 or int8 with a
+ * per-vector scale). Rows become shorter, so that more of them fit in cache and fewer
+ * bytes are fetched per hop, while the quantization codes and neighbors are kept as
+ * they are. Exact distances used for reranking are computed on the compressed vectors.
+ * The graph can no longer be updated by QGBuilder afterwards.
+ */
+template <typename T>
+inline void QuantizedGraph<T>::compress_raw_vectors(RawDataType type) {
+    if (type == raw_type_) {
+        return;
+    }
+    if (raw_type_ != RAW_FP32) {
+        std::cerr << "Raw vectors of qg are already compressed\n";
+        exit(1);
+    }
 
-    while (search_pool.has_next()) {
-        PID cur_node = search_pool.pop();
-        if (vis->get(cur_node)) {
-            continue;
+    size_t new_self_data_offset =
+        round_up_to_multiple(raw_data_bytes(type, dim_), sizeof(float));
+    size_t tail_bytes = row_offset_ - self_data_offset_;  // codes + neighbors
+    size_t new_row_offset = new_self_data_offset + tail_bytes;
+
+    Array<char, std::vector<size_t>, memory::AlignedAllocator<char, 1 << 22, true>>
+        new_data(std::vector<size_t>{num_points_, new_row_offset});
+
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < num_points_; ++i) {
+        char* dst = &new_data.at(new_row_offset * i);
+        encode_raw_data(get_vector(i), dim_, type, dst);
+        std::memcpy(dst + new_self_data_offset, get_self_data(i), tail_bytes);
+    }
+    data_ = std::move(new_data);
+    capacity_ = num_points_;
+
+    raw_type_ = type;
+    size_t shift = self_data_offset_ - new_self_data_offset;
+    batch_data_offset_ -= shift;
+    ex_data_offset_ -= shift;
+    neighbor_offset_ -= shift;
+    self_data_offset_ = new_self_data_offset;
+    row_offset_ = new_row_offset;
+    query_dist_func_ = select_raw_dist_func(raw_type_, metric_type_);
+}
+
+// append num uninitialized rows, used by QGBuilder::insert(). The capacity grows by at
+// least half each time it runs out, so repeated small inserts copy each row O(1) times.
+template <typename T>
+inline void QuantizedGraph<T>::add_rows(size_t num) {
+    size_t new_num = num_points_ + num;
+    if (new_num > capacity_) {
+        capacity_ = std::max(new_num, capacity_ + (capacity_ / 2));
+        Array<char, std::vector<size_t>, memory::AlignedAllocator<char, 1 << 22, true>>
+            new_data(std::vector<size_t>{capacity_, row_offset_});
+        std::memcpy(new_data.data(), data_.data(), num_points_ * row_offset_);
+        data_ = std::move(new_data);
+        visited_list_pool_ = std::make_unique<VisitedListPool>(1, capacity_);
+    }
+
+    // new vertices keep their ids as external ids
+    if (!external_ids_.empty()) {
+        for (size_t i = 0; i < num; ++i) {
+            external_ids_.push_back(static_cast<PID>(num_points_ + i));
         }
-        vis->set(cur_node);
+    }
+    num_points_ = new_num;
+}
 
-        q_obj.set_g_add(raw_dist_func_(query, get_vector(cur_node), dim_));
+/**
+ * @brief Search a group of queries on qg in a single thread. The queries are advanced
+ * one vertex at a time in turns, and the row of each query's next vertex is prefetched
+ * before switching to the other queries, so that its memory latency is hidden by their
+ * work. Results are identical to search().
+ *
+ * @param queries           unrotated query vectors, num_queries * dimension_ elements
+ * @param num_queries       num of queries
+ * @param k                 num of nearest neighbors
+ * @param results           search results, num_queries * k elements
+ * @param num_interleave    num of queries in flight
+ * @param hops              num of expanded vertices of each query (optional)
+ */
+template <typename T>
+inline void QuantizedGraph<T>::search_interleaved(
+    const T* __restrict__ queries,
+    size_t num_queries,
+    uint32_t k,
+    uint32_t* __restrict__ results,
+    size_t num_interleave,
+    uint32_t* __restrict__ hops
+) {
+    num_interleave = std::max<size_t>(num_interleave, 1);
+    std::vector<T> est_dist(degree_bound_);
+    std::vector<T> ip_x0_qr(degree_bound_);
+    std::vector<std::unique_ptr<SearchState>> states;
+    for (size_t i = 0; i < std::min(num_interleave, num_queries); ++i) {
+        states.emplace_back(
+            std::make_unique<SearchState>(padded_dim_, ef_, k, early_stop_)
+        );
+    }
 
+    for (size_t begin = 0; begin < num_queries; begin += num_interleave) {
+        size_t num = std::min(num_interleave, num_queries - begin);
+
+        for (size_t i = 0; i < num; ++i) {
+            const T* query = queries + ((begin + i) * dim_);
+            auto& state = *states[i];
+            rotator_->rotate(query, state.rotated_query.data());
+            state.reset(query, ex_bits_, early_stop_);
+            state.vis = visited_list_pool_->get_free_vislist();
+            state.ep_dist = use_raw_dist_ ? 0 : raw_dist(query, this->entry_point_);
+            state.search_pool.insert(this->entry_point_, std::numeric_limits<T>::max());
+            search_step(state, est_dist.data(), ip_x0_qr.data());
+        }
+
+        // round robin until all queries finish
+        size_t num_active = num;
+        while (num_active > 0) {
+            num_active = 0;
+            for (auto& state : states) {
+                if (state->cur_node != kPidMax) {
+                    num_active += static_cast<size_t>(
+                        search_step(*state, est_dist.data(), ip_x0_qr.data())
+                    );
+                }
+            }
+        }
+
+        for (size_t i = 0; i < num; ++i) {
+            auto& state = *states[i];
+            update_results(state.res_pool, *state.vis, state.query);
+            visited_list_pool_->release_vis_list(state.vis);
+            uint32_t* res = results + ((begin + i) * k);
+            state.res_pool.copy_results(res);
+            map_to_external(res, state.res_pool.size());
+            if (hops != nullptr) {
+                hops[begin + i] = static_cast<uint32_t>(state.stop.hops());
+            }
+        }
+    }
+}
+
+// Process the vertex popped by the last step (if any), then pop the next unvisited
+// vertex and prefetch its row. Return false if the search of this query finishes.
+template <typename T>
+inline bool QuantizedGraph<T>::search_step(SearchState& state, T* est_dist, T* ip_x0_qr) {
+    if (state.cur_node != kPidMax) {
+        PID cur_node = state.cur_node;
+        state.q_obj.set_g_add(
+            visit_dist(state.query, state.q_obj, cur_node, state.ep_dist)
+        );
         scan_neighbors(
-            q_obj, cur_node, est_dist.data(), search_pool, *vis, this->degree_bound_
+            state.q_obj,
+            cur_node,
+            est_dist,
+            ip_x0_qr,
+            state.search_pool,
+            *state.vis,
+            this->degree_bound_
         );
-        res_pool.insert(cur_node, q_obj.g_add());
+        T dist = state.q_obj.g_add();
+        record_visit(state.stop, state.cur_est, dist, dist < state.res_pool.top_dist());
+        state.res_pool.insert(cur_node, dist);
     }
 
-    update_results(res_pool, *vis, query);
-    visited_list_pool_->release_vis_list(vis);
-    res_pool.copy_results(results, dists);
+    state.cur_node = kPidMax;
+    while (state.search_pool.has_next()) {
+        if (stop_search(state.stop, state.search_pool, state.res_pool)) {
+            break;
+        }
+        T est = state.search_pool.next_dist();
+        PID next = state.search_pool.pop();
+        if (!state.vis->get(next)) {
+            state.vis->set(next);
+            state.cur_node = next;
+            state.cur_est = est;
+            prefetch_row(next);
+            return true;
+        }
+    }
+    return false;
 }
 
 // scan a data row (including data vec and quantization codes for its neighbors)
-// store estimated distance & return exact distnace for current vertex
+// store estimated distance & return exact distnace for current vertex. If neighbors
+// have ex-bits codes, estimated distances of unvisited neighbors are refined by them.
 template <typename T>
 void QuantizedGraph<T>::scan_neighbors(
     const BatchQuery<T>& q_obj,
     PID data_id,
     T* est_dist,
+    T* ip_x0_qr,
     buffer::SearchBuffer<T>& search_pool,
     HashBasedBooleanSet& vis,
     size_t cur_degree
 ) const {
     const auto* batch_data = get_batch_data(data_id);
     for (size_t i = 0; i < cur_degree; i += fastscan::kBatchSize) {
-        qg_batch_estdist(batch_data, q_obj, padded_dim_, est_dist + i);
+        qg_batch_estdist(
+            batch_data,
+            q_obj,
+            padded_dim_,
+            est_dist + i,
+            ex_bits_ > 0 ? ip_x0_qr + i : nullptr
+        );
         batch_data += QGBatchDataMap<T>::data_bytes(padded_dim_);
     }
 
     const PID* ptr_nb = get_neighbors(data_id);
+    const char* ex_data = get_ex_data(data_id);
+    size_t ex_bytes = ExDataMap<T>::data_bytes(padded_dim_, ex_bits_);
     for (size_t i = 0; i < cur_degree; ++i) {
         PID cur_neighbor = ptr_nb[i];
         T dist = est_dist[i];
 
-        if (search_pool.is_full(dist) || vis.get(cur_neighbor)) {
+        if (vis.get(cur_neighbor)) {
+            continue;
+        }
+        if (ex_bits_ > 0) {
+            dist = split_distance_boosting(
+                ex_data + (i * ex_bytes),
+                ip_func_,
+                q_obj,
+                padded_dim_,
+                ex_bits_,
+                ip_x0_qr[i]
+            );
+        }
+        if (search_pool.is_full(dist)) {
             continue;
         }
         search_pool.insert(cur_neighbor, dist);  // update search buffer
@@ -379,21 +938,20 @@ void QuantizedGraph<T>::scan_neighbors(
 template <typename T>
 inline void QuantizedGraph<T>::update_results(
     buffer::SearchBuffer<T>& result_pool, HashBasedBooleanSet& vis, const T* query
-) {
-    if (result_pool.is_full()) {
+) const {
+    // only estimated distances are available for unvisited vertices
+    if (result_pool.is_full() || !use_raw_dist_) {
         return;
     }
 
     auto data = result_pool.data();
     for (auto record : data) {
-        PID* ptr_nb = get_neighbors(record.id);
+        const PID* ptr_nb = get_neighbors(record.id);
         for (uint32_t i = 0; i < this->degree_bound_; ++i) {
             PID cur_neighbor = ptr_nb[i];
             if (!vis.get(cur_neighbor)) {
                 vis.set(cur_neighbor);
-                result_pool.insert(
-                    cur_neighbor, raw_dist_func_(query, get_vector(cur_neighbor), dim_)
-                );
+                result_pool.insert(cur_neighbor, raw_dist(query, cur_neighbor));
             }
         }
         if (result_pool.is_full()) {
@@ -402,6 +960,25 @@ inline void QuantizedGraph<T>::update_results(
     }
 }
 
+// estimate distance to a vertex by its own codes, ep_dist is the distance to entry point
+template <typename T>
+inline T QuantizedGraph<T>::self_dist(
+    const BatchQuery<T>& q_obj, PID data_id, T ep_dist
+) const {
+    const char* self_data = get_self_data(data_id);
+    ConstBinDataMap<T> cur_bin(self_data, padded_dim_);
+    ConstExDataMap<T> cur_ex(
+        self_data + BinDataMap<T>::data_bytes(padded_dim_), padded_dim_, ex_bits_
+    );
+
+    T ip_x0_qr = mask_ip_x0_q(q_obj.rotated_query(), cur_bin.bin_code(), padded_dim_);
+    return cur_ex.f_add_ex() + ep_dist +
+           (cur_ex.f_rescale_ex() *
+            (static_cast<T>(1 << ex_bits_) * ip_x0_qr +
+             q_obj.ex_ip(ip_func_, cur_ex.ex_code(), padded_dim_) +
+             q_obj.kbxsumq()));
+}
+
 // initialize const offsets & data array
 template <typename T>
 inline void QuantizedGraph<T>::initialize() {
@@ -414,16 +991,31 @@ inline void QuantizedGraph<T>::initialize() {
     assert(padded_dim_ % 64 == 0);
     assert(padded_dim_ >= dim_);
 
-    this->batch_data_offset_ = dim_ * sizeof(T);  // pos of packed code (aligned)
-    this->neighbor_offset_ =
+    // pos of packed code (aligned)
+    this->self_data_offset_ =
+        round_up_to_multiple(raw_data_bytes(raw_type_, dim_), sizeof(float));
+    this->batch_data_offset_ = self_data_offset_;
+    if (ex_bits_ > 0) {
+        batch_data_offset_ += BinDataMap<T>::data_bytes(padded_dim_) +
+                              ExDataMap<T>::data_bytes(padded_dim_, ex_bits_);
+    }
+    this->ex_data_offset_ =
         batch_data_offset_ + (QGBatchDataMap<T>::data_bytes(padded_dim_) *
                               (degree_bound_ / fastscan::kBatchSize));
+    this->neighbor_offset_ =
+        ex_data_offset_ + (ExDataMap<T>::data_bytes(padded_dim_, ex_bits_) * degree_bound_);
     this->row_offset_ = neighbor_offset_ + (degree_bound_ * sizeof(PID));
 
     data_ = Array<char, std::vector<size_t>, memory::AlignedAllocator<char, 1 << 22, true>>(
         std::vector<size_t>{num_points_, row_offset_}
     );
+    capacity_ = num_points_;
 
+    query_dist_func_ = select_raw_dist_func(raw_type_, metric_type_);
+    if (ex_bits_ > 0) {
+        ip_func_ = select_excode_ipfunc(ex_bits_);
+        config_ = quant::faster_config(padded_dim_, ex_bits_ + 1);
+    }
     visited_list_pool_ = std::make_unique<VisitedListPool>(1, num_points_);
 }
 
@@ -441,7 +1033,7 @@ inline void QuantizedGraph<T>::find_candidates(
     rotator_->rotate(query, rotated_query.data());
 
     // init query
-    BatchQuery<T> q_obj(rotated_query.data(), padded_dim_);
+    BatchQuery<T> q_obj(rotated_query.data(), padded_dim_, ex_bits_);
 
     // insert entry point to initialize search buffer
     buffer::SearchBuffer tmp_pool(search_ef);
@@ -452,6 +1044,7 @@ inline void QuantizedGraph<T>::find_candidates(
 
     /* Current version of fast scan compute 32 distances */
     std::vector<T> est_dist(degree_bound_);  // estimated distances
+    std::vector<T> ip_x0_qr(degree_bound_);  // intermediate results for ex-bits codes
     while (tmp_pool.has_next()) {
         auto cur_candi = tmp_pool.pop();
         if (vis.get(cur_candi)) {
@@ -460,7 +1053,9 @@ inline void QuantizedGraph<T>::find_candidates(
         vis.set(cur_candi);
         auto cur_degree = degrees[cur_candi];
         q_obj.set_g_add(raw_dist_func_(query, get_vector(cur_candi), dim_));
-        scan_neighbors(q_obj, cur_candi, est_dist.data(), tmp_pool, vis, cur_degree);
+        scan_neighbors(
+            q_obj, cur_candi, est_dist.data(), ip_x0_qr.data(), tmp_pool, vis, cur_degree
+        );
         if (cur_candi != cur_id) {
             results.emplace_back(cur_candi, q_obj.g_add());
         }
@@ -472,22 +1067,34 @@ template <typename T>
 inline void QuantizedGraph<T>::update_qg(
     PID cur_id, const std::vector<AnnCandidate<T>>& new_neighbors
 ) {
-    size_t cur_degree = new_neighbors.size();
-
-    if (cur_degree == 0) {
+    if (new_neighbors.empty()) {
         return;
     }
-    // copy neighbors
+    set_neighbors(cur_id, new_neighbors);
+    update_codes(cur_id, new_neighbors.size());
+}
+
+// copy ids of new neighbors to the row, without updating codes
+template <typename T>
+inline void QuantizedGraph<T>::set_neighbors(
+    PID cur_id, const std::vector<AnnCandidate<T>>& new_neighbors
+) {
     PID* neighbor_ptr = get_neighbors(cur_id);
-    for (size_t i = 0; i < cur_degree; ++i) {
+    for (size_t i = 0; i < new_neighbors.size(); ++i) {
         neighbor_ptr[i] = new_neighbors[i].id;
     }
+}
+
+// quantize the first cur_degree neighbors in the row of cur_id
+template <typename T>
+inline void QuantizedGraph<T>::update_codes(PID cur_id, size_t cur_degree) {
+    const PID* neighbor_ptr = get_neighbors(cur_id);
 
     // rotated data
     std::vector<T> rotated_data(cur_degree * padded_dim_);
     std::vector<T> rotated_centroid(padded_dim_);
     for (size_t i = 0; i < cur_degree; ++i) {
-        const T* neighbor_vec = get_vector(new_neighbors[i].id);
+        const T* neighbor_vec = get_vector(neighbor_ptr[i]);
         this->rotator_->rotate(neighbor_vec, &rotated_data[i * padded_dim_]);
     }
     this->rotator_->rotate(get_vector(cur_id), rotated_centroid.data());
@@ -508,5 +1115,38 @@ inline void QuantizedGraph<T>::update_qg(
         data += fastscan::kBatchSize * padded_dim_;
         batch_data += QGBatchDataMap<T>::data_bytes(padded_dim_);
     }
+
+    // ex-bits codes of neighbors and codes of current vertex, centered at entry point
+    if (ex_bits_ > 0) {
+        std::vector<T> rotated_ep(padded_dim_);
+        this->rotator_->rotate(get_vector(entry_point_), rotated_ep.data());
+        char* self_data = get_self_data(cur_id);
+        quant::quantize_compact_one_bit(
+            rotated_centroid.data(), rotated_ep.data(), padded_dim_, self_data, metric_type_
+        );
+        quant::quantize_compact_ex_bits(
+            rotated_centroid.data(),
+            rotated_ep.data(),
+            padded_dim_,
+            ex_bits_,
+            self_data + BinDataMap<T>::data_bytes(padded_dim_),
+            metric_type_,
+            config_
+        );
+
+        char* ex_data = get_ex_data(cur_id);
+        size_t ex_bytes = ExDataMap<T>::data_bytes(padded_dim_, ex_bits_);
+        for (size_t i = 0; i < cur_degree; ++i) {
+            quant::quantize_compact_ex_bits(
+                &rotated_data[i * padded_dim_],
+                rotated_centroid.data(),
+                padded_dim_,
+                ex_bits_,
+                ex_data + (i * ex_bytes),
+                metric_type_,
+                config_
+            );
+        }
+    }
 }
 }  // namespace rabitqlib::symqg
@@ -5,7 +5,10 @@
 #include <cassert>
 #include <cstdint>
 #include <mutex>
+#include <iterator>
 #include <numeric>
+#include <random>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -17,14 +20,31 @@
 
 namespace rabitqlib::symqg {
 constexpr size_t kMaxBsIter = 5;  // max iter for binary search of pruning bar
+constexpr size_t kInsertBatchSize = 256;  // num of vertices linked together by insert()
+constexpr size_t kInitClusterRatio = 4;  // target cluster size of init / degree bound
+constexpr size_t kInitBranch = 32;       // max num of children of a cluster split by init
+constexpr size_t kInitSampleRatio = 32;  // sampled vectors per cluster for k-means of init
+constexpr size_t kInitKmeansIter = 5;    // k-means iterations for init
+constexpr size_t kNoCluster = std::numeric_limits<size_t>::max();
 using CandidateList = std::vector<AnnCandidate<float>>;
 
+/**
+ * @brief How QGBuilder initializes the graph before its iterations.
+ * RandomInit: degree_bound random neighbors for every vertex.
+ * ClusterInit: vectors are partitioned into small clusters by recursive k-means on samples,
+ * and every vertex is linked to its nearest neighbors in its own cluster and the nearest
+ * other one by brute force, which gives an approximate kNN graph for the first iteration.
+ */
+enum class QGInitType : uint8_t { RandomInit, ClusterInit };
+
 /**
  * @brief Builder of qg. Since we need to build the symphonyqg iteratively, which requires
  * to record a lot of temp data, we use a separate class as a builder for this purpose.
  *
  */
 class QGBuilder {
+    friend class QGPartitionBuilder;
+
    private:
     QuantizedGraph<float>& qg_;
     size_t ef_build_;      // size of search pool for indexing
@@ -35,26 +55,61 @@ class QGBuilder {
     static constexpr size_t kMaxCandidatePoolSize =
         750;  // max num of candidates for indexing
     static constexpr size_t kMaxPrunedSize =
-        300;                                    // max number of recorded pruned candidates
-    std::vector<CandidateList> new_neighbors_;  // new neighbors for current iteration
-    std::vector<CandidateList> pruned_neighbors_;    // recorded pruned neighbors
+        300;  // max number of recorded pruned candidates
+
+    // All builder states are flat arrays with a fixed-capacity slot for each vertex, so
+    // that the memory is allocated once and has no per-vertex overhead.
+    std::vector<AnnCandidate<float>> new_neighbors_;  // new neighbors, degree_bound_ slots
+    std::vector<uint32_t> num_new_neighbors_;         // num of new neighbors
+    std::vector<PID> pruned_neighbors_;  // recorded pruned neighbors, kMaxPrunedSize slots
+    std::vector<uint16_t> num_pruned_neighbors_;     // num of recorded pruned neighbors
     std::vector<HashBasedBooleanSet> visited_list_;  // list of visited hash set
     std::vector<uint32_t> degrees_;                  // record degree of qg
+    const float* data_ = nullptr;   // data for constructing qg from scratch
+    QGInitType init_type_ = QGInitType::RandomInit;
+    bool final_codes_ = true;  // if false, the last iteration only writes neighbor ids
+
+    // node of the cluster tree of cluster_init(), a leaf or split into children by k-means
+    struct InitCluster {
+        std::vector<PID> members;      // vertices of a leaf, empty once split
+        std::vector<size_t> children;  // child clusters, empty for leaves
+        std::vector<float> centroids;  // centroids of children
+    };
+
+    [[nodiscard]] CandidateList get_new_neighbors(PID cur_id) const {
+        const auto* begin = &new_neighbors_[cur_id * degree_bound_];
+        return CandidateList(begin, begin + num_new_neighbors_[cur_id]);
+    }
+
+    void set_new_neighbors(PID cur_id, const CandidateList& neighbors) {
+        std::copy(
+            neighbors.begin(), neighbors.end(), &new_neighbors_[cur_id * degree_bound_]
+        );
+        num_new_neighbors_[cur_id] = static_cast<uint32_t>(neighbors.size());
+    }
+
+    void record_pruned(PID, const std::vector<PID>&);
     void random_init();
+    void cluster_init();
+    void split_cluster(std::vector<InitCluster>&, size_t, std::vector<size_t>&) const;
     void search_new_neighbors(bool refine);
-    void heuristic_prune(PID, CandidateList&, CandidateList&, bool);
+    void heuristic_prune(const CandidateList&, CandidateList&, std::vector<PID>*);
     void add_reverse_edges(bool);
     void add_pruned_edges(
         const CandidateList&, const CandidateList&, CandidateList&, float
     );
+    void supplement_edges(PID, CandidateList&, const PID*, size_t, size_t);
     void graph_refine();
-    void iter(bool);
+    float iter(bool);
+    void insert_batch(PID, PID);
 
    public:
+    /**
+     * @brief Builder for inserting new vertices into a built (or loaded) qg
+     */
     explicit QGBuilder(
         QuantizedGraph<float>& index,
         uint32_t ef_build,
-        const float* data,
         size_t num_threads = std::numeric_limits<size_t>::max()
     )
         : qg_{index}
@@ -63,14 +118,30 @@ class QGBuilder {
         , num_nodes_{qg_.num_vertices()}
         , dim_{qg_.dimension()}
         , degree_bound_(qg_.degree_bound())
-        , new_neighbors_(qg_.num_vertices())
-        , pruned_neighbors_(qg_.num_vertices())
         , visited_list_(
               num_threads_,
               HashBasedBooleanSet(std::min(ef_build_ * ef_build_, num_nodes_ / 10))
           )
         , degrees_(qg_.num_vertices(), degree_bound_) {
+        if (qg_.raw_data_type() != RAW_FP32) {
+            std::cerr << "QGBuilder requires fp32 raw vectors in qg\n";
+            exit(1);
+        }
         omp_set_num_threads(static_cast<int>(num_threads_));
+    }
+
+    /**
+     * @brief Builder for constructing qg from scratch
+     */
+    explicit QGBuilder(
+        QuantizedGraph<float>& index,
+        uint32_t ef_build,
+        const float* data,
+        size_t num_threads = std::numeric_limits<size_t>::max()
+    )
+        : QGBuilder(index, ef_build, num_threads) {
+        new_neighbors_.resize(num_nodes_ * degree_bound_);
+        num_new_neighbors_.resize(num_nodes_, 0);
 
         std::vector<float> centroid =
             compute_centroid(data, num_nodes_, dim_, num_threads_);
@@ -83,32 +154,58 @@ class QGBuilder {
 
         qg_.set_ep(entry_point);
         qg_.copy_vectors(data);
-
-        random_init();
+        data_ = data;
     }
 
-    void build(size_t num_iter = 3) {
+    /**
+     * @brief build qg from scratch
+     *
+     * @param num_iter          max num of iterations, the last one refines the graph
+     * @param min_change_rate   stop the iterations before the last one once the fraction
+     *                          of edges changed by an iteration is below it, 0 by default
+     *                          (always run num_iter iterations)
+     */
+    void build(size_t num_iter = 3, float min_change_rate = 0) {
         if (num_iter < 2) {
-            std::cerr << "The number of iter for building qg should >= 3\n";
+            std::cerr << "The number of iter for building qg should >= 2\n";
             exit(1);
         }
+        if (init_type_ == QGInitType::ClusterInit) {
+            cluster_init();
+        } else {
+            random_init();
+        }
         // for first iterations, we do not need to refine the graph structure
         for (size_t i = 0; i < num_iter - 1; ++i) {
-            iter(false);
+            float change_rate = iter(false);
+            std::cout << "Iteration " << i + 1 << ", " << change_rate * 100
+                      << "% of edges changed\n"
+                      << std::flush;
+            if (change_rate < min_change_rate) {
+                break;
+            }
         }
         iter(true);
     }
 
+    /**
+     * @brief Initialization of the graph (see QGInitType), RandomInit by default. Should
+     * be set before build().
+     */
+    void set_init_type(QGInitType init_type) { init_type_ = init_type; }
+
+    void insert(const float*, size_t);
+
+    // whether any vertex has duplicated neighbors in qg, the lists of qg (instead of new
+    // neighbors of build()) are checked, so it also works for a builder for insertion
     [[nodiscard]] bool check_dup() const {
         std::atomic<bool> flag(false);
 #pragma omp parallel for
         for (size_t i = 0; i < num_nodes_; ++i) {
-            std::unordered_set<PID> edges;
-            for (auto nei : new_neighbors_[i]) {
-                if (edges.find(nei.id) != edges.end()) {
-                    flag = true;
-                }
-                edges.emplace(nei.id);
+            const PID* neighbors = qg_.get_neighbors(i);
+            std::unordered_set<PID> edges(neighbors, neighbors + degrees_[i]);
+            if (edges.size() != degrees_[i]) {
+                flag = true;
             }
         }
         return flag;
@@ -171,8 +268,13 @@ inline void QGBuilder::add_pruned_edges(
     }
 }
 
+/**
+ * @brief prune candidates (sorted by distance) to at most degree_bound_ neighbors
+ *
+ * @param pruned if not nullptr, record the pruned candidates in it
+ */
 inline void QGBuilder::heuristic_prune(
-    PID cur_id, CandidateList& pool, CandidateList& pruned_results, bool refine
+    const CandidateList& pool, CandidateList& pruned_results, std::vector<PID>* pruned
 ) {
     if (pool.empty()) {
         return;
@@ -186,7 +288,7 @@ inline void QGBuilder::heuristic_prune(
         return;
     }
 
-    std::vector<bool> pruned(
+    std::vector<bool> is_pruned(
         poolsize, false
     );                 // bool vector to record if this neighbor is pruned
     size_t start = 0;  // start position
@@ -195,7 +297,7 @@ inline void QGBuilder::heuristic_prune(
         auto candidate_id = pool[start].id;
 
         // if already pruned, move to next
-        if (pruned[start]) {
+        if (is_pruned[start]) {
             ++start;
             continue;
         }
@@ -207,17 +309,17 @@ inline void QGBuilder::heuristic_prune(
         // j : neighbor added in this iter
         // k : remained unpruned candidate neighbor
         for (size_t k = start + 1; k < poolsize; ++k) {
-            if (pruned[k]) {
+            if (is_pruned[k]) {
                 continue;
             }
             float dik = pool[k].distance;
             auto djk = qg_.raw_dist_func_(data_j, qg_.get_vector(pool[k].id), dim_);
 
             if (djk < dik) {
-                if (refine && pruned_neighbors_[cur_id].size() < kMaxPrunedSize) {
-                    pruned_neighbors_[cur_id].emplace_back(pool[k]);
+                if (pruned != nullptr) {
+                    pruned->push_back(pool[k].id);
                 }
-                pruned[k] = true;
+                is_pruned[k] = true;
             }
         }
 
@@ -242,7 +344,7 @@ inline void QGBuilder::search_new_neighbors(bool refine) {
         qg_.find_candidates(cur_id, ef_build_, candidates, vis, degrees_);
 
         // add current neighbors
-        for (auto& nei : new_neighbors_[cur_id]) {
+        for (auto& nei : get_new_neighbors(cur_id)) {
             auto neighbor_id = nei.id;
             if (neighbor_id != cur_id && !vis.get(neighbor_id)) {
                 candidates.emplace_back(nei);
@@ -258,50 +360,89 @@ inline void QGBuilder::search_new_neighbors(bool refine) {
         candidates.resize(min_size);
 
         // prune and update qg
-        heuristic_prune(cur_id, candidates, new_neighbors_[cur_id], refine);
+        CandidateList result;
+        std::vector<PID> pruned;
+        heuristic_prune(candidates, result, refine ? &pruned : nullptr);
+        set_new_neighbors(cur_id, result);
+        if (refine) {
+            record_pruned(cur_id, pruned);
+        }
     }
 }
 
-inline void QGBuilder::add_reverse_edges(bool refine) {
-    std::vector<std::mutex> locks(num_nodes_);
-    std::vector<CandidateList> reverse_buffer(num_nodes_);
+// append pruned candidates to the recorded ones of a vertex, up to kMaxPrunedSize
+inline void QGBuilder::record_pruned(PID cur_id, const std::vector<PID>& pruned) {
+    size_t num = num_pruned_neighbors_[cur_id];
+    size_t num_add = std::min(pruned.size(), kMaxPrunedSize - num);
+    std::copy(
+        pruned.begin(),
+        pruned.begin() + static_cast<long>(num_add),
+        &pruned_neighbors_[(cur_id * kMaxPrunedSize) + num]
+    );
+    num_pruned_neighbors_[cur_id] = static_cast<uint16_t>(num + num_add);
+}
 
+/**
+ * @brief add reverse edges and prune. Reverse edges are grouped by their destination in a
+ * flat array (CSR layout) with atomic counters, so neither per-vertex buffers nor locks
+ * are needed.
+ */
+inline void QGBuilder::add_reverse_edges(bool refine) {
+    // count reverse edges of each vertex
+    std::vector<size_t> offsets(num_nodes_ + 1, 0);
 #pragma omp parallel for schedule(dynamic)
     for (PID data_id = 0; data_id < num_nodes_; ++data_id) {
-        for (const auto& nei : new_neighbors_[data_id]) {
-            PID dst = nei.id;
-            bool dup = false;
-            CandidateList& dst_neighbors = new_neighbors_[dst];
-            std::lock_guard lock(locks[dst]);
-            for (auto& dst_nei : dst_neighbors) {
-                if (dst_nei.id == data_id) {
-                    dup = true;
-                    break;
-                }
-            }
-            if (dup) {
-                continue;
-            }
+        const auto* neighbors = &new_neighbors_[data_id * degree_bound_];
+        for (size_t j = 0; j < num_new_neighbors_[data_id]; ++j) {
+#pragma omp atomic
+            ++offsets[neighbors[j].id + 1];
+        }
+    }
+    for (size_t i = 0; i < num_nodes_; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
 
-            if (dst_neighbors.size() < degree_bound_) {
-                dst_neighbors.emplace_back(data_id, nei.distance);
-            } else {
-                if (reverse_buffer[dst].size() < kMaxCandidatePoolSize) {
-                    reverse_buffer[dst].emplace_back(data_id, nei.distance);
-                }
-            }
+    // fill reverse edges
+    std::vector<AnnCandidate<float>> reverse_edges(offsets[num_nodes_]);
+    std::vector<size_t> cursors(offsets.begin(), offsets.end() - 1);
+#pragma omp parallel for schedule(dynamic)
+    for (PID data_id = 0; data_id < num_nodes_; ++data_id) {
+        const auto* neighbors = &new_neighbors_[data_id * degree_bound_];
+        for (size_t j = 0; j < num_new_neighbors_[data_id]; ++j) {
+            size_t pos;
+#pragma omp atomic capture
+            pos = cursors[neighbors[j].id]++;
+            reverse_edges[pos] = AnnCandidate<float>(data_id, neighbors[j].distance);
         }
     }
+    std::vector<size_t>().swap(cursors);
 
 #pragma omp parallel for schedule(dynamic)
     for (PID data_id = 0; data_id < num_nodes_; ++data_id) {
-        CandidateList& tmp_pool = reverse_buffer[data_id];
-        tmp_pool.reserve(tmp_pool.size() + degree_bound_);
-        tmp_pool.insert(
-            tmp_pool.end(), new_neighbors_[data_id].begin(), new_neighbors_[data_id].end()
-        );
+        CandidateList tmp_pool = get_new_neighbors(data_id);
+        std::unordered_set<PID> ids;
+        ids.reserve(tmp_pool.size());
+        for (const auto& nei : tmp_pool) {
+            ids.emplace(nei.id);
+        }
+        size_t num_reverse = 0;
+        for (size_t j = offsets[data_id];
+             j < offsets[data_id + 1] && num_reverse < kMaxCandidatePoolSize;
+             ++j) {
+            if (ids.find(reverse_edges[j].id) == ids.end()) {
+                tmp_pool.emplace_back(reverse_edges[j]);
+                ++num_reverse;
+            }
+        }
         std::sort(tmp_pool.begin(), tmp_pool.end());
-        heuristic_prune(data_id, tmp_pool, new_neighbors_[data_id], refine);
+
+        CandidateList result;
+        std::vector<PID> pruned;
+        heuristic_prune(tmp_pool, result, refine ? &pruned : nullptr);
+        set_new_neighbors(data_id, result);
+        if (refine) {
+            record_pruned(data_id, pruned);
+        }
     }
 }
 
@@ -320,91 +461,316 @@ inline void QGBuilder::random_init() {
         }
 
         const float* cur_data = qg_.get_vector(i);
-        new_neighbors_[i].reserve(degree_bound_);
+        CandidateList neighbors;
+        neighbors.reserve(degree_bound_);
         for (PID cur_neigh : neighbor_set) {
-            new_neighbors_[i].emplace_back(
+            neighbors.emplace_back(
                 cur_neigh, qg_.raw_dist_func_(cur_data, qg_.get_vector(cur_neigh), dim_)
             );
         }
 
-        degrees_[i] = new_neighbors_[i].size();
-        qg_.update_qg(i, new_neighbors_[i]);
+        set_new_neighbors(i, neighbors);
+        degrees_[i] = neighbors.size();
+        qg_.update_qg(i, neighbors);
     }
 }
 
+// index of the nearest one of num centroids to vec
+inline size_t nearest_centroid(
+    const float* vec, const float* centroids, size_t num, size_t dim
+) {
+    size_t nearest = 0;
+    float min_dist = std::numeric_limits<float>::max();
+    for (size_t j = 0; j < num; ++j) {
+        float dist = euclidean_sqr(vec, centroids + (j * dim), dim);
+        if (dist < min_dist) {
+            min_dist = dist;
+            nearest = j;
+        }
+    }
+    return nearest;
+}
+
 /**
- * @brief refine the graph structure, make sure the degree for each vertex in qg equals the
- * degree bound (multiple of 32)
+ * @brief split clusters[cur] by k-means if it has more than 2 * kInitClusterRatio *
+ * degree_bound_ members, children are appended to clusters. Members that k-means cannot
+ * separate (e.g., duplicated vectors) are cut into chunks, so no cluster stays oversized.
  *
+ * @param second    cluster of the second nearest centroid of every vertex at its last split
  */
-inline void QGBuilder::graph_refine() {
-    std::cout << "Supplementing edges...\n";
+inline void QGBuilder::split_cluster(
+    std::vector<InitCluster>& clusters, size_t cur, std::vector<size_t>& second
+) const {
+    size_t cluster_size = kInitClusterRatio * degree_bound_;
+    std::vector<PID> members = std::move(clusters[cur].members);
+    if (members.size() <= 2 * cluster_size) {
+        clusters[cur].members = std::move(members);
+        return;
+    }
+    size_t num_children = std::min(kInitBranch, div_round_up(members.size(), cluster_size));
+
+    std::mt19937 generator(cur);
+    std::vector<PID> sample;
+    std::sample(
+        members.begin(),
+        members.end(),
+        std::back_inserter(sample),
+        num_children * kInitSampleRatio,
+        generator
+    );
+    std::vector<float> sample_data(sample.size() * dim_);
+    for (size_t i = 0; i < sample.size(); ++i) {
+        std::copy_n(data_ + (sample[i] * dim_), dim_, &sample_data[i * dim_]);
+    }
+    std::vector<float> centroids = sample_kmeans(
+        sample_data.data(),
+        sample.size(),
+        dim_,
+        num_children,
+        sample.size(),
+        kInitKmeansIter
+    );
+    num_children = centroids.size() / dim_;
+
+    // nearest and second nearest centroids of members
+    std::vector<size_t> nearest(members.size());
+    std::vector<size_t> next(members.size(), kNoCluster);
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < members.size(); ++i) {
+        const float* vec = data_ + (members[i] * dim_);
+        float min_dist = std::numeric_limits<float>::max();
+        float next_dist = std::numeric_limits<float>::max();
+        for (size_t j = 0; j < num_children; ++j) {
+            float dist = euclidean_sqr(vec, &centroids[j * dim_], dim_);
+            if (dist < min_dist) {
+                next_dist = min_dist;
+                next[i] = nearest[i];
+                min_dist = dist;
+                nearest[i] = j;
+            } else if (dist < next_dist) {
+                next_dist = dist;
+                next[i] = j;
+            }
+        }
+    }
 
-#pragma omp parallel for schedule(dynamic)
-    for (size_t i = 0; i < num_nodes_; ++i) {
-        CandidateList& cur_neighbors = new_neighbors_[i];
-        size_t cur_degree = cur_neighbors.size();
+    std::vector<std::vector<PID>> groups(num_children);
+    for (size_t i = 0; i < members.size(); ++i) {
+        groups[nearest[i]].push_back(members[i]);
+    }
+    bool separated = std::none_of(groups.begin(), groups.end(), [&](const auto& group) {
+        return group.size() == members.size();
+    });
+    if (!separated) {
+        for (auto& group : groups) {
+            group.clear();
+        }
+        for (size_t i = 0; i < members.size(); ++i) {
+            groups[i * num_children / members.size()].push_back(members[i]);
+        }
+    }
 
-        // skip vertices with enough neighbors
-        if (cur_degree >= degree_bound_) {
+    std::vector<size_t> child_of(num_children, kNoCluster);
+    for (size_t j = 0; j < num_children; ++j) {
+        if (groups[j].empty()) {
             continue;
         }
+        child_of[j] = clusters.size();
+        clusters[cur].children.push_back(clusters.size());
+        clusters[cur].centroids.insert(
+            clusters[cur].centroids.end(),
+            &centroids[j * dim_],
+            &centroids[(j + 1) * dim_]
+        );
+        clusters.push_back(InitCluster{std::move(groups[j]), {}, {}});
+    }
+    if (separated) {
+        for (size_t i = 0; i < members.size(); ++i) {
+            if (next[i] != kNoCluster) {
+                second[members[i]] = child_of[next[i]];
+            }
+        }
+    }
+}
 
-        CandidateList& pruned_list = pruned_neighbors_[i];
-        CandidateList new_result;
-        new_result.reserve(degree_bound_);
-
-        std::sort(pruned_list.begin(), pruned_list.end());
+/**
+ * @brief link every vertex to its nearest neighbors among the vertices of its own cluster
+ * and the nearest other one. Clusters are split recursively (see split_cluster), so they
+ * have at most 2 * kInitClusterRatio * degree_bound_ members and the cost is about linear
+ * in num_nodes_. Vertices with too few neighbors in their clusters get random ones.
+ */
+inline void QGBuilder::cluster_init() {
+    std::vector<InitCluster> clusters(1);
+    clusters[0].members.resize(num_nodes_);
+    std::iota(clusters[0].members.begin(), clusters[0].members.end(), 0);
+    std::vector<size_t> second(num_nodes_, kNoCluster);
+    for (size_t cur = 0; cur < clusters.size(); ++cur) {
+        split_cluster(clusters, cur, second);
+    }
 
-        // use binary search to get refined results
-        float left = 0.5;
-        float right = 1.0;
-        size_t iter = 0;
-        while (iter++ < kMaxBsIter) {
-            float mid = (left + right) / 2;
-            add_pruned_edges(cur_neighbors, pruned_list, new_result, mid);
-            if (new_result.size() < degree_bound_) {
-                left = mid;
-            } else {
-                right = mid;
+    std::vector<size_t> leaf_of(num_nodes_);
+    size_t num_leaves = 0;
+    for (size_t j = 0; j < clusters.size(); ++j) {
+        if (clusters[j].children.empty()) {
+            ++num_leaves;
+            for (PID id : clusters[j].members) {
+                leaf_of[id] = j;
             }
         }
+    }
+    std::cout << "Initializing qg with " << num_leaves << " clusters\n" << std::flush;
 
-        // update neighbors with larger cosine value since we want to retain more edges
-        add_pruned_edges(cur_neighbors, pruned_list, new_result, right);
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < num_nodes_; ++i) {
+        auto tid = omp_get_thread_num();
+        HashBasedBooleanSet& vis = visited_list_[tid];
+        vis.clear();
+        vis.set(i);
 
-        // if the vertex still doesn't have enough neighbors, use random vertices
-        if (new_result.size() < degree_bound_) {
-            std::unordered_set<PID> ids;
-            ids.reserve(degree_bound_);
-            for (auto& neighbor : new_result) {
-                ids.emplace(neighbor.id);
+        const float* cur_data = qg_.get_vector(i);
+        // go down from the second nearest cluster to its nearest leaf
+        size_t other = second[i];
+        while (other != kNoCluster && !clusters[other].children.empty()) {
+            const InitCluster& cluster = clusters[other];
+            other = cluster.children[nearest_centroid(
+                data_ + (i * dim_), cluster.centroids.data(), cluster.children.size(), dim_
+            )];
+        }
+
+        CandidateList candidates;
+        for (size_t cluster : {leaf_of[i], other}) {
+            if (cluster == kNoCluster) {
+                continue;
             }
-            while (new_result.size() < degree_bound_) {
-                PID rand_id = rand_integer<PID>(0, static_cast<PID>(num_nodes_) - 1);
-                if (rand_id != static_cast<PID>(i) && ids.find(rand_id) == ids.end()) {
-                    new_result.emplace_back(
-                        rand_id,
-                        qg_.raw_dist_func_(qg_.get_vector(rand_id), qg_.get_vector(i), dim_)
+            for (PID cur_id : clusters[cluster].members) {
+                if (!vis.get(cur_id)) {
+                    vis.set(cur_id);
+                    candidates.emplace_back(
+                        cur_id, qg_.raw_dist_func_(cur_data, qg_.get_vector(cur_id), dim_)
                     );
-                    ids.emplace(rand_id);
                 }
             }
         }
 
-        cur_neighbors = new_result;
+        size_t min_size = std::min(candidates.size(), degree_bound_);
+        std::partial_sort(
+            candidates.begin(),
+            candidates.begin() + static_cast<long>(min_size),
+            candidates.end()
+        );
+        candidates.resize(min_size);
+        supplement_edges(i, candidates, nullptr, 0, num_nodes_);
+
+        set_new_neighbors(i, candidates);
+        degrees_[i] = candidates.size();
+        qg_.update_qg(i, candidates);
+    }
+}
+
+/**
+ * @brief refine the graph structure, make sure the degree for each vertex in qg equals the
+ * degree bound (multiple of 32)
+ *
+ */
+inline void QGBuilder::graph_refine() {
+    std::cout << "Supplementing edges...\n";
+
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < num_nodes_; ++i) {
+        if (num_new_neighbors_[i] >= degree_bound_) {
+            continue;
+        }
+        CandidateList neighbors = get_new_neighbors(i);
+        supplement_edges(
+            i,
+            neighbors,
+            &pruned_neighbors_[i * kMaxPrunedSize],
+            num_pruned_neighbors_[i],
+            num_nodes_
+        );
+        set_new_neighbors(i, neighbors);
     }
     std::cout << "Supplementing finished...\n";
 }
 
-inline void QGBuilder::iter(bool refine) {
-    if (refine) {
-        for (size_t i = 0; i < num_nodes_; ++i) {
-            pruned_neighbors_[i].clear();
-            pruned_neighbors_[i].reserve(kMaxPrunedSize);
+/**
+ * @brief supplement the neighbors of a vertex to the degree bound with its pruned
+ * candidates, and random vertices in [0, num_valid) if there are still not enough
+ */
+inline void QGBuilder::supplement_edges(
+    PID cur_id,
+    CandidateList& cur_neighbors,
+    const PID* pruned,
+    size_t num_pruned,
+    size_t num_valid
+) {
+    size_t cur_degree = cur_neighbors.size();
+
+    // skip vertices with enough neighbors
+    if (cur_degree >= degree_bound_) {
+        return;
+    }
+
+    // only ids of pruned candidates are recorded, recompute their distances
+    const float* cur_data = qg_.get_vector(cur_id);
+    CandidateList pruned_list;
+    pruned_list.reserve(num_pruned);
+    for (size_t i = 0; i < num_pruned; ++i) {
+        pruned_list.emplace_back(
+            pruned[i], qg_.raw_dist_func_(cur_data, qg_.get_vector(pruned[i]), dim_)
+        );
+    }
+    CandidateList new_result;
+    new_result.reserve(degree_bound_);
+
+    std::sort(pruned_list.begin(), pruned_list.end());
+
+    // use binary search to get refined results
+    float left = 0.5;
+    float right = 1.0;
+    size_t iter = 0;
+    while (iter++ < kMaxBsIter) {
+        float mid = (left + right) / 2;
+        add_pruned_edges(cur_neighbors, pruned_list, new_result, mid);
+        if (new_result.size() < degree_bound_) {
+            left = mid;
+        } else {
+            right = mid;
         }
     }
 
+    // update neighbors with larger cosine value since we want to retain more edges
+    add_pruned_edges(cur_neighbors, pruned_list, new_result, right);
+
+    // if the vertex still doesn't have enough neighbors, use random vertices
+    if (new_result.size() < degree_bound_) {
+        std::unordered_set<PID> ids;
+        ids.reserve(degree_bound_);
+        for (auto& neighbor : new_result) {
+            ids.emplace(neighbor.id);
+        }
+        while (new_result.size() < degree_bound_) {
+            PID rand_id = rand_integer<PID>(0, static_cast<PID>(num_valid) - 1);
+            if (rand_id != cur_id && ids.find(rand_id) == ids.end()) {
+                new_result.emplace_back(
+                    rand_id, qg_.raw_dist_func_(qg_.get_vector(rand_id), cur_data, dim_)
+                );
+                ids.emplace(rand_id);
+            }
+        }
+    }
+
+    cur_neighbors = new_result;
+}
+
+// run one iteration of building, return the fraction of edges changed by it
+inline float QGBuilder::iter(bool refine) {
+    // pruned candidates are only recorded in the refining iteration
+    if (refine) {
+        pruned_neighbors_.resize(num_nodes_ * kMaxPrunedSize);
+        num_pruned_neighbors_.assign(num_nodes_, 0);
+    }
+
     search_new_neighbors(refine);
 
     add_reverse_edges(refine);
@@ -412,13 +778,175 @@ inline void QGBuilder::iter(bool refine) {
     // Use pruned edges to refine graph
     if (refine) {
         graph_refine();
+        std::vector<PID>().swap(pruned_neighbors_);
+        std::vector<uint16_t>().swap(num_pruned_neighbors_);
+    }
+
+    // update qg, count new edges against the neighbors in qg
+    size_t num_changed = 0;
+    size_t num_edges = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+ : num_changed, num_edges)
+    for (size_t i = 0; i < num_nodes_; ++i) {
+        const PID* old_neighbors = qg_.get_neighbors(i);
+        const PID* old_end = old_neighbors + degrees_[i];
+        CandidateList neighbors = get_new_neighbors(i);
+        for (const auto& nei : neighbors) {
+            num_changed += static_cast<size_t>(
+                std::find(old_neighbors, old_end, nei.id) == old_end
+            );
+        }
+        num_edges += neighbors.size();
+
+        if (refine && !final_codes_) {
+            qg_.set_neighbors(i, neighbors);
+        } else {
+            qg_.update_qg(i, neighbors);
+        }
+        degrees_[i] = num_new_neighbors_[i];
+    }
+    return static_cast<float>(num_changed) /
+           static_cast<float>(std::max<size_t>(num_edges, 1));
+}
+
+/**
+ * @brief insert new vertices into qg. The graph is extended in batches of
+ * kInsertBatchSize vertices, and each batch is searchable once it is linked.
+ *
+ * @param data  new vectors, num * dimension elements, ids of them start from the
+ *              current num of vertices
+ * @param num   num of new vectors
+ */
+inline void QGBuilder::insert(const float* data, size_t num) {
+    PID old_num = num_nodes_;
+    qg_.add_rows(num);
+    num_nodes_ += num;
+    degrees_.resize(num_nodes_, 0);  // new vertices are not linked yet
+
+    for (size_t i = 0; i < num; ++i) {
+        std::copy(data + (i * dim_), data + ((i + 1) * dim_), qg_.get_vector(old_num + i));
+    }
+
+    for (size_t begin = old_num; begin < num_nodes_; begin += kInsertBatchSize) {
+        insert_batch(begin, std::min(begin + kInsertBatchSize, num_nodes_));
+    }
+}
+
+/**
+ * @brief link vertices in [begin, end) to qg, where vertices before begin are already
+ * linked. Each new vertex searches its neighbors on the current graph and among the new
+ * vertices of this batch. Then it is added as a reverse edge to its neighbors, whose
+ * lists are pruned back to exactly degree_bound_ neighbors and re-quantized.
+ */
+inline void QGBuilder::insert_batch(PID begin, PID end) {
+    std::vector<CandidateList> batch_neighbors(end - begin);
+
+#pragma omp parallel for schedule(dynamic)
+    for (PID cur_id = begin; cur_id < end; ++cur_id) {
+        auto tid = omp_get_thread_num();
+        CandidateList candidates;
+        HashBasedBooleanSet& vis = visited_list_[tid];
+        candidates.reserve(2 * kMaxCandidatePoolSize);
+        vis.clear();
+        qg_.find_candidates(cur_id, ef_build_, candidates, vis, degrees_);
+
+        // new vertices in this batch are not reachable yet
+        const float* cur_data = qg_.get_vector(cur_id);
+        for (PID other = begin; other < end; ++other) {
+            if (other != cur_id) {
+                candidates.emplace_back(
+                    other, qg_.raw_dist_func_(cur_data, qg_.get_vector(other), dim_)
+                );
+            }
+        }
+
+        size_t min_size = std::min(candidates.size(), kMaxCandidatePoolSize);
+        std::partial_sort(
+            candidates.begin(),
+            candidates.begin() + static_cast<long>(min_size),
+            candidates.end()
+        );
+        candidates.resize(min_size);
+
+        CandidateList& result = batch_neighbors[cur_id - begin];
+        std::vector<PID> pruned;
+        heuristic_prune(candidates, result, &pruned);
+        supplement_edges(
+            cur_id, result, pruned.data(), std::min(pruned.size(), kMaxPrunedSize), end
+        );
+    }
+
+    // collect reverse edges
+    std::unordered_map<PID, CandidateList> reverse_edges;
+    for (PID cur_id = begin; cur_id < end; ++cur_id) {
+        for (const auto& nei : batch_neighbors[cur_id - begin]) {
+            reverse_edges[nei.id].emplace_back(cur_id, nei.distance);
+        }
+    }
+    std::vector<PID> affected;
+    affected.reserve(reverse_edges.size() + (end - begin));
+    for (const auto& pair : reverse_edges) {
+        affected.push_back(pair.first);
+    }
+    for (PID cur_id = begin; cur_id < end; ++cur_id) {
+        if (reverse_edges.find(cur_id) == reverse_edges.end()) {
+            affected.push_back(cur_id);
+        }
+    }
+
+    // merge reverse edges into current neighbors and prune
+    std::vector<CandidateList> new_lists(affected.size());
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < affected.size(); ++i) {
+        PID cur_id = affected[i];
+        auto iter = reverse_edges.find(cur_id);
+        if (iter == reverse_edges.end()) {
+            new_lists[i] = batch_neighbors[cur_id - begin];
+            continue;
+        }
+
+        CandidateList pool;
+        if (cur_id >= begin) {
+            pool = batch_neighbors[cur_id - begin];
+        } else {
+            const float* cur_data = qg_.get_vector(cur_id);
+            const PID* neighbors = qg_.get_neighbors(cur_id);
+            pool.reserve(degree_bound_ + iter->second.size());
+            for (size_t j = 0; j < degree_bound_; ++j) {
+                pool.emplace_back(
+                    neighbors[j],
+                    qg_.raw_dist_func_(cur_data, qg_.get_vector(neighbors[j]), dim_)
+                );
+            }
+        }
+        std::unordered_set<PID> ids;
+        ids.reserve(pool.size());
+        for (const auto& nei : pool) {
+            ids.emplace(nei.id);
+        }
+        for (const auto& nei : iter->second) {
+            if (ids.find(nei.id) == ids.end()) {
+                pool.emplace_back(nei);
+            }
+        }
+        std::sort(pool.begin(), pool.end());
+
+        std::vector<PID> pruned;
+        heuristic_prune(pool, new_lists[i], &pruned);
+        supplement_edges(
+            cur_id,
+            new_lists[i],
+            pruned.data(),
+            std::min(pruned.size(), kMaxPrunedSize),
+            end
+        );
     }
 
     // update qg
 #pragma omp parallel for schedule(dynamic)
-    for (size_t i = 0; i < num_nodes_; ++i) {
-        qg_.update_qg(i, new_neighbors_[i]);
-        degrees_[i] = new_neighbors_[i].size();
+    for (size_t i = 0; i < affected.size(); ++i) {
+        PID cur_id = affected[i];
+        qg_.update_qg(cur_id, new_lists[i]);
+        degrees_[cur_id] = new_lists[i].size();
     }
 }
 }  // namespace rabitqlib::symqg
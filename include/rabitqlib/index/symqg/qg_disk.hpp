@@ -0,0 +1,603 @@
+#pragma once
+
+#include <aio.h>
+#include <fcntl.h>
+#include <omp.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rabitqlib/defines.hpp"
+#include "rabitqlib/index/estimator.hpp"
+#include "rabitqlib/index/query.hpp"
+#include "rabitqlib/index/symqg/qg.hpp"
+#include "rabitqlib/index/symqg/qg_builder.hpp"
+#include "rabitqlib/quantization/data_layout.hpp"
+#include "rabitqlib/utils/buffer.hpp"
+#include "rabitqlib/utils/hashset.hpp"
+#include "rabitqlib/utils/io.hpp"
+#include "rabitqlib/utils/low_precision.hpp"
+#include "rabitqlib/utils/memory.hpp"
+#include "rabitqlib/utils/rotator.hpp"
+
+namespace rabitqlib::symqg {
+/**
+ * @brief qg served from disk. Rows of qg (raw vector + quantization codes of neighbors +
+ * neighbor ids) are stored in a file aligned to 4 KB pages, so that a row never crosses
+ * page boundaries unless it is larger than a page. Since every row carries the codes of
+ * its neighbors, reading the row of a vertex is enough to estimate distances to all of
+ * its neighbors. Search is a beam search: the beam_width nearest unvisited candidates
+ * are read from disk together with a batch of asynchronous reads in every step. Only a
+ * small qg on a sample of vectors is kept in memory to find entry points.
+ *
+ * If neighbors have ex-bits codes, their estimated distances are refined by them as in
+ * QuantizedGraph. Rows keep the raw vector but not the codes of the vertex itself: a row
+ * is read with its raw vector anyway, so visited vertices always get exact distances
+ * (set_use_raw_dist() of the source qg does not apply).
+ *
+ * File layout: [header page][rows][rotator, external ids, ids of sampled vectors]. The
+ * navigation graph is saved to <filename>.nav.
+ */
+template <typename T = float>
+class DiskQuantizedGraph {
+   private:
+    static constexpr size_t kPageSize = 4096;
+    static constexpr size_t kNavDegree = 32;  // degree bound of the navigation graph
+
+    size_t num_points_ = 0;
+    size_t degree_bound_ = 0;
+    size_t dim_ = 0;
+    size_t padded_dim_ = 0;
+    PID entry_point_ = 0;
+    MetricType metric_type_ = METRIC_L2;
+    RotatorType rotator_type_ = RotatorType::FhtKacRotator;
+    RawDataType raw_type_ = RAW_FP32;
+    size_t ex_bits_ = 0;            // num of ex-bits in codes of neighbors
+    size_t batch_data_offset_ = 0;  // offsets in a row, QuantizedGraph without self codes
+    size_t ex_data_offset_ = 0;
+    size_t neighbor_offset_ = 0;
+    size_t row_bytes_ = 0;
+    size_t rows_per_page_ = 0;  // rows in a page, 1 if a row is larger than a page
+    size_t pages_per_row_ = 0;  // pages read for a row
+    size_t meta_offset_ = 0;    // file offset of data after rows
+
+    Rotator<T>* rotator_ = nullptr;
+    RawDistFunc query_dist_func_ = nullptr;
+    ex_ipfunc ip_func_ = nullptr;
+    std::vector<PID> external_ids_;  // permutation from reorder(), may be empty
+    std::vector<PID> nav_ids_;       // vertex id of each vertex in nav_graph_
+    std::unique_ptr<QuantizedGraph<T>> nav_graph_ = nullptr;
+    int fd_ = -1;
+
+    // Scratch buffers of one searching thread
+    struct SearchContext {
+        size_t ef;
+        std::vector<T> rotated_query;
+        BatchQuery<T> q_obj;  // lut of the query, rebuilt for each query
+        std::vector<T> est_dist;
+        std::vector<T> ip_x0_qr;
+        buffer::SearchBuffer<T> search_pool;
+        buffer::SearchBuffer<T> res_pool;
+        HashBasedBooleanSet vis;
+        std::vector<PID> beam;
+        std::vector<aiocb> requests;
+        std::vector<aiocb*> request_ptrs;
+        char* pages;  // beam_width * pages_per_row_ pages
+        // buffers of the navigation graph search, created by the first query using it
+        std::unique_ptr<typename QuantizedGraph<T>::SearchContext> nav_ctx;
+        std::vector<PID> entries;
+        std::vector<T> entry_dists;
+
+        SearchContext(
+            size_t padded_dim,
+            size_t degree,
+            size_t ef,
+            size_t k,
+            size_t beam_width,
+            size_t read_bytes
+        )
+            : ef(ef)
+            , rotated_query(padded_dim)
+            , est_dist(degree)
+            , ip_x0_qr(degree)
+            , search_pool(ef)
+            , res_pool(k)
+            , vis(ef * degree)
+            , requests(beam_width)
+            , request_ptrs(beam_width)
+            , pages(memory::align_allocate<kPageSize, char>(beam_width * read_bytes)) {
+            beam.reserve(beam_width);
+        }
+
+        SearchContext(const SearchContext&) = delete;
+        SearchContext& operator=(const SearchContext&) = delete;
+
+        ~SearchContext() { std::free(pages); }
+    };
+
+    [[nodiscard]] size_t read_bytes() const { return pages_per_row_ * kPageSize; }
+
+    [[nodiscard]] size_t row_file_offset(PID data_id) const {
+        return kPageSize + ((data_id / rows_per_page_) * read_bytes());
+    }
+
+    [[nodiscard]] size_t row_page_offset(PID data_id) const {
+        return (data_id % rows_per_page_) * row_bytes_;
+    }
+
+    void read_rows(SearchContext&) const;
+
+    size_t search_with_context(const T*, SearchContext&, size_t, uint32_t*, T*) const;
+
+   public:
+    explicit DiskQuantizedGraph() = default;
+
+    DiskQuantizedGraph(const DiskQuantizedGraph&) = delete;
+    DiskQuantizedGraph& operator=(const DiskQuantizedGraph&) = delete;
+
+    ~DiskQuantizedGraph() {
+        ::delete rotator_;
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    [[nodiscard]] auto num_vertices() const { return this->num_points_; }
+
+    [[nodiscard]] auto dimension() const { return this->dim_; }
+
+    [[nodiscard]] auto degree_bound() const { return this->degree_bound_; }
+
+    [[nodiscard]] auto num_nav_vertices() const { return this->nav_ids_.size(); }
+
+    static void save(
+        const QuantizedGraph<T>& qg,
+        const char* filename,
+        size_t num_nav,
+        size_t num_threads = std::numeric_limits<size_t>::max()
+    );
+
+    void load(const char*);
+
+    size_t search(
+        const T* __restrict__ query,
+        uint32_t k,
+        size_t ef,
+        size_t beam_width,
+        uint32_t* __restrict__ results,
+        T* __restrict__ dists = nullptr
+    ) const;
+
+    size_t search_batch(
+        const T* __restrict__ queries,
+        size_t num_queries,
+        uint32_t k,
+        size_t ef,
+        size_t beam_width,
+        size_t num_threads,
+        uint32_t* __restrict__ results,
+        T* __restrict__ dists = nullptr
+    ) const;
+};
+
+/**
+ * @brief write a built (or loaded) qg in the disk layout, and build the in-memory
+ * navigation graph on num_nav vectors sampled evenly from qg
+ *
+ * @param qg            source qg, kept unchanged
+ * @param filename      path of the disk index
+ * @param num_nav       num of vectors in the navigation graph, 0 to use only the entry
+ *                      point of qg
+ * @param num_threads   num of threads for building the navigation graph
+ */
+template <typename T>
+inline void DiskQuantizedGraph<T>::save(
+    const QuantizedGraph<T>& qg, const char* filename, size_t num_nav, size_t num_threads
+) {
+    std::cout << "Saving disk quantized graph to " << filename << '\n';
+    size_t num_points = qg.num_points_;
+    // codes of the vertex itself (between raw vector and batch data) are not saved
+    size_t raw_bytes = qg.self_data_offset_;
+    size_t self_bytes = qg.batch_data_offset_ - raw_bytes;
+    size_t row_bytes = qg.row_offset_ - self_bytes;
+    size_t rows_per_page = std::max<size_t>(kPageSize / row_bytes, 1);
+    size_t pages_per_row = div_round_up(row_bytes, kPageSize);
+    size_t num_groups = div_round_up(num_points, rows_per_page);
+    size_t group_bytes = pages_per_row * kPageSize;
+    size_t meta_offset = kPageSize + (num_groups * group_bytes);
+
+    std::ofstream output(filename, std::ios::binary);
+    if (!output.is_open()) {
+        std::cerr << "Cannot open " << filename << " for writing\n";
+        exit(1);
+    }
+
+    /* Header page */
+    std::vector<char> page(std::max(kPageSize, group_bytes), 0);
+    char* ptr = page.data();
+    auto put = [&ptr](const auto& value) {
+        std::memcpy(ptr, &value, sizeof(value));
+        ptr += sizeof(value);
+    };
+    put(num_points);
+    put(qg.degree_bound_);
+    put(qg.dim_);
+    put(qg.padded_dim_);
+    put(qg.entry_point_);
+    put(qg.metric_type_);
+    put(qg.rotator_type_);
+    put(qg.raw_type_);
+    put(raw_bytes);  // batch data offset
+    put(qg.neighbor_offset_ - self_bytes);
+    put(row_bytes);
+    put(rows_per_page);
+    put(pages_per_row);
+    put(meta_offset);
+    put(qg.ex_bits_);
+    put(qg.ex_data_offset_ - self_bytes);
+    output.write(page.data(), kPageSize);
+
+    /* Rows, rows_per_page rows (or one row) per group of pages */
+    for (size_t i = 0; i < num_groups; ++i) {
+        std::fill(page.begin(), page.begin() + group_bytes, 0);
+        size_t begin = i * rows_per_page;
+        size_t end = std::min(begin + rows_per_page, num_points);
+        for (size_t j = begin; j < end; ++j) {
+            const char* src = &qg.data_.at(qg.row_offset_ * j);
+            char* dst = page.data() + ((j - begin) * row_bytes);
+            std::memcpy(dst, src, raw_bytes);
+            std::memcpy(
+                dst + raw_bytes, src + qg.batch_data_offset_, row_bytes - raw_bytes
+            );
+        }
+        output.write(page.data(), static_cast<std::streamsize>(group_bytes));
+    }
+
+    /* Rotator and ids */
+    qg.rotator_->save(output);
+    size_t num_ids = qg.external_ids_.size();
+    output.write(reinterpret_cast<const char*>(&num_ids), sizeof(size_t));
+    output.write(
+        reinterpret_cast<const char*>(qg.external_ids_.data()), num_ids * sizeof(PID)
+    );
+
+    // a qg can not be built on too few vectors
+    if (num_nav < 4 * kNavDegree) {
+        num_nav = 0;
+    }
+    num_nav = std::min(num_nav, num_points);
+    std::vector<PID> nav_ids(num_nav);
+    for (size_t i = 0; i < num_nav; ++i) {
+        nav_ids[i] = static_cast<PID>(i * num_points / num_nav);
+    }
+    output.write(reinterpret_cast<const char*>(&num_nav), sizeof(size_t));
+    output.write(reinterpret_cast<const char*>(nav_ids.data()), num_nav * sizeof(PID));
+    output.close();
+
+    /* Navigation graph */
+    if (num_nav > 0) {
+        std::vector<T> nav_data(num_nav * qg.dim_);
+        for (size_t i = 0; i < num_nav; ++i) {
+            decode_raw_data(
+                &qg.data_.at(qg.row_offset_ * nav_ids[i]),
+                qg.dim_,
+                qg.raw_type_,
+                &nav_data[i * qg.dim_]
+            );
+        }
+        QuantizedGraph<T> nav_graph(
+            num_nav, qg.dim_, kNavDegree, qg.metric_type_, qg.rotator_type_
+        );
+        QGBuilder builder(nav_graph, 100, nav_data.data(), num_threads);
+        builder.build();
+        nav_graph.save((std::string(filename) + ".nav").c_str());
+    }
+    std::cout << "\tDisk quantized graph saved!\n";
+}
+
+template <typename T>
+inline void DiskQuantizedGraph<T>::load(const char* filename) {
+    std::cout << "loading disk quantized graph " << filename << '\n';
+
+    if (!file_exists(filename)) {
+        std::cerr << "Index does not exist!\n";
+        exit(1);
+    }
+    std::ifstream input(filename, std::ios::binary);
+
+    /* Header page */
+    std::vector<char> page(kPageSize);
+    input.read(page.data(), kPageSize);
+    const char* ptr = page.data();
+    auto get = [&ptr](auto& value) {
+        std::memcpy(&value, ptr, sizeof(value));
+        ptr += sizeof(value);
+    };
+    get(num_points_);
+    get(degree_bound_);
+    get(dim_);
+    get(padded_dim_);
+    get(entry_point_);
+    get(metric_type_);
+    get(rotator_type_);
+    get(raw_type_);
+    get(batch_data_offset_);
+    get(neighbor_offset_);
+    get(row_bytes_);
+    get(rows_per_page_);
+    get(pages_per_row_);
+    get(meta_offset_);
+    get(ex_bits_);
+    get(ex_data_offset_);
+    query_dist_func_ = select_raw_dist_func(raw_type_, metric_type_);
+    ip_func_ = ex_bits_ > 0 ? select_excode_ipfunc(ex_bits_) : nullptr;
+
+    /* Rotator and ids */
+    input.seekg(static_cast<std::streamoff>(meta_offset_));
+    ::delete rotator_;
+    rotator_ = choose_rotator<T>(dim_, rotator_type_, padded_dim_);
+    rotator_->load(input);
+
+    size_t num_ids = 0;
+    input.read(reinterpret_cast<char*>(&num_ids), sizeof(size_t));
+    external_ids_.resize(num_ids);
+    input.read(reinterpret_cast<char*>(external_ids_.data()), num_ids * sizeof(PID));
+
+    size_t num_nav = 0;
+    input.read(reinterpret_cast<char*>(&num_nav), sizeof(size_t));
+    nav_ids_.resize(num_nav);
+    input.read(reinterpret_cast<char*>(nav_ids_.data()), num_nav * sizeof(PID));
+    input.close();
+
+    nav_graph_ = nullptr;
+    if (num_nav > 0) {
+        nav_graph_ = std::make_unique<QuantizedGraph<T>>();
+        nav_graph_->load((std::string(filename) + ".nav").c_str());
+    }
+
+    /* Rows are read with direct io, fall back to buffered io if it is not supported by
+     * the file system (e.g., tmpfs) */
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = ::open(filename, O_RDONLY | O_DIRECT);
+    if (fd_ < 0) {
+        fd_ = ::open(filename, O_RDONLY);
+    }
+    if (fd_ < 0) {
+        std::cerr << "Cannot open " << filename << ": " << std::strerror(errno) << '\n';
+        exit(1);
+    }
+    std::cout << "Disk quantized graph loaded!\n";
+}
+
+// read rows of vertices in ctx.beam with a batch of asynchronous reads
+template <typename T>
+inline void DiskQuantizedGraph<T>::read_rows(SearchContext& ctx) const {
+    size_t num = ctx.beam.size();
+    for (size_t i = 0; i < num; ++i) {
+        aiocb& req = ctx.requests[i];
+        std::memset(&req, 0, sizeof(aiocb));
+        req.aio_fildes = fd_;
+        req.aio_offset = static_cast<off_t>(row_file_offset(ctx.beam[i]));
+        req.aio_buf = ctx.pages + (i * read_bytes());
+        req.aio_nbytes = read_bytes();
+        req.aio_lio_opcode = LIO_READ;
+        ctx.request_ptrs[i] = &req;
+    }
+    if (lio_listio(LIO_WAIT, ctx.request_ptrs.data(), static_cast<int>(num), nullptr) !=
+        0) {
+        std::cerr << "Failed to read rows of disk quantized graph: "
+                  << std::strerror(errno) << '\n';
+        exit(1);
+    }
+    for (size_t i = 0; i < num; ++i) {
+        if (aio_return(&ctx.requests[i]) != static_cast<ssize_t>(read_bytes())) {
+            std::cerr << "Short read on rows of disk quantized graph\n";
+            exit(1);
+        }
+    }
+}
+
+/**
+ * @brief search on the disk index
+ *
+ * @param query         unrotated query vector, dimension_ elements
+ * @param k             num of nearest neighbors
+ * @param ef            size of search window
+ * @param beam_width    num of rows read from disk together in every step
+ * @param results       search results, k elements
+ * @param dists         distances of results, k elements (optional)
+ * @return num of rows read from disk
+ */
+template <typename T>
+inline size_t DiskQuantizedGraph<T>::search(
+    const T* __restrict__ query,
+    uint32_t k,
+    size_t ef,
+    size_t beam_width,
+    uint32_t* __restrict__ results,
+    T* __restrict__ dists
+) const {
+    beam_width = std::max<size_t>(beam_width, 1);
+    SearchContext ctx(
+        padded_dim_, degree_bound_, std::max<size_t>(ef, k), k, beam_width, read_bytes()
+    );
+    return search_with_context(query, ctx, beam_width, results, dists);
+}
+
+/**
+ * @brief search a batch of queries with multiple threads, each thread reuses its
+ * buffers for all of its queries
+ *
+ * @return total num of rows read from disk
+ */
+template <typename T>
+inline size_t DiskQuantizedGraph<T>::search_batch(
+    const T* __restrict__ queries,
+    size_t num_queries,
+    uint32_t k,
+    size_t ef,
+    size_t beam_width,
+    size_t num_threads,
+    uint32_t* __restrict__ results,
+    T* __restrict__ dists
+) const {
+    ef = std::max<size_t>(ef, k);
+    beam_width = std::max<size_t>(beam_width, 1);
+    num_threads = std::max<size_t>(std::min(num_threads, num_queries), 1);
+    size_t num_reads = 0;
+#pragma omp parallel num_threads(static_cast<int>(num_threads)) reduction(+ : num_reads)
+    {
+        SearchContext ctx(padded_dim_, degree_bound_, ef, k, beam_width, read_bytes());
+#pragma omp for schedule(dynamic, 8)
+        for (size_t i = 0; i < num_queries; ++i) {
+            num_reads += search_with_context(
+                queries + (i * dim_),
+                ctx,
+                beam_width,
+                results + (i * k),
+                dists == nullptr ? nullptr : dists + (i * k)
+            );
+        }
+    }
+    return num_reads;
+}
+
+template <typename T>
+inline size_t DiskQuantizedGraph<T>::search_with_context(
+    const T* __restrict__ query,
+    SearchContext& ctx,
+    size_t beam_width,
+    uint32_t* __restrict__ results,
+    T* __restrict__ dists
+) const {
+    auto& search_pool = ctx.search_pool;
+    auto& res_pool = ctx.res_pool;
+    auto& vis = ctx.vis;
+    search_pool.clear();
+    res_pool.clear();
+    vis.clear();
+
+    // entry points from the in-memory navigation graph
+    if (nav_graph_ != nullptr) {
+        size_t num_entries = std::min(beam_width, nav_ids_.size());
+        if (ctx.nav_ctx == nullptr) {
+            ctx.nav_ctx = std::make_unique<typename QuantizedGraph<T>::SearchContext>(
+                nav_graph_->padded_dim_,
+                nav_graph_->degree_bound_,
+                std::max(ctx.ef / 2, num_entries),
+                num_entries,
+                nullptr
+            );
+        }
+        auto& nav_ctx = *ctx.nav_ctx;
+        auto& entries = ctx.entries;
+        auto& entry_dists = ctx.entry_dists;
+        entries.assign(num_entries, kPidMax);
+        entry_dists.resize(num_entries);
+        nav_ctx.vis = nav_graph_->visited_list_pool_->get_free_vislist();
+        nav_graph_->search_with_context(query, nav_ctx, entries.data(), entry_dists.data());
+        nav_graph_->visited_list_pool_->release_vis_list(nav_ctx.vis);
+        for (size_t i = 0; i < num_entries; ++i) {
+            if (entries[i] < nav_ids_.size()) {
+                search_pool.insert(nav_ids_[entries[i]], entry_dists[i]);
+            }
+        }
+    }
+    if (!search_pool.has_next()) {
+        search_pool.insert(entry_point_, std::numeric_limits<T>::max());
+    }
+
+    rotator_->rotate(query, ctx.rotated_query.data());
+    auto& q_obj = ctx.q_obj;
+    q_obj.reset(ctx.rotated_query.data(), padded_dim_, ex_bits_);
+
+    size_t num_reads = 0;
+    while (search_pool.has_next()) {
+        // the nearest unvisited candidates form the beam
+        ctx.beam.clear();
+        while (ctx.beam.size() < beam_width && search_pool.has_next()) {
+            PID cur_node = search_pool.pop();
+            if (!vis.get(cur_node)) {
+                vis.set(cur_node);
+                ctx.beam.push_back(cur_node);
+            }
+        }
+        if (ctx.beam.empty()) {
+            break;
+        }
+        read_rows(ctx);
+        num_reads += ctx.beam.size();
+
+        for (size_t i = 0; i < ctx.beam.size(); ++i) {
+            PID cur_node = ctx.beam[i];
+            const char* row =
+                ctx.pages + (i * read_bytes()) + row_page_offset(cur_node);
+            q_obj.set_g_add(query_dist_func_(query, row, dim_));
+
+            const char* batch_data = row + batch_data_offset_;
+            for (size_t j = 0; j < degree_bound_; j += fastscan::kBatchSize) {
+                qg_batch_estdist(
+                    batch_data,
+                    q_obj,
+                    padded_dim_,
+                    ctx.est_dist.data() + j,
+                    ex_bits_ > 0 ? ctx.ip_x0_qr.data() + j : nullptr
+                );
+                batch_data += QGBatchDataMap<T>::data_bytes(padded_dim_);
+            }
+
+            // as QuantizedGraph::scan_neighbors, unvisited neighbors are refined by their
+            // ex-bits codes
+            const auto* neighbors = reinterpret_cast<const PID*>(row + neighbor_offset_);
+            const char* ex_data = row + ex_data_offset_;
+            size_t ex_bytes = ExDataMap<T>::data_bytes(padded_dim_, ex_bits_);
+            for (size_t j = 0; j < degree_bound_; ++j) {
+                if (vis.get(neighbors[j])) {
+                    continue;
+                }
+                T dist = ctx.est_dist[j];
+                if (ex_bits_ > 0) {
+                    dist = split_distance_boosting(
+                        ex_data + (j * ex_bytes),
+                        ip_func_,
+                        q_obj,
+                        padded_dim_,
+                        ex_bits_,
+                        ctx.ip_x0_qr[j]
+                    );
+                }
+                if (search_pool.is_full(dist)) {
+                    continue;
+                }
+                search_pool.insert(neighbors[j], dist);
+            }
+            res_pool.insert(cur_node, q_obj.g_add());
+        }
+    }
+
+    if (dists == nullptr) {
+        res_pool.copy_results(results);
+    } else {
+        res_pool.copy_results(results, dists);
+    }
+    if (!external_ids_.empty()) {
+        for (size_t i = 0; i < res_pool.size(); ++i) {
+            results[i] = external_ids_[results[i]];
+        }
+    }
+    return num_reads;
+}
+}  // namespace rabitqlib::symqg
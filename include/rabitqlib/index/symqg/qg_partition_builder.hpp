@@ -0,0 +1,305 @@
+#pragma once
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <unordered_set>
+#include <vector>
+
+#include "rabitqlib/defines.hpp"
+#include "rabitqlib/index/symqg/qg.hpp"
+#include "rabitqlib/index/symqg/qg_builder.hpp"
+#include "rabitqlib/utils/space.hpp"
+#include "rabitqlib/utils/tools.hpp"
+
+namespace rabitqlib::symqg {
+/**
+ * @brief Builder of qg for datasets whose builder states do not fit in memory. Every vector
+ * is assigned to its nearest `overlap` partitions (given by centroids, e.g., from k-means).
+ * Then a qg is built for one partition at a time. The first neighbor list of a vector is
+ * written to its row of qg with global ids, and later ones are spilled to a temporary
+ * file. Finally, the spilled lists are merged into the rows in a streaming pass (the
+ * union is pruned again), and all rows of qg are quantized. Besides the index, peak
+ * memory is the builder of the largest partition.
+ *
+ */
+class QGPartitionBuilder {
+   private:
+    QuantizedGraph<float>& qg_;
+    size_t ef_build_;      // size of search pool for indexing
+    size_t num_threads_;   // number of threads used for indexing
+    size_t num_nodes_;     // num of data points
+    size_t dim_;           // dimension of data
+    size_t degree_bound_;  // degree bound for qg, multiple of 32
+    size_t overlap_;       // num of partitions each vector is assigned to
+    const float* data_;
+    static constexpr size_t kMergeChunk = 1 << 16;  // num of spilled lists merged at once
+    std::vector<bool> has_list_;  // if the row of a vector has a list from a partition
+    std::FILE* spill_ = nullptr;  // lists of vectors whose rows already have one
+
+    std::vector<std::vector<PID>> assign(const float*, size_t) const;
+    void build_partition(const std::vector<PID>&);
+    void merge();
+
+   public:
+    explicit QGPartitionBuilder(
+        QuantizedGraph<float>& index,
+        uint32_t ef_build,
+        const float* data,
+        size_t overlap = 2,
+        size_t num_threads = std::numeric_limits<size_t>::max()
+    )
+        : qg_{index}
+        , ef_build_{ef_build}
+        , num_threads_{std::min(num_threads, total_threads())}
+        , num_nodes_{qg_.num_vertices()}
+        , dim_{qg_.dimension()}
+        , degree_bound_{qg_.degree_bound()}
+        , overlap_{std::max<size_t>(overlap, 1)}
+        , data_{data} {
+        if (qg_.raw_data_type() != RAW_FP32) {
+            std::cerr << "QGPartitionBuilder requires fp32 raw vectors in qg\n";
+            exit(1);
+        }
+    }
+
+    /**
+     * @brief build qg partition by partition
+     *
+     * @param centroids         centroids of partitions, num_partitions * dimension
+     * @param num_partitions    num of partitions
+     */
+    void build(const float* centroids, size_t num_partitions) {
+        omp_set_num_threads(static_cast<int>(num_threads_));
+
+        std::vector<float> centroid =
+            compute_centroid(data_, num_nodes_, dim_, num_threads_);
+        PID entry_point = exact_nn(
+            data_, centroid.data(), num_nodes_, dim_, num_threads_, euclidean_sqr<float>
+        );
+        std::cout << "Setting entry_point to " << entry_point << '\n' << std::flush;
+        qg_.set_ep(entry_point);
+        qg_.copy_vectors(data_);
+
+        std::vector<std::vector<PID>> partitions = assign(centroids, num_partitions);
+
+        has_list_.assign(num_nodes_, false);
+        spill_ = std::tmpfile();
+        if (spill_ == nullptr) {
+            std::cerr << "Failed to create a temporary file for QGPartitionBuilder\n";
+            exit(1);
+        }
+        for (size_t i = 0; i < partitions.size(); ++i) {
+            if (partitions[i].empty()) {
+                continue;
+            }
+            std::cout << "Building partition " << i << " with " << partitions[i].size()
+                      << " vectors\n"
+                      << std::flush;
+            build_partition(partitions[i]);
+            std::vector<PID>().swap(partitions[i]);
+        }
+
+        merge();
+        std::fclose(spill_);
+        spill_ = nullptr;
+        std::vector<bool>().swap(has_list_);
+    }
+};
+
+/**
+ * @brief assign vectors to their nearest overlap_ partitions. Partitions too small to
+ * build a graph of degree_bound_ are dropped, and their vectors go to the nearest
+ * remaining partitions.
+ *
+ * @return members of each partition
+ */
+inline std::vector<std::vector<PID>> QGPartitionBuilder::assign(
+    const float* centroids, size_t num_partitions
+) const {
+    size_t min_size = 4 * degree_bound_;
+    if (num_nodes_ < min_size) {
+        std::cerr << "Too few vectors for partitioned build of qg\n";
+        exit(1);
+    }
+    size_t overlap = std::min(overlap_, num_partitions);
+
+    // distances from a vector to all centroids, sorted
+    auto nearest_partitions = [&](size_t i, std::vector<AnnCandidate<float>>& dists) {
+        for (size_t j = 0; j < num_partitions; ++j) {
+            dists[j] = AnnCandidate<float>(
+                j, euclidean_sqr(data_ + (i * dim_), centroids + (j * dim_), dim_)
+            );
+        }
+        std::sort(dists.begin(), dists.end());
+    };
+
+    // size of each partition if every vector goes to its nearest one
+    std::vector<PID> nearest(num_nodes_);
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < num_nodes_; ++i) {
+        std::vector<AnnCandidate<float>> dists(num_partitions);
+        nearest_partitions(i, dists);
+        nearest[i] = dists[0].id;
+    }
+    std::vector<size_t> sizes(num_partitions, 0);
+    for (size_t i = 0; i < num_nodes_; ++i) {
+        sizes[nearest[i]]++;
+    }
+    std::vector<PID>().swap(nearest);
+
+    std::vector<bool> valid(num_partitions);
+    for (size_t j = 0; j < num_partitions; ++j) {
+        valid[j] = sizes[j] >= min_size;
+    }
+    if (std::find(valid.begin(), valid.end(), true) == valid.end()) {
+        valid[std::max_element(sizes.begin(), sizes.end()) - sizes.begin()] = true;
+    }
+
+    // assign each vector to its nearest valid partitions
+    std::vector<PID> assigned(num_nodes_ * overlap, kPidMax);
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < num_nodes_; ++i) {
+        std::vector<AnnCandidate<float>> dists(num_partitions);
+        nearest_partitions(i, dists);
+        size_t num_assigned = 0;
+        for (size_t j = 0; j < num_partitions && num_assigned < overlap; ++j) {
+            if (valid[dists[j].id]) {
+                assigned[(i * overlap) + num_assigned++] = dists[j].id;
+            }
+        }
+    }
+
+    std::vector<std::vector<PID>> partitions(num_partitions);
+    for (size_t i = 0; i < num_nodes_ * overlap; ++i) {
+        if (assigned[i] != kPidMax) {
+            partitions[assigned[i]].push_back(static_cast<PID>(i / overlap));
+        }
+    }
+    return partitions;
+}
+
+// build qg on a partition and record its neighbor lists with global ids
+inline void QGPartitionBuilder::build_partition(const std::vector<PID>& members) {
+    size_t num = members.size();
+    std::vector<float> sub_data(num * dim_);
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < num; ++i) {
+        const float* src = data_ + (members[i] * dim_);
+        std::copy(src, src + dim_, &sub_data[i * dim_]);
+    }
+
+    // only the graph is used, codes of the sub qg are not needed after its build
+    QuantizedGraph<float> sub_qg(num, dim_, degree_bound_, qg_.metric_type());
+    {
+        QGBuilder builder(sub_qg, ef_build_, sub_data.data(), num_threads_);
+        builder.final_codes_ = false;
+        builder.build();
+    }
+
+    // global id followed by degree_bound_ neighbors for each spilled list
+    size_t record_size = degree_bound_ + 1;
+    std::vector<PID> spilled;
+    for (size_t i = 0; i < num; ++i) {
+        PID global_id = members[i];
+        const PID* neighbors = sub_qg.get_neighbors(i);
+        PID* slots = qg_.get_neighbors(global_id);
+        if (has_list_[global_id]) {
+            spilled.resize(spilled.size() + record_size);
+            slots = &spilled[spilled.size() - record_size];
+            *slots++ = global_id;
+        }
+        has_list_[global_id] = true;
+        for (size_t j = 0; j < degree_bound_; ++j) {
+            slots[j] = members[neighbors[j]];
+        }
+    }
+    size_t num_written = std::fwrite(spilled.data(), sizeof(PID), spilled.size(), spill_);
+    if (num_written != spilled.size()) {
+        std::cerr << "Failed to spill neighbor lists of QGPartitionBuilder\n";
+        exit(1);
+    }
+}
+
+/**
+ * @brief merge spilled neighbor lists into rows of qg by chunks. A vector prunes the union
+ * of its lists to exactly degree_bound_ neighbors, and vectors in a single partition keep
+ * their lists. Then all rows are quantized.
+ */
+inline void QGPartitionBuilder::merge() {
+    std::cout << "Merging partitions...\n" << std::flush;
+    QGBuilder pruner(qg_, ef_build_, num_threads_);
+
+    size_t record_size = degree_bound_ + 1;
+    std::vector<PID> chunk(kMergeChunk * record_size);
+    std::rewind(spill_);
+    size_t num_records = 0;
+    while ((num_records = std::fread(
+                chunk.data(), sizeof(PID) * record_size, kMergeChunk, spill_
+            )) > 0) {
+        // with overlap > 2, a vector may have several lists in a chunk, merge them together
+        std::vector<size_t> order(num_records);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return chunk[a * record_size] < chunk[b * record_size];
+        });
+        std::vector<size_t> starts;
+        for (size_t j = 0; j < num_records; ++j) {
+            if (j == 0 ||
+                chunk[order[j] * record_size] != chunk[order[j - 1] * record_size]) {
+                starts.push_back(j);
+            }
+        }
+        size_t num_groups = starts.size();
+        starts.push_back(num_records);
+
+#pragma omp parallel for schedule(dynamic)
+        for (size_t g = 0; g < num_groups; ++g) {
+            PID cur_id = chunk[order[starts[g]] * record_size];
+            const float* cur_data = qg_.get_vector(cur_id);
+            PID* slots = qg_.get_neighbors(cur_id);
+
+            CandidateList pool;
+            std::unordered_set<PID> ids;
+            auto add_list = [&](const PID* list) {
+                for (size_t j = 0; j < degree_bound_; ++j) {
+                    if (ids.emplace(list[j]).second) {
+                        pool.emplace_back(
+                            list[j],
+                            qg_.raw_dist_func_(cur_data, qg_.get_vector(list[j]), dim_)
+                        );
+                    }
+                }
+            };
+            add_list(slots);
+            for (size_t j = starts[g]; j < starts[g + 1]; ++j) {
+                add_list(&chunk[(order[j] * record_size) + 1]);
+            }
+            std::sort(pool.begin(), pool.end());
+
+            CandidateList result;
+            std::vector<PID> pruned;
+            pruner.heuristic_prune(pool, result, &pruned);
+            pruner.supplement_edges(
+                cur_id,
+                result,
+                pruned.data(),
+                std::min(pruned.size(), QGBuilder::kMaxPrunedSize),
+                num_nodes_
+            );
+            qg_.set_neighbors(cur_id, result);
+        }
+    }
+
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < num_nodes_; ++i) {
+        qg_.update_codes(i, degree_bound_);
+    }
+    std::cout << "Merging finished...\n";
+}
+}  // namespace rabitqlib::symqg
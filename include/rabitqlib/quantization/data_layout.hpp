@@ -5,16 +5,15 @@
 #include "rabitqlib/fastscan/fastscan.hpp"
 
 namespace rabitqlib {
-template <typename T>
+// kWidth vectors per batch, see fastscan::pack_codes
+template <typename T, size_t kWidth = fastscan::kBatchSize>
 struct BatchDataMap {
    public:
     explicit BatchDataMap(char* data, size_t padded_dim)
         : batch_bin_code_(reinterpret_cast<uint8_t*>(data))
-        , f_add_(
-              reinterpret_cast<T*>(data + (padded_dim * fastscan::kBatchSize / 8))
-          )  // 1 bit code
-        , f_rescale_(f_add_ + fastscan::kBatchSize)
-        , f_error_(f_rescale_ + fastscan::kBatchSize) {}
+        , f_add_(reinterpret_cast<T*>(data + (padded_dim * kWidth / 8)))  // 1 bit code
+        , f_rescale_(f_add_ + kWidth)
+        , f_error_(f_rescale_ + kWidth) {}
 
     [[nodiscard]] uint8_t* bin_code() { return batch_bin_code_; }
     [[nodiscard]] T* f_add() { return f_add_; }
@@ -22,8 +21,7 @@ struct BatchDataMap {
     [[nodiscard]] T* f_error() { return f_error_; }
 
     static size_t data_bytes(size_t padded_dim) {
-        return (padded_dim * fastscan::kBatchSize / 8) +
-               (sizeof(T) * fastscan::kBatchSize * 3);
+        return (padded_dim * kWidth / 8) + (sizeof(T) * kWidth * 3);
     }
 
    private:
@@ -33,16 +31,15 @@ struct BatchDataMap {
     T* f_error_;
 };
 
-template <typename T>
+template <typename T, size_t kWidth = fastscan::kBatchSize>
 struct ConstBatchDataMap {
    public:
     explicit ConstBatchDataMap(const char* data, size_t padded_dim)
         : batch_bin_code_(reinterpret_cast<const uint8_t*>(data))
-        , f_add_(
-              reinterpret_cast<const T*>(data + (padded_dim * fastscan::kBatchSize / 8))
+        , f_add_(reinterpret_cast<const T*>(data + (padded_dim * kWidth / 8))
           )  // 1 bit code
-        , f_rescale_(f_add_ + fastscan::kBatchSize)
-        , f_error_(f_rescale_ + fastscan::kBatchSize) {}
+        , f_rescale_(f_add_ + kWidth)
+        , f_error_(f_rescale_ + kWidth) {}
 
     [[nodiscard]] const uint8_t* bin_code() const { return batch_bin_code_; }
     [[nodiscard]] const T* f_add() const { return f_add_; }
@@ -33,7 +33,7 @@ inline RabitqConfig faster_config(size_t dim, size_t total_bits) {
     return config;
 }
 
-template <typename T, bool Parallel = false>
+template <typename T, bool Parallel = false, size_t kWidth = fastscan::kBatchSize>
 inline void quantize_one_batch(
     const T* data,
     const T* centroid,
@@ -42,9 +42,9 @@ inline void quantize_one_batch(
     char* batch_data,
     MetricType metric_type = METRIC_L2
 ) {
-    BatchDataMap<T> this_batch(batch_data, padded_dim);
+    BatchDataMap<T, kWidth> this_batch(batch_data, padded_dim);
 
-    rabitq_impl::one_bit::one_bit_batch_code(
+    rabitq_impl::one_bit::one_bit_batch_code<T, Parallel, kWidth>(
         data,
         centroid,
         num,
@@ -57,7 +57,7 @@ inline void quantize_one_batch(
     );
 }
 
-template <typename T, bool Parallel = false>
+template <typename T, bool Parallel = false, size_t kWidth = fastscan::kBatchSize>
 inline void quantize_one_batch(
     const T* data,
     size_t num,
@@ -66,9 +66,9 @@ inline void quantize_one_batch(
     MetricType metric_type = METRIC_L2
 ) {
     std::vector<T> centroid(padded_dim, 0);
-    BatchDataMap<T> this_batch(batch_data, padded_dim);
+    BatchDataMap<T, kWidth> this_batch(batch_data, padded_dim);
 
-    rabitq_impl::one_bit::one_bit_batch_code(
+    rabitq_impl::one_bit::one_bit_batch_code<T, Parallel, kWidth>(
         data,
         centroid.data(),
         num,
@@ -246,6 +246,65 @@ inline void quantize_split_batch(
     }
 }
 
+/**
+ * @brief Like quantize_split_batch, but the batch data holds the top 2 bits of each
+ * dimension for FastScan and the ex data only the remaining ex_bits - 1 bits, with the
+ * factors of the whole code. The batch data is a BatchDataMap of 2 * padded_dim dims
+ * and each ex data an ExDataMap of ex_bits - 1 bits (none if ex_bits == 1).
+ *
+ * @param ex_bits   total bits - 1, >= 1
+ */
+inline void quantize_split_batch_2bit(
+    const float* data,
+    const float* centroid,
+    size_t num_points,
+    size_t padded_dim,
+    size_t ex_bits,
+    char* batch_data,
+    char* ex_data,
+    MetricType metric_type = METRIC_L2,
+    RabitqConfig config = RabitqConfig()
+) {
+    size_t low_bits = ex_bits - 1;
+    BatchDataMap<float> this_batch(batch_data, padded_dim * 2);
+    std::vector<uint8_t> top_codes(num_points * padded_dim * 2 / 8);
+    std::vector<uint8_t> low_code(padded_dim);
+
+    for (size_t i = 0; i < num_points; ++i) {
+        float f_add_ex;
+        float f_rescale_ex;
+        rabitq_impl::two_bit::two_bit_split_code(
+            data + (i * padded_dim),
+            centroid,
+            padded_dim,
+            ex_bits + 1,
+            top_codes.data() + (i * padded_dim * 2 / 8),
+            this_batch.f_add()[i],
+            this_batch.f_rescale()[i],
+            this_batch.f_error()[i],
+            low_code.data(),
+            f_add_ex,
+            f_rescale_ex,
+            metric_type,
+            config.t_const
+        );
+
+        if (low_bits > 0) {
+            ExDataMap<float> cur_ex(ex_data, padded_dim, low_bits);
+            rabitq_impl::ex_bits::packing_rabitqplus_code(
+                low_code.data(), cur_ex.ex_code(), padded_dim, low_bits
+            );
+            cur_ex.f_add_ex() = f_add_ex;
+            cur_ex.f_rescale_ex() = f_rescale_ex;
+            ex_data += ExDataMap<float>::data_bytes(padded_dim, low_bits);
+        }
+    }
+
+    fastscan::pack_codes(
+        padded_dim * 2, top_codes.data(), num_points, this_batch.bin_code()
+    );
+}
+
 inline void quantize_split_single(
     const float* data,
     const float* centroid,
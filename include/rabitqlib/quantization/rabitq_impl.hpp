@@ -3,6 +3,7 @@
 #include <immintrin.h>
 #include <omp.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
@@ -17,6 +18,80 @@ namespace rabitqlib::quant::rabitq_impl {
 
 constexpr float kConstEpsilon = 1.9;
 
+/**
+ * @brief Factors for distance estimation with a code of the given bits per dimension,
+ * whose reconstructed direction is code - (2^bits - 1) / 2.
+ *
+ * @param residual  data - centroid
+ * @param centroid  centroid vector
+ * @param code      code of each dimension, in [0, 2^bits - 1]
+ * @param dim       dimensionality of the vectors
+ * @param bits      bits per dimension of code
+ */
+template <typename T>
+inline void code_factors(
+    const T* residual,
+    const T* centroid,
+    const int* code,
+    size_t dim,
+    size_t bits,
+    T& f_add,
+    T& f_rescale,
+    T& f_error,
+    MetricType metric_type = METRIC_L2
+) {
+    // xu_cb = x_u + cb, xu_cb has same direction and different length with x_bar
+    float cb = -static_cast<float>((1 << bits) - 1) / 2.F;
+    ConstRowMajorArrayMap<int> x_u(code, 1, static_cast<long>(dim));
+    RowMajorArray<T> xu_cb = x_u.template cast<T>() + cb;
+
+    // distance to centroid
+    T l2_sqr = l2norm_sqr<T>(residual, dim);
+    T l2_norm = std::sqrt(l2_sqr);
+
+    // dot product between residual and xu_cb
+    T ip_resi_xucb = dot_product<T>(residual, xu_cb.data(), dim);
+    // dot product between centroid and xu_cb
+    T ip_cent_xucb = dot_product<T>(centroid, xu_cb.data(), dim);
+
+    // corner case
+    if (ip_resi_xucb == 0) {
+        ip_resi_xucb = std::numeric_limits<T>::infinity();
+    }
+
+    // We use unnormalized vector to get error factor. To be more specific,
+    // sqrt((1 - <o, o_bar>^2) / <o, o_bar>^2) / sqrt(dim - 1) = 3rd item in following
+    // expression. The radicand is clamped at 0, it is negative for a zero residual (data
+    // equal to the centroid) and may be slightly negative by rounding.
+    T tmp_error =
+        l2_norm * kConstEpsilon *
+        std::sqrt(std::max<T>(
+            (((l2_sqr * l2norm_sqr<T>(xu_cb.data(), dim)) / (ip_resi_xucb * ip_resi_xucb)) -
+             1) /
+                static_cast<T>(dim - 1),
+            0
+        ));
+
+    // 3 factors used for distance estimation, please refer to document for more info.
+    // For f_rescale and 2nd item of f_add, we use the dot product of raw residual (rather
+    // than the normalized one) as the denominator, thus we need to multiply another l2norm.
+    // For (ip_cent_xucb / ip_resi_xucb), the norm of xucb does not matter since it is also
+    // in numerator.
+    if (metric_type == METRIC_L2) {
+        f_add = l2_sqr + (2 * l2_sqr * ip_cent_xucb / ip_resi_xucb);
+        f_rescale = -2 * l2_sqr / ip_resi_xucb;
+        f_error = 2 * tmp_error;
+    } else if (metric_type == METRIC_IP) {
+        f_add = 1 - dot_product<T>(residual, centroid, dim) +
+                (l2_sqr * ip_cent_xucb / ip_resi_xucb);
+        f_rescale = -l2_sqr / ip_resi_xucb;
+        f_error = 1 * tmp_error;
+    } else {
+        std::cerr << "Unsupported metric type in quantization\n" << std::flush;
+        exit(1);
+    }
+}
+
 namespace one_bit {
 
 /**
@@ -86,54 +161,17 @@ inline void one_bit_code_with_factor(
     // quantize
     RowMajorArray<T> residual_arr = one_bit_code(data, centroid, dim, binary_code);
 
-    // xu_cb = x_u + cb, xu_cb has same direction and different length with x_bar
-    float cb = -((1 << 1) - 1) / 2.F;
-    RowMajorArrayMap<int> x_u(binary_code, 1, static_cast<long>(dim));
-    RowMajorArray<T> xu_cb = x_u.template cast<T>() + cb;
-
-    // distance to centroid
-    T l2_sqr = l2norm_sqr<T>(residual_arr.data(), dim);
-    T l2_norm = std::sqrt(l2_sqr);
-
-    // dot product between residual and xu_cb
-    T ip_resi_xucb = dot_product<T>(residual_arr.data(), xu_cb.data(), dim);
-    // dot product between centroid and xu_cb
-    T ip_cent_xucb = dot_product<T>(centroid, xu_cb.data(), dim);
-
-    // corner case
-    if (ip_resi_xucb == 0) {
-        ip_resi_xucb = std::numeric_limits<T>::infinity();
-    }
-
-    // We use unnormalized vector to get error factor. To be more specific,
-    // sqrt((1 - <o, o_bar>^2) / <o, o_bar>^2) / sqrt(dim - 1) = 3rd item in following
-    // expression
-    T tmp_error =
-        l2_norm * kConstEpsilon *
-        std::sqrt(
-            (((l2_sqr * l2norm_sqr<T>(xu_cb.data(), dim)) / (ip_resi_xucb * ip_resi_xucb)) -
-             1) /
-            (dim - 1)
-        );
-
-    // 3 factors used for distance estimation, please refer to document for more info.
-    // For f_rescale and 2nd item of f_add, we use the dot product of raw residual (rather
-    // than the normalized one) as the denominator, thus we need to multiply another l2norm.
-    // For (ip_cent_xucb / ip_resi_xucb), the norm of xucb does not matter since it is also
-    // in numerator.
-    if (metric_type == METRIC_L2) {
-        f_add = l2_sqr + (2 * l2_sqr * ip_cent_xucb / ip_resi_xucb);
-        f_rescale = -2 * l2_sqr / ip_resi_xucb;
-        f_error = 2 * tmp_error;
-    } else if (metric_type == METRIC_IP) {
-        f_add = 1 - dot_product<T>(residual_arr.data(), centroid, dim) +
-                (l2_sqr * ip_cent_xucb / ip_resi_xucb);
-        f_rescale = -l2_sqr / ip_resi_xucb;
-        f_error = 1 * tmp_error;
-    } else {
-        std::cerr << "Unsupported metric type in quantization\n" << std::flush;
-        exit(1);
-    }
+    code_factors(
+        residual_arr.data(),
+        centroid,
+        binary_code,
+        dim,
+        1,
+        f_add,
+        f_rescale,
+        f_error,
+        metric_type
+    );
 }
 
 /**
@@ -216,8 +254,8 @@ inline void one_bit_compact_codes(
     }
 }
 
-// ! padded_dim % 64 == 0
-template <typename T, bool Parallel = false>
+// ! padded_dim % 64 == 0, codes are packed in batches of kWidth vectors
+template <typename T, bool Parallel = false, size_t kWidth = fastscan::kBatchSize>
 inline void one_bit_batch_code(
     const T* data,
     const T* centroid,
@@ -242,7 +280,7 @@ inline void one_bit_batch_code(
         f_error,
         metric_type
     );
-    fastscan::pack_codes(padded_dim, compact_codes.data(), num, packed_code);
+    fastscan::pack_codes<kWidth>(padded_dim, compact_codes.data(), num, packed_code);
 }
 
 }  // namespace one_bit
@@ -409,6 +447,13 @@ inline T ex_bits_code(
 ) {
     ConstRowMajorArrayMap<T> res_arr(residual, 1, dim);
 
+    // a zero residual has no direction to quantize, and its factors make the codes
+    // irrelevant
+    if (res_arr.matrix().squaredNorm() == 0) {
+        std::fill(ex_code, ex_code + dim, 0);
+        return 1;
+    }
+
     // get normalized abs residual for plus code
     RowMajorArray<T> abs_res = res_arr.rowwise().normalized().abs();
 
@@ -477,13 +522,15 @@ inline void ex_bits_code_with_factor(
         ip_resi_xucb = std::numeric_limits<T>::infinity();
     }
 
+    // see code_factors() for the clamp
     T tmp_error =
         l2_norm * kConstEpsilon *
-        std::sqrt(
+        std::sqrt(std::max<T>(
             (((l2_sqr * l2norm_sqr<T>(xu_cb.data(), dim)) / (ip_resi_xucb * ip_resi_xucb)) -
              1) /
-            (dim - 1)
-        );
+                static_cast<T>(dim - 1),
+            0
+        ));
 
     if (metric_type == METRIC_L2) {
         f_add_ex = l2_sqr + (2 * l2_sqr * ip_cent_xucb / ip_resi_xucb);
@@ -571,7 +618,9 @@ static inline void rabitq_scalar_impl(
     float cos_similarity =
         dot_product<T>(residual_arr.data(), u_cb.data(), dim) / (norm_data * norm_quan);
 
-    if (scalar_quantizer_type == ScalarQuantizerType::RECONSTRUCTION) {
+    if (norm_data == 0) {
+        delta = 0;
+    } else if (scalar_quantizer_type == ScalarQuantizerType::RECONSTRUCTION) {
         delta = norm_data / norm_quan * cos_similarity;
     } else if (scalar_quantizer_type == ScalarQuantizerType::UNBIASED_ESTIMATION) {
         delta = norm_data / norm_quan / cos_similarity;
@@ -620,4 +669,76 @@ static inline void rabitq_full_impl(
     }
 }
 }  // namespace total_bits
+
+namespace two_bit {
+/**
+ * @brief Split a code of total_bits >= 2 into its top 2 bits of each dimension, which are
+ * scanned by FastScan, and the remaining total_bits - 2 bits for re-ranking. The top bits
+ * are stored as a binary code of 2 * dim bits, the higher bit of dimension i goes to bit
+ * 2i, so that FastScan estimates <top code, q> with a lut over (2q_0, q_0, 2q_1, q_1, ...).
+ *
+ * @param top_code  compact binary code of 2 * dim bits, see pack_binary
+ * @param f_add, f_rescale, f_error  factors of the top 2 bits, see code_factors
+ * @param low_code  code of the remaining bits of each dimension (not compact)
+ * @param f_add_ex, f_rescale_ex  factors of the whole code, see ex_bits_code_with_factor
+ */
+template <typename T>
+inline void two_bit_split_code(
+    const T* data,
+    const T* centroid,
+    size_t dim,
+    size_t total_bits,
+    uint8_t* top_code,
+    T& f_add,
+    T& f_rescale,
+    T& f_error,
+    uint8_t* low_code,
+    T& f_add_ex,
+    T& f_rescale_ex,
+    MetricType metric_type = METRIC_L2,
+    double t_const = -1
+) {
+    size_t low_bits = total_bits - 2;
+    std::vector<uint16_t> total_code(dim);
+    T f_error_ex;  // not used for re-ranking
+    total_bits::rabitq_full_impl(
+        data,
+        centroid,
+        dim,
+        total_bits,
+        total_code.data(),
+        f_add_ex,
+        f_rescale_ex,
+        f_error_ex,
+        metric_type,
+        t_const
+    );
+
+    std::vector<int> top(dim);
+    std::vector<int> top_binary(dim * 2);
+    for (size_t i = 0; i < dim; ++i) {
+        top[i] = total_code[i] >> low_bits;
+        top_binary[2 * i] = top[i] >> 1;
+        top_binary[(2 * i) + 1] = top[i] & 1;
+        low_code[i] = static_cast<uint8_t>(total_code[i] & ((1 << low_bits) - 1));
+    }
+    pack_binary(top_binary.data(), top_code, dim * 2);
+
+    std::vector<T> residual(dim);
+    for (size_t i = 0; i < dim; ++i) {
+        residual[i] = data[i] - centroid[i];
+    }
+    code_factors(
+        residual.data(),
+        centroid,
+        top.data(),
+        dim,
+        2,
+        f_add,
+        f_rescale,
+        f_error,
+        metric_type
+    );
+}
+}  // namespace two_bit
 }  // namespace rabitqlib::quant::rabitq_impl
\ No newline at end of file
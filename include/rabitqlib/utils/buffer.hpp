@@ -74,8 +74,13 @@ class SearchBuffer {
     // return candidate id for next pop()
     [[nodiscard]] auto next_id() const { return data_[cur_].id; }
 
+    // return distance of candidate for next pop()
+    [[nodiscard]] auto next_dist() const { return data_[cur_].distance; }
+
     [[nodiscard]] auto has_next() const -> bool { return cur_ < size_; }
 
+    [[nodiscard]] auto size() const -> size_t { return size_; }
+
     void resize(size_t new_size) {
         this->capacity_ = new_size;
         data_ = std::vector<AnnCandidate<T>, memory::AlignedAllocator<AnnCandidate<T>>>(
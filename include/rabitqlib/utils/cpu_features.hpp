@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace rabitqlib {
+/**
+ * @brief SIMD levels of hot kernels. Every dispatched kernel is compiled for each level
+ * with target attributes, so that one binary built without -march=native still uses
+ * AVX-512 on machines that have it. The level is detected once with cpuid, dispatching
+ * costs a well predicted branch and nothing at all when the binary is compiled for the
+ * highest level.
+ *
+ * None:       no AVX2, dispatched kernels fall back to scalar references
+ * AVX2:       AVX2, FMA, F16C, BMI2 (Haswell and later)
+ * AVX512:     AVX-512 F/BW/DQ/VL (Skylake-SP and later)
+ * AVX512Ext:  AVX512 plus VPOPCNTDQ, VNNI and VBMI (Ice Lake and later)
+ */
+enum class SimdLevel : uint8_t { None, AVX2, AVX512, AVX512Ext };
+
+// the target strings of the levels, a kernel of some level may call kernels of lower levels
+#define RABITQ_TARGET_AVX2 __attribute__((target("avx2,fma,f16c,bmi,bmi2,popcnt,lzcnt")))
+#define RABITQ_TARGET_AVX512                                                       \
+    __attribute__((target("avx2,fma,f16c,bmi,bmi2,popcnt,lzcnt,avx512f,avx512bw," \
+                          "avx512dq,avx512vl,avx512cd")))
+#define RABITQ_TARGET_AVX512EXT                                                    \
+    __attribute__((target("avx2,fma,f16c,bmi,bmi2,popcnt,lzcnt,avx512f,avx512bw," \
+                          "avx512dq,avx512vl,avx512cd,avx512vpopcntdq,avx512vnni,"  \
+                          "avx512vbmi")))
+
+// the level this translation unit is compiled for
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512DQ__) && \
+    defined(__AVX512VL__) && defined(__AVX512VPOPCNTDQ__) &&                    \
+    defined(__AVX512VNNI__) && defined(__AVX512VBMI__)
+constexpr SimdLevel kCompiledSimdLevel = SimdLevel::AVX512Ext;
+#elif defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512DQ__) && \
+    defined(__AVX512VL__)
+constexpr SimdLevel kCompiledSimdLevel = SimdLevel::AVX512;
+#elif defined(__AVX2__) && defined(__FMA__)
+constexpr SimdLevel kCompiledSimdLevel = SimdLevel::AVX2;
+#else
+constexpr SimdLevel kCompiledSimdLevel = SimdLevel::None;
+#endif
+
+inline const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2:
+            return "avx2";
+        case SimdLevel::AVX512:
+            return "avx512";
+        case SimdLevel::AVX512Ext:
+            return "avx512ext";
+        default:
+            return "none";
+    }
+}
+
+/**
+ * @brief detect the SIMD level of the running cpu. Setting the environment variable
+ * RABITQ_SIMD_LEVEL (none, avx2, avx512 or avx512ext) lowers the level, e.g., to compare
+ * kernels or to test the scalar references on one machine. Binaries compiled for
+ * AVX512Ext do not detect the level at all (see simd_level()), so the variable has no
+ * effect there; build with -DRABITQ_NATIVE=OFF to compare levels.
+ */
+inline SimdLevel detect_simd_level() {
+    __builtin_cpu_init();
+    SimdLevel level = SimdLevel::None;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+        __builtin_cpu_supports("bmi2")) {
+        level = SimdLevel::AVX2;
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+            __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl")) {
+            level = SimdLevel::AVX512;
+            if (__builtin_cpu_supports("avx512vpopcntdq") &&
+                __builtin_cpu_supports("avx512vnni") &&
+                __builtin_cpu_supports("avx512vbmi")) {
+                level = SimdLevel::AVX512Ext;
+            }
+        }
+    }
+
+    const char* env = std::getenv("RABITQ_SIMD_LEVEL");
+    if (env != nullptr) {
+        for (auto cap : {SimdLevel::None, SimdLevel::AVX2, SimdLevel::AVX512}) {
+            if (std::strcmp(env, simd_level_name(cap)) == 0 && cap < level) {
+                level = cap;
+            }
+        }
+    }
+    return level;
+}
+
+// SIMD level used by dispatched kernels, detected on first use
+inline SimdLevel simd_level() {
+    if constexpr (kCompiledSimdLevel == SimdLevel::AVX512Ext) {
+        return SimdLevel::AVX512Ext;
+    } else {
+        static const SimdLevel kLevel = detect_simd_level();
+        return kLevel;
+    }
+}
+}  // namespace rabitqlib
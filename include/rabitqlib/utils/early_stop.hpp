@@ -0,0 +1,65 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+namespace rabitqlib {
+/**
+ * @brief Adaptive termination of beam search on graphs. By default, a search runs until
+ * all candidates in its beam (of size ef) are expanded, no matter how easy the query is.
+ *
+ * patience:   if > 0, stop once the top-k results have not improved for patience
+ *             consecutive expanded vertices.
+ * error_gap:  if true, stop once the lower bound of the distance of the nearest
+ *             unexpanded candidate exceeds the k-th result, i.e., no candidate left is
+ *             likely to improve the results.
+ */
+struct EarlyStopParams {
+    size_t patience = 0;
+    bool error_gap = false;
+};
+
+// Termination state of one query, it also counts expanded vertices (hops)
+template <typename T>
+class EarlyStop {
+   private:
+    EarlyStopParams params_;
+    size_t hops_ = 0;       // num of expanded vertices
+    size_t num_stale_ = 0;  // num of expanded vertices since the last improvement
+    T max_error_ = 0;       // largest error of estimated distances seen by this query
+
+   public:
+    explicit EarlyStop(const EarlyStopParams& params) : params_(params) {}
+
+    // record an expanded vertex, improved: if it changed the top-k results
+    void expand(bool improved) {
+        ++hops_;
+        num_stale_ = improved ? 0 : num_stale_ + 1;
+    }
+
+    // record the observed error of an estimated distance, used as the error bound of
+    // codes that store no error factor (see max_error())
+    void add_error(T error) { max_error_ = std::max(max_error_, error); }
+
+    // largest observed error of this query, next_dist - max_error() is the lower bound of
+    // candidates whose codes have no error factor
+    [[nodiscard]] T max_error() const { return max_error_; }
+
+    /**
+     * @brief whether to stop before expanding the next candidate
+     *
+     * @param next_low    lower bound of the distance of the next candidate
+     * @param kth_dist    distance of the k-th result, max of T if there are less than k
+     */
+    [[nodiscard]] bool stop(T next_low, T kth_dist) const {
+        if (params_.patience > 0 && num_stale_ >= params_.patience) {
+            return true;
+        }
+        return params_.error_gap && kth_dist < std::numeric_limits<T>::max() &&
+               next_low > kth_dist;
+    }
+
+    [[nodiscard]] size_t hops() const { return hops_; }
+};
+}  // namespace rabitqlib
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "rabitqlib/defines.hpp"
+#include "rabitqlib/utils/space.hpp"
+
+namespace rabitqlib {
+// Storage type of raw vectors (e.g., the raw vectors in rows of qg)
+enum RawDataType : std::uint8_t { RAW_FP32, RAW_FP16, RAW_BF16, RAW_INT8 };
+
+namespace low_precision_impl {
+inline uint32_t float_bits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(float));
+    return bits;
+}
+
+inline float bits_float(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+// IEEE binary16, round to nearest even
+inline uint16_t float_to_half(float value) {
+    uint32_t x = float_bits(value);
+    auto sign = static_cast<uint16_t>((x >> 16) & 0x8000);
+    uint32_t mant = x & 0x007FFFFF;
+    int32_t exp = static_cast<int32_t>((x >> 23) & 0xFF);
+
+    if (exp == 0xFF) {  // inf or nan
+        return sign | 0x7C00 | (mant != 0 ? 0x200 : 0);
+    }
+    int32_t half_exp = exp - 127 + 15;
+    if (half_exp >= 31) {  // overflow
+        return sign | 0x7C00;
+    }
+    if (half_exp <= 0) {  // subnormal or zero
+        if (half_exp < -10) {
+            return sign;
+        }
+        mant |= 0x00800000;
+        auto shift = static_cast<uint32_t>(14 - half_exp);
+        uint32_t half_mant = mant >> shift;
+        uint32_t rem = mant & ((1U << shift) - 1);
+        uint32_t halfway = 1U << (shift - 1);
+        if (rem > halfway || (rem == halfway && (half_mant & 1) != 0)) {
+            ++half_mant;
+        }
+        return sign | static_cast<uint16_t>(half_mant);
+    }
+    uint32_t half = (static_cast<uint32_t>(half_exp) << 10) | (mant >> 13);
+    uint32_t rem = mant & 0x1FFF;
+    if (rem > 0x1000 || (rem == 0x1000 && (half & 1) != 0)) {
+        ++half;  // a carry into the exponent is still correct
+    }
+    return sign | static_cast<uint16_t>(half);
+}
+
+inline float half_to_float(uint16_t half) {
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exp = (half >> 10) & 0x1F;
+    uint32_t mant = half & 0x3FF;
+
+    if (exp == 0) {
+        if (mant == 0) {
+            return bits_float(sign);
+        }
+        // subnormal, normalize it
+        int32_t e = 1;
+        while ((mant & 0x400) == 0) {
+            mant <<= 1;
+            --e;
+        }
+        mant &= 0x3FF;
+        return bits_float(sign | (static_cast<uint32_t>(e + 112) << 23) | (mant << 13));
+    }
+    if (exp == 31) {
+        return bits_float(sign | 0x7F800000 | (mant << 13));
+    }
+    return bits_float(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
+// bfloat16, round to nearest even
+inline uint16_t float_to_bf16(float value) {
+    uint32_t x = float_bits(value);
+    if ((x & 0x7FFFFFFF) > 0x7F800000) {  // nan
+        return static_cast<uint16_t>((x >> 16) | 0x40);
+    }
+    x += 0x7FFF + ((x >> 16) & 1);
+    return static_cast<uint16_t>(x >> 16);
+}
+
+inline float bf16_to_float(uint16_t value) {
+    return bits_float(static_cast<uint32_t>(value) << 16);
+}
+
+struct Fp16 {
+    using storage = uint16_t;
+    static float to_float(storage value) { return half_to_float(value); }
+#if defined(__AVX512F__)
+    static __m512 load16(const storage* ptr) {
+        return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr)));
+    }
+#elif defined(__AVX2__) && defined(__F16C__)
+    static __m256 load8(const storage* ptr) {
+        return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)));
+    }
+#endif
+};
+
+struct Bf16 {
+    using storage = uint16_t;
+    static float to_float(storage value) { return bf16_to_float(value); }
+#if defined(__AVX512F__)
+    static __m512 load16(const storage* ptr) {
+        __m256i raw = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+        return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(raw), 16));
+    }
+#elif defined(__AVX2__) && defined(__F16C__)
+    static __m256 load8(const storage* ptr) {
+        __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(raw), 16));
+    }
+#endif
+};
+
+struct Int8 {
+    using storage = int8_t;
+    static float to_float(storage value) { return static_cast<float>(value); }
+#if defined(__AVX512F__)
+    static __m512 load16(const storage* ptr) {
+        __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+        return _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(raw));
+    }
+#elif defined(__AVX2__) && defined(__F16C__)
+    static __m256 load8(const storage* ptr) {
+        __m128i raw = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ptr));
+        return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(raw));
+    }
+#endif
+};
+
+/**
+ * @brief inner product (kIP) or squared l2 distance between a float vector and
+ * scale * vec, where vec is stored in a low precision format
+ */
+template <typename Format, bool kIP>
+inline float dist_impl(
+    const float* __restrict__ query,
+    const typename Format::storage* __restrict__ vec,
+    float scale,
+    size_t dim
+) {
+    size_t i = 0;
+    float result = 0;
+#if defined(__AVX512F__)
+    __m512 sum = _mm512_setzero_ps();
+    __m512 s = _mm512_set1_ps(scale);
+    for (; i + 16 <= dim; i += 16) {
+        __m512 q = _mm512_loadu_ps(query + i);
+        __m512 v = Format::load16(vec + i);
+        if constexpr (kIP) {
+            sum = _mm512_fmadd_ps(q, v, sum);
+        } else {
+            __m512 diff = _mm512_fnmadd_ps(s, v, q);
+            sum = _mm512_fmadd_ps(diff, diff, sum);
+        }
+    }
+    result = _mm512_reduce_add_ps(sum);
+#elif defined(__AVX2__) && defined(__F16C__)
+    __m256 sum = _mm256_setzero_ps();
+    __m256 s = _mm256_set1_ps(scale);
+    for (; i + 8 <= dim; i += 8) {
+        __m256 q = _mm256_loadu_ps(query + i);
+        __m256 v = Format::load8(vec + i);
+        if constexpr (kIP) {
+            sum = _mm256_fmadd_ps(q, v, sum);
+        } else {
+            __m256 diff = _mm256_fnmadd_ps(s, v, q);
+            sum = _mm256_fmadd_ps(diff, diff, sum);
+        }
+    }
+    result = excode_ipimpl::mm256_reduce_add_ps(sum);
+#endif
+    for (; i < dim; ++i) {
+        if constexpr (kIP) {
+            result += query[i] * Format::to_float(vec[i]);
+        } else {
+            float diff = query[i] - (scale * Format::to_float(vec[i]));
+            result += diff * diff;
+        }
+    }
+    return kIP ? result * scale : result;
+}
+}  // namespace low_precision_impl
+
+// num of bytes to store a raw vector, int8 vectors are stored with a float scale
+inline size_t raw_data_bytes(RawDataType type, size_t dim) {
+    switch (type) {
+        case RAW_FP16:
+        case RAW_BF16:
+            return dim * sizeof(uint16_t);
+        case RAW_INT8:
+            return sizeof(float) + dim;
+        default:
+            return dim * sizeof(float);
+    }
+}
+
+/**
+ * @brief encode a float vector in the given format
+ *
+ * @param vec   float vector, dim elements
+ * @param dim   dimension
+ * @param type  storage type
+ * @param code  result, raw_data_bytes(type, dim) bytes
+ */
+inline void encode_raw_data(const float* vec, size_t dim, RawDataType type, char* code) {
+    switch (type) {
+        case RAW_FP16: {
+            auto* dst = reinterpret_cast<uint16_t*>(code);
+            for (size_t i = 0; i < dim; ++i) {
+                dst[i] = low_precision_impl::float_to_half(vec[i]);
+            }
+            break;
+        }
+        case RAW_BF16: {
+            auto* dst = reinterpret_cast<uint16_t*>(code);
+            for (size_t i = 0; i < dim; ++i) {
+                dst[i] = low_precision_impl::float_to_bf16(vec[i]);
+            }
+            break;
+        }
+        case RAW_INT8: {
+            // symmetric quantization, vec ~= scale * code
+            float max_abs = 0;
+            for (size_t i = 0; i < dim; ++i) {
+                max_abs = std::max(max_abs, std::abs(vec[i]));
+            }
+            float scale = max_abs / 127;
+            float inv_scale = max_abs > 0 ? 1 / scale : 0;
+            std::memcpy(code, &scale, sizeof(float));
+            auto* dst = reinterpret_cast<int8_t*>(code + sizeof(float));
+            for (size_t i = 0; i < dim; ++i) {
+                dst[i] = static_cast<int8_t>(std::lround(vec[i] * inv_scale));
+            }
+            break;
+        }
+        default:
+            std::memcpy(code, vec, dim * sizeof(float));
+    }
+}
+
+// decode a raw vector encoded by encode_raw_data()
+inline void decode_raw_data(const char* code, size_t dim, RawDataType type, float* vec) {
+    switch (type) {
+        case RAW_FP16: {
+            const auto* src = reinterpret_cast<const uint16_t*>(code);
+            for (size_t i = 0; i < dim; ++i) {
+                vec[i] = low_precision_impl::half_to_float(src[i]);
+            }
+            break;
+        }
+        case RAW_BF16: {
+            const auto* src = reinterpret_cast<const uint16_t*>(code);
+            for (size_t i = 0; i < dim; ++i) {
+                vec[i] = low_precision_impl::bf16_to_float(src[i]);
+            }
+            break;
+        }
+        case RAW_INT8: {
+            float scale;
+            std::memcpy(&scale, code, sizeof(float));
+            const auto* src = reinterpret_cast<const int8_t*>(code + sizeof(float));
+            for (size_t i = 0; i < dim; ++i) {
+                vec[i] = scale * static_cast<float>(src[i]);
+            }
+            break;
+        }
+        default:
+            std::memcpy(vec, code, dim * sizeof(float));
+    }
+}
+
+/**
+ * @brief distance between a float query and an encoded raw vector, consistent with
+ * euclidean_sqr() and dot_product_dis() on the original vector
+ */
+template <RawDataType kType, MetricType kMetric>
+inline float raw_data_dist(const float* __restrict__ query, const char* code, size_t dim) {
+    constexpr bool kIP = kMetric == METRIC_IP;
+    float res;
+    if constexpr (kType == RAW_FP16) {
+        res = low_precision_impl::dist_impl<low_precision_impl::Fp16, kIP>(
+            query, reinterpret_cast<const uint16_t*>(code), 1, dim
+        );
+    } else if constexpr (kType == RAW_BF16) {
+        res = low_precision_impl::dist_impl<low_precision_impl::Bf16, kIP>(
+            query, reinterpret_cast<const uint16_t*>(code), 1, dim
+        );
+    } else if constexpr (kType == RAW_INT8) {
+        float scale;
+        std::memcpy(&scale, code, sizeof(float));
+        res = low_precision_impl::dist_impl<low_precision_impl::Int8, kIP>(
+            query, reinterpret_cast<const int8_t*>(code + sizeof(float)), scale, dim
+        );
+    } else {
+        const auto* vec = reinterpret_cast<const float*>(code);
+        return kIP ? dot_product_dis<float>(query, vec, dim)
+                   : euclidean_sqr<float>(query, vec, dim);
+    }
+    return kIP ? 1 - res : res;
+}
+
+using RawDistFunc = float (*)(const float*, const char*, size_t);
+
+inline RawDistFunc select_raw_dist_func(RawDataType type, MetricType metric_type) {
+    bool is_ip = metric_type == METRIC_IP;
+    switch (type) {
+        case RAW_FP16:
+            return is_ip ? raw_data_dist<RAW_FP16, METRIC_IP>
+                         : raw_data_dist<RAW_FP16, METRIC_L2>;
+        case RAW_BF16:
+            return is_ip ? raw_data_dist<RAW_BF16, METRIC_IP>
+                         : raw_data_dist<RAW_BF16, METRIC_L2>;
+        case RAW_INT8:
+            return is_ip ? raw_data_dist<RAW_INT8, METRIC_IP>
+                         : raw_data_dist<RAW_INT8, METRIC_L2>;
+        default:
+            return is_ip ? raw_data_dist<RAW_FP32, METRIC_IP>
+                         : raw_data_dist<RAW_FP32, METRIC_L2>;
+    }
+}
+}  // namespace rabitqlib
@@ -3,11 +3,15 @@
 #include <immintrin.h>
 #include <sys/mman.h>
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdlib>
 #include <cstring>
 #include <limits>
+#include <mutex>
 #include <new>
 #include <type_traits>
+#include <vector>
 
 #include "rabitqlib/utils/tools.hpp"
 
@@ -84,6 +88,53 @@ inline T* align_allocate(size_t nbytes) {
     return static_cast<T*>(ptr);
 }
 
+/**
+ * @brief Bump allocator for many small buffers that share the same lifetime. Memory is
+ * taken from large blocks and released all at once by reset() or the destructor.
+ * allocate() is thread-safe.
+ */
+class Arena {
+   private:
+    size_t block_size_;
+    size_t used_ = 0;  // bytes used in the last block
+    std::vector<char*> blocks_;
+    std::mutex lock_;
+
+   public:
+    explicit Arena(size_t block_size = 1 << 22) : block_size_(block_size) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() { reset(); }
+
+    [[nodiscard]] char* allocate(size_t nbytes) {
+        nbytes = round_up_to_multiple_of<size_t>(nbytes, alignof(std::max_align_t));
+        std::lock_guard<std::mutex> guard(lock_);
+        if (blocks_.empty() || used_ + nbytes > block_size_) {
+            // oversized requests get a dedicated block
+            auto* block = static_cast<char*>(std::malloc(std::max(nbytes, block_size_)));
+            if (block == nullptr) {
+                throw std::bad_alloc();
+            }
+            blocks_.push_back(block);
+            used_ = 0;
+        }
+        char* ptr = blocks_.back() + used_;
+        used_ += nbytes;
+        return ptr;
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> guard(lock_);
+        for (char* block : blocks_) {
+            std::free(block);
+        }
+        blocks_.clear();
+        used_ = 0;
+    }
+};
+
 static inline void prefetch_l1(const void* addr) {
 #if defined(__SSE2__)
     _mm_prefetch(addr, _MM_HINT_T0);
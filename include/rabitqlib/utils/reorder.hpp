@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "rabitqlib/defines.hpp"
+
+namespace rabitqlib {
+/**
+ * @brief Compute a BFS order of a graph for better cache locality during search.
+ * Vertices reached from the same vertex are placed next to each other, so that the
+ * rows touched by consecutive hops tend to share pages and cache lines.
+ *
+ * @param num_nodes     number of vertices
+ * @param root          vertex where BFS starts (usually the entry point)
+ * @param neighbors     callable, neighbors(id) returns {const PID* list, size_t size}
+ * @return new_to_old   new_to_old[i] is the old id of the vertex placed at i
+ */
+template <typename NeighborFunc>
+inline std::vector<PID> bfs_order(size_t num_nodes, PID root, NeighborFunc&& neighbors) {
+    std::vector<PID> new_to_old;
+    new_to_old.reserve(num_nodes);
+    std::vector<bool> visited(num_nodes, false);
+
+    auto bfs_from = [&](PID start) {
+        size_t head = new_to_old.size();
+        visited[start] = true;
+        new_to_old.push_back(start);
+        while (head < new_to_old.size()) {
+            PID cur = new_to_old[head++];
+            std::pair<const PID*, size_t> nbs = neighbors(cur);
+            for (size_t i = 0; i < nbs.second; ++i) {
+                PID nb = nbs.first[i];
+                if (nb < num_nodes && !visited[nb]) {
+                    visited[nb] = true;
+                    new_to_old.push_back(nb);
+                }
+            }
+        }
+    };
+
+    if (num_nodes > 0) {
+        bfs_from(root);
+    }
+    // vertices unreachable from root
+    for (PID i = 0; i < num_nodes; ++i) {
+        if (!visited[i]) {
+            bfs_from(i);
+        }
+    }
+    return new_to_old;
+}
+
+// inverse of a permutation
+inline std::vector<PID> inverse_permutation(const std::vector<PID>& perm) {
+    std::vector<PID> inv(perm.size());
+    for (size_t i = 0; i < perm.size(); ++i) {
+        inv[perm[i]] = static_cast<PID>(i);
+    }
+    return inv;
+}
+}  // namespace rabitqlib
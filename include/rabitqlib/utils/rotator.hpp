@@ -10,6 +10,7 @@
 #include <random>
 
 #include "rabitqlib/defines.hpp"
+#include "rabitqlib/utils/cpu_features.hpp"
 #include "rabitqlib/utils/fht_avx.hpp"
 #include "rabitqlib/utils/space.hpp"
 #include "rabitqlib/utils/tools.hpp"
@@ -112,8 +113,32 @@ class MatrixRotator : public Rotator<T> {
     }
 };
 
-static inline void flip_sign(const uint8_t* flip, float* data, size_t dim) {
-#if defined(__AVX512F__) && defined(__AVX512DQ__)
+// scalar reference of flip_sign, the sign of data[i] is flipped if the i-th bit is set
+static inline void flip_sign_scalar(const uint8_t* flip, float* data, size_t dim) {
+    for (size_t i = 0; i < dim; ++i) {
+        if (((flip[i / 8] >> (i % 8)) & 1) != 0) {
+            data[i] = -data[i];
+        }
+    }
+}
+
+// unnormalized Walsh-Hadamard transform in place, scalar reference of helper_float_*
+static inline void fht_scalar(float* buf, size_t len) {
+    for (size_t h = 1; h < len; h <<= 1) {
+        for (size_t i = 0; i < len; i += 2 * h) {
+            for (size_t j = i; j < i + h; ++j) {
+                float x = buf[j];
+                float y = buf[j + h];
+                buf[j] = x + y;
+                buf[j + h] = x - y;
+            }
+        }
+    }
+}
+
+RABITQ_TARGET_AVX512 static inline void flip_sign_avx512(
+    const uint8_t* flip, float* data, size_t dim
+) {
     constexpr size_t kFloatsPerChunk = 64;  // Process 64 floats per iteration
     // constexpr size_t bits_per_chunk = floats_per_chunk;  // 64 bits = 8 bytes
 
@@ -156,38 +181,48 @@ static inline void flip_sign(const uint8_t* flip, float* data, size_t dim) {
         vec3 = _mm512_mask_xor_ps(vec3, mask3, vec3, sign_flip);
         _mm512_storeu_ps(&data[i + 48], vec3);
     }
-#elif defined(__AVX2__)
-   // Process 32 floats (4 AVX2 registers) per iteration
-    constexpr size_t kFloatsPerChunk = 32; 
-    
+}
+
+// mask to flip the signs of 8 floats given by the bits of byte_mask
+RABITQ_TARGET_AVX2 static inline __m256 flip_mask_avx2(uint8_t byte_mask) {
     const __m256i bit_select = _mm256_setr_epi32(
         0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80
     );
     const __m256 sign_flip = _mm256_castsi256_ps(_mm256_set1_epi32(0x80000000));
 
-    // utility lambda to create a mask for flipping signs
-    auto create_mask = [&](uint8_t byte_mask) -> __m256 {
-        __m256i mask_bits = _mm256_set1_epi32(byte_mask);
-        __m256i test = _mm256_and_si256(mask_bits, bit_select);
-        __m256i cmp = _mm256_cmpeq_epi32(test, bit_select);
-        return _mm256_and_ps(_mm256_castsi256_ps(cmp), sign_flip);
-    } ;
+    __m256i mask_bits = _mm256_set1_epi32(byte_mask);
+    __m256i test = _mm256_and_si256(mask_bits, bit_select);
+    __m256i cmp = _mm256_cmpeq_epi32(test, bit_select);
+    return _mm256_and_ps(_mm256_castsi256_ps(cmp), sign_flip);
+}
+
+RABITQ_TARGET_AVX2 static inline void flip_sign_avx2(
+    const uint8_t* flip, float* data, size_t dim
+) {
+   // Process 32 floats (4 AVX2 registers) per iteration
+    constexpr size_t kFloatsPerChunk = 32;
 
     for (size_t i = 0; i < dim; i += kFloatsPerChunk) {
         uint32_t mask_bits;
         std::memcpy(&mask_bits, &flip[i / 8], sizeof(mask_bits));
 
         for (int b = 0; b < 4; ++b) {
-            __m256 xor_mask = create_mask((mask_bits >> (b * 8)) & 0xFF);
+            __m256 xor_mask = flip_mask_avx2((mask_bits >> (b * 8)) & 0xFF);
             __m256 vec = _mm256_loadu_ps(&data[i + b * 8]);
             vec = _mm256_xor_ps(vec, xor_mask);
             _mm256_storeu_ps(&data[i + b * 8], vec);
         }
     }
-#else
-    std:: cerr << "Sign flip requires AVX512 or AVX2 support!\n";
-    exit(1);
-#endif
+}
+
+static inline void flip_sign(const uint8_t* flip, float* data, size_t dim) {
+    if (simd_level() >= SimdLevel::AVX512) {
+        flip_sign_avx512(flip, data, dim);
+    } else if (simd_level() >= SimdLevel::AVX2) {
+        flip_sign_avx2(flip, data, dim);
+    } else {
+        flip_sign_scalar(flip, data, dim);
+    }
 }
 
 class FhtKacRotator : public Rotator<float> {
@@ -242,6 +277,10 @@ class FhtKacRotator : public Rotator<float> {
                 std::cerr << "dimension of vector is too big\n";
                 exit(1);
         }
+        // helper_float_* are written in AVX assembly
+        if (simd_level() == SimdLevel::None) {
+            this->fht_float_ = [len = trunc_dim_](float* buf) { fht_scalar(buf, len); };
+        }
     }
     FhtKacRotator() = default;
     ~FhtKacRotator() override = default;
@@ -282,8 +321,16 @@ class FhtKacRotator : public Rotator<float> {
         return *this;
     }
 
-    static void kacs_walk(float* data, size_t len) {
-    #if defined(__AVX512F__)
+    static void kacs_walk_scalar(float* data, size_t len) {
+        for (size_t i = 0; i < len / 2; ++i) {
+            float x = data[i];
+            float y = data[i + (len / 2)];
+            data[i] = x + y;
+            data[i + (len / 2)] = x - y;
+        }
+    }
+
+    RABITQ_TARGET_AVX512 static void kacs_walk_avx512(float* data, size_t len) {
         // ! len % 32 == 0;
         for (size_t i = 0; i < len / 2; i += 16) {
             __m512 x = _mm512_loadu_ps(&data[i]);
@@ -295,7 +342,9 @@ class FhtKacRotator : public Rotator<float> {
             _mm512_storeu_ps(&data[i], new_x);
             _mm512_storeu_ps(&data[i + (len / 2)], new_y);
         }
-    #elif defined(__AVX2__)
+    }
+
+    RABITQ_TARGET_AVX2 static void kacs_walk_avx2(float* data, size_t len) {
         // ! len % 16 == 0;
         for (size_t i = 0; i < len / 2; i += 8) {
             __m256 x = _mm256_loadu_ps(&data[i]);
@@ -307,10 +356,16 @@ class FhtKacRotator : public Rotator<float> {
             _mm256_storeu_ps(&data[i], new_x);
             _mm256_storeu_ps(&data[i + (len / 2)], new_y);
         }
-    #else
-        std:: cerr << "FhtKacRotator requires AVX512 or AVX2 support!\n";
-        exit(1);
-    #endif
+    }
+
+    static void kacs_walk(float* data, size_t len) {
+        if (simd_level() >= SimdLevel::AVX512) {
+            kacs_walk_avx512(data, len);
+        } else if (simd_level() >= SimdLevel::AVX2) {
+            kacs_walk_avx2(data, len);
+        } else {
+            kacs_walk_scalar(data, len);
+        }
     }
 
     void rotate(const float* data, float* rotated_vec) const override {
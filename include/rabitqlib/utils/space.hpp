@@ -4,15 +4,22 @@
 #include <immintrin.h>
 #include <omp.h>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <limits>
+#include <numeric>
 #include <optional>
+#include <random>
 #include <type_traits>
+#include <vector>
 
 #include "rabitqlib/defines.hpp"
+#include "rabitqlib/utils/cpu_features.hpp"
 #include "rabitqlib/utils/tools.hpp"
 
 namespace rabitqlib {
@@ -270,11 +277,86 @@ inline PID exact_nn(
     return nearest_neighbor;
 }
 
+/**
+ * @brief a few iterations of k-means (Lloyd) on a random sample of points, which is enough
+ * for coarse partitions of data
+ *
+ * @param sample_size   num of sampled points, at least num_clusters
+ * @return centroids, num_clusters * dim
+ */
+template <typename T>
+inline std::vector<T> sample_kmeans(
+    const T* data,
+    size_t num_points,
+    size_t dim,
+    size_t num_clusters,
+    size_t sample_size,
+    size_t num_iter
+) {
+    num_clusters = std::min(num_clusters, num_points);
+    sample_size = std::clamp(sample_size, num_clusters, num_points);
+    std::mt19937 generator(num_points);
+
+    std::vector<PID> ids(num_points);
+    std::iota(ids.begin(), ids.end(), 0);
+    std::shuffle(ids.begin(), ids.end(), generator);
+    ids.resize(sample_size);
+
+    std::vector<T> centroids(num_clusters * dim);
+    for (size_t j = 0; j < num_clusters; ++j) {
+        std::copy_n(data + (ids[j] * dim), dim, &centroids[j * dim]);
+    }
+
+    std::vector<PID> assigned(sample_size);
+    for (size_t iter = 0; iter < num_iter; ++iter) {
+#pragma omp parallel for schedule(dynamic)
+        for (size_t i = 0; i < sample_size; ++i) {
+            const T* vec = data + (ids[i] * dim);
+            T min_dist = std::numeric_limits<T>::max();
+            for (size_t j = 0; j < num_clusters; ++j) {
+                T dist = euclidean_sqr(vec, &centroids[j * dim], dim);
+                if (dist < min_dist) {
+                    min_dist = dist;
+                    assigned[i] = static_cast<PID>(j);
+                }
+            }
+        }
+
+        std::fill(centroids.begin(), centroids.end(), 0);
+        std::vector<size_t> sizes(num_clusters, 0);
+        for (size_t i = 0; i < sample_size; ++i) {
+            T* centroid = &centroids[assigned[i] * dim];
+            const T* vec = data + (ids[i] * dim);
+            for (size_t k = 0; k < dim; ++k) {
+                centroid[k] += vec[k];
+            }
+            sizes[assigned[i]]++;
+        }
+        for (size_t j = 0; j < num_clusters; ++j) {
+            T* centroid = &centroids[j * dim];
+            if (sizes[j] == 0) {
+                // restart empty clusters from random sampled points
+                PID id = ids[std::uniform_int_distribution<size_t>(0, sample_size - 1)(
+                    generator
+                )];
+                std::copy_n(data + (id * dim), dim, centroid);
+                continue;
+            }
+            T inv_size = 1 / static_cast<T>(sizes[j]);
+            for (size_t k = 0; k < dim; ++k) {
+                centroid[k] *= inv_size;
+            }
+        }
+    }
+    return centroids;
+}
+
 namespace excode_ipimpl {
 
-#if defined(__AVX2__)
 // helper function for AVX2 inner product
-inline void contribute_ip(__m128i vec, const float* __restrict__ query, __m256& sum) {
+RABITQ_TARGET_AVX2 inline void contribute_ip(
+    __m128i vec, const float* __restrict__ query, __m256& sum
+) {
     /* // Equivalent AVX512 code:
         __m512 q = _mm512_loadu_ps(&query[i]);
         __m512 cf = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(vec_00_to_15));
@@ -289,7 +371,7 @@ inline void contribute_ip(__m128i vec, const float* __restrict__ query, __m256&
     sum = _mm256_fmadd_ps(q, cf, sum);
 };
 
-inline void contribute_ip_signed(
+RABITQ_TARGET_AVX2 inline void contribute_ip_signed(
     __m128i vec, const float* __restrict__ query, __m256& sum
 ) {
     /* // Equivalent AVX512 code:
@@ -306,7 +388,7 @@ inline void contribute_ip_signed(
     sum = _mm256_fmadd_ps(cf, q, sum);
 };
 
-inline float mm256_reduce_add_ps(__m256 v) {
+RABITQ_TARGET_AVX2 inline float mm256_reduce_add_ps(__m256 v) {
     std::array<float, 8> accumulator{};
     _mm256_storeu_ps(accumulator.data(), v);
     float result = 0.0F;
@@ -315,18 +397,90 @@ inline float mm256_reduce_add_ps(__m256 v) {
     }
     return result;
 }
-#endif
+
+/**
+ * @brief decode kBlock ex-codes (16 dims for 1 and 4 bits, 64 dims otherwise) from the
+ * compact layout of packing_*bit_excode in quantization/pack_excode.hpp
+ */
+template <size_t kBits>
+inline void unpack_excode_block(
+    const uint8_t* __restrict__ compact, uint8_t* __restrict__ code
+) {
+    // the highest bit of 64 codes, the bit of dim d is at (d % 8) * 8 + d / 8
+    auto top_bit = [&](const uint8_t* bits, size_t d) {
+        uint64_t word;
+        std::memcpy(&word, bits, sizeof(uint64_t));
+        return static_cast<uint8_t>((word >> (((d % 8) * 8) + (d / 8))) & 1);
+    };
+
+    if constexpr (kBits == 1) {
+        for (size_t d = 0; d < 16; ++d) {
+            code[d] = (compact[d / 8] >> (d % 8)) & 1;
+        }
+    } else if constexpr (kBits == 2 || kBits == 3) {
+        for (size_t d = 0; d < 64; ++d) {
+            code[d] = (compact[d % 16] >> (2 * (d / 16))) & 0b11;
+        }
+        if constexpr (kBits == 3) {
+            for (size_t d = 0; d < 64; ++d) {
+                code[d] |= top_bit(compact + 16, d) << 2;
+            }
+        }
+    } else if constexpr (kBits == 4) {
+        for (size_t d = 0; d < 16; ++d) {
+            code[d] = (compact[d % 8] >> (4 * (d / 8))) & 0b1111;
+        }
+    } else if constexpr (kBits == 5) {
+        for (size_t d = 0; d < 64; ++d) {
+            uint8_t byte = compact[((d / 32) * 16) + (d % 16)];
+            code[d] = (byte >> (4 * ((d / 16) % 2))) & 0b1111;
+            code[d] |= top_bit(compact + 32, d) << 4;
+        }
+    } else if constexpr (kBits == 6 || kBits == 7) {
+        for (size_t d = 0; d < 48; ++d) {
+            code[d] = compact[d] & 0b111111;
+        }
+        for (size_t d = 48; d < 64; ++d) {
+            code[d] = static_cast<uint8_t>(
+                (compact[d - 48] >> 6) | ((compact[d - 32] >> 6) << 2) |
+                ((compact[d - 16] >> 6) << 4)
+            );
+        }
+        if constexpr (kBits == 7) {
+            for (size_t d = 0; d < 64; ++d) {
+                code[d] |= top_bit(compact + 48, d) << 6;
+            }
+        }
+    }
+}
+
+// scalar reference of the ip*_fxu*_avx kernels below
+template <size_t kBits>
+inline float ip_fxu_scalar(
+    const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    constexpr size_t kBlock = (kBits == 1 || kBits == 4) ? 16 : 64;
+    std::array<uint8_t, kBlock> code;
+    float result = 0;
+    for (size_t i = 0; i < dim; i += kBlock) {
+        unpack_excode_block<kBits>(compact_code, code.data());
+        for (size_t j = 0; j < kBlock; ++j) {
+            result += query[i + j] * static_cast<float>(code[j]);
+        }
+        compact_code += kBlock * kBits / 8;
+    }
+    return result;
+}
 
 // ip16: this function is used to compute inner product of
 // vectors padded to multiple of 16
 // fxu1: the inner product is computed between float and 1-bit unsigned int (lay out can be
 // found rabitq_impl.hpp)
 // avx512: only applicable for avx512
-inline float ip16_fxu1_avx(
+RABITQ_TARGET_AVX512 inline float ip16_fxu1_avx512(
     const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
 ) {
     float result = 0;
-#if defined(__AVX512F__)
     __m512 sum = _mm512_setzero_ps();
 
     for (size_t i = 0; i < dim; i += 16) {
@@ -339,7 +493,13 @@ inline float ip16_fxu1_avx(
         query += 16;
     }
     result = _mm512_reduce_add_ps(sum);
-#elif defined(__AVX2__)
+    return result;
+}
+
+RABITQ_TARGET_AVX2 inline float ip16_fxu1_avx2(
+    const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    float result = 0;
     __m256 sum = _mm256_setzero_ps();
 
     const __m256i bitmask = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
@@ -357,21 +517,25 @@ inline float ip16_fxu1_avx(
         ++compact_code;
     }
     result = mm256_reduce_add_ps(sum);
-#endif
     return result;
 }
 
-inline float ip64_fxu2_avx(
+inline float ip16_fxu1_avx(
+    const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    if (simd_level() >= SimdLevel::AVX512) {
+        return ip16_fxu1_avx512(query, compact_code, dim);
+    }
+    if (simd_level() >= SimdLevel::AVX2) {
+        return ip16_fxu1_avx2(query, compact_code, dim);
+    }
+    return ip_fxu_scalar<1>(query, compact_code, dim);
+}
+
+RABITQ_TARGET_AVX512 inline float ip64_fxu2_avx512(
     const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
 ) {
-#if defined(__AVX512F__)
     __m512 sum = _mm512_setzero_ps();
-#elif defined(__AVX2__)
-    __m256 sum = _mm256_setzero_ps();
-#else
-    std::cerr << "AVX2 or AVX512 is required for excode ip functions\n";
-    exit(1);
-#endif
     float result = 0;
     const __m128i mask = _mm_set1_epi8(0b00000011);
 
@@ -382,7 +546,6 @@ inline float ip64_fxu2_avx(
         __m128i vec_16_to_31 = _mm_and_si128(_mm_srli_epi16(compact, 2), mask);
         __m128i vec_32_to_47 = _mm_and_si128(_mm_srli_epi16(compact, 4), mask);
         __m128i vec_48_to_63 = _mm_and_si128(_mm_srli_epi16(compact, 6), mask);
-#if defined(__AVX512F__)
         __m512 q;
         __m512 cf;
 
@@ -401,34 +564,54 @@ inline float ip64_fxu2_avx(
         q = _mm512_loadu_ps(&query[i + 48]);
         cf = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(vec_48_to_63));
         sum = _mm512_fmadd_ps(q, cf, sum);
-#elif defined(__AVX2__)
+        compact_code += 16;
+    }
+
+    result = _mm512_reduce_add_ps(sum);
+    return result;
+}
+
+RABITQ_TARGET_AVX2 inline float ip64_fxu2_avx2(
+    const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    __m256 sum = _mm256_setzero_ps();
+    float result = 0;
+    const __m128i mask = _mm_set1_epi8(0b00000011);
+
+    for (size_t i = 0; i < dim; i += 64) {
+        __m128i compact = _mm_loadu_si128(reinterpret_cast<const __m128i*>(compact_code));
+
+        __m128i vec_00_to_15 = _mm_and_si128(compact, mask);
+        __m128i vec_16_to_31 = _mm_and_si128(_mm_srli_epi16(compact, 2), mask);
+        __m128i vec_32_to_47 = _mm_and_si128(_mm_srli_epi16(compact, 4), mask);
+        __m128i vec_48_to_63 = _mm_and_si128(_mm_srli_epi16(compact, 6), mask);
         contribute_ip(vec_00_to_15, &query[i], sum);
         contribute_ip(vec_16_to_31, &query[i + 16], sum);
         contribute_ip(vec_32_to_47, &query[i + 32], sum);
         contribute_ip(vec_48_to_63, &query[i + 48], sum);
-#endif
         compact_code += 16;
     }
 
-#if defined(__AVX512F__)
-    result = _mm512_reduce_add_ps(sum);
-#elif defined(__AVX2__)
     result = mm256_reduce_add_ps(sum);
-#endif
     return result;
 }
 
-inline float ip64_fxu3_avx(
+inline float ip64_fxu2_avx(
+    const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    if (simd_level() >= SimdLevel::AVX512) {
+        return ip64_fxu2_avx512(query, compact_code, dim);
+    }
+    if (simd_level() >= SimdLevel::AVX2) {
+        return ip64_fxu2_avx2(query, compact_code, dim);
+    }
+    return ip_fxu_scalar<2>(query, compact_code, dim);
+}
+
+RABITQ_TARGET_AVX512 inline float ip64_fxu3_avx512(
     const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
 ) {
-#if defined(__AVX512F__)
     __m512 sum = _mm512_setzero_ps();
-#elif defined(__AVX2__)
-    __m256 sum = _mm256_setzero_ps();
-#else
-    std::cerr << "AVX2 or AVX512 is required for excode ip functions\n";
-    exit(1);
-#endif
     float result = 0;
     const __m128i mask = _mm_set1_epi8(0b11);
     const __m128i top_mask = _mm_set1_epi8(0b100);
@@ -458,7 +641,6 @@ inline float ip64_fxu3_avx(
         vec_16_to_31 = _mm_or_si128(top_16_to_31, vec_16_to_31);
         vec_32_to_47 = _mm_or_si128(top_32_to_47, vec_32_to_47);
         vec_48_to_63 = _mm_or_si128(top_48_to_63, vec_48_to_63);
-#if defined(__AVX512F__)
         __m512 q;
         __m512 cf;
 
@@ -477,33 +659,71 @@ inline float ip64_fxu3_avx(
         q = _mm512_loadu_ps(&query[i + 48]);
         cf = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(vec_48_to_63));
         sum = _mm512_fmadd_ps(q, cf, sum);
-#elif defined(__AVX2__)
+    }
+
+    result = _mm512_reduce_add_ps(sum);
+    return result;
+}
+
+RABITQ_TARGET_AVX2 inline float ip64_fxu3_avx2(
+    const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    __m256 sum = _mm256_setzero_ps();
+    float result = 0;
+    const __m128i mask = _mm_set1_epi8(0b11);
+    const __m128i top_mask = _mm_set1_epi8(0b100);
+
+    for (size_t i = 0; i < dim; i += 64) {
+        __m128i compact2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(compact_code));
+        compact_code += 16;
+
+        int64_t top_bit = *reinterpret_cast<const int64_t*>(compact_code);
+        compact_code += 8;
+
+        __m128i vec_00_to_15 = _mm_and_si128(compact2, mask);
+        __m128i vec_16_to_31 = _mm_and_si128(_mm_srli_epi16(compact2, 2), mask);
+        __m128i vec_32_to_47 = _mm_and_si128(_mm_srli_epi16(compact2, 4), mask);
+        __m128i vec_48_to_63 = _mm_and_si128(_mm_srli_epi16(compact2, 6), mask);
+
+        __m128i top_00_to_15 =
+            _mm_and_si128(_mm_set_epi64x(top_bit << 1, top_bit << 2), top_mask);
+        __m128i top_16_to_31 =
+            _mm_and_si128(_mm_set_epi64x(top_bit >> 1, top_bit >> 0), top_mask);
+        __m128i top_32_to_47 =
+            _mm_and_si128(_mm_set_epi64x(top_bit >> 3, top_bit >> 2), top_mask);
+        __m128i top_48_to_63 =
+            _mm_and_si128(_mm_set_epi64x(top_bit >> 5, top_bit >> 4), top_mask);
+
+        vec_00_to_15 = _mm_or_si128(top_00_to_15, vec_00_to_15);
+        vec_16_to_31 = _mm_or_si128(top_16_to_31, vec_16_to_31);
+        vec_32_to_47 = _mm_or_si128(top_32_to_47, vec_32_to_47);
+        vec_48_to_63 = _mm_or_si128(top_48_to_63, vec_48_to_63);
         contribute_ip(vec_00_to_15, &query[i], sum);
         contribute_ip(vec_16_to_31, &query[i + 16], sum);
         contribute_ip(vec_32_to_47, &query[i + 32], sum);
         contribute_ip(vec_48_to_63, &query[i + 48], sum);
-#endif
     }
 
-#if defined(__AVX512F__)
-    result = _mm512_reduce_add_ps(sum);
-#elif defined(__AVX2__)
     result = mm256_reduce_add_ps(sum);
-#endif
     return result;
 }
 
-inline float ip16_fxu4_avx(
+inline float ip64_fxu3_avx(
+    const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    if (simd_level() >= SimdLevel::AVX512) {
+        return ip64_fxu3_avx512(query, compact_code, dim);
+    }
+    if (simd_level() >= SimdLevel::AVX2) {
+        return ip64_fxu3_avx2(query, compact_code, dim);
+    }
+    return ip_fxu_scalar<3>(query, compact_code, dim);
+}
+
+RABITQ_TARGET_AVX512 inline float ip16_fxu4_avx512(
     const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
 ) {
-#if defined(__AVX512F__)
     __m512 sum = _mm512_setzero_ps();
-#elif defined(__AVX2__)
-    __m256 sum = _mm256_setzero_ps();
-#else
-    std::cerr << "AVX2 or AVX512 is required for excode ip functions\n";
-    exit(1);
-#endif
     float result = 0.0F;
     constexpr int64_t kMask = 0x0f0f0f0f0f0f0f0f;
     for (size_t i = 0; i < dim; i += 16) {
@@ -512,34 +732,50 @@ inline float ip16_fxu4_avx(
         int64_t code1 = (compact >> 4) & kMask;
 
         __m128i c8 = _mm_set_epi64x(code1, code0);
-#if defined(__AVX512F__)
         __m512 q = _mm512_loadu_ps(&query[i]);
         __m512 cf = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(c8));
         sum = _mm512_fmadd_ps(cf, q, sum);
-#elif defined(__AVX2__)
-        contribute_ip_signed(c8, &query[i], sum);
-#endif
         compact_code += 8;
     }
-#if defined(__AVX512F__)
     result = _mm512_reduce_add_ps(sum);
-#elif defined(__AVX2__)
+    return result;
+}
+
+RABITQ_TARGET_AVX2 inline float ip16_fxu4_avx2(
+    const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    __m256 sum = _mm256_setzero_ps();
+    float result = 0.0F;
+    constexpr int64_t kMask = 0x0f0f0f0f0f0f0f0f;
+    for (size_t i = 0; i < dim; i += 16) {
+        int64_t compact = *reinterpret_cast<const int64_t*>(compact_code);
+        int64_t code0 = compact & kMask;
+        int64_t code1 = (compact >> 4) & kMask;
+
+        __m128i c8 = _mm_set_epi64x(code1, code0);
+        contribute_ip_signed(c8, &query[i], sum);
+        compact_code += 8;
+    }
     result = mm256_reduce_add_ps(sum);
-#endif
     return result;
 }
 
-inline float ip64_fxu5_avx(
+inline float ip16_fxu4_avx(
+    const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    if (simd_level() >= SimdLevel::AVX512) {
+        return ip16_fxu4_avx512(query, compact_code, dim);
+    }
+    if (simd_level() >= SimdLevel::AVX2) {
+        return ip16_fxu4_avx2(query, compact_code, dim);
+    }
+    return ip_fxu_scalar<4>(query, compact_code, dim);
+}
+
+RABITQ_TARGET_AVX512 inline float ip64_fxu5_avx512(
     const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
 ) {
-#if defined(__AVX512F__)
     __m512 sum = _mm512_setzero_ps();
-#elif defined(__AVX2__)
-    __m256 sum = _mm256_setzero_ps();
-#else
-    std::cerr << "AVX2 or AVX512 is required for excode ip functions\n";
-    exit(1);
-#endif
 
     float result = 0.0F;
     const __m128i mask = _mm_set1_epi8(0b1111);
@@ -574,7 +810,6 @@ inline float ip64_fxu5_avx(
         vec_32_to_47 = _mm_or_si128(top_32_to_47, vec_32_to_47);
         vec_48_to_63 = _mm_or_si128(top_48_to_63, vec_48_to_63);
 
-#if defined(__AVX512F__)
         __m512 q;
         __m512 cf;
 
@@ -593,32 +828,74 @@ inline float ip64_fxu5_avx(
         q = _mm512_loadu_ps(&query[i + 48]);
         cf = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(vec_48_to_63));
         sum = _mm512_fmadd_ps(q, cf, sum);
-#elif defined(__AVX2__)
+    }
+    result = _mm512_reduce_add_ps(sum);
+    return result;
+}
+
+RABITQ_TARGET_AVX2 inline float ip64_fxu5_avx2(
+    const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    __m256 sum = _mm256_setzero_ps();
+
+    float result = 0.0F;
+    const __m128i mask = _mm_set1_epi8(0b1111);
+    const __m128i top_mask = _mm_set1_epi8(0b10000);
+
+    for (size_t i = 0; i < dim; i += 64) {
+        __m128i compact4_1 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(compact_code));
+        __m128i compact4_2 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(compact_code + 16));
+        compact_code += 32;
+
+        int64_t top_bit = *reinterpret_cast<const int64_t*>(compact_code);
+        compact_code += 8;
+
+        __m128i vec_00_to_15 = _mm_and_si128(compact4_1, mask);
+        __m128i vec_16_to_31 = _mm_and_si128(_mm_srli_epi16(compact4_1, 4), mask);
+        __m128i vec_32_to_47 = _mm_and_si128(compact4_2, mask);
+        __m128i vec_48_to_63 = _mm_and_si128(_mm_srli_epi16(compact4_2, 4), mask);
+
+        __m128i top_00_to_15 =
+            _mm_and_si128(_mm_set_epi64x(top_bit << 3, top_bit << 4), top_mask);
+        __m128i top_16_to_31 =
+            _mm_and_si128(_mm_set_epi64x(top_bit << 1, top_bit << 2), top_mask);
+        __m128i top_32_to_47 =
+            _mm_and_si128(_mm_set_epi64x(top_bit >> 1, top_bit >> 0), top_mask);
+        __m128i top_48_to_63 =
+            _mm_and_si128(_mm_set_epi64x(top_bit >> 3, top_bit >> 2), top_mask);
+
+        vec_00_to_15 = _mm_or_si128(top_00_to_15, vec_00_to_15);
+        vec_16_to_31 = _mm_or_si128(top_16_to_31, vec_16_to_31);
+        vec_32_to_47 = _mm_or_si128(top_32_to_47, vec_32_to_47);
+        vec_48_to_63 = _mm_or_si128(top_48_to_63, vec_48_to_63);
+
         contribute_ip(vec_00_to_15, &query[i], sum);
         contribute_ip(vec_16_to_31, &query[i + 16], sum);
         contribute_ip(vec_32_to_47, &query[i + 32], sum);
         contribute_ip(vec_48_to_63, &query[i + 48], sum);
-#endif
     }
-#if defined(__AVX512F__)
-    result = _mm512_reduce_add_ps(sum);
-#elif defined(__AVX2__)
     result = mm256_reduce_add_ps(sum);
-#endif
     return result;
 }
 
-inline float ip64_fxu6_avx(
+inline float ip64_fxu5_avx(
+    const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    if (simd_level() >= SimdLevel::AVX512) {
+        return ip64_fxu5_avx512(query, compact_code, dim);
+    }
+    if (simd_level() >= SimdLevel::AVX2) {
+        return ip64_fxu5_avx2(query, compact_code, dim);
+    }
+    return ip_fxu_scalar<5>(query, compact_code, dim);
+}
+
+RABITQ_TARGET_AVX512 inline float ip64_fxu6_avx512(
     const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
 ) {
-#if defined(__AVX512F__)
     __m512 sum = _mm512_setzero_ps();
-#elif defined(__AVX2__)
-    __m256 sum = _mm256_setzero_ps();
-#else
-    std::cerr << "AVX2 or AVX512 is required for excode ip functions\n";
-    exit(1);
-#endif
     float result = 0.0F;
     const __m128i mask6 = _mm_set1_epi8(0b00111111);
     const __m128i mask2 = _mm_set1_epi8(static_cast<char>(0b11000000));
@@ -641,7 +918,6 @@ inline float ip64_fxu6_avx(
             _mm_srli_epi16(_mm_and_si128(cpt3, mask2), 2)
         );
 
-#if defined(__AVX512F__)
         __m512 q;
         __m512 cf;
 
@@ -660,32 +936,62 @@ inline float ip64_fxu6_avx(
         q = _mm512_loadu_ps(&query[i + 48]);
         cf = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(vec_48_to_63));
         sum = _mm512_fmadd_ps(q, cf, sum);
-#elif defined(__AVX2__)
+    }
+    result = _mm512_reduce_add_ps(sum);
+    return result;
+}
+
+RABITQ_TARGET_AVX2 inline float ip64_fxu6_avx2(
+    const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    __m256 sum = _mm256_setzero_ps();
+    float result = 0.0F;
+    const __m128i mask6 = _mm_set1_epi8(0b00111111);
+    const __m128i mask2 = _mm_set1_epi8(static_cast<char>(0b11000000));
+
+    for (size_t i = 0; i < dim; i += 64) {
+        __m128i cpt1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(compact_code));
+        __m128i cpt2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(compact_code + 16));
+        __m128i cpt3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(compact_code + 32));
+
+        compact_code += 48;
+
+        __m128i vec_00_to_15 = _mm_and_si128(cpt1, mask6);
+        __m128i vec_16_to_31 = _mm_and_si128(cpt2, mask6);
+        __m128i vec_32_to_47 = _mm_and_si128(cpt3, mask6);
+        __m128i vec_48_to_63 = _mm_or_si128(
+            _mm_or_si128(
+                _mm_srli_epi16(_mm_and_si128(cpt1, mask2), 6),
+                _mm_srli_epi16(_mm_and_si128(cpt2, mask2), 4)
+            ),
+            _mm_srli_epi16(_mm_and_si128(cpt3, mask2), 2)
+        );
+
         contribute_ip(vec_00_to_15, &query[i], sum);
         contribute_ip(vec_16_to_31, &query[i + 16], sum);
         contribute_ip(vec_32_to_47, &query[i + 32], sum);
         contribute_ip(vec_48_to_63, &query[i + 48], sum);
-#endif
     }
-#if defined(__AVX512F__)
-    result = _mm512_reduce_add_ps(sum);
-#elif defined(__AVX2__)
     result = mm256_reduce_add_ps(sum);
-#endif
     return result;
 }
 
-inline float ip64_fxu7_avx(
+inline float ip64_fxu6_avx(
+    const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    if (simd_level() >= SimdLevel::AVX512) {
+        return ip64_fxu6_avx512(query, compact_code, dim);
+    }
+    if (simd_level() >= SimdLevel::AVX2) {
+        return ip64_fxu6_avx2(query, compact_code, dim);
+    }
+    return ip_fxu_scalar<6>(query, compact_code, dim);
+}
+
+RABITQ_TARGET_AVX512 inline float ip64_fxu7_avx512(
     const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
 ) {
-#if defined(__AVX512F__)
     __m512 sum = _mm512_setzero_ps();
-#elif defined(__AVX2__)
-    __m256 sum = _mm256_setzero_ps();
-#else
-    std::cerr << "AVX2 or AVX512 is required for excode ip functions\n";
-    exit(1);
-#endif
 
     float result = 0.0F;
     const __m128i mask6 = _mm_set1_epi8(0b00111111);
@@ -726,7 +1032,6 @@ inline float ip64_fxu7_avx(
         vec_32_to_47 = _mm_or_si128(top_32_to_47, vec_32_to_47);
         vec_48_to_63 = _mm_or_si128(top_48_to_63, vec_48_to_63);
 
-#if defined(__AVX512F__)
         __m512 q;
         __m512 cf;
 
@@ -745,22 +1050,78 @@ inline float ip64_fxu7_avx(
         q = _mm512_loadu_ps(&query[i + 48]);
         cf = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(vec_48_to_63));
         sum = _mm512_fmadd_ps(q, cf, sum);
-#elif defined(__AVX2__)
+    }
+
+    result = _mm512_reduce_add_ps(sum);
+    return result;
+}
+
+RABITQ_TARGET_AVX2 inline float ip64_fxu7_avx2(
+    const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    __m256 sum = _mm256_setzero_ps();
+
+    float result = 0.0F;
+    const __m128i mask6 = _mm_set1_epi8(0b00111111);
+    const __m128i mask2 = _mm_set1_epi8(static_cast<char>(0b11000000));
+    const __m128i top_mask = _mm_set1_epi8(0b1000000);
+
+    for (size_t i = 0; i < dim; i += 64) {
+        __m128i cpt1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(compact_code));
+        __m128i cpt2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(compact_code + 16));
+        __m128i cpt3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(compact_code + 32));
+        compact_code += 48;
+
+        __m128i vec_00_to_15 = _mm_and_si128(cpt1, mask6);
+        __m128i vec_16_to_31 = _mm_and_si128(cpt2, mask6);
+        __m128i vec_32_to_47 = _mm_and_si128(cpt3, mask6);
+        __m128i vec_48_to_63 = _mm_or_si128(
+            _mm_or_si128(
+                _mm_srli_epi16(_mm_and_si128(cpt1, mask2), 6),
+                _mm_srli_epi16(_mm_and_si128(cpt2, mask2), 4)
+            ),
+            _mm_srli_epi16(_mm_and_si128(cpt3, mask2), 2)
+        );
+
+        int64_t top_bit = *reinterpret_cast<const int64_t*>(compact_code);
+        compact_code += 8;
+
+        __m128i top_00_to_15 =
+            _mm_and_si128(_mm_set_epi64x(top_bit << 5, top_bit << 6), top_mask);
+        __m128i top_16_to_31 =
+            _mm_and_si128(_mm_set_epi64x(top_bit << 3, top_bit << 4), top_mask);
+        __m128i top_32_to_47 =
+            _mm_and_si128(_mm_set_epi64x(top_bit << 1, top_bit << 2), top_mask);
+        __m128i top_48_to_63 =
+            _mm_and_si128(_mm_set_epi64x(top_bit >> 1, top_bit << 0), top_mask);
+
+        vec_00_to_15 = _mm_or_si128(top_00_to_15, vec_00_to_15);
+        vec_16_to_31 = _mm_or_si128(top_16_to_31, vec_16_to_31);
+        vec_32_to_47 = _mm_or_si128(top_32_to_47, vec_32_to_47);
+        vec_48_to_63 = _mm_or_si128(top_48_to_63, vec_48_to_63);
+
         contribute_ip(vec_00_to_15, &query[i], sum);
         contribute_ip(vec_16_to_31, &query[i + 16], sum);
         contribute_ip(vec_32_to_47, &query[i + 32], sum);
         contribute_ip(vec_48_to_63, &query[i + 48], sum);
-#endif
     }
 
-#if defined(__AVX512F__)
-    result = _mm512_reduce_add_ps(sum);
-#elif defined(__AVX2__)
     result = mm256_reduce_add_ps(sum);
-#endif
     return result;
 }
 
+inline float ip64_fxu7_avx(
+    const float* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    if (simd_level() >= SimdLevel::AVX512) {
+        return ip64_fxu7_avx512(query, compact_code, dim);
+    }
+    if (simd_level() >= SimdLevel::AVX2) {
+        return ip64_fxu7_avx2(query, compact_code, dim);
+    }
+    return ip_fxu_scalar<7>(query, compact_code, dim);
+}
+
 // inner product between float type and int type vectors
 template <typename TF, typename TI>
 inline TF ip_fxi(const TF* __restrict__ vec0, const TI* __restrict__ vec1, size_t dim) {
@@ -771,6 +1132,155 @@ inline TF ip_fxi(const TF* __restrict__ vec0, const TI* __restrict__ vec1, size_
     ConstVectorMap<TI> v1(vec1, dim);
     return v0.dot(v1.template cast<TF>());
 }
+
+// Integer kernels: inner products between a query quantized to int8 and ex codes of kBits
+// (1 to 8, 8 bits are stored as plain bytes). Products are exact in int32 for any dim
+// used in practice.
+
+// scalar reference of ip64_i8xu_vnni
+template <size_t kBits>
+inline int32_t ip_i8xu_scalar(
+    const int8_t* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    int32_t result = 0;
+    if constexpr (kBits == 8) {
+        for (size_t i = 0; i < dim; ++i) {
+            result += static_cast<int32_t>(query[i]) * compact_code[i];
+        }
+    } else {
+        constexpr size_t kBlock = (kBits == 1 || kBits == 4) ? 16 : 64;
+        std::array<uint8_t, kBlock> code;
+        for (size_t i = 0; i < dim; i += kBlock) {
+            unpack_excode_block<kBits>(compact_code, code.data());
+            for (size_t j = 0; j < kBlock; ++j) {
+                result += static_cast<int32_t>(query[i + j]) * code[j];
+            }
+            compact_code += kBlock * kBits / 8;
+        }
+    }
+    return result;
+}
+
+// the highest bit of 64 codes (the bit of dim d is at (d % 8) * 8 + d / 8 of top_bit) as
+// bytes of value 1 << kShift. Byte d of qword d / 8 takes the bit after a right shift of
+// the qword by d / 8.
+template <size_t kShift>
+RABITQ_TARGET_AVX512 inline __m512i unpack_top_bit_avx512(uint64_t top_bit) {
+    const __m512i shift = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+    __m512i bits = _mm512_and_si512(
+        _mm512_srlv_epi64(_mm512_set1_epi64(static_cast<int64_t>(top_bit)), shift),
+        _mm512_set1_epi8(1)
+    );
+    return _mm512_slli_epi64(bits, kShift);
+}
+
+// decode 64 ex codes of kBits (8 * kBits bytes) into bytes
+template <size_t kBits>
+RABITQ_TARGET_AVX512EXT inline __m512i unpack64_excode_vnni(const uint8_t* compact_code) {
+    __m512i code;
+    if constexpr (kBits == 1) {
+        // 4 blocks of 16 dims, dim d is bit d of 8 bytes
+        uint64_t bits;
+        std::memcpy(&bits, compact_code, sizeof(uint64_t));
+        code = _mm512_maskz_mov_epi8(bits, _mm512_set1_epi8(1));
+    } else if constexpr (kBits == 2 || kBits == 3) {
+        // dims 16k to 16k + 15 are bits 2k, 2k + 1 of 16 bytes
+        const __m512i shift = _mm512_setr_epi64(0, 0, 2, 2, 4, 4, 6, 6);
+        __m512i compact = _mm512_broadcast_i32x4(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(compact_code))
+        );
+        code = _mm512_and_si512(_mm512_srlv_epi64(compact, shift), _mm512_set1_epi8(0b11));
+        if constexpr (kBits == 3) {
+            uint64_t top_bit;
+            std::memcpy(&top_bit, compact_code + 16, sizeof(uint64_t));
+            code = _mm512_or_si512(code, unpack_top_bit_avx512<2>(top_bit));
+        }
+    } else if constexpr (kBits == 4 || kBits == 5) {
+        // 4-bit codes are 4 blocks of 16 dims, dims 8 to 15 of a block are the upper
+        // nibbles of dims 0 to 7. The lower 4 bits of 5-bit codes are 2 blocks of 32
+        // dims, dims 16 to 31 of a block are the upper nibbles of dims 0 to 15.
+        __m512i index;
+        __m512i shift;
+        if constexpr (kBits == 4) {
+            index = _mm512_set_epi8(
+                31, 30, 29, 28, 27, 26, 25, 24, 31, 30, 29, 28, 27, 26, 25, 24,
+                23, 22, 21, 20, 19, 18, 17, 16, 23, 22, 21, 20, 19, 18, 17, 16,
+                15, 14, 13, 12, 11, 10, 9, 8, 15, 14, 13, 12, 11, 10, 9, 8,
+                7, 6, 5, 4, 3, 2, 1, 0, 7, 6, 5, 4, 3, 2, 1, 0
+            );
+            shift = _mm512_setr_epi64(0, 4, 0, 4, 0, 4, 0, 4);
+        } else {
+            index = _mm512_set_epi8(
+                31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16,
+                31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16,
+                15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+            );
+            shift = _mm512_setr_epi64(0, 0, 4, 4, 0, 0, 4, 4);
+        }
+        __m512i compact = _mm512_castsi256_si512(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(compact_code))
+        );
+        code = _mm512_srlv_epi64(_mm512_permutexvar_epi8(index, compact), shift);
+        code = _mm512_and_si512(code, _mm512_set1_epi8(0b1111));
+        if constexpr (kBits == 5) {
+            uint64_t top_bit;
+            std::memcpy(&top_bit, compact_code + 32, sizeof(uint64_t));
+            code = _mm512_or_si512(code, unpack_top_bit_avx512<4>(top_bit));
+        }
+    } else if constexpr (kBits == 6 || kBits == 7) {
+        // dims 0 to 47 are the lower 6 bits of 48 bytes, the upper 2 bits of bytes d,
+        // d + 16 and d + 32 are dim 48 + d
+        const __m128i mask2 = _mm_set1_epi8(static_cast<char>(0b11000000));
+        __m512i compact = _mm512_maskz_loadu_epi8(0xFFFFFFFFFFFFULL, compact_code);
+        __m128i cpt1 = _mm512_castsi512_si128(compact);
+        __m128i cpt2 = _mm512_extracti32x4_epi32(compact, 1);
+        __m128i cpt3 = _mm512_extracti32x4_epi32(compact, 2);
+        __m128i vec_48_to_63 = _mm_or_si128(
+            _mm_or_si128(
+                _mm_srli_epi16(_mm_and_si128(cpt1, mask2), 6),
+                _mm_srli_epi16(_mm_and_si128(cpt2, mask2), 4)
+            ),
+            _mm_srli_epi16(_mm_and_si128(cpt3, mask2), 2)
+        );
+        code = _mm512_inserti32x4(
+            _mm512_and_si512(compact, _mm512_set1_epi8(0b00111111)), vec_48_to_63, 3
+        );
+        if constexpr (kBits == 7) {
+            uint64_t top_bit;
+            std::memcpy(&top_bit, compact_code + 48, sizeof(uint64_t));
+            code = _mm512_or_si512(code, unpack_top_bit_avx512<6>(top_bit));
+        }
+    } else {
+        code = _mm512_loadu_si512(compact_code);
+    }
+    return code;
+}
+
+/**
+ * @brief ip64_i8xu: inner product of an int8 query and ex codes of kBits by VNNI. Codes
+ * are unpacked to bytes (with VBMI for 4 and 5 bits) and multiplied with 64 dims of
+ * the query by one vpdpbusd. dim should be a multiple of 64, except for 1 and 4 bits
+ * whose blocks of 16 dims are finished by the scalar kernel.
+ */
+template <size_t kBits>
+RABITQ_TARGET_AVX512EXT inline int32_t ip64_i8xu_vnni(
+    const int8_t* __restrict__ query, const uint8_t* __restrict__ compact_code, size_t dim
+) {
+    __m512i sum = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 64 <= dim; i += 64) {
+        __m512i code = unpack64_excode_vnni<kBits>(compact_code);
+        compact_code += 8 * kBits;
+        __m512i q = _mm512_loadu_si512(&query[i]);
+        sum = _mm512_dpbusd_epi32(sum, code, q);
+    }
+    int32_t result = _mm512_reduce_add_epi32(sum);
+    if (i < dim) {
+        result += ip_i8xu_scalar<kBits>(query + i, compact_code, dim - i);
+    }
+    return result;
+}
 }  // namespace excode_ipimpl
 
 using ex_ipfunc = float (*)(const float*, const uint8_t*, size_t);
@@ -806,6 +1316,135 @@ inline ex_ipfunc select_excode_ipfunc(size_t ex_bits) {
     exit(1);
 }
 
+using ex_ipfunc_i8 = int32_t (*)(const int8_t*, const uint8_t*, size_t);
+
+/**
+ * @brief Select the integer inner product for ex codes of ex_bits (1 to 8), nullptr if the
+ * cpu has no VNNI, then ex codes should use select_excode_ipfunc.
+ */
+inline ex_ipfunc_i8 select_excode_ipfunc_i8(size_t ex_bits) {
+    if (ex_bits == 0 || ex_bits > 8 || simd_level() < SimdLevel::AVX512Ext) {
+        return nullptr;
+    }
+    constexpr std::array<ex_ipfunc_i8, 8> kFuncs = {
+        excode_ipimpl::ip64_i8xu_vnni<1>,
+        excode_ipimpl::ip64_i8xu_vnni<2>,
+        excode_ipimpl::ip64_i8xu_vnni<3>,
+        excode_ipimpl::ip64_i8xu_vnni<4>,
+        excode_ipimpl::ip64_i8xu_vnni<5>,
+        excode_ipimpl::ip64_i8xu_vnni<6>,
+        excode_ipimpl::ip64_i8xu_vnni<7>,
+        excode_ipimpl::ip64_i8xu_vnni<8>
+    };
+    return kFuncs[ex_bits - 1];
+}
+
+/**
+ * @brief Scalar reference of quantize_int8_symmetric, rounding half to even as the SIMD
+ * conversions do.
+ */
+inline float quantize_int8_symmetric_scalar(
+    const float* __restrict__ vec, size_t dim, int8_t* __restrict__ result
+) {
+    float max_abs = 0;
+    for (size_t i = 0; i < dim; ++i) {
+        max_abs = std::max(max_abs, std::abs(vec[i]));
+    }
+    if (max_abs == 0) {
+        std::fill(result, result + dim, 0);
+        return 0;
+    }
+    float delta = max_abs / 127.F;
+    float inv_delta = 127.F / max_abs;
+    for (size_t i = 0; i < dim; ++i) {
+        result[i] = static_cast<int8_t>(std::nearbyint(vec[i] * inv_delta));
+    }
+    return delta;
+}
+
+RABITQ_TARGET_AVX512 inline float quantize_int8_symmetric_avx512(
+    const float* __restrict__ vec, size_t dim, int8_t* __restrict__ result
+) {
+    size_t mul16 = dim - (dim & 0b1111);
+    __m512 max_vec = _mm512_setzero_ps();
+    for (size_t i = 0; i < mul16; i += 16) {
+        max_vec = _mm512_max_ps(max_vec, _mm512_abs_ps(_mm512_loadu_ps(vec + i)));
+    }
+    float max_abs = _mm512_reduce_max_ps(max_vec);
+    for (size_t i = mul16; i < dim; ++i) {
+        max_abs = std::max(max_abs, std::abs(vec[i]));
+    }
+    if (max_abs == 0) {
+        std::fill(result, result + dim, 0);
+        return 0;
+    }
+    float delta = max_abs / 127.F;
+    float inv_delta = 127.F / max_abs;
+    __m512 inv512 = _mm512_set1_ps(inv_delta);
+    for (size_t i = 0; i < mul16; i += 16) {
+        __m512i v = _mm512_cvtps_epi32(_mm512_mul_ps(_mm512_loadu_ps(vec + i), inv512));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), _mm512_cvtsepi32_epi8(v));
+    }
+    for (size_t i = mul16; i < dim; ++i) {
+        result[i] = static_cast<int8_t>(std::nearbyint(vec[i] * inv_delta));
+    }
+    return delta;
+}
+
+RABITQ_TARGET_AVX2 inline float quantize_int8_symmetric_avx2(
+    const float* __restrict__ vec, size_t dim, int8_t* __restrict__ result
+) {
+    size_t mul16 = dim - (dim & 0b1111);
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 max_vec = _mm256_setzero_ps();
+    for (size_t i = 0; i < mul16; i += 8) {
+        max_vec = _mm256_max_ps(max_vec, _mm256_and_ps(_mm256_loadu_ps(vec + i), abs_mask));
+    }
+    alignas(32) float max_arr[8];
+    _mm256_store_ps(max_arr, max_vec);
+    float max_abs = *std::max_element(max_arr, max_arr + 8);
+    for (size_t i = mul16; i < dim; ++i) {
+        max_abs = std::max(max_abs, std::abs(vec[i]));
+    }
+    if (max_abs == 0) {
+        std::fill(result, result + dim, 0);
+        return 0;
+    }
+    float delta = max_abs / 127.F;
+    float inv_delta = 127.F / max_abs;
+    __m256 inv256 = _mm256_set1_ps(inv_delta);
+    for (size_t i = 0; i < mul16; i += 16) {
+        __m256i lo = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(vec + i), inv256));
+        __m256i hi =
+            _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(vec + i + 8), inv256));
+        // packs works within 128-bit lanes, restore the order before the last pack
+        __m256i i16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0b11011000);
+        __m128i i8 =
+            _mm_packs_epi16(_mm256_castsi256_si128(i16), _mm256_extracti128_si256(i16, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), i8);
+    }
+    for (size_t i = mul16; i < dim; ++i) {
+        result[i] = static_cast<int8_t>(std::nearbyint(vec[i] * inv_delta));
+    }
+    return delta;
+}
+
+/**
+ * @brief Quantize a vector to int8 by a symmetric uniform scalar quantizer,
+ * vec[i] ~= delta * result[i]. Returns delta.
+ */
+inline float quantize_int8_symmetric(
+    const float* __restrict__ vec, size_t dim, int8_t* __restrict__ result
+) {
+    if (simd_level() >= SimdLevel::AVX512) {
+        return quantize_int8_symmetric_avx512(vec, dim, result);
+    }
+    if (simd_level() >= SimdLevel::AVX2) {
+        return quantize_int8_symmetric_avx2(vec, dim, result);
+    }
+    return quantize_int8_symmetric_scalar(vec, dim, result);
+}
+
 static inline uint32_t reverse_bits(uint32_t n) {
     n = ((n >> 1) & 0x55555555) | ((n << 1) & 0xaaaaaaaa);
     n = ((n >> 2) & 0x33333333) | ((n << 2) & 0xcccccccc);
@@ -825,6 +1464,23 @@ static inline uint64_t reverse_bits_u64(uint64_t n) {
     return n;
 }
 
+// scalar reference of new_transpose_bin, bit p of q[d] goes to bit (63 - d % 64) of the
+// p-th word of the block of d
+static inline void new_transpose_bin_scalar(
+    const uint16_t* q, uint64_t* tq, size_t padded_dim, size_t b_query
+) {
+    for (size_t i = 0; i < padded_dim; i += 64) {
+        std::fill(tq, tq + b_query, 0);
+        for (size_t d = 0; d < 64; ++d) {
+            for (size_t p = 0; p < b_query; ++p) {
+                tq[p] |= static_cast<uint64_t>((q[d] >> p) & 1) << (63 - d);
+            }
+        }
+        tq += b_query;
+        q += 64;
+    }
+}
+
 static inline void new_transpose_bin(
     const uint16_t* q, uint64_t* tq, size_t padded_dim, size_t b_query
 ) {
@@ -900,11 +1556,30 @@ static inline void new_transpose_bin(
         q += 64;
     }
 #else
-    std::cerr << "AVX512 or AVX2 is required for new transpose bin\n";
-    exit(1);
+    new_transpose_bin_scalar(q, tq, padded_dim, b_query);
 #endif
 }
 
+// scalar reference of new_transpose_bin_512, see warmup_ip_x0_q_512 for the layout
+static inline void new_transpose_bin_512_scalar(
+    const uint8_t* q, uint64_t* tq, size_t padded_dim, size_t b_query
+) {
+    for (size_t i = 0; i < padded_dim; i += 512) {
+        size_t num_chunks = std::min<size_t>(padded_dim - i, 512) / 64;
+        std::fill(tq, tq + (num_chunks * b_query), 0);
+        for (size_t k = 0; k < num_chunks; ++k) {
+            for (size_t t = 0; t < 64; ++t) {
+                uint8_t val = q[i + (k * 64) + t];
+                for (size_t p = 0; p < b_query; ++p) {
+                    tq[(p * num_chunks) + k] |= static_cast<uint64_t>((val >> p) & 1)
+                                                << (63 - t);
+                }
+            }
+        }
+        tq += num_chunks * b_query;
+    }
+}
+
 static inline void new_transpose_bin_512(
     const uint8_t* q, uint64_t* tq, size_t padded_dim, size_t b_query
 ) {
@@ -975,8 +1650,7 @@ static inline void new_transpose_bin_512(
         tq += num_chunks * b_query;
     }
 #else
-    std::cerr << "AVX512BW or AVX2 is required for new_transpose_bin_512\n";
-    exit(1);
+    new_transpose_bin_512_scalar(q, tq, padded_dim, b_query);
 #endif
 }
 
@@ -1014,12 +1688,29 @@ inline float mask_ip_x0_q_old(const float* query, const uint64_t* data, size_t p
     return _mm512_reduce_add_ps(sum);
 }
 
-inline float mask_ip_x0_q(const float* query, const uint64_t* data, size_t padded_dim) {
+// scalar reference of mask_ip_x0_q, sum of query[d] whose bit (63 - d % 64) is set
+inline float mask_ip_x0_q_scalar(
+    const float* query, const uint64_t* data, size_t padded_dim
+) {
+    const size_t num_blk = padded_dim / 64;
+    float result = 0;
+    for (size_t i = 0; i < num_blk; ++i) {
+        uint64_t bits = reverse_bits_u64(data[i]);
+        for (size_t j = 0; j < 64; ++j) {
+            if (((bits >> j) & 1) != 0) {
+                result += query[(i * 64) + j];
+            }
+        }
+    }
+    return result;
+}
+
+RABITQ_TARGET_AVX512 inline float mask_ip_x0_q_avx512(
+    const float* query, const uint64_t* data, size_t padded_dim
+) {
     const size_t num_blk = padded_dim / 64;
     const uint64_t* it_data = data;
     const float* it_query = query;
-// Easier
-#if defined(__AVX512F__)
 
     //    __m512 sum0 = _mm512_setzero_ps();
     //    __m512 sum1 = _mm512_setzero_ps();
@@ -1053,7 +1744,14 @@ inline float mask_ip_x0_q(const float* query, const uint64_t* data, size_t padde
 
     //    __m512 sum = _mm512_add_ps(_mm512_add_ps(sum0, sum1), _mm512_add_ps(sum2, sum3));
     return _mm512_reduce_add_ps(sum);
-#elif defined(__AVX2__)
+}
+
+RABITQ_TARGET_AVX2 inline float mask_ip_x0_q_avx2(
+    const float* query, const uint64_t* data, size_t padded_dim
+) {
+    const size_t num_blk = padded_dim / 64;
+    const uint64_t* it_data = data;
+    const float* it_query = query;
 
     __m256 sum = _mm256_setzero_ps();
 
@@ -1084,11 +1782,16 @@ inline float mask_ip_x0_q(const float* query, const uint64_t* data, size_t padde
         result += reinterpret_cast<float*>(&sum)[i];
     }
     return result;
-#else
-    std::cerr << "AVX512 or AVX2 is required for mask ip x0 q\n";
-    exit(1);
-#endif
-    return 0.0F;
+}
+
+inline float mask_ip_x0_q(const float* query, const uint64_t* data, size_t padded_dim) {
+    if (simd_level() >= SimdLevel::AVX512) {
+        return mask_ip_x0_q_avx512(query, data, padded_dim);
+    }
+    if (simd_level() >= SimdLevel::AVX2) {
+        return mask_ip_x0_q_avx2(query, data, padded_dim);
+    }
+    return mask_ip_x0_q_scalar(query, data, padded_dim);
 }
 
 inline float ip_x0_q(
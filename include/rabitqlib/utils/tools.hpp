@@ -1,5 +1,7 @@
 #pragma once
 
+#include <sys/resource.h>
+
 #include <ctime>
 #include <queue>
 #include <random>
@@ -74,6 +76,13 @@ inline size_t total_threads() {
     return threads == 0 ? 1 : threads;
 }
 
+// peak resident set size of current process in bytes
+inline size_t peak_rss_bytes() {
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;  // ru_maxrss is in kilobytes
+}
+
 template <typename T, typename TP>
 float distance_ratio(
     const T* data,
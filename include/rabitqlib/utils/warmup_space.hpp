@@ -2,12 +2,15 @@
 
 #include <immintrin.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <iostream>
+
+#include "rabitqlib/utils/cpu_features.hpp"
 
 // Helper: AVX2 64-bit Popcount; Mula's method
-inline __m256i popcount_avx2(__m256i v) {
-#if defined(__AVX2__)
+RABITQ_TARGET_AVX2 inline __m256i popcount_avx2(__m256i v) {
     // Lookup table for population count of 0-15
     const __m256i lookup = _mm256_setr_epi8(
         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
@@ -28,13 +31,52 @@ inline __m256i popcount_avx2(__m256i v) {
 
     // Sum bytes horizontally into 64-bit integers (SAD against 0)
     return _mm256_sad_epu8(cnt_bytes, _mm256_setzero_si256());
-#else
-    std::cerr << "AVX2 is required for popcount_avx2\n";
-    exit(1);
-#endif
 }
 
-inline float warmup_ip_x0_q_512(
+// Standard reduction for a single __m256i
+RABITQ_TARGET_AVX2 inline int64_t mm256_reduce_add_epi64(__m256i v) {
+    __m128i low = _mm256_castsi256_si128(v);
+    __m128i high = _mm256_extracti128_si256(v, 1);
+    __m128i sum = _mm_add_epi64(low, high);
+    return _mm_extract_epi64(sum, 0) + _mm_extract_epi64(sum, 1);
+}
+
+// the query is transposed from uint8 codes, see new_transpose_bin_512
+constexpr size_t kMaxQueryBits = 8;
+
+/**
+ * @brief Scalar reference of warmup_ip_x0_q_512. Every 512 dims (or the remaining dims)
+ * take num_chunks words of data, and the query stores b_query bit planes of num_chunks
+ * words each right after them.
+ */
+inline float warmup_ip_x0_q_512_scalar(
+    const uint64_t* data,
+    const uint64_t* query,
+    float delta,
+    float vl,
+    size_t padded_dim,
+    size_t b_query
+) {
+    size_t ip_scalar = 0;
+    size_t ppc_scalar = 0;
+
+    for (size_t i = 0; i < padded_dim; i += 512) {
+        size_t num_chunks = (std::min<size_t>(padded_dim - i, 512)) / 64;
+        for (size_t k = 0; k < num_chunks; ++k) {
+            ppc_scalar += __builtin_popcountll(data[k]);
+            for (size_t j = 0; j < b_query; ++j) {
+                uint64_t y = query[(j * num_chunks) + k];
+                ip_scalar += static_cast<size_t>(__builtin_popcountll(data[k] & y)) << j;
+            }
+        }
+        data += num_chunks;
+        query += num_chunks * b_query;
+    }
+
+    return (delta * static_cast<float>(ip_scalar)) + (vl * static_cast<float>(ppc_scalar));
+}
+
+RABITQ_TARGET_AVX512EXT inline float warmup_ip_x0_q_512_avx512(
     const uint64_t* data,
     const uint64_t* query,
     float delta,
@@ -42,7 +84,6 @@ inline float warmup_ip_x0_q_512(
     size_t padded_dim,
     size_t b_query
 ) {
-#if defined(__AVX512VPOPCNTDQ__) && defined(__AVX512BW__)
     size_t ip_scalar = 0;
     size_t ppc_scalar = 0;
 
@@ -52,7 +93,7 @@ inline float warmup_ip_x0_q_512(
     size_t i = 0;
     size_t dim_end_512 = (padded_dim / 512) * 512;
 
-    __m512i acc_bits[b_query];
+    __m512i acc_bits[kMaxQueryBits];
     for (size_t j = 0; j < b_query; ++j) {
         acc_bits[j] = _mm512_setzero_si512();
     }
@@ -98,7 +139,16 @@ inline float warmup_ip_x0_q_512(
     ppc_scalar += static_cast<size_t>(_mm512_reduce_add_epi64(acc_ppc));
 
     return (delta * static_cast<float>(ip_scalar)) + (vl * static_cast<float>(ppc_scalar));
-#elif defined(__AVX2__)
+}
+
+RABITQ_TARGET_AVX2 inline float warmup_ip_x0_q_512_avx2(
+    const uint64_t* data,
+    const uint64_t* query,
+    float delta,
+    float vl,
+    size_t padded_dim,
+    size_t b_query
+) {
     size_t ip_scalar = 0;
     size_t ppc_scalar = 0;
 
@@ -109,7 +159,7 @@ inline float warmup_ip_x0_q_512(
     // Step by 512 bits at a time (64 bytes = 16 elements of 32-bit integers)
     size_t dim_end_512 = (padded_dim / 512) * 512;
 
-    __m256i acc_bits[b_query];
+    __m256i acc_bits[kMaxQueryBits];
     for (size_t j = 0; j < b_query; ++j) {
         acc_bits[j] = _mm256_setzero_si256();
     }
@@ -183,22 +233,85 @@ inline float warmup_ip_x0_q_512(
         acc_ip = _mm256_add_epi64(acc_ip, _mm256_sll_epi64(acc_bits[j], shift));
     }
 
-    // Standard reduction for a single __m256i
-    auto mm256_reduce_add_epi64 = [](__m256i v) {
-        __m128i low = _mm256_castsi256_si128(v);
-        __m128i high = _mm256_extracti128_si256(v, 1);
-        __m128i sum = _mm_add_epi64(low, high);
-        return _mm_extract_epi64(sum, 0) + _mm_extract_epi64(sum, 1);
-    };
-
     ip_scalar += mm256_reduce_add_epi64(acc_ip);
     ppc_scalar += mm256_reduce_add_epi64(acc_ppc);
 
     return (delta * static_cast<float>(ip_scalar)) + (vl * static_cast<float>(ppc_scalar));
-#else    
-    std::cerr << "AVX512 VPOPCNTDQ and AVX512BW or AVX2 are required for warmup_ip_x0_q_512\n";
-    exit(1);
-#endif
+}
+
+// The kernels above with a compile-time b_query, whose loops over the bit planes are then
+// fully unrolled
+template <size_t kBQuery>
+RABITQ_TARGET_AVX512EXT inline float warmup_ip_x0_q_512_avx512_fixed(
+    const uint64_t* data, const uint64_t* query, float delta, float vl, size_t padded_dim
+) {
+    return warmup_ip_x0_q_512_avx512(data, query, delta, vl, padded_dim, kBQuery);
+}
+
+template <size_t kBQuery>
+RABITQ_TARGET_AVX2 inline float warmup_ip_x0_q_512_avx2_fixed(
+    const uint64_t* data, const uint64_t* query, float delta, float vl, size_t padded_dim
+) {
+    return warmup_ip_x0_q_512_avx2(data, query, delta, vl, padded_dim, kBQuery);
+}
+
+// the vpopcntdq kernel needs avx512ext, plain avx512 falls back to avx2. b_query is fixed
+// per query, so the switch is always predicted
+inline float warmup_ip_x0_q_512(
+    const uint64_t* data,
+    const uint64_t* query,
+    float delta,
+    float vl,
+    size_t padded_dim,
+    size_t b_query
+) {
+    if (rabitqlib::simd_level() >= rabitqlib::SimdLevel::AVX512Ext) {
+        switch (b_query) {
+            case 2:
+                return warmup_ip_x0_q_512_avx512_fixed<2>(
+                    data, query, delta, vl, padded_dim
+                );
+            case 4:
+                return warmup_ip_x0_q_512_avx512_fixed<4>(
+                    data, query, delta, vl, padded_dim
+                );
+            case 6:
+                return warmup_ip_x0_q_512_avx512_fixed<6>(
+                    data, query, delta, vl, padded_dim
+                );
+            case 8:
+                return warmup_ip_x0_q_512_avx512_fixed<8>(
+                    data, query, delta, vl, padded_dim
+                );
+            default:
+                return warmup_ip_x0_q_512_avx512(
+                    data, query, delta, vl, padded_dim, b_query
+                );
+        }
+    }
+    if (rabitqlib::simd_level() >= rabitqlib::SimdLevel::AVX2) {
+        switch (b_query) {
+            case 2:
+                return warmup_ip_x0_q_512_avx2_fixed<2>(
+                    data, query, delta, vl, padded_dim
+                );
+            case 4:
+                return warmup_ip_x0_q_512_avx2_fixed<4>(
+                    data, query, delta, vl, padded_dim
+                );
+            case 6:
+                return warmup_ip_x0_q_512_avx2_fixed<6>(
+                    data, query, delta, vl, padded_dim
+                );
+            case 8:
+                return warmup_ip_x0_q_512_avx2_fixed<8>(
+                    data, query, delta, vl, padded_dim
+                );
+            default:
+                return warmup_ip_x0_q_512_avx2(data, query, delta, vl, padded_dim, b_query);
+        }
+    }
+    return warmup_ip_x0_q_512_scalar(data, query, delta, vl, padded_dim, b_query);
 }
 
 template <uint32_t b_query>
@@ -305,12 +418,6 @@ inline float warmup_ip_x0_q(
         }
     }
 
-    auto mm256_reduce_add_epi64 = [](__m256i v) {
-        __m128i low = _mm256_castsi256_si128(v);
-        __m128i high = _mm256_extracti128_si256(v, 1);
-        __m128i sum = _mm_add_epi64(low, high);
-        return _mm_extract_epi64(sum, 0) + _mm_extract_epi64(sum, 1);
-    };
     // Horizontally reduce the vector accumulators.
     ppc_scalar += mm256_reduce_add_epi64(ppc_vec);
     ip_scalar += mm256_reduce_add_epi64(ip_vec);
@@ -326,10 +433,20 @@ inline float warmup_ip_x0_q(
 
     return (delta * static_cast<float>(ip_scalar)) + (vl * static_cast<float>(ppc_scalar));
 #else
-    std::cerr << "AVX512 or AVX2 is required for warmup_ip_x0_q\n";
-    exit(1);
+    const size_t num_blk = padded_dim / 64;
+    size_t ip_scalar = 0;
+    size_t ppc_scalar = 0;
+
+    for (size_t i = 0; i < num_blk; i++) {
+        const uint64_t x = data[i];
+        ppc_scalar += __builtin_popcountll(x);
+        for (uint32_t j = 0; j < b_query; j++) {
+            ip_scalar += __builtin_popcountll(x & query[j * num_blk + i]) << j;
+        }
+    }
+
+    return (delta * static_cast<float>(ip_scalar)) + (vl * static_cast<float>(ppc_scalar));
 #endif
-    return 0.0f;
 }
 
 template <uint32_t b_query, uint32_t padded_dim>
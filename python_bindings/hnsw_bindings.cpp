@@ -81,7 +81,16 @@ class HnswIndex {
         built_ = true;
     }
 
-    py::tuple search(py::handle queries, size_t k, size_t ef = 0, size_t num_threads = 1) {
+    py::tuple search(
+        py::handle queries,
+        size_t k,
+        size_t ef = 0,
+        size_t num_threads = 1,
+        size_t num_seed_clusters = 0,
+        size_t patience = 0,
+        bool error_gap = false,
+        size_t query_bits = rabitqlib::SplitSingleQuery<float>::kNumBits
+    ) {
         auto query_array = ensure_2d_array<float>(queries, "queries");
         if (dim_ != 0 && static_cast<size_t>(query_array.shape(1)) != dim_) {
             throw std::invalid_argument("query dimension does not match index dim");
@@ -97,12 +106,15 @@ class HnswIndex {
         auto ids_buf = ids.mutable_unchecked<2>();
         auto dists_buf = dists.mutable_unchecked<2>();
 
+        index_->set_early_stop({patience, error_gap});
+        index_->set_query_bits(query_bits);
         std::vector<std::vector<std::pair<float, rabitqlib::PID>>> results = index_->search(
                 query_array.data(),
                 static_cast<size_t>(query_array.shape(0)),
                 k,
                 ef,
-                num_threads
+                num_threads,
+                num_seed_clusters
             );
 
         for (ssize_t i = 0; i < static_cast<ssize_t>(results.size()); ++i) {
@@ -118,6 +130,20 @@ class HnswIndex {
         return py::make_tuple(ids, dists);
     }
 
+    void drop_upper_layers() {
+        if (!built_) {
+            throw std::runtime_error("HnswIndex must be built or loaded before drop_upper_layers");
+        }
+        index_->drop_upper_layers();
+    }
+
+    void reorder() {
+        if (!built_) {
+            throw std::runtime_error("HnswIndex must be built or loaded before reorder");
+        }
+        index_->reorder();
+    }
+
     void save(const std::string& path) const {
         if (!built_) {
             throw std::runtime_error("HnswIndex must be built or loaded before save");
@@ -187,7 +213,13 @@ void register_hnsw(py::module_ &m) {
              py::arg("queries"),
              py::arg("k"),
              py::arg("ef") = 0,
-             py::arg("num_threads") = 1)
+             py::arg("num_threads") = 1,
+             py::arg("num_seed_clusters") = 0,
+             py::arg("patience") = 0,
+             py::arg("error_gap") = false,
+             py::arg("query_bits") = rabitqlib::SplitSingleQuery<float>::kNumBits)
+        .def("drop_upper_layers", &HnswIndex::drop_upper_layers)
+        .def("reorder", &HnswIndex::reorder)
         .def("save", &HnswIndex::save, py::arg("path"))
         .def_static("load", &HnswIndex::load, py::arg("path"))
         .def_property_readonly("dim", &HnswIndex::dim)
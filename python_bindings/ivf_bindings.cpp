@@ -19,7 +19,8 @@ class IvfIndex {
         size_t max_elements,
         size_t num_clusters,
         size_t nbits,
-        const std::string& metric = "l2"
+        const std::string& metric = "l2",
+        size_t fastscan_bits = 1
     )
         : dim_(dim)
         , max_elements_(max_elements)
@@ -32,7 +33,8 @@ class IvfIndex {
               num_clusters,
               nbits,
               metric_,
-              rabitqlib::RotatorType::FhtKacRotator
+              rabitqlib::RotatorType::FhtKacRotator,
+              fastscan_bits
           )) {}
 
     void build(
@@ -129,6 +131,7 @@ class IvfIndex {
     [[nodiscard]] size_t max_elements() const { return max_elements_; }
     [[nodiscard]] size_t num_clusters() const { return num_clusters_; }
     [[nodiscard]] size_t nbits() const { return nbits_; }
+    [[nodiscard]] size_t fastscan_bits() const { return index_->fastscan_bits(); }
     [[nodiscard]] bool is_built() const { return built_; }
     [[nodiscard]] std::string metric() const { return metric_to_string(metric_); }
 
@@ -151,12 +154,13 @@ void register_ivf(py::module_ &m) {
     using namespace rabitqlib::python_bindings;
 
     py::class_<IvfIndex>(m, "IvfIndex")
-       .def(py::init<size_t, size_t, size_t, size_t, const std::string&>(),
+       .def(py::init<size_t, size_t, size_t, size_t, const std::string&, size_t>(),
            py::arg("dim"),
            py::arg("max_elements"),
            py::arg("num_clusters"),
            py::arg("nbits"),
-           py::arg("metric") = "l2")
+           py::arg("metric") = "l2",
+           py::arg("fastscan_bits") = 1)
        .def("build", &IvfIndex::build,
            py::arg("data"),
            py::arg("centroids"),
@@ -174,6 +178,7 @@ void register_ivf(py::module_ &m) {
        .def_property_readonly("max_elements", &IvfIndex::max_elements)
        .def_property_readonly("num_clusters", &IvfIndex::num_clusters)
        .def_property_readonly("nbits", &IvfIndex::nbits)
+       .def_property_readonly("fastscan_bits", &IvfIndex::fastscan_bits)
        .def_property_readonly("is_built", &IvfIndex::is_built)
        .def_property_readonly("metric", &IvfIndex::metric);
 }
\ No newline at end of file
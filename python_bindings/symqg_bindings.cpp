@@ -6,7 +6,6 @@
 #include <pybind11/stl.h>
 
 #include "bindings_common.hpp"
-#include "rabitqlib/index/ivf/initializer.hpp"
 #include "rabitqlib/index/symqg/qg.hpp"
 #include "rabitqlib/index/symqg/qg_builder.hpp"
 
@@ -16,63 +15,147 @@ namespace rabitqlib::python_bindings {
 
 class SymqgIndex {
    public:
-    SymqgIndex(size_t dim, size_t max_degree, const std::string& metric = "l2")
+    SymqgIndex(
+        size_t dim, size_t max_degree, const std::string& metric = "l2", size_t ex_bits = 0
+    )
         : dim_(dim)
         , max_degree_(max_degree)
-        , metric_(metric_from_string(metric)) {}
+        , metric_(metric_from_string(metric))
+        , ex_bits_(ex_bits) {
+        if (ex_bits_ > 8) {
+            throw std::invalid_argument("ex_bits must be in [0, 8]");
+        }
+    }
 
-    void build(py::handle data, size_t ef_construction, size_t num_threads = 1) {
+    void build(
+        py::handle data,
+        size_t ef_construction,
+        size_t num_threads = 1,
+        const std::string& init = "random",
+        size_t num_iter = 3,
+        float min_change_rate = 0
+    ) {
         auto data_array = ensure_2d_array<float>(data, "data");
         if (static_cast<size_t>(data_array.shape(1)) != dim_) {
             throw std::invalid_argument("data dimension does not match index dim");
         }
+        if (init != "random" && init != "cluster") {
+            throw std::invalid_argument("Unsupported init. Use 'random' or 'cluster'.");
+        }
+        if (num_iter < 2) {
+            throw std::invalid_argument("num_iter must be at least 2");
+        }
 
         num_points_ = static_cast<size_t>(data_array.shape(0));
         index_ = std::make_unique<rabitqlib::symqg::QuantizedGraph<float>>(
-            num_points_, dim_, max_degree_, metric_, rabitqlib::RotatorType::FhtKacRotator
+            num_points_,
+            dim_,
+            max_degree_,
+            metric_,
+            rabitqlib::RotatorType::FhtKacRotator,
+            ex_bits_
         );
 
         rabitqlib::symqg::QGBuilder builder(*index_, ef_construction, data_array.data(), num_threads);
-        builder.build();
+        builder.set_init_type(
+            init == "cluster" ? rabitqlib::symqg::QGInitType::ClusterInit
+                              : rabitqlib::symqg::QGInitType::RandomInit
+        );
+        builder.build(num_iter, min_change_rate);
         built_ = true;
     }
 
-    py::tuple search(py::handle queries, size_t k, size_t ef, size_t num_threads = 1) {
+    void insert(py::handle data, size_t ef_construction, size_t num_threads = 1) {
+        auto data_array = ensure_2d_array<float>(data, "data");
+        if (!built_) {
+            throw std::runtime_error("SymqgIndex must be built or loaded before insert");
+        }
+        if (static_cast<size_t>(data_array.shape(1)) != dim_) {
+            throw std::invalid_argument("data dimension does not match index dim");
+        }
+
+        if (index_->raw_data_type() != rabitqlib::RAW_FP32) {
+            throw std::runtime_error("Cannot insert into SymqgIndex with compressed vectors");
+        }
+        rabitqlib::symqg::QGBuilder builder(*index_, ef_construction, num_threads);
+        builder.insert(data_array.data(), static_cast<size_t>(data_array.shape(0)));
+        num_points_ = index_->num_vertices();
+    }
+
+    py::tuple search(
+        py::handle queries,
+        size_t k,
+        size_t ef,
+        size_t num_threads = 1,
+        bool use_raw_dist = true,
+        size_t patience = 0,
+        bool error_gap = false
+    ) {
         auto query_array = ensure_2d_array<float>(queries, "queries");
         if (!built_) {
             throw std::runtime_error("SymqgIndex must be built or loaded before search");
         }
+        if (!use_raw_dist && ex_bits_ == 0) {
+            throw std::runtime_error(
+                "Searching SymqgIndex without raw vectors requires ex_bits > 0"
+            );
+        }
         if (static_cast<size_t>(query_array.shape(1)) != dim_) {
             throw std::invalid_argument("query dimension does not match index dim");
         }
 
-        index_->set_ef(ef);
-
         const size_t nq = static_cast<size_t>(query_array.shape(0));
         const auto shape = std::vector<ssize_t>{static_cast<ssize_t>(nq), static_cast<ssize_t>(k)};
         auto ids = py::array_t<rabitqlib::PID>(shape);
         auto dists = py::array_t<float>(shape);
-        auto ids_buf = ids.mutable_unchecked<2>();
-        auto dists_buf = dists.mutable_unchecked<2>();
-    
-        rabitqlib::ivf::parallel_for(
-            0,
+        std::fill_n(ids.mutable_data(), nq * k, 0);
+        std::fill_n(dists.mutable_data(), nq * k, 0.0F);
+
+        index_->set_use_raw_dist(use_raw_dist);
+        index_->set_early_stop({patience, error_gap});
+        index_->search_batch(
+            query_array.data(),
             nq,
+            static_cast<uint32_t>(k),
+            ef,
             num_threads,
-            [&](size_t idx, size_t /*threadId*/) {
-                std::vector<rabitqlib::PID> row_ids(k, 0);
-                std::vector<float> row_dists(k, 0.0F);
-                index_->search(query_array.data() + (idx * dim_), static_cast<uint32_t>(k), row_ids.data(), row_dists.data());
-                for (size_t j = 0; j < k; ++j) {
-                    ids_buf(static_cast<ssize_t>(idx), static_cast<ssize_t>(j)) = row_ids[j];
-                    dists_buf(static_cast<ssize_t>(idx), static_cast<ssize_t>(j)) = row_dists[j];
-                }
-            }
+            ids.mutable_data(),
+            dists.mutable_data()
         );
 
         return py::make_tuple(ids, dists);
     }
 
+    void reorder() {
+        if (!built_) {
+            throw std::runtime_error("SymqgIndex must be built or loaded before reorder");
+        }
+        index_->reorder();
+    }
+
+    void compress_raw_vectors(const std::string& dtype) {
+        if (!built_) {
+            throw std::runtime_error(
+                "SymqgIndex must be built or loaded before compress_raw_vectors"
+            );
+        }
+        rabitqlib::RawDataType type;
+        if (dtype == "fp16") {
+            type = rabitqlib::RAW_FP16;
+        } else if (dtype == "bf16") {
+            type = rabitqlib::RAW_BF16;
+        } else if (dtype == "int8") {
+            type = rabitqlib::RAW_INT8;
+        } else {
+            throw std::invalid_argument("Unsupported dtype. Use 'fp16', 'bf16' or 'int8'.");
+        }
+        if (index_->raw_data_type() != rabitqlib::RAW_FP32 &&
+            index_->raw_data_type() != type) {
+            throw std::runtime_error("Raw vectors of SymqgIndex are already compressed");
+        }
+        index_->compress_raw_vectors(type);
+    }
+
     void save(const std::string& path) const {
         if (!built_) {
             throw std::runtime_error("SymqgIndex must be built before save");
@@ -88,6 +171,7 @@ class SymqgIndex {
         wrapper.dim_ = wrapper.index_->dimension();
         wrapper.max_degree_ = wrapper.index_->degree_bound();
         wrapper.metric_ = wrapper.index_->metric_type();
+        wrapper.ex_bits_ = wrapper.index_->ex_bits();
         wrapper.built_ = true;
         return wrapper;
     }
@@ -95,6 +179,7 @@ class SymqgIndex {
     [[nodiscard]] size_t dim() const { return dim_; }
     [[nodiscard]] size_t max_degree() const { return max_degree_; }
     [[nodiscard]] size_t num_points() const { return num_points_; }
+    [[nodiscard]] size_t ex_bits() const { return ex_bits_; }
     [[nodiscard]] bool is_built() const { return built_; }
     [[nodiscard]] std::string metric() const { return metric_to_string(metric_); }
 
@@ -105,6 +190,7 @@ class SymqgIndex {
     size_t max_degree_ = 0;
     size_t num_points_ = 0;
     rabitqlib::MetricType metric_ = rabitqlib::METRIC_L2;
+    size_t ex_bits_ = 0;
     bool built_ = false;
     std::unique_ptr<rabitqlib::symqg::QuantizedGraph<float>> index_;
 };
@@ -116,11 +202,19 @@ void register_symqg(py::module_ &m) {
     using namespace rabitqlib::python_bindings;
 
     py::class_<SymqgIndex>(m, "SymqgIndex")
-       .def(py::init<size_t, size_t, const std::string&>(),
+       .def(py::init<size_t, size_t, const std::string&, size_t>(),
            py::arg("dim"),
            py::arg("max_degree"),
-           py::arg("metric") = "l2")
+           py::arg("metric") = "l2",
+           py::arg("ex_bits") = 0)
        .def("build", &SymqgIndex::build,
+           py::arg("data"),
+           py::arg("ef_construction"),
+           py::arg("num_threads") = 1,
+           py::arg("init") = "random",
+           py::arg("num_iter") = 3,
+           py::arg("min_change_rate") = 0.0F)
+       .def("insert", &SymqgIndex::insert,
            py::arg("data"),
            py::arg("ef_construction"),
            py::arg("num_threads") = 1)
@@ -128,12 +222,18 @@ void register_symqg(py::module_ &m) {
            py::arg("queries"),
            py::arg("k"),
            py::arg("ef"),
-           py::arg("num_threads") = 1)
+           py::arg("num_threads") = 1,
+           py::arg("use_raw_dist") = true,
+           py::arg("patience") = 0,
+           py::arg("error_gap") = false)
+       .def("reorder", &SymqgIndex::reorder)
+       .def("compress_raw_vectors", &SymqgIndex::compress_raw_vectors, py::arg("dtype"))
        .def("save", &SymqgIndex::save, py::arg("path"))
        .def_static("load", &SymqgIndex::load, py::arg("path"))
        .def_property_readonly("dim", &SymqgIndex::dim)
        .def_property_readonly("max_degree", &SymqgIndex::max_degree)
        .def_property_readonly("num_points", &SymqgIndex::num_points)
+       .def_property_readonly("ex_bits", &SymqgIndex::ex_bits)
        .def_property_readonly("is_built", &SymqgIndex::is_built)
        .def_property_readonly("metric", &SymqgIndex::metric);
 }
\ No newline at end of file
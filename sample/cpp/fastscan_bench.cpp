@@ -0,0 +1,196 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "rabitqlib/fastscan/fastscan.hpp"
+#include "rabitqlib/fastscan/highacc_fastscan.hpp"
+#include "rabitqlib/utils/cpu_features.hpp"
+#include "rabitqlib/utils/stopw.hpp"
+
+namespace fastscan = rabitqlib::fastscan;
+
+static size_t test_round = 5;
+static size_t g_checksum = 0;  // sum of kernel results, printed so they are not elided
+
+// ns per vector of scanning num vectors packed in batches of kWidth
+template <size_t kWidth, bool kHacc>
+static float bench_scan(
+    const std::vector<uint8_t>& codes,
+    size_t num,
+    size_t dim,
+    const std::vector<uint8_t>& lut,
+    size_t repeat
+) {
+    std::vector<uint8_t> packed((num + kWidth - 1) / kWidth * kWidth * dim / 8);
+    fastscan::pack_codes<kWidth>(dim, codes.data(), num, packed.data());
+    size_t batch_bytes = kWidth * dim / 8;
+
+    std::vector<uint16_t> result(kWidth);
+    std::vector<int32_t> hacc_result(kWidth);
+    size_t checksum = 0;
+    float best = 1e30F;
+    for (size_t r = 0; r < test_round; ++r) {
+        rabitqlib::StopW stopw;
+        for (size_t i = 0; i < repeat; ++i) {
+            for (size_t offset = 0; offset < packed.size(); offset += batch_bytes) {
+                if constexpr (kHacc) {
+                    fastscan::accumulate_hacc<kWidth>(
+                        packed.data() + offset, lut.data(), hacc_result.data(), dim
+                    );
+                    checksum += hacc_result[0];
+                } else {
+                    fastscan::accumulate<kWidth>(
+                        packed.data() + offset, lut.data(), result.data(), dim
+                    );
+                    checksum += result[0];
+                }
+            }
+        }
+        best = std::min(best, stopw.get_elapsed_nano() / static_cast<float>(repeat * num));
+    }
+    g_checksum += checksum;
+    return best;
+}
+
+// ns per vector and query of scanning 32-vector batches for num_queries queries, one
+// query at a time or all together with the multi-query kernels
+template <bool kHacc>
+static float bench_multi(
+    const std::vector<uint8_t>& codes,
+    size_t num,
+    size_t dim,
+    const std::vector<const uint8_t*>& luts,
+    size_t repeat,
+    bool multi
+) {
+    constexpr size_t kWidth = fastscan::kBatchSize;
+    size_t num_queries = luts.size();
+    std::vector<uint8_t> packed((num + kWidth - 1) / kWidth * kWidth * dim / 8);
+    fastscan::pack_codes(dim, codes.data(), num, packed.data());
+    size_t batch_bytes = kWidth * dim / 8;
+    repeat = std::max<size_t>(1, repeat / num_queries);
+
+    std::vector<uint16_t> result(kWidth * num_queries);
+    std::vector<int32_t> hacc_result(kWidth * num_queries);
+    size_t checksum = 0;
+    float best = 1e30F;
+    for (size_t r = 0; r < test_round; ++r) {
+        rabitqlib::StopW stopw;
+        for (size_t i = 0; i < repeat; ++i) {
+            for (size_t offset = 0; offset < packed.size(); offset += batch_bytes) {
+                const uint8_t* batch_codes = packed.data() + offset;
+                if (multi && kHacc) {
+                    fastscan::accumulate_hacc_multi(
+                        batch_codes, luts.data(), num_queries, hacc_result.data(), dim
+                    );
+                } else if (multi) {
+                    fastscan::accumulate_multi(
+                        batch_codes, luts.data(), num_queries, result.data(), dim
+                    );
+                } else {
+                    for (size_t q = 0; q < num_queries; ++q) {
+                        if constexpr (kHacc) {
+                            fastscan::accumulate_hacc(
+                                batch_codes, luts[q], hacc_result.data() + (q * kWidth), dim
+                            );
+                        } else {
+                            fastscan::accumulate(
+                                batch_codes, luts[q], result.data() + (q * kWidth), dim
+                            );
+                        }
+                    }
+                }
+                checksum += result[0] + hacc_result[0];
+            }
+        }
+        best = std::min(
+            best, stopw.get_elapsed_nano() / static_cast<float>(repeat * num * num_queries)
+        );
+    }
+    g_checksum += checksum;
+    return best;
+}
+
+// compare FastScan with batches of 32 and 64 vectors, and scanning for one or several
+// queries at a time, on random codes
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <arg1> <arg2>\n"
+                  << "arg1: dimension (padded_dim), must be a multiple of 16\n"
+                  << "arg2: number of vectors, e.g., size of an IVF cluster, 4096 by "
+                     "default\n";
+        exit(1);
+    }
+
+    size_t dim = atoi(argv[1]);
+    size_t num = 4096;
+    if (argc > 2) {
+        num = atoi(argv[2]);
+    }
+    if (dim % 16 != 0 || num == 0) {
+        std::cerr << "dimension must be a multiple of 16\n";
+        exit(1);
+    }
+    // scan about 1G codebooks per measurement
+    size_t repeat = std::max<size_t>(1, (1UL << 30) / (num * dim / 4));
+
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> byte_dist(0, 255);
+    std::vector<uint8_t> codes(num * dim / 8);
+    for (auto& c : codes) {
+        c = static_cast<uint8_t>(byte_dist(gen));
+    }
+    std::vector<uint8_t> lut(dim * 4);
+    for (auto& l : lut) {
+        l = static_cast<uint8_t>(byte_dist(gen));
+    }
+    std::vector<uint16_t> lut16(dim * 4);
+    for (auto& l : lut16) {
+        l = static_cast<uint16_t>(byte_dist(gen) << 4);
+    }
+    std::vector<uint8_t> hc_lut(dim * 8);
+    fastscan::transfer_lut_hacc(lut16.data(), dim, hc_lut.data());
+
+    std::cout << "simd level: " << rabitqlib::simd_level_name(rabitqlib::simd_level())
+              << ", dim: " << dim << ", vectors: " << num << '\n';
+    std::cout << "kernel\twidth\tns/vector\n";
+
+    float fs32 = bench_scan<fastscan::kBatchSize, false>(codes, num, dim, lut, repeat);
+    float fs64 = bench_scan<fastscan::kWideBatchSize, false>(codes, num, dim, lut, repeat);
+    float hc32 = bench_scan<fastscan::kBatchSize, true>(codes, num, dim, hc_lut, repeat);
+    float hc64 =
+        bench_scan<fastscan::kWideBatchSize, true>(codes, num, dim, hc_lut, repeat);
+
+    std::cout << "fastscan\t32\t" << fs32 << '\n';
+    std::cout << "fastscan\t64\t" << fs64 << "\t(" << fs32 / fs64 << "x)\n";
+    std::cout << "hacc\t32\t" << hc32 << '\n';
+    std::cout << "hacc\t64\t" << hc64 << "\t(" << hc32 / hc64 << "x)\n";
+
+    // several queries scanning the same batches, e.g., a batch of queries probing the
+    // same IVF cluster
+    constexpr size_t kNumQueries = 4;
+    std::vector<std::vector<uint8_t>> luts(kNumQueries, lut);
+    std::vector<std::vector<uint8_t>> hc_luts(kNumQueries, hc_lut);
+    std::vector<const uint8_t*> lut_ptrs;
+    std::vector<const uint8_t*> hc_lut_ptrs;
+    for (size_t q = 0; q < kNumQueries; ++q) {
+        lut_ptrs.push_back(luts[q].data());
+        hc_lut_ptrs.push_back(hc_luts[q].data());
+    }
+    float fs_single = bench_multi<false>(codes, num, dim, lut_ptrs, repeat, false);
+    float fs_multi = bench_multi<false>(codes, num, dim, lut_ptrs, repeat, true);
+    float hc_single = bench_multi<true>(codes, num, dim, hc_lut_ptrs, repeat, false);
+    float hc_multi = bench_multi<true>(codes, num, dim, hc_lut_ptrs, repeat, true);
+
+    std::cout << "kernel\tqueries\tns/vector/query\n";
+    std::cout << "fastscan\t1 by 1\t" << fs_single << '\n';
+    std::cout << "fastscan\t" << kNumQueries << "\t" << fs_multi << "\t("
+              << fs_single / fs_multi << "x)\n";
+    std::cout << "hacc\t1 by 1\t" << hc_single << '\n';
+    std::cout << "hacc\t" << kNumQueries << "\t" << hc_multi << "\t("
+              << hc_single / hc_multi << "x)\n";
+    std::cout << "checksum: " << g_checksum << '\n';
+
+    return 0;
+}
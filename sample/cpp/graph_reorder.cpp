@@ -0,0 +1,133 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "rabitqlib/index/hnsw/hnsw.hpp"
+#include "rabitqlib/index/symqg/qg.hpp"
+#include "rabitqlib/utils/io.hpp"
+#include "rabitqlib/utils/perf_counter.hpp"
+#include "rabitqlib/utils/stopw.hpp"
+
+using PID = rabitqlib::PID;
+using data_type = rabitqlib::RowMajorArray<float>;
+using gt_type = rabitqlib::RowMajorArray<uint32_t>;
+
+std::vector<size_t> efs = {50, 100, 200, 400};
+size_t topk = 10;
+
+// search all queries once with each ef, print QPS, recall and cache misses per query
+template <typename SearchFunc>
+void bench(const data_type& query, const gt_type& gt, SearchFunc&& search) {
+    size_t nq = query.rows();
+    rabitqlib::PerfCounter counter;
+    rabitqlib::StopW stopw;
+
+    std::cout << "EF\tQPS\tRecall\tLLC-misses/query\n";
+    for (size_t ef : efs) {
+        std::vector<PID> results(nq * topk, rabitqlib::kPidMax);
+
+        counter.start();
+        stopw.reset();
+        for (size_t i = 0; i < nq; ++i) {
+            search(&query(i, 0), ef, &results[i * topk]);
+        }
+        float total_time = stopw.get_elapsed_micro();
+        uint64_t misses = counter.stop();
+
+        size_t total_correct = 0;
+        for (size_t i = 0; i < nq; ++i) {
+            for (size_t j = 0; j < topk; ++j) {
+                for (size_t k = 0; k < topk; ++k) {
+                    if (gt(i, k) == results[(i * topk) + j]) {
+                        total_correct++;
+                        break;
+                    }
+                }
+            }
+        }
+
+        float qps = static_cast<float>(nq) / (total_time / 1e6F);
+        float recall = static_cast<float>(total_correct) / static_cast<float>(nq * topk);
+        std::cout << ef << '\t' << qps << '\t' << recall << '\t';
+        if (counter.available()) {
+            std::cout << static_cast<double>(misses) / static_cast<double>(nq) << '\n';
+        } else {
+            std::cout << "n/a\n";
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 5) {
+        std::cerr << "Usage: " << argv[0] << " <arg1> <arg2> <arg3> <arg4> <arg5>\n"
+                  << "arg1: index type (\"qg\" or \"hnsw\")\n"
+                  << "arg2: path for index \n"
+                  << "arg3: path for query file, format .fvecs\n"
+                  << "arg4: path for groundtruth file format .ivecs\n"
+                  << "arg5: path for saving the reordered index (optional)\n";
+        exit(1);
+    }
+
+    std::string index_type(argv[1]);
+    char* index_file = argv[2];
+    char* query_file = argv[3];
+    char* gt_file = argv[4];
+
+    data_type query;
+    gt_type gt;
+    rabitqlib::load_vecs<float, data_type>(query_file, query);
+    rabitqlib::load_vecs<uint32_t, gt_type>(gt_file, gt);
+
+    rabitqlib::StopW stopw;
+
+    if (index_type == "qg") {
+        rabitqlib::symqg::QuantizedGraph<float> qg;
+        qg.load(index_file);
+        auto search = [&](const float* q, size_t ef, PID* res) {
+            qg.set_ef(ef);
+            qg.search(q, topk, res);
+        };
+
+        std::cout << "Before reorder\n";
+        bench(query, gt, search);
+
+        stopw.reset();
+        qg.reorder();
+        std::cout << "reorder time = " << stopw.get_elapsed_sec() << "s\n";
+
+        std::cout << "After reorder\n";
+        bench(query, gt, search);
+
+        if (argc > 5) {
+            qg.save(argv[5]);
+        }
+    } else if (index_type == "hnsw") {
+        rabitqlib::hnsw::HierarchicalNSW hnsw;
+        hnsw.load(index_file);
+        auto search = [&](const float* q, size_t ef, PID* res) {
+            auto knn = hnsw.search(q, 1, topk, ef, 1);
+            for (size_t j = 0; j < knn[0].size(); ++j) {
+                res[j] = knn[0][j].second;
+            }
+        };
+
+        std::cout << "Before reorder\n";
+        bench(query, gt, search);
+
+        stopw.reset();
+        hnsw.reorder();
+        std::cout << "reorder time = " << stopw.get_elapsed_sec() << "s\n";
+
+        std::cout << "After reorder\n";
+        bench(query, gt, search);
+
+        if (argc > 5) {
+            hnsw.save(argv[5]);
+        }
+    } else {
+        std::cerr << "Unknown index type " << index_type << '\n';
+        exit(1);
+    }
+
+    return 0;
+}
@@ -23,7 +23,9 @@ int main(int argc, char* argv[]) {
                   << "arg7: path for saving index\n"
                   << "arg8: metric type (\"l2\" or \"ip\"), l2 by default\n"
                   << "arg9: if use faster quantization (\"true\" or \"false\"), false by "
-                     "default\n";
+                     "default\n"
+                  << "arg10: if drop upper layers and search from cluster entries "
+                     "(\"true\" or \"false\"), false by default\n";
         exit(1);
     }
 
@@ -57,6 +59,15 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    bool drop_upper = false;
+    if (argc > 10) {
+        std::string drop_str(argv[10]);
+        if (drop_str == "true") {
+            drop_upper = true;
+            std::cout << "Dropping upper layers after indexing...\n";
+        }
+    }
+
     data_type data;
     data_type centroids;
     gt_type cluster_id;
@@ -90,6 +101,9 @@ int main(int argc, char* argv[]) {
     total_time /= 1e6;
 
     std::cout << "indexing time = " << total_time << "s" << '\n';
+    if (drop_upper) {
+        hnsw->drop_upper_layers();
+    }
     hnsw->save(index_file);
 
     std::cout << "index saved..." << '\n';
@@ -21,13 +21,47 @@ int main(int argc, char* argv[]) {
         std::cerr << "Usage: " << argv[0] << " <arg1> <arg2> <arg3>\n"
                   << "arg1: path for index \n"
                   << "arg2: path for query file, format .fvecs\n"
-                  << "arg3: path for groundtruth file format .ivecs\n";
+                  << "arg3: path for groundtruth file format .ivecs\n"
+                  << "arg4: number of nearest clusters to seed the search from, 0 (upper "
+                     "layer descent) by default\n"
+                  << "arg5: number of queries preprocessed together, 64 by default\n"
+                  << "arg6: number of queries interleaved in one thread, 1 (no "
+                     "interleaving) by default\n"
+                  << "arg7: stop if top-k is not improved for this number of expanded "
+                     "nodes, 0 (disabled) by default\n"
+                  << "arg8: 1 to stop once the nearest candidate is beyond the k-th result "
+                     "plus the estimation error, 0 by default\n"
+                  << "arg9: bits per dimension of quantized queries (1 to 8), fewer bits "
+                     "are faster and more bits rerank fewer candidates, 4 by default\n";
         exit(1);
     }
 
     char* index_file = argv[1];
     char* query_file = argv[2];
     char* gt_file = argv[3];
+    size_t num_seed_clusters = 0;
+    if (argc > 4) {
+        num_seed_clusters = atoi(argv[4]);
+    }
+    size_t query_batch_size = 64;
+    if (argc > 5) {
+        query_batch_size = atoi(argv[5]);
+    }
+    size_t num_interleave = 1;
+    if (argc > 6) {
+        num_interleave = atoi(argv[6]);
+    }
+    rabitqlib::EarlyStopParams early_stop;
+    if (argc > 7) {
+        early_stop.patience = atoi(argv[7]);
+    }
+    if (argc > 8) {
+        early_stop.error_gap = atoi(argv[8]) != 0;
+    }
+    size_t query_bits = rabitqlib::SplitSingleQuery<float>::kNumBits;
+    if (argc > 9) {
+        query_bits = atoi(argv[9]);
+    }
 
     data_type query;
     gt_type gt;
@@ -39,6 +73,10 @@ int main(int argc, char* argv[]) {
     index_type hnsw;
 
     hnsw.load(index_file);
+    hnsw.set_query_batch_size(query_batch_size);
+    hnsw.set_search_interleave(num_interleave);
+    hnsw.set_early_stop(early_stop);
+    hnsw.set_query_bits(query_bits);
 
     rabitqlib::StopW stopw;
 
@@ -48,6 +86,8 @@ int main(int argc, char* argv[]) {
 
     std::vector<std::vector<float>> all_qps(test_round, std::vector<float>(length));
     std::vector<std::vector<float>> all_recall(test_round, std::vector<float>(length));
+    std::vector<std::vector<float>> all_prep(test_round, std::vector<float>(length));
+    std::vector<std::vector<float>> all_hops(test_round, std::vector<float>(length));
 
     std::cout << "search start >.....\n";
 
@@ -57,10 +97,11 @@ int main(int argc, char* argv[]) {
             size_t total_correct = 0;
             float total_time = 0;
 
+            hnsw.reset_search_stats();
             auto start = std::chrono::high_resolution_clock::now();
 
             std::vector<std::vector<std::pair<float, PID>>> res =
-                hnsw.search(query.data(), nq, topk, ef, 1);
+                hnsw.search(query.data(), nq, topk, ef, 1, num_seed_clusters);
 
             auto end = std::chrono::high_resolution_clock::now();
 
@@ -87,16 +128,26 @@ int main(int argc, char* argv[]) {
 
             all_qps[r][i_probe] = qps;
             all_recall[r][i_probe] = recall;
+
+            const auto& stats = hnsw.search_stats();
+            all_prep[r][i_probe] = static_cast<float>(
+                100 * stats.preprocess_us / (stats.preprocess_us + stats.search_us)
+            );
+            all_hops[r][i_probe] =
+                static_cast<float>(stats.num_hops) / static_cast<float>(stats.num_queries);
         }
     }
 
     auto avg_qps = rabitqlib::horizontal_avg(all_qps);
     auto avg_recall = rabitqlib::horizontal_avg(all_recall);
+    auto avg_prep = rabitqlib::horizontal_avg(all_prep);
+    auto avg_hops = rabitqlib::horizontal_avg(all_hops);
 
-    std::cout << "EF\tQPS\tRecall\t"
+    std::cout << "EF\tQPS\tRecall\tPreprocess(%)\tHops\t"
 
                  "\n";
     for (size_t i = 0; i < avg_qps.size(); ++i) {
-        std::cout << efs[i] << '\t' << avg_qps[i] << '\t' << avg_recall[i] << '\t' << '\n';
+        std::cout << efs[i] << '\t' << avg_qps[i] << '\t' << avg_recall[i] << '\t'
+                  << avg_prep[i] << '\t' << avg_hops[i] << '\t' << '\n';
     }
 }
\ No newline at end of file
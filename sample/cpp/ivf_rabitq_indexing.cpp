@@ -21,7 +21,8 @@ int main(int argc, char** argv) {
                   << "arg5: path for saving index\n"
                   << "arg6: metric type (\"l2\" or \"ip\"), l2 by default\n"
                   << "arg7: if use faster quantization (\"true\" or \"false\"), false by "
-                     "default\n";
+                     "default\n"
+                  << "arg8: bits per dimension scanned by FastScan (1 or 2), 1 by default\n";
         exit(1);
     }
 
@@ -47,6 +48,12 @@ int main(int argc, char** argv) {
         }
     }
 
+    size_t fastscan_bits = 1;
+    if (argc > 8) {
+        fastscan_bits = atoi(argv[8]);
+        std::cout << "FastScan bits: " << fastscan_bits << '\n';
+    }
+
     char* data_file = argv[1];
     char* centroids_file = argv[2];
     char* cids_file = argv[3];
@@ -70,7 +77,15 @@ int main(int argc, char** argv) {
     std::cout << "\tDIM: " << dim << '\n';
 
     rabitqlib::StopW stopw;
-    index_type ivf(num_points, dim, k, total_bits, metric_type);
+    index_type ivf(
+        num_points,
+        dim,
+        k,
+        total_bits,
+        metric_type,
+        rabitqlib::RotatorType::FhtKacRotator,
+        fastscan_bits
+    );
     ivf.construct(data.data(), centroids.data(), cids.data(), faster_quant);
     float miniutes = stopw.get_elapsed_mili() / 1000 / 60;
     std::cout << "ivf constructed \n";
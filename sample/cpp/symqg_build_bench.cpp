@@ -0,0 +1,99 @@
+#include <iostream>
+#include <unordered_set>
+#include <vector>
+
+#include "rabitqlib/defines.hpp"
+#include "rabitqlib/index/symqg/qg.hpp"
+#include "rabitqlib/index/symqg/qg_builder.hpp"
+#include "rabitqlib/utils/io.hpp"
+#include "rabitqlib/utils/stopw.hpp"
+
+using PID = rabitqlib::PID;
+using index_type = rabitqlib::symqg::QuantizedGraph<float>;
+using data_type = rabitqlib::RowMajorArray<float>;
+using gt_type = rabitqlib::RowMajorArray<uint32_t>;
+using rabitqlib::symqg::QGInitType;
+
+std::vector<size_t> efs = {50, 100, 200, 400};
+size_t topk = 10;
+
+struct BuildConfig {
+    const char* name;
+    QGInitType init_type;
+    size_t num_iter;
+};
+
+// random init with 3 iterations is the default of QGBuilder
+std::vector<BuildConfig> configs = {
+    {"random init, 3 iters", QGInitType::RandomInit, 3},
+    {"cluster init, 2 iters", QGInitType::ClusterInit, 2},
+};
+
+// build time and search recall of qg with different build configurations
+int main(int argc, char** argv) {
+    if (argc < 6) {
+        std::cerr << "Usage: " << argv[0] << " <arg1> <arg2> <arg3> <arg4> <arg5> <arg6>\n"
+                  << "arg1: path for data file, format .fvecs\n"
+                  << "arg2: path for query file, format .fvecs\n"
+                  << "arg3: path for groundtruth file format .ivecs\n"
+                  << "arg4: degree bound for symqg, must be a multiple of 32\n"
+                  << "arg5: ef for indexing\n"
+                  << "arg6: metric type (\"l2\" or \"ip\"), l2 by default\n";
+        exit(1);
+    }
+
+    char* data_file = argv[1];
+    char* query_file = argv[2];
+    char* gt_file = argv[3];
+    size_t degree = atoi(argv[4]);
+    size_t ef_build = atoi(argv[5]);
+
+    rabitqlib::MetricType metric_type = rabitqlib::METRIC_L2;
+    if (argc > 6) {
+        std::string metric_str(argv[6]);
+        if (metric_str == "ip" || metric_str == "IP") {
+            metric_type = rabitqlib::METRIC_IP;
+        }
+    }
+
+    data_type data;
+    data_type query;
+    gt_type gt;
+    rabitqlib::load_vecs<float, data_type>(data_file, data);
+    rabitqlib::load_vecs<float, data_type>(query_file, query);
+    rabitqlib::load_vecs<uint32_t, gt_type>(gt_file, gt);
+    size_t nq = query.rows();
+
+    rabitqlib::StopW stopw;
+    for (const auto& config : configs) {
+        index_type qg(data.rows(), data.cols(), degree, metric_type);
+
+        stopw.reset();
+        {
+            rabitqlib::symqg::QGBuilder builder(qg, ef_build, data.data());
+            builder.set_init_type(config.init_type);
+            builder.build(config.num_iter);
+        }
+        float secs = stopw.get_elapsed_mili() / 1000.F;
+
+        std::cout << config.name << ": indexing time " << secs << " secs\n";
+        std::cout << "EF\tRecall\n";
+        for (size_t ef : efs) {
+            qg.set_ef(ef);
+            std::vector<PID> results(topk);
+            size_t total_correct = 0;
+            for (size_t z = 0; z < nq; ++z) {
+                qg.search(&query(z, 0), topk, results.data());
+                std::unordered_set<PID> gt_set(&gt(z, 0), &gt(z, 0) + topk);
+                for (PID id : results) {
+                    total_correct += gt_set.count(id);
+                }
+            }
+            std::cout << ef << '\t'
+                      << static_cast<float>(total_correct) / static_cast<float>(nq * topk)
+                      << '\n';
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "rabitqlib/index/symqg/qg.hpp"
+#include "rabitqlib/utils/io.hpp"
+#include "rabitqlib/utils/stopw.hpp"
+
+using PID = rabitqlib::PID;
+using data_type = rabitqlib::RowMajorArray<float>;
+using gt_type = rabitqlib::RowMajorArray<uint32_t>;
+
+std::vector<size_t> efs = {50, 100, 200, 400};
+size_t topk = 10;
+
+// search all queries once with each ef, print QPS and recall
+void bench(
+    rabitqlib::symqg::QuantizedGraph<float>& qg, const data_type& query, const gt_type& gt
+) {
+    size_t nq = query.rows();
+    rabitqlib::StopW stopw;
+
+    std::cout << "EF\tQPS\tRecall\n";
+    for (size_t ef : efs) {
+        std::vector<PID> results(nq * topk, rabitqlib::kPidMax);
+        qg.set_ef(ef);
+
+        stopw.reset();
+        for (size_t i = 0; i < nq; ++i) {
+            qg.search(&query(i, 0), topk, &results[i * topk]);
+        }
+        float total_time = stopw.get_elapsed_micro();
+
+        size_t total_correct = 0;
+        for (size_t i = 0; i < nq; ++i) {
+            for (size_t j = 0; j < topk; ++j) {
+                for (size_t k = 0; k < topk; ++k) {
+                    if (gt(i, k) == results[(i * topk) + j]) {
+                        total_correct++;
+                        break;
+                    }
+                }
+            }
+        }
+
+        float qps = static_cast<float>(nq) / (total_time / 1e6F);
+        float recall = static_cast<float>(total_correct) / static_cast<float>(nq * topk);
+        std::cout << ef << '\t' << qps << '\t' << recall << '\n';
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 5) {
+        std::cerr << "Usage: " << argv[0] << " <arg1> <arg2> <arg3> <arg4> <arg5>\n"
+                  << "arg1: path for index \n"
+                  << "arg2: path for query file, format .fvecs\n"
+                  << "arg3: path for groundtruth file format .ivecs\n"
+                  << "arg4: storage type of raw vectors (\"fp16\", \"bf16\" or \"int8\")\n"
+                  << "arg5: path for saving the compressed index (optional)\n";
+        exit(1);
+    }
+
+    char* index_file = argv[1];
+    char* query_file = argv[2];
+    char* gt_file = argv[3];
+    std::string type_name(argv[4]);
+
+    rabitqlib::RawDataType type;
+    if (type_name == "fp16") {
+        type = rabitqlib::RAW_FP16;
+    } else if (type_name == "bf16") {
+        type = rabitqlib::RAW_BF16;
+    } else if (type_name == "int8") {
+        type = rabitqlib::RAW_INT8;
+    } else {
+        std::cerr << "Unknown storage type " << type_name << '\n';
+        exit(1);
+    }
+
+    data_type query;
+    gt_type gt;
+    rabitqlib::load_vecs<float, data_type>(query_file, query);
+    rabitqlib::load_vecs<uint32_t, gt_type>(gt_file, gt);
+
+    rabitqlib::symqg::QuantizedGraph<float> qg;
+    qg.load(index_file);
+
+    std::cout << "Before compression\n";
+    bench(qg, query, gt);
+
+    rabitqlib::StopW stopw;
+    qg.compress_raw_vectors(type);
+    std::cout << "compression time = " << stopw.get_elapsed_sec() << "s\n";
+
+    std::cout << "After compression (" << type_name << ")\n";
+    bench(qg, query, gt);
+
+    if (argc > 5) {
+        qg.save(argv[5]);
+    }
+
+    return 0;
+}
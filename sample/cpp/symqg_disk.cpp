@@ -0,0 +1,87 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "rabitqlib/index/symqg/qg.hpp"
+#include "rabitqlib/index/symqg/qg_disk.hpp"
+#include "rabitqlib/utils/io.hpp"
+#include "rabitqlib/utils/stopw.hpp"
+
+using PID = rabitqlib::PID;
+using data_type = rabitqlib::RowMajorArray<float>;
+using gt_type = rabitqlib::RowMajorArray<uint32_t>;
+
+std::vector<size_t> efs = {50, 100, 200, 400};
+std::vector<size_t> beam_widths = {1, 4, 8};
+size_t topk = 10;
+
+int main(int argc, char* argv[]) {
+    if (argc < 5) {
+        std::cerr << "Usage: " << argv[0] << " <arg1> <arg2> <arg3> <arg4> <arg5>\n"
+                  << "arg1: path for in-memory index \n"
+                  << "arg2: path for disk index\n"
+                  << "arg3: path for query file, format .fvecs\n"
+                  << "arg4: path for groundtruth file format .ivecs\n"
+                  << "arg5: num of vectors in the navigation graph (optional, default "
+                     "1% of the data)\n";
+        exit(1);
+    }
+
+    char* index_file = argv[1];
+    char* disk_file = argv[2];
+    char* query_file = argv[3];
+    char* gt_file = argv[4];
+
+    {
+        rabitqlib::symqg::QuantizedGraph<float> qg;
+        qg.load(index_file);
+        size_t num_nav = qg.num_vertices() / 100;
+        if (argc > 5) {
+            num_nav = std::stoull(argv[5]);
+        }
+        rabitqlib::symqg::DiskQuantizedGraph<float>::save(qg, disk_file, num_nav);
+    }
+
+    data_type query;
+    gt_type gt;
+    rabitqlib::load_vecs<float, data_type>(query_file, query);
+    rabitqlib::load_vecs<uint32_t, gt_type>(gt_file, gt);
+    size_t nq = query.rows();
+
+    rabitqlib::symqg::DiskQuantizedGraph<float> disk_qg;
+    disk_qg.load(disk_file);
+
+    rabitqlib::StopW stopw;
+    std::vector<PID> results(nq * topk);
+
+    std::cout << "Beam\tEF\tQPS\tRecall\tReads/query\n";
+    for (size_t beam_width : beam_widths) {
+        for (size_t ef : efs) {
+            stopw.reset();
+            size_t num_reads = disk_qg.search_batch(
+                query.data(), nq, topk, ef, beam_width, 1, results.data()
+            );
+            float total_time = stopw.get_elapsed_micro();
+
+            size_t total_correct = 0;
+            for (size_t i = 0; i < nq; ++i) {
+                for (size_t j = 0; j < topk; ++j) {
+                    for (size_t k = 0; k < topk; ++k) {
+                        if (gt(i, k) == results[(i * topk) + j]) {
+                            total_correct++;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            float qps = static_cast<float>(nq) / (total_time / 1e6F);
+            float recall =
+                static_cast<float>(total_correct) / static_cast<float>(nq * topk);
+            std::cout << beam_width << '\t' << ef << '\t' << qps << '\t' << recall << '\t'
+                      << static_cast<double>(num_reads) / static_cast<double>(nq) << '\n';
+        }
+    }
+
+    return 0;
+}
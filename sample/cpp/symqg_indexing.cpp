@@ -3,8 +3,10 @@
 #include "rabitqlib/defines.hpp"
 #include "rabitqlib/index/symqg/qg.hpp"
 #include "rabitqlib/index/symqg/qg_builder.hpp"
+#include "rabitqlib/index/symqg/qg_partition_builder.hpp"
 #include "rabitqlib/utils/io.hpp"
 #include "rabitqlib/utils/stopw.hpp"
+#include "rabitqlib/utils/tools.hpp"
 
 using PID = rabitqlib::PID;
 using index_type = rabitqlib::symqg::QuantizedGraph<float>;
@@ -18,7 +20,11 @@ int main(int argc, char** argv) {
                   << "arg2: degree bound for symqg, must be a multiple of 32\n"
                   << "arg3: ef for indexing \n"
                   << "arg4: path for saving index\n"
-                  << "arg5: metric type (\"l2\" or \"ip\"), l2 by default\n";
+                  << "arg5: metric type (\"l2\" or \"ip\"), l2 by default\n"
+                  << "arg6: num of ex-bits in codes of neighbors (0-8), 0 by default\n"
+                  << "arg7: path for centroids of partitions, format .fvecs (optional, "
+                     "build partition by partition if given)\n"
+                  << "arg8: num of partitions each vector is assigned to, 2 by default\n";
         exit(1);
     }
 
@@ -40,22 +46,41 @@ int main(int argc, char** argv) {
         std::cout << "Metric Type: L2\n";
     }
 
+    size_t ex_bits = argc > 6 ? atoi(argv[6]) : 0;
+
     data_type data;
 
     rabitqlib::load_vecs<float, data_type>(data_file, data);
 
     rabitqlib::StopW stopw;
 
-    index_type qg(data.rows(), data.cols(), degree, metric_type);
+    index_type qg(
+        data.rows(),
+        data.cols(),
+        degree,
+        metric_type,
+        rabitqlib::RotatorType::FhtKacRotator,
+        ex_bits
+    );
+
+    if (argc > 7) {
+        data_type centroids;
+        rabitqlib::load_vecs<float, data_type>(argv[7], centroids);
+        size_t overlap = argc > 8 ? atoi(argv[8]) : 2;
 
-    rabitqlib::symqg::QGBuilder builder(qg, ef, data.data());
+        rabitqlib::symqg::QGPartitionBuilder builder(qg, ef, data.data(), overlap);
+        builder.build(centroids.data(), centroids.rows());
+    } else {
+        rabitqlib::symqg::QGBuilder builder(qg, ef, data.data());
 
-    // 3 iters, refine at last iter
-    builder.build();
+        // 3 iters, refine at last iter
+        builder.build();
+    }
 
     auto milisecs = stopw.get_elapsed_mili();
 
     std::cout << "Indexing time " << milisecs / 1000.F << " secs\n";
+    std::cout << "Peak RSS " << rabitqlib::peak_rss_bytes() / (1024 * 1024) << " MB\n";
 
     qg.save(index_file);
 
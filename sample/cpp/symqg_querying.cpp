@@ -1,4 +1,6 @@
 #include <iostream>
+#include <numeric>
+#include <thread>
 
 #include "rabitqlib/defines.hpp"
 #include "rabitqlib/index/symqg/qg.hpp"
@@ -15,19 +17,32 @@ std::vector<size_t> efs = {
 };
 size_t test_round = 3;
 size_t topk = 10;
+size_t scaling_ef = 100;  // ef used for reporting multi-thread scaling
 
 int main(int argc, char** argv) {
-    if (argc != 4) {
-        std::cerr << "Usage: " << argv[0] << " <arg1> <arg2> <arg3>\n"
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <arg1> ... <arg7>\n"
                   << "arg1: path for index \n"
                   << "arg2: path for query file, format .fvecs\n"
-                  << "arg3: path for groundtruth file format .ivecs\n";
+                  << "arg3: path for groundtruth file format .ivecs\n"
+                  << "arg4: number of queries interleaved in one thread, 1 (no "
+                     "interleaving) by default\n"
+                  << "arg5: 0 to search only with estimated distances (requires an index "
+                     "with ex-bits codes), 1 (use raw vectors) by default\n"
+                  << "arg6: stop if top-k is not improved for this number of expanded "
+                     "vertices, 0 (disabled) by default\n"
+                  << "arg7: 1 to stop once the nearest candidate is beyond the k-th result "
+                     "plus the estimation error, 0 by default\n";
         exit(1);
     }
 
     char* index_file = argv[1];
     char* query_file = argv[2];
     char* gt_file = argv[3];
+    size_t num_interleave = 1;
+    if (argc > 4) {
+        num_interleave = atoi(argv[4]);
+    }
 
     data_type query;
     gt_type gt;
@@ -38,11 +53,23 @@ int main(int argc, char** argv) {
 
     index_type qg;
     qg.load(index_file);
+    if (argc > 5) {
+        qg.set_use_raw_dist(atoi(argv[5]) != 0);
+    }
+    rabitqlib::EarlyStopParams early_stop;
+    if (argc > 6) {
+        early_stop.patience = atoi(argv[6]);
+    }
+    if (argc > 7) {
+        early_stop.error_gap = atoi(argv[7]) != 0;
+    }
+    qg.set_early_stop(early_stop);
 
     rabitqlib::StopW stopw;
 
     std::vector<std::vector<float>> all_qps(test_round, std::vector<float>(efs.size()));
     std::vector<std::vector<float>> all_recall(test_round, std::vector<float>(efs.size()));
+    std::vector<std::vector<float>> all_hops(test_round, std::vector<float>(efs.size()));
 
     for (size_t r = 0; r < test_round; r++) {
         for (size_t i = 0; i < efs.size(); ++i) {
@@ -50,14 +77,27 @@ int main(int argc, char** argv) {
             size_t total_correct = 0;
             float total_time = 0;
             qg.set_ef(ef);
-            std::vector<PID> results(topk);
-            for (size_t z = 0; z < nq; z++) {
+            std::vector<PID> results(nq * topk);
+            std::vector<uint32_t> hops(nq);
+            if (num_interleave > 1) {
                 stopw.reset();
-                qg.search(&query(z, 0), topk, results.data());
+                qg.search_interleaved(
+                    query.data(), nq, topk, results.data(), num_interleave, hops.data()
+                );
                 total_time += stopw.get_elapsed_micro();
+            } else {
+                for (size_t z = 0; z < nq; z++) {
+                    stopw.reset();
+                    hops[z] = qg.search(&query(z, 0), topk, &results[z * topk]);
+                    total_time += stopw.get_elapsed_micro();
+                }
+            }
+            double total_hops = std::accumulate(hops.begin(), hops.end(), 0.0);
+            all_hops[r][i] = static_cast<float>(total_hops / static_cast<double>(nq));
+            for (size_t z = 0; z < nq; z++) {
                 for (size_t y = 0; y < topk; y++) {
                     for (size_t k = 0; k < topk; k++) {
-                        if (gt(z, k) == results[y]) {
+                        if (gt(z, k) == results[(z * topk) + y]) {
                             total_correct++;
                             break;
                         }
@@ -75,10 +115,38 @@ int main(int argc, char** argv) {
 
     auto avg_qps = rabitqlib::horizontal_avg(all_qps);
     auto avg_recall = rabitqlib::horizontal_avg(all_recall);
+    auto avg_hops = rabitqlib::horizontal_avg(all_hops);
 
-    std::cout << "EF\tQPS\tRecall\n";
+    std::cout << "EF\tQPS\tRecall\tHops\n";
     for (size_t i = 0; i < avg_qps.size(); ++i) {
-        std::cout << efs[i] << '\t' << avg_qps[i] << '\t' << avg_recall[i] << '\n';
+        std::cout << efs[i] << '\t' << avg_qps[i] << '\t' << avg_recall[i] << '\t'
+                  << avg_hops[i] << '\n';
+    }
+
+    // QPS of search_batch from 1 thread to all cores
+    size_t max_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    std::vector<size_t> thread_nums;
+    for (size_t t = 1; t < max_threads; t *= 2) {
+        thread_nums.push_back(t);
+    }
+    thread_nums.push_back(max_threads);
+
+    std::cout << "\nThreads\tQPS\tSpeedup (ef = " << scaling_ef << ")\n";
+    std::vector<PID> results(nq * topk);
+    float base_qps = 0;
+    for (size_t num_threads : thread_nums) {
+        float best_qps = 0;
+        for (size_t r = 0; r < test_round; r++) {
+            stopw.reset();
+            qg.search_batch(query.data(), nq, topk, scaling_ef, num_threads, results.data());
+            float qps = static_cast<float>(nq) / (stopw.get_elapsed_micro() / 1e6F);
+            best_qps = std::max(best_qps, qps);
+        }
+        if (num_threads == 1) {
+            base_qps = best_qps;
+        }
+        std::cout << num_threads << '\t' << best_qps << '\t' << (best_qps / base_qps)
+                  << '\n';
     }
 
     return 0;
@@ -9,7 +9,10 @@ from utils import read_fvecs
 MAX_DEGREE      = 32            # degree bound for SymphonyQG
 EF_CONSTRUCTION = 200           # ef for indexing
 METRIC          = "l2"          # "l2" or "ip"
+EX_BITS         = 0             # ex-bits in codes of neighbors (0-8)
 NUM_THREADS     = 1             # number of threads for build
+INIT            = "random"      # graph initialization, "random" or "cluster"
+NUM_ITER        = 3             # max num of build iterations
 # ──────────────────────────────────────────────
 
 
@@ -21,12 +24,14 @@ def main(args=None) -> None:
     # 3. Build SymphonyQG index
     n, dim = data.shape
     print(f"\nBuilding SymphonyQG index: n={n}, dim={dim}, MaxDegree={args.max_degree}, "
-          f"ef={args.ef_construction}, metric={args.metric}")
+          f"ef={args.ef_construction}, metric={args.metric}, ex_bits={args.ex_bits}, "
+          f"init={args.init}, num_iter={args.num_iter}")
 
-    idx = SymqgIndex(dim=dim, max_degree=args.max_degree, metric=args.metric)
+    idx = SymqgIndex(dim=dim, max_degree=args.max_degree, metric=args.metric, ex_bits=args.ex_bits)
     
     t0 = time()
-    idx.build(data, ef_construction=args.ef_construction, num_threads=args.num_threads)
+    idx.build(data, ef_construction=args.ef_construction, num_threads=args.num_threads,
+              init=args.init, num_iter=args.num_iter, min_change_rate=args.min_change_rate)
     print(f"Indexing time: {time() - t0:.2f}s")
 
     idx.save(args.index_file)
@@ -40,7 +45,11 @@ if __name__ == "__main__":
     parser.add_argument("--max-degree", dest="max_degree", type=int, metavar="INT", default=MAX_DEGREE, help="Degree bound for SymphonyQG")
     parser.add_argument("--ef-construction", dest="ef_construction", type=int, metavar="INT", default=EF_CONSTRUCTION, help="EF parameter for index construction")
     parser.add_argument("--metric", dest="metric", type=str, default=METRIC, choices=["l2", "ip"], help="Distance metric (l2 or ip)")
+    parser.add_argument("--ex-bits", dest="ex_bits", type=int, metavar="INT", default=EX_BITS, help="Number of ex-bits in codes of neighbors (0-8)")
     parser.add_argument("--num-threads", dest="num_threads", type=int, metavar="INT", default=NUM_THREADS, help="Number of threads for building the index")
+    parser.add_argument("--init", dest="init", type=str, default=INIT, choices=["random", "cluster"], help="Graph initialization (random or cluster)")
+    parser.add_argument("--num-iter", dest="num_iter", type=int, metavar="INT", default=NUM_ITER, help="Max number of build iterations (at least 2)")
+    parser.add_argument("--min-change-rate", dest="min_change_rate", type=float, metavar="FLOAT", default=0.0, help="Stop iterating early once fewer edges than this fraction change")
 
     args = parser.parse_args()
     main(args)
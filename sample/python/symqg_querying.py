@@ -35,7 +35,8 @@ def main(args=None) -> None:
     for i_probe, ef in enumerate(EFS):
         for r in range(args.test_rounds):
             t0 = time()
-            ids, _ = idx.search(queries, k=args.topk, ef=ef, num_threads=args.num_threads)
+            ids, _ = idx.search(queries, k=args.topk, ef=ef, num_threads=args.num_threads,
+                                use_raw_dist=not args.no_raw_dist)
             elapsed = time() - t0  # seconds
 
             qps    = nq / elapsed
@@ -62,6 +63,7 @@ if __name__ == "__main__":
     parser.add_argument("--metric", dest="metric", type=str, default=METRIC, choices=["l2", "ip"], help="Distance metric (l2 or ip)")
     parser.add_argument("--topk", dest="topk", type=int, metavar="INT", default=TOPK, help="Number of top-k results to retrieve")
     parser.add_argument("--num-threads", dest="num_threads", type=int, metavar="INT", default=NUM_THREADS, help="Number of threads for searching")
+    parser.add_argument("--no-raw-dist", dest="no_raw_dist", action="store_true", help="Search only with estimated distances (index must have ex-bits codes)")
     parser.add_argument("--test-rounds", dest="test_rounds", type=int, metavar="INT", default=TEST_ROUNDS, help="Number of test rounds to average results")
     args = parser.parse_args()
     main(args)
@@ -0,0 +1,61 @@
+#ifndef RABITQ_BATCH_HELPERS_HPP
+#define RABITQ_BATCH_HELPERS_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include <rabitqlib/index/estimator.hpp>
+#include <rabitqlib/index/query.hpp>
+#include <rabitqlib/quantization/data_layout.hpp>
+#include <rabitqlib/quantization/rabitq.hpp>
+
+#include "test_data.hpp"
+
+namespace rabitq_test {
+
+// num Gaussian vectors of dim dims, stored row by row
+inline std::vector<float> GenerateGaussianVectors(
+    size_t num, size_t dim, unsigned int seed, float stddev = 1.0f
+) {
+    return TestDataGenerator::GenerateGaussianVector(num * dim, 0.0f, stddev, seed);
+}
+
+// Estimated distances, lower bounds and inner products of one FastScan batch
+struct BatchEstimates {
+    std::vector<float> est;
+    std::vector<float> low;
+    std::vector<float> ip;
+
+    explicit BatchEstimates(size_t size) : est(size), low(size), ip(size) {}
+};
+
+// Quantize num (<= kWidth) vectors into one batch of 1-bit FastScan codes
+template <size_t kWidth = rabitqlib::fastscan::kBatchSize>
+inline std::vector<char> QuantizeBatch(
+    const float* data, const float* centroid, size_t num, size_t padded_dim
+) {
+    std::vector<char> batch(rabitqlib::BatchDataMap<float, kWidth>::data_bytes(padded_dim));
+    rabitqlib::quant::quantize_one_batch<float, false, kWidth>(
+        data, centroid, num, padded_dim, batch.data()
+    );
+    return batch;
+}
+
+// Estimate the distances of a query to one batch by split_batch_estdist
+template <size_t kWidth = rabitqlib::fastscan::kBatchSize>
+inline BatchEstimates EstimateBatch(
+    const char* batch,
+    const rabitqlib::SplitBatchQuery<float>& q_obj,
+    size_t padded_dim,
+    bool use_hacc
+) {
+    BatchEstimates res(kWidth);
+    rabitqlib::split_batch_estdist<kWidth>(
+        batch, q_obj, padded_dim, res.est.data(), res.low.data(), res.ip.data(), use_hacc
+    );
+    return res;
+}
+
+}  // namespace rabitq_test
+
+#endif  // RABITQ_BATCH_HELPERS_HPP
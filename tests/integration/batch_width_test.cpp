@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include <rabitqlib/index/query.hpp>
+#include <vector>
+
+#include "batch_helpers.hpp"
+
+using namespace rabitqlib;
+using rabitq_test::EstimateBatch;
+using rabitq_test::GenerateGaussianVectors;
+using rabitq_test::QuantizeBatch;
+
+// A batch of 64 vectors must give the same estimated distances as two batches of 32.
+static void check_wide_batch(size_t padded_dim, bool use_hacc) {
+    constexpr size_t kNarrow = fastscan::kBatchSize;
+    constexpr size_t kWide = fastscan::kWideBatchSize;
+    const size_t num = kWide - 5;  // a partial batch
+
+    auto data = GenerateGaussianVectors(num, padded_dim, padded_dim);
+    auto centroid = GenerateGaussianVectors(1, padded_dim, padded_dim + 1, 0.1F);
+    auto query = GenerateGaussianVectors(1, padded_dim, padded_dim + 2);
+
+    std::vector<std::vector<char>> narrow = {
+        QuantizeBatch<kNarrow>(data.data(), centroid.data(), kNarrow, padded_dim),
+        QuantizeBatch<kNarrow>(
+            data.data() + (kNarrow * padded_dim), centroid.data(), num - kNarrow, padded_dim
+        )
+    };
+    auto wide = QuantizeBatch<kWide>(data.data(), centroid.data(), num, padded_dim);
+
+    SplitBatchQuery<float> q_obj(query.data(), padded_dim, 0, METRIC_L2, use_hacc);
+    q_obj.set_g_add(1.5F);
+
+    auto res_wide = EstimateBatch<kWide>(wide.data(), q_obj, padded_dim, use_hacc);
+    for (size_t b = 0; b < 2; ++b) {
+        auto res = EstimateBatch<kNarrow>(narrow[b].data(), q_obj, padded_dim, use_hacc);
+        for (size_t i = 0; i < kNarrow && (b * kNarrow) + i < num; ++i) {
+            size_t j = (b * kNarrow) + i;
+            EXPECT_FLOAT_EQ(res.est[i], res_wide.est[j])
+                << "dim " << padded_dim << " vector " << j;
+            EXPECT_FLOAT_EQ(res.low[i], res_wide.low[j])
+                << "dim " << padded_dim << " vector " << j;
+            EXPECT_FLOAT_EQ(res.ip[i], res_wide.ip[j])
+                << "dim " << padded_dim << " vector " << j;
+        }
+    }
+}
+
+TEST(BatchWidth, wide_batch_matches_narrow_batches) {
+    // 1280 goes through the chunked accumulation of split_batch_estdist
+    for (size_t padded_dim : {64, 256, 768, 1280}) {
+        check_wide_batch(padded_dim, false);
+        check_wide_batch(padded_dim, true);
+    }
+}
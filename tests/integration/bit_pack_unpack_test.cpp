@@ -11,6 +11,8 @@ class BitPackUnpackTest : public ::testing::Test {
 protected:
     // 1. Shared Constants & Data Structures
     const size_t dim = 768;
+    // SIMD kernels sum the products in another order, the error grows with the sum
+    const float kRelTolerance = 1e-6F;
     std::vector<float> query;
     std::vector<uint8_t> code;
     std::vector<uint8_t> compact_code;
@@ -65,7 +67,8 @@ TEST_F(BitPackUnpackTest, ExCode1Bit) {
         query.data(), compact_code.data(), dim
     );
 
-    ASSERT_NEAR(CalculateExpected(), result, 0.1);
+    float expected = CalculateExpected();
+    ASSERT_NEAR(expected, result, kRelTolerance * std::abs(expected));
 }
 
 TEST_F(BitPackUnpackTest, ExCode2Bit) {
@@ -76,7 +79,8 @@ TEST_F(BitPackUnpackTest, ExCode2Bit) {
         query.data(), compact_code.data(), dim
     );
 
-    ASSERT_NEAR(CalculateExpected(), result, 0.1);
+    float expected = CalculateExpected();
+    ASSERT_NEAR(expected, result, kRelTolerance * std::abs(expected));
 }
 
 TEST_F(BitPackUnpackTest, ExCode3Bit) {
@@ -87,7 +91,8 @@ TEST_F(BitPackUnpackTest, ExCode3Bit) {
         query.data(), compact_code.data(), dim
     );
 
-    ASSERT_NEAR(CalculateExpected(), result, 0.1);
+    float expected = CalculateExpected();
+    ASSERT_NEAR(expected, result, kRelTolerance * std::abs(expected));
 }
 
 TEST_F(BitPackUnpackTest, ExCode4Bit) {
@@ -98,7 +103,8 @@ TEST_F(BitPackUnpackTest, ExCode4Bit) {
         query.data(), compact_code.data(), dim
     );
 
-    ASSERT_NEAR(CalculateExpected(), result, 0.1);
+    float expected = CalculateExpected();
+    ASSERT_NEAR(expected, result, kRelTolerance * std::abs(expected));
 }
 
 TEST_F(BitPackUnpackTest, ExCode5Bit) {
@@ -109,7 +115,8 @@ TEST_F(BitPackUnpackTest, ExCode5Bit) {
         query.data(), compact_code.data(), dim
     );
 
-    ASSERT_NEAR(CalculateExpected(), result, 0.1);
+    float expected = CalculateExpected();
+    ASSERT_NEAR(expected, result, kRelTolerance * std::abs(expected));
 }
 
 TEST_F(BitPackUnpackTest, ExCode6Bit) {
@@ -120,7 +127,8 @@ TEST_F(BitPackUnpackTest, ExCode6Bit) {
         query.data(), compact_code.data(), dim
     );
 
-    ASSERT_NEAR(CalculateExpected(), result, 0.1);
+    float expected = CalculateExpected();
+    ASSERT_NEAR(expected, result, kRelTolerance * std::abs(expected));
 }
 
 TEST_F(BitPackUnpackTest, ExCode7Bit) {
@@ -131,7 +139,8 @@ TEST_F(BitPackUnpackTest, ExCode7Bit) {
         query.data(), compact_code.data(), dim
     );
 
-    ASSERT_NEAR(CalculateExpected(), result, 0.1);
+    float expected = CalculateExpected();
+    ASSERT_NEAR(expected, result, kRelTolerance * std::abs(expected));
 }
 
 
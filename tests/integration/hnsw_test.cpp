@@ -0,0 +1,248 @@
+#include <gtest/gtest.h>
+#include <rabitqlib/index/hnsw/hnsw.hpp>
+#include <rabitqlib/utils/space.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "batch_helpers.hpp"
+
+using namespace rabitqlib;
+using rabitq_test::GenerateGaussianVectors;
+
+namespace {
+
+constexpr size_t kNum = 2000;
+constexpr size_t kDim = 64;
+constexpr size_t kNumClusters = 16;
+constexpr size_t kM = 16;
+constexpr size_t kEfConstruction = 100;
+constexpr size_t kNumQueries = 50;
+constexpr size_t kTopk = 10;
+constexpr size_t kEf = 100;
+
+using SearchResults = std::vector<std::vector<std::pair<float, PID>>>;
+
+// Data vectors, every (kNum / kNumClusters)-th vector as a centroid and the nearest
+// centroid of each vector as its cluster id
+struct HnswData {
+    std::vector<float> data = GenerateGaussianVectors(kNum, kDim, 41);
+    std::vector<float> centroids;
+    std::vector<PID> cluster_ids;
+
+    HnswData() : centroids(kNumClusters * kDim), cluster_ids(kNum) {
+        for (size_t c = 0; c < kNumClusters; ++c) {
+            std::copy_n(
+                &data[c * (kNum / kNumClusters) * kDim], kDim, &centroids[c * kDim]
+            );
+        }
+        for (size_t i = 0; i < kNum; ++i) {
+            float best = std::numeric_limits<float>::max();
+            for (PID c = 0; c < kNumClusters; ++c) {
+                float dist = euclidean_sqr(&data[i * kDim], &centroids[c * kDim], kDim);
+                if (dist < best) {
+                    best = dist;
+                    cluster_ids[i] = c;
+                }
+            }
+        }
+    }
+
+    void build(hnsw::HierarchicalNSW& index) {
+        index.construct(
+            kNumClusters, centroids.data(), kNum, data.data(), cluster_ids.data(), 1, false
+        );
+    }
+};
+
+SearchResults search(
+    hnsw::HierarchicalNSW& index, const std::vector<float>& queries, size_t num_seeds = 0
+) {
+    return index.search(queries.data(), kNumQueries, kTopk, kEf, 1, num_seeds);
+}
+
+std::vector<PID> labels(const SearchResults& results) {
+    std::vector<PID> ids;
+    for (const auto& res : results) {
+        for (const auto& [dist, id] : res) {
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+template <typename V>
+V read_field(const std::string& bytes, size_t& pos) {
+    V value;
+    std::memcpy(&value, bytes.data() + pos, sizeof(V));
+    pos += sizeof(V);
+    return value;
+}
+
+// Rewrite an index saved by HierarchicalNSW::save() with the upper-level link lists of
+// each element preceded by their size, the layout before they were saved as one block
+void rewrite_in_old_layout(const std::string& filename) {
+    std::string bytes;
+    {
+        std::ifstream input(filename, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(input), {});
+    }
+
+    size_t pos = 0;
+    read_field<size_t>(bytes, pos);  // max_elements_
+    auto num = read_field<size_t>(bytes, pos);
+    read_field<size_t>(bytes, pos);  // dim_
+    auto padded_dim = read_field<size_t>(bytes, pos);
+    auto num_cluster = read_field<size_t>(bytes, pos);
+    read_field<size_t>(bytes, pos);  // ex_bits_
+    read_field<MetricType>(bytes, pos);
+    pos += 5 * sizeof(size_t);  // sizes and offsets of codes and level-0 links
+    read_field<PID>(bytes, pos);  // label_offset_
+    auto size_data_per_element = read_field<size_t>(bytes, pos);
+    auto size_links_per_element = read_field<size_t>(bytes, pos);
+    read_field<int>(bytes, pos);  // maxlevel_
+    read_field<PID>(bytes, pos);  // enterpoint_node_
+    pos += 3 * sizeof(size_t) + sizeof(double) + sizeof(size_t);  // M, mult, ef
+    pos += (num_cluster * padded_dim * sizeof(float)) + (num * size_data_per_element);
+    std::string old_bytes = bytes.substr(0, pos);
+
+    ASSERT_EQ(read_field<unsigned int>(bytes, pos), 0xFFFFFFFF);
+    std::vector<int> levels(num);
+    std::memcpy(levels.data(), bytes.data() + pos, num * sizeof(int));
+    pos += num * sizeof(int);
+    auto upper_bytes = read_field<size_t>(bytes, pos);
+
+    for (size_t i = 0; i < num; ++i) {
+        auto size = static_cast<unsigned int>(size_links_per_element * levels[i]);
+        old_bytes.append(reinterpret_cast<const char*>(&size), sizeof(unsigned int));
+        old_bytes.append(bytes, pos, size);
+        pos += size;
+        upper_bytes -= size;
+    }
+    ASSERT_EQ(upper_bytes, 0);
+    old_bytes.append(bytes, pos, std::string::npos);
+
+    std::ofstream output(filename, std::ios::binary);
+    output.write(old_bytes.data(), static_cast<std::streamsize>(old_bytes.size()));
+}
+
+}  // namespace
+
+// An index saved and loaded back must give the same results, from the global entry point
+// and from cluster entries.
+TEST(HNSW, save_load_search) {
+    HnswData input;
+    auto queries = GenerateGaussianVectors(kNumQueries, kDim, 43);
+    std::string filename = ::testing::TempDir() + "hnsw_round_trip.idx";
+
+    hnsw::HierarchicalNSW index(kNum, kDim, 5, kM, kEfConstruction);
+    input.build(index);
+    index.save(filename.c_str());
+    hnsw::HierarchicalNSW loaded;
+    loaded.load(filename.c_str());
+    std::remove(filename.c_str());
+
+    EXPECT_TRUE(loaded.has_cluster_entries());
+    EXPECT_EQ(search(loaded, queries), search(index, queries));
+    EXPECT_EQ(search(loaded, queries, 4), search(index, queries, 4));
+}
+
+// An index saved with one size and link list per element must still be loadable.
+TEST(HNSW, load_old_layout) {
+    HnswData input;
+    auto queries = GenerateGaussianVectors(kNumQueries, kDim, 47);
+    std::string filename = ::testing::TempDir() + "hnsw_old_layout.idx";
+
+    hnsw::HierarchicalNSW index(kNum, kDim, 5, kM, kEfConstruction);
+    input.build(index);
+    index.save(filename.c_str());
+    rewrite_in_old_layout(filename);
+    hnsw::HierarchicalNSW loaded;
+    loaded.load(filename.c_str());
+    std::remove(filename.c_str());
+
+    EXPECT_EQ(search(loaded, queries), search(index, queries));
+}
+
+// Reordering permutes internal ids only, so every query must return the same labels.
+TEST(HNSW, reorder_keeps_results) {
+    HnswData input;
+    auto queries = GenerateGaussianVectors(kNumQueries, kDim, 53);
+
+    hnsw::HierarchicalNSW index(kNum, kDim, 5, kM, kEfConstruction);
+    input.build(index);
+    auto before = labels(search(index, queries));
+    auto seeded_before = labels(search(index, queries, 4));
+    index.reorder();
+
+    EXPECT_EQ(labels(search(index, queries)), before);
+    EXPECT_EQ(labels(search(index, queries, 4)), seeded_before);
+}
+
+// Labels index the dense label lookup, so a label >= max_elements must be rejected.
+TEST(HNSW, label_out_of_range) {
+    HnswData input;
+    hnsw::HierarchicalNSW index(kNum - 1, kDim, 5, kM, kEfConstruction);
+    EXPECT_THROW(input.build(index), std::runtime_error);
+}
+
+// Seeded from the entries of the nearest clusters, a search needs no upper layers: after
+// dropping them, it must find the top-k about as well as a search through them.
+TEST(HNSW, seed_from_clusters) {
+    HnswData input;
+    auto queries = GenerateGaussianVectors(kNumQueries, kDim, 59);
+
+    hnsw::HierarchicalNSW index(kNum, kDim, 5, kM, kEfConstruction);
+    input.build(index);
+    ASSERT_TRUE(index.has_cluster_entries());
+
+    auto num_hits = [&](const SearchResults& results) {
+        size_t hits = 0;
+        for (size_t q = 0; q < kNumQueries; ++q) {
+            std::vector<std::pair<float, PID>> dists(kNum);
+            for (PID i = 0; i < kNum; ++i) {
+                dists[i] = {
+                    euclidean_sqr(&queries[q * kDim], &input.data[i * kDim], kDim), i
+                };
+            }
+            std::partial_sort(dists.begin(), dists.begin() + kTopk, dists.end());
+            for (const auto& [dist, id] : results[q]) {
+                hits += static_cast<size_t>(std::any_of(
+                    dists.begin(),
+                    dists.begin() + kTopk,
+                    [id = id](const auto& gt) { return gt.second == id; }
+                ));
+            }
+        }
+        return hits;
+    };
+
+    size_t hierarchy_hits = num_hits(search(index, queries));
+    EXPECT_GE(hierarchy_hits, kNumQueries * kTopk * 8 / 10);
+    index.drop_upper_layers();
+    size_t seeded_hits = num_hits(search(index, queries, 4));
+    EXPECT_GE(seeded_hits, hierarchy_hits * 95 / 100);
+}
+
+// Queries are pre-processed in batches and searched in parallel, neither of which may
+// change the labels returned for a query (distances to centroids by GEMMs of other sizes
+// may differ in the last bit).
+TEST(HNSW, search_batches_and_threads) {
+    HnswData input;
+    auto queries = GenerateGaussianVectors(kNumQueries, kDim, 61);
+
+    hnsw::HierarchicalNSW index(kNum, kDim, 5, kM, kEfConstruction);
+    input.build(index);
+    auto expected = labels(search(index, queries));
+
+    index.set_query_batch_size(7);
+    EXPECT_EQ(labels(search(index, queries)), expected);
+    EXPECT_EQ(labels(index.search(queries.data(), kNumQueries, kTopk, kEf, 3)), expected);
+}
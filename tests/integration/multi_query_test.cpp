@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include <rabitqlib/index/estimator.hpp>
+#include <rabitqlib/index/query.hpp>
+#include <memory>
+#include <vector>
+
+#include "batch_helpers.hpp"
+
+using namespace rabitqlib;
+using rabitq_test::BatchEstimates;
+using rabitq_test::EstimateBatch;
+using rabitq_test::GenerateGaussianVectors;
+using rabitq_test::QuantizeBatch;
+
+// Scanning a batch for several queries at once must give the same estimated distances as
+// scanning it once per query.
+static void check_multi_query(size_t padded_dim, bool use_hacc) {
+    constexpr size_t kBatch = fastscan::kBatchSize;
+    constexpr size_t kMaxQueries = 7;
+    const size_t num = kBatch - 3;
+
+    auto data = GenerateGaussianVectors(num, padded_dim, padded_dim);
+    std::vector<float> centroid(padded_dim, 0.0F);
+    auto batch = QuantizeBatch(data.data(), centroid.data(), num, padded_dim);
+
+    auto queries = GenerateGaussianVectors(kMaxQueries, padded_dim, padded_dim + 1);
+    std::vector<std::unique_ptr<SplitBatchQuery<float>>> q_objs;
+    std::vector<const SplitBatchQuery<float>*> q_ptrs;
+    std::vector<BatchEstimates> single;
+    for (size_t q = 0; q < kMaxQueries; ++q) {
+        q_objs.push_back(std::make_unique<SplitBatchQuery<float>>(
+            queries.data() + (q * padded_dim), padded_dim, 0, METRIC_L2, use_hacc
+        ));
+        q_objs.back()->set_g_add(static_cast<float>(q) + 1.0F);
+        q_ptrs.push_back(q_objs.back().get());
+        single.push_back(EstimateBatch(batch.data(), *q_objs.back(), padded_dim, use_hacc));
+    }
+
+    for (size_t nq = 1; nq <= kMaxQueries; ++nq) {
+        BatchEstimates multi(kMaxQueries * kBatch);
+        split_batch_estdist_multi(
+            batch.data(),
+            q_ptrs.data(),
+            nq,
+            padded_dim,
+            multi.est.data(),
+            multi.low.data(),
+            multi.ip.data(),
+            use_hacc
+        );
+        for (size_t q = 0; q < nq; ++q) {
+            for (size_t i = 0; i < kBatch; ++i) {
+                size_t j = (q * kBatch) + i;
+                EXPECT_FLOAT_EQ(single[q].est[i], multi.est[j])
+                    << "dim " << padded_dim << ", nq " << nq;
+                EXPECT_FLOAT_EQ(single[q].low[i], multi.low[j])
+                    << "dim " << padded_dim << ", nq " << nq;
+                EXPECT_FLOAT_EQ(single[q].ip[i], multi.ip[j])
+                    << "dim " << padded_dim << ", nq " << nq;
+            }
+        }
+    }
+}
+
+TEST(MultiQuery, batch_estdist_matches_single_query) {
+    // 1280 goes through the chunked accumulation
+    for (size_t padded_dim : {64, 768, 1280}) {
+        check_multi_query(padded_dim, false);
+        check_multi_query(padded_dim, true);
+    }
+}
@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+#include <rabitqlib/index/symqg/qg.hpp>
+#include <rabitqlib/index/symqg/qg_builder.hpp>
+#include <rabitqlib/index/symqg/qg_partition_builder.hpp>
+#include <rabitqlib/utils/space.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "batch_helpers.hpp"
+
+using namespace rabitqlib;
+using rabitq_test::GenerateGaussianVectors;
+
+namespace {
+
+constexpr size_t kDim = 64;
+constexpr size_t kDegree = 32;
+constexpr uint32_t kEfBuild = 64;
+
+// Every vertex must have exactly degree_bound distinct neighbors other than itself.
+void check_neighbors(const symqg::QuantizedGraph<float>& qg) {
+    size_t degree = qg.degree_bound();
+    for (PID i = 0; i < qg.num_vertices(); ++i) {
+        const PID* neighbors = qg.get_neighbors(i);
+        std::unordered_set<PID> ids(neighbors, neighbors + degree);
+        ASSERT_EQ(ids.size(), degree) << "vertex " << i;
+        ASSERT_EQ(ids.count(i), 0) << "vertex " << i;
+        ASSERT_TRUE(std::all_of(ids.begin(), ids.end(), [&](PID id) {
+            return id < qg.num_vertices();
+        })) << "vertex " << i;
+    }
+}
+
+// Number of vectors in [begin, end) returned as their own nearest neighbor.
+size_t num_found(
+    symqg::QuantizedGraph<float>& qg, const std::vector<float>& data, PID begin, PID end
+) {
+    qg.set_ef(100);
+    size_t found = 0;
+    for (PID i = begin; i < end; ++i) {
+        uint32_t result;
+        qg.search(&data[i * kDim], 1, &result);
+        found += static_cast<size_t>(result == i);
+    }
+    return found;
+}
+
+}  // namespace
+
+// Cluster init cuts clusters of duplicated vectors, which k-means cannot split, into
+// chunks. The graph must still be complete and find the other vectors.
+TEST(QGBuilder, cluster_init_with_duplicates) {
+    constexpr size_t kNum = 4000;
+    constexpr size_t kNumDup = 600;  // more than a cluster may hold
+    constexpr size_t kNumUnique = kNum - kNumDup;
+    auto data = GenerateGaussianVectors(kNum, kDim, 7);
+    for (size_t i = kNumUnique + 1; i < kNum; ++i) {
+        std::copy_n(
+            data.begin() + static_cast<long>(kNumUnique * kDim),
+            kDim,
+            data.begin() + static_cast<long>(i * kDim)
+        );
+    }
+
+    symqg::QuantizedGraph<float> qg(kNum, kDim, kDegree);
+    symqg::QGBuilder builder(qg, kEfBuild, data.data());
+    builder.set_init_type(symqg::QGInitType::ClusterInit);
+    builder.build(2);
+
+    check_neighbors(qg);
+    EXPECT_GE(num_found(qg, data, 0, kNumUnique), kNumUnique * 95 / 100);
+}
+
+// Inserting into a built graph, in batches and one vector at a time, must keep every list
+// complete and make the new vectors searchable, also after saving and loading.
+TEST(QGBuilder, insert_into_built_graph) {
+    constexpr size_t kNumBuilt = 2000;
+    constexpr size_t kNumBatched = 900;
+    constexpr size_t kNumSingle = 100;
+    constexpr size_t kNum = kNumBuilt + kNumBatched + kNumSingle;
+    auto data = GenerateGaussianVectors(kNum, kDim, 11);
+
+    symqg::QuantizedGraph<float> qg(kNumBuilt, kDim, kDegree);
+    {
+        symqg::QGBuilder builder(qg, kEfBuild, data.data());
+        builder.build();
+    }
+
+    symqg::QGBuilder inserter(qg, kEfBuild);
+    for (size_t begin = kNumBuilt; begin < kNumBuilt + kNumBatched; begin += 300) {
+        inserter.insert(&data[begin * kDim], 300);
+    }
+    for (size_t i = kNumBuilt + kNumBatched; i < kNum; ++i) {
+        inserter.insert(&data[i * kDim], 1);
+    }
+    ASSERT_EQ(qg.num_vertices(), kNum);
+    EXPECT_FALSE(inserter.check_dup());
+
+    check_neighbors(qg);
+    EXPECT_GE(num_found(qg, data, kNumBuilt, kNum), (kNum - kNumBuilt) * 95 / 100);
+    size_t found = num_found(qg, data, 0, kNum);
+
+    std::string filename = ::testing::TempDir() + "qg_insert_test.idx";
+    qg.save(filename.c_str());
+    symqg::QuantizedGraph<float> loaded;
+    loaded.load(filename.c_str());
+    std::remove(filename.c_str());
+    ASSERT_EQ(loaded.num_vertices(), kNum);
+    check_neighbors(loaded);
+    EXPECT_EQ(num_found(loaded, data, 0, kNum), found);
+}
+
+// Partitioned build spills the neighbor lists of vectors in several partitions and merges
+// them afterwards, the merged graph must be complete and find the vectors.
+TEST(QGBuilder, partitioned_build) {
+    constexpr size_t kNum = 4000;
+    constexpr size_t kNumPartitions = 4;
+    auto data = GenerateGaussianVectors(kNum, kDim, 13);
+    std::vector<float> centroids =
+        sample_kmeans(data.data(), kNum, kDim, kNumPartitions, kNum, 5);
+
+    for (size_t overlap : {2, 3}) {
+        symqg::QuantizedGraph<float> qg(kNum, kDim, kDegree);
+        symqg::QGPartitionBuilder builder(qg, kEfBuild, data.data(), overlap);
+        builder.build(centroids.data(), kNumPartitions);
+
+        check_neighbors(qg);
+        EXPECT_GE(num_found(qg, data, 0, kNum), kNum * 95 / 100) << "overlap " << overlap;
+    }
+}
+
+// Searching a batch of queries with several threads must give the same ids, distances and
+// hops as searching them one by one.
+TEST(QGSearch, search_batch_matches_search) {
+    constexpr size_t kNum = 3000;
+    constexpr size_t kNumQueries = 200;
+    constexpr uint32_t kTopk = 10;
+    constexpr size_t kEf = 64;
+    auto data = GenerateGaussianVectors(kNum, kDim, 23);
+    auto queries = GenerateGaussianVectors(kNumQueries, kDim, 29);
+
+    symqg::QuantizedGraph<float> qg(kNum, kDim, kDegree);
+    {
+        symqg::QGBuilder builder(qg, kEfBuild, data.data());
+        builder.build();
+    }
+
+    qg.set_ef(kEf);
+    std::vector<uint32_t> results(kNumQueries * kTopk);
+    std::vector<float> dists(kNumQueries * kTopk);
+    std::vector<uint32_t> hops(kNumQueries);
+    for (size_t i = 0; i < kNumQueries; ++i) {
+        hops[i] = static_cast<uint32_t>(qg.search(
+            &queries[i * kDim], kTopk, &results[i * kTopk], &dists[i * kTopk]
+        ));
+    }
+
+    std::vector<uint32_t> batch_results(kNumQueries * kTopk);
+    std::vector<float> batch_dists(kNumQueries * kTopk);
+    std::vector<uint32_t> batch_hops(kNumQueries);
+    qg.search_batch(
+        queries.data(),
+        kNumQueries,
+        kTopk,
+        kEf,
+        4,
+        batch_results.data(),
+        batch_dists.data(),
+        batch_hops.data()
+    );
+    EXPECT_EQ(batch_results, results);
+    EXPECT_EQ(batch_dists, dists);
+    EXPECT_EQ(batch_hops, hops);
+}
+
+// Early stop is disabled by default, so resetting it to EarlyStopParams{} must give the
+// results and hops of a plain search, while patience and error_gap must expand fewer
+// vertices. error_gap needs estimated distances close to the exact ones (ex-bits codes)
+// and a gap between the k-th result and the rest of the candidates (clustered data).
+TEST(QGSearch, early_stop) {
+    constexpr size_t kNum = 3000;
+    constexpr size_t kNumQueries = 200;
+    constexpr uint32_t kTopk = 10;
+    constexpr size_t kNumClusters = 30;
+    // well separated clusters, queries are near data vectors, so that the k-th distance
+    // is clearly below the distance to the rest of the graph
+    auto centers = GenerateGaussianVectors(kNumClusters, kDim, 29, 4.0F);
+    auto data = GenerateGaussianVectors(kNum, kDim, 31);
+    for (size_t i = 0; i < kNum; ++i) {
+        for (size_t j = 0; j < kDim; ++j) {
+            data[(i * kDim) + j] += centers[((i % kNumClusters) * kDim) + j];
+        }
+    }
+    auto queries = GenerateGaussianVectors(kNumQueries, kDim, 37, 0.3F);
+    for (size_t i = 0; i < kNumQueries; ++i) {
+        for (size_t j = 0; j < kDim; ++j) {
+            queries[(i * kDim) + j] += data[(i * 13 * kDim) + j];
+        }
+    }
+
+    symqg::QuantizedGraph<float> qg(
+        kNum, kDim, kDegree, METRIC_L2, RotatorType::FhtKacRotator, 7
+    );
+    {
+        symqg::QGBuilder builder(qg, kEfBuild, data.data());
+        builder.build();
+    }
+    qg.set_ef(200);
+
+    auto search_all = [&](std::vector<uint32_t>& results) {
+        results.assign(kNumQueries * kTopk, 0);
+        size_t hops = 0;
+        for (size_t i = 0; i < kNumQueries; ++i) {
+            hops += qg.search(&queries[i * kDim], kTopk, &results[i * kTopk]);
+        }
+        return hops;
+    };
+
+    std::vector<uint32_t> plain_results;
+    size_t plain_hops = search_all(plain_results);
+
+    std::vector<uint32_t> results;
+    qg.set_early_stop(EarlyStopParams{16, false});
+    EXPECT_LT(search_all(results), plain_hops);
+    qg.set_early_stop(EarlyStopParams{0, true});
+    EXPECT_LT(search_all(results), plain_hops);
+
+    qg.set_early_stop(EarlyStopParams{});
+    EXPECT_EQ(search_all(results), plain_hops);
+    EXPECT_EQ(results, plain_results);
+}
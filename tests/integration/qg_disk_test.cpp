@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <rabitqlib/index/symqg/qg.hpp>
+#include <rabitqlib/index/symqg/qg_builder.hpp>
+#include <rabitqlib/index/symqg/qg_disk.hpp>
+#include <rabitqlib/utils/space.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "batch_helpers.hpp"
+
+using namespace rabitqlib;
+using rabitq_test::GenerateGaussianVectors;
+
+namespace {
+
+constexpr size_t kNum = 3000;
+constexpr size_t kDim = 64;
+constexpr size_t kDegree = 32;
+constexpr size_t kEf = 64;
+constexpr size_t kBeamWidth = 4;
+
+struct DiskSearchStats {
+    size_t found = 0;  // num of vectors returned as their own nearest neighbor
+    size_t reads = 0;  // num of rows read
+};
+
+// Search every 10th vector on the disk index, its nearest neighbor is itself.
+DiskSearchStats search_disk(
+    const symqg::DiskQuantizedGraph<float>& disk_qg, const std::vector<float>& data
+) {
+    DiskSearchStats stats;
+    for (PID i = 0; i < kNum; i += 10) {
+        uint32_t result;
+        float dist;
+        stats.reads +=
+            disk_qg.search(&data[i * kDim], 1, kEf, kBeamWidth, &result, &dist);
+        stats.found += static_cast<size_t>(result == i);
+        if (result == i) {
+            EXPECT_NEAR(dist, 0, 1e-3) << "vector " << i;
+        }
+    }
+    return stats;
+}
+
+}  // namespace
+
+// A reordered qg saved in the disk layout and loaded back must find the vectors with
+// their original ids, with recall close to the in-memory qg.
+TEST(DiskQG, save_load_search) {
+    auto data = GenerateGaussianVectors(kNum, kDim, 19);
+    std::string filename = ::testing::TempDir() + "qg_disk_round_trip.idx";
+
+    symqg::QuantizedGraph<float> qg(kNum, kDim, kDegree);
+    {
+        symqg::QGBuilder builder(qg, 64, data.data());
+        builder.build();
+    }
+    qg.reorder();
+    symqg::DiskQuantizedGraph<float>::save(qg, filename.c_str(), 300);
+    symqg::DiskQuantizedGraph<float> disk_qg;
+    disk_qg.load(filename.c_str());
+    std::remove(filename.c_str());
+    std::remove((filename + ".nav").c_str());
+
+    DiskSearchStats stats = search_disk(disk_qg, data);
+    EXPECT_GE(stats.found, kNum / 10 * 95 / 100);
+
+    // recall of top-10 against brute force, the disk index must be close to qg
+    constexpr uint32_t kTopk = 10;
+    qg.set_ef(kEf);
+    size_t mem_hits = 0;
+    size_t disk_hits = 0;
+    for (PID i = 0; i < kNum; i += 10) {
+        std::vector<std::pair<float, uint32_t>> dists(kNum);
+        for (PID j = 0; j < kNum; ++j) {
+            dists[j] = {euclidean_sqr(&data[i * kDim], &data[j * kDim], kDim), j};
+        }
+        std::partial_sort(dists.begin(), dists.begin() + kTopk, dists.end());
+        std::unordered_set<uint32_t> gt;
+        for (size_t j = 0; j < kTopk; ++j) {
+            gt.insert(dists[j].second);
+        }
+
+        std::vector<uint32_t> mem_results(kTopk);
+        std::vector<uint32_t> disk_results(kTopk);
+        qg.search(&data[i * kDim], kTopk, mem_results.data());
+        disk_qg.search(&data[i * kDim], kTopk, kEf, kBeamWidth, disk_results.data());
+        for (size_t j = 0; j < kTopk; ++j) {
+            mem_hits += gt.count(mem_results[j]);
+            disk_hits += gt.count(disk_results[j]);
+        }
+    }
+    EXPECT_GE(disk_hits, mem_hits * 95 / 100);
+}
+
+// With ex-bits codes of neighbors, the disk search refines estimated distances by them,
+// so it reads fewer rows than on a 1-bit graph of the same data for the same ef.
+TEST(DiskQG, search_with_ex_bits) {
+    auto data = GenerateGaussianVectors(kNum, kDim, 17);
+    std::string filename = ::testing::TempDir() + "qg_disk_ex_bits.idx";
+
+    std::vector<DiskSearchStats> stats;
+    for (size_t ex_bits : {0, 4}) {
+        symqg::QuantizedGraph<float> qg(
+            kNum, kDim, kDegree, METRIC_L2, RotatorType::FhtKacRotator, ex_bits
+        );
+        {
+            symqg::QGBuilder builder(qg, 64, data.data());
+            builder.build();
+        }
+        symqg::DiskQuantizedGraph<float>::save(qg, filename.c_str(), 0);
+        symqg::DiskQuantizedGraph<float> disk_qg;
+        disk_qg.load(filename.c_str());
+        stats.push_back(search_disk(disk_qg, data));
+    }
+    std::remove(filename.c_str());
+
+    EXPECT_GE(stats[1].found, kNum / 10 * 95 / 100);
+    EXPECT_LT(stats[1].reads, stats[0].reads);
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <rabitqlib/index/estimator.hpp>
+#include <rabitqlib/index/query.hpp>
+#include <rabitqlib/quantization/data_layout.hpp>
+#include <rabitqlib/quantization/rabitq.hpp>
+#include <rabitqlib/utils/space.hpp>
+#include <rabitqlib/utils/warmup_space.hpp>
+#include <cmath>
+#include <vector>
+
+#include "batch_helpers.hpp"
+
+using namespace rabitqlib;
+using rabitq_test::GenerateGaussianVectors;
+
+// Estimate inner products of a query and binary codes with the query quantized to 2 to 8
+// bits. The dispatched (unrolled) popcount kernels must match the scalar reference, and
+// more bits must give more accurate inner products.
+TEST(QueryBits, single_estdist_accuracy) {
+    constexpr size_t kNum = 200;
+    for (size_t padded_dim : {128, 768}) {
+        auto data = GenerateGaussianVectors(kNum, padded_dim, padded_dim);
+        auto query = GenerateGaussianVectors(1, padded_dim, padded_dim + 1);
+        std::vector<float> centroid(padded_dim, 0.0F);
+
+        size_t bin_bytes = BinDataMap<float>::data_bytes(padded_dim);
+        std::vector<char> bin_data(kNum * bin_bytes);
+        for (size_t i = 0; i < kNum; ++i) {
+            quant::quantize_split_single(
+                data.data() + (i * padded_dim),
+                centroid.data(),
+                padded_dim,
+                0,
+                bin_data.data() + (i * bin_bytes),
+                nullptr
+            );
+        }
+
+        float prev_err = 0;
+        for (size_t num_bits : {2, 4, 6, 8}) {
+            SplitSingleQuery<float> q_obj(
+                query.data(),
+                padded_dim,
+                0,
+                quant::faster_config(padded_dim, num_bits),
+                METRIC_L2,
+                num_bits
+            );
+            ASSERT_EQ(q_obj.num_bits(), num_bits);
+
+            float err = 0;
+            for (size_t i = 0; i < kNum; ++i) {
+                const char* cur = bin_data.data() + (i * bin_bytes);
+                float ip_x0_qr;
+                float est_dist;
+                float low_dist;
+                split_single_estdist(cur, q_obj, padded_dim, ip_x0_qr, est_dist, low_dist);
+
+                ConstBinDataMap<float> cur_bin(cur, padded_dim);
+                float expected = warmup_ip_x0_q_512_scalar(
+                    cur_bin.bin_code(),
+                    q_obj.query_bin(),
+                    q_obj.delta(),
+                    q_obj.vl(),
+                    padded_dim,
+                    num_bits
+                );
+                ASSERT_EQ(ip_x0_qr, expected) << "dim " << padded_dim << ", " << num_bits;
+
+                float exact = mask_ip_x0_q(query.data(), cur_bin.bin_code(), padded_dim);
+                err += std::abs(ip_x0_qr - exact);
+            }
+            if (num_bits > 2) {
+                EXPECT_LT(err, prev_err) << "dim " << padded_dim << ", " << num_bits;
+            }
+            prev_err = err;
+        }
+    }
+}
@@ -0,0 +1,220 @@
+#include <gtest/gtest.h>
+#include <rabitqlib/index/estimator.hpp>
+#include <rabitqlib/index/ivf/ivf.hpp>
+#include <rabitqlib/index/query.hpp>
+#include <rabitqlib/quantization/data_layout.hpp>
+#include <rabitqlib/quantization/rabitq.hpp>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "batch_helpers.hpp"
+
+using namespace rabitqlib;
+using rabitq_test::EstimateBatch;
+using rabitq_test::GenerateGaussianVectors;
+
+namespace {
+
+// Quantize one batch with a 1-bit and a 2-bit FastScan stage. Both keep the same
+// total_bits code, so the boosted distances must agree, while the first-stage estimate of
+// the 2-bit stage must be more accurate.
+void check_two_bit_batch(size_t padded_dim, size_t total_bits) {
+    constexpr size_t kNum = fastscan::kBatchSize;
+    size_t ex_bits = total_bits - 1;
+    auto data = GenerateGaussianVectors(kNum, padded_dim, padded_dim + total_bits);
+    auto centroid = GenerateGaussianVectors(1, padded_dim, 1, 0.1F);
+    auto query = GenerateGaussianVectors(1, padded_dim, 2);
+
+    size_t ex_bytes_1 = ExDataMap<float>::data_bytes(padded_dim, ex_bits);
+    size_t ex_bytes_2 = ExDataMap<float>::data_bytes(padded_dim, ex_bits - 1);
+    std::vector<char> batch_1(BatchDataMap<float>::data_bytes(padded_dim));
+    std::vector<char> batch_2(BatchDataMap<float>::data_bytes(padded_dim * 2));
+    std::vector<char> ex_1(ex_bytes_1 * kNum);
+    std::vector<char> ex_2(ex_bytes_2 * kNum);
+    quant::quantize_split_batch(
+        data.data(), centroid.data(), kNum, padded_dim, ex_bits, batch_1.data(), ex_1.data()
+    );
+    quant::quantize_split_batch_2bit(
+        data.data(), centroid.data(), kNum, padded_dim, ex_bits, batch_2.data(), ex_2.data()
+    );
+
+    float g_add = 0;
+    for (size_t j = 0; j < padded_dim; ++j) {
+        g_add += (query[j] - centroid[j]) * (query[j] - centroid[j]);
+    }
+    SplitBatchQuery<float> q_1(query.data(), padded_dim, ex_bits, METRIC_L2, true, 1);
+    SplitBatchQuery<float> q_2(query.data(), padded_dim, ex_bits, METRIC_L2, true, 2);
+    q_1.set_g_add(std::sqrt(g_add));
+    q_2.set_g_add(std::sqrt(g_add));
+
+    auto res_1 = EstimateBatch(batch_1.data(), q_1, padded_dim, true);
+    auto res_2 = EstimateBatch(batch_2.data(), q_2, padded_dim * 2, true);
+    const auto& est_1 = res_1.est;
+    const auto& low_1 = res_1.low;
+    const auto& est_2 = res_2.est;
+    const auto& low_2 = res_2.low;
+
+    auto ip_func_1 = select_excode_ipfunc(ex_bits);
+    auto ip_func_2 = select_excode_ipfunc(ex_bits - 1);
+    float err_1 = 0;
+    float err_2 = 0;
+    for (size_t i = 0; i < kNum; ++i) {
+        float truth = 0;
+        for (size_t j = 0; j < padded_dim; ++j) {
+            float diff = data[(i * padded_dim) + j] - query[j];
+            truth += diff * diff;
+        }
+        err_1 += std::abs(est_1[i] - truth);
+        err_2 += std::abs(est_2[i] - truth);
+        EXPECT_LT(est_2[i] - low_2[i], est_1[i] - low_1[i]) << "vector " << i;
+
+        float full_1 = split_distance_boosting(
+            ex_1.data() + (i * ex_bytes_1), ip_func_1, q_1, padded_dim, ex_bits, res_1.ip[i]
+        );
+        float full_2 = total_bits == 2 ? est_2[i]
+                                       : split_distance_boosting(
+                                             ex_2.data() + (i * ex_bytes_2),
+                                             ip_func_2,
+                                             q_2,
+                                             padded_dim,
+                                             ex_bits - 1,
+                                             res_2.ip[i]
+                                         );
+        EXPECT_NEAR(full_1, full_2, 1e-2F * truth)
+            << "dim " << padded_dim << " bits " << total_bits << " vector " << i;
+    }
+    EXPECT_LT(err_2, err_1 * 0.75F) << "dim " << padded_dim << " bits " << total_bits;
+}
+}  // namespace
+
+TEST(TwoBitFastScan, boosted_distance_matches_one_bit_stage) {
+    for (size_t padded_dim : {64, 256}) {
+        for (size_t total_bits : {2, 3, 4, 7}) {
+            check_two_bit_batch(padded_dim, total_bits);
+        }
+    }
+}
+
+TEST(TwoBitFastScan, ivf_save_load_round_trip) {
+    constexpr size_t kNum = 1000;
+    constexpr size_t kDim = 100;
+    constexpr size_t kClusters = 4;
+    constexpr size_t kTopk = 10;
+    auto data = GenerateGaussianVectors(kNum, kDim, 3);
+    // assign vectors to the nearest of a few seed rows, then move centroids to the means
+    // of their clusters, so that no centroid equals a data vector
+    std::vector<float> seeds(data.begin(), data.begin() + (kClusters * kDim));
+    std::vector<PID> cluster_ids(kNum);
+    for (size_t i = 0; i < kNum; ++i) {
+        float best = std::numeric_limits<float>::max();
+        for (size_t c = 0; c < kClusters; ++c) {
+            float dist = 0;
+            for (size_t j = 0; j < kDim; ++j) {
+                float diff = data[(i * kDim) + j] - seeds[(c * kDim) + j];
+                dist += diff * diff;
+            }
+            if (dist < best) {
+                best = dist;
+                cluster_ids[i] = static_cast<PID>(c);
+            }
+        }
+    }
+    std::vector<float> centroids(kClusters * kDim, 0.0F);
+    std::vector<size_t> cluster_sizes(kClusters, 0);
+    for (size_t i = 0; i < kNum; ++i) {
+        ++cluster_sizes[cluster_ids[i]];
+        for (size_t j = 0; j < kDim; ++j) {
+            centroids[(cluster_ids[i] * kDim) + j] += data[(i * kDim) + j];
+        }
+    }
+    for (size_t c = 0; c < kClusters; ++c) {
+        for (size_t j = 0; j < kDim; ++j) {
+            centroids[(c * kDim) + j] /= static_cast<float>(cluster_sizes[c]);
+        }
+    }
+
+    ivf::IVF index(kNum, kDim, kClusters, 4, METRIC_L2, RotatorType::FhtKacRotator, 2);
+    index.construct(data.data(), centroids.data(), cluster_ids.data(), false);
+    std::string path = ::testing::TempDir() + "two_bit_fastscan_ivf.index";
+    index.save(path.c_str());
+
+    ivf::IVF loaded;
+    loaded.load(path.c_str());
+    std::remove(path.c_str());
+    EXPECT_EQ(loaded.fastscan_bits(), 2);
+
+    // queries are perturbed data vectors, whose nearest neighbours are unambiguous
+    auto queries = GenerateGaussianVectors(5, kDim, 4, 0.1F);
+    for (size_t q = 0; q < 5; ++q) {
+        for (size_t j = 0; j < kDim; ++j) {
+            queries[(q * kDim) + j] += data[(q * 97 * kDim) + j];
+        }
+    }
+    for (size_t q = 0; q < 5; ++q) {
+        std::vector<PID> ids(kTopk), loaded_ids(kTopk);
+        std::vector<float> dists(kTopk), loaded_dists(kTopk);
+        index.search(
+            queries.data() + (q * kDim), kTopk, kClusters, ids.data(), dists.data(), true
+        );
+        loaded.search(
+            queries.data() + (q * kDim),
+            kTopk,
+            kClusters,
+            loaded_ids.data(),
+            loaded_dists.data(),
+            true
+        );
+        EXPECT_EQ(ids, loaded_ids) << "query " << q;
+        EXPECT_EQ(dists, loaded_dists) << "query " << q;
+
+        EXPECT_EQ(ids[0], q * 97) << "query " << q;
+    }
+}
+
+// A vector equal to its centroid has a zero residual. Its factors must stay finite, and
+// its estimated distance is the distance of the query to the centroid.
+TEST(TwoBitFastScan, zero_residual) {
+    constexpr size_t kNum = fastscan::kBatchSize;
+    constexpr size_t kDim = 64;
+    constexpr size_t kExBits = 3;
+    auto data = GenerateGaussianVectors(kNum, kDim, 5);
+    std::vector<float> centroid(data.begin(), data.begin() + kDim);
+    auto query = GenerateGaussianVectors(1, kDim, 6);
+
+    float g_add = 0;
+    for (size_t j = 0; j < kDim; ++j) {
+        g_add += (query[j] - centroid[j]) * (query[j] - centroid[j]);
+    }
+
+    for (size_t fastscan_bits : {1, 2}) {
+        size_t ex_bits = kExBits + 1 - fastscan_bits;
+        size_t ex_bytes = ExDataMap<float>::data_bytes(kDim, ex_bits);
+        std::vector<char> batch(BatchDataMap<float>::data_bytes(kDim * fastscan_bits));
+        std::vector<char> ex(ex_bytes * kNum);
+        if (fastscan_bits == 2) {
+            quant::quantize_split_batch_2bit(
+                data.data(), centroid.data(), kNum, kDim, kExBits, batch.data(), ex.data()
+            );
+        } else {
+            quant::quantize_split_batch(
+                data.data(), centroid.data(), kNum, kDim, kExBits, batch.data(), ex.data()
+            );
+        }
+
+        SplitBatchQuery<float> q_obj(
+            query.data(), kDim, kExBits, METRIC_L2, true, fastscan_bits
+        );
+        q_obj.set_g_add(std::sqrt(g_add));
+        auto res = EstimateBatch(batch.data(), q_obj, kDim * fastscan_bits, true);
+        EXPECT_NEAR(res.est[0], g_add, 1e-4F * g_add) << fastscan_bits << " bits";
+        EXPECT_NEAR(res.low[0], g_add, 1e-4F * g_add) << fastscan_bits << " bits";
+
+        float full = split_distance_boosting(
+            ex.data(), select_excode_ipfunc(ex_bits), q_obj, kDim, ex_bits, res.ip[0]
+        );
+        EXPECT_NEAR(full, g_add, 1e-4F * g_add) << fastscan_bits << " bits";
+    }
+}
@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <string>
+#include "rabitqlib/utils/cpu_features.hpp"
+
+using namespace rabitqlib;
+
+TEST(CpuFeatures, simd_level) {
+    if constexpr (kCompiledSimdLevel == SimdLevel::AVX512Ext) {
+        ASSERT_EQ(simd_level(), SimdLevel::AVX512Ext);
+    } else {
+        ASSERT_EQ(simd_level(), detect_simd_level());
+    }
+    ASSERT_STRNE(simd_level_name(simd_level()), "");
+}
+
+// RABITQ_SIMD_LEVEL caps the detected level at any level, down to the scalar references
+TEST(CpuFeatures, env_caps_level) {
+    const char* env = std::getenv("RABITQ_SIMD_LEVEL");
+    std::string saved = env == nullptr ? "" : env;
+
+    for (auto cap : {SimdLevel::None, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        setenv("RABITQ_SIMD_LEVEL", simd_level_name(cap), 1);
+        EXPECT_LE(detect_simd_level(), cap) << simd_level_name(cap);
+    }
+    setenv("RABITQ_SIMD_LEVEL", "none", 1);
+    EXPECT_EQ(detect_simd_level(), SimdLevel::None);
+
+    if (env == nullptr) {
+        unsetenv("RABITQ_SIMD_LEVEL");
+    } else {
+        setenv("RABITQ_SIMD_LEVEL", saved.c_str(), 1);
+    }
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include "rabitqlib/utils/low_precision.hpp"
+#include "rabitqlib/utils/space.hpp"
+#include "test_helpers.hpp"
+#include "test_data.hpp"
+#include <vector>
+#include <cmath>
+
+using namespace rabitqlib;
+using namespace rabitq_test;
+
+namespace {
+// decode an encoded raw vector back to float with the scalar conversions
+std::vector<float> decode(const char* code, size_t dim, RawDataType type) {
+    std::vector<float> vec(dim);
+    for (size_t i = 0; i < dim; ++i) {
+        if (type == RAW_FP16) {
+            vec[i] = low_precision_impl::half_to_float(
+                reinterpret_cast<const uint16_t*>(code)[i]
+            );
+        } else if (type == RAW_BF16) {
+            vec[i] = low_precision_impl::bf16_to_float(
+                reinterpret_cast<const uint16_t*>(code)[i]
+            );
+        } else if (type == RAW_INT8) {
+            float scale;
+            std::memcpy(&scale, code, sizeof(float));
+            vec[i] = scale * reinterpret_cast<const int8_t*>(code + sizeof(float))[i];
+        } else {
+            vec[i] = reinterpret_cast<const float*>(code)[i];
+        }
+    }
+    return vec;
+}
+}  // namespace
+
+TEST(LowPrecision, half_conversion_round_trip) {
+    std::vector<float> values = {0.0f, -0.0f, 1.0f, -2.5f, 0.1f, 65504.0f, 6e-8f, 1e-5f};
+    for (float v : values) {
+        uint16_t half = low_precision_impl::float_to_half(v);
+        float back = low_precision_impl::half_to_float(half);
+        EXPECT_NEAR(back, v, std::abs(v) * 1e-3f + 6e-8f);
+        EXPECT_EQ(low_precision_impl::float_to_half(back), half);
+    }
+    // overflow to inf
+    EXPECT_EQ(low_precision_impl::float_to_half(1e6f), 0x7C00);
+}
+
+TEST(LowPrecision, bf16_conversion_round_trip) {
+    std::vector<float> values = {0.0f, 1.0f, -3.75f, 0.1f, 1e20f, -1e-20f};
+    for (float v : values) {
+        float back =
+            low_precision_impl::bf16_to_float(low_precision_impl::float_to_bf16(v));
+        EXPECT_NEAR(back, v, std::abs(v) * 4e-3f);
+    }
+}
+
+TEST(LowPrecision, int8_encoding_error_is_bounded) {
+    size_t dim = 100;
+    auto vec = TestDataGenerator::GenerateRandomVector(dim, -1.0f, 1.0f, 7);
+    std::vector<char> code(raw_data_bytes(RAW_INT8, dim));
+    encode_raw_data(vec.data(), dim, RAW_INT8, code.data());
+    auto decoded = decode(code.data(), dim, RAW_INT8);
+
+    float scale;
+    std::memcpy(&scale, code.data(), sizeof(float));
+    for (size_t i = 0; i < dim; ++i) {
+        EXPECT_LE(std::abs(decoded[i] - vec[i]), (scale / 2) + 1e-6f);
+    }
+}
+
+// simd kernels should match distances on the decoded vectors, including tails
+TEST(LowPrecision, dist_funcs_match_decoded_vectors) {
+    for (size_t dim : {1UL, 7UL, 33UL, 100UL, 128UL}) {
+        auto query = TestDataGenerator::GenerateRandomVector(dim, -1.0f, 1.0f, 1);
+        auto vec = TestDataGenerator::GenerateRandomVector(dim, -1.0f, 1.0f, 2);
+        for (RawDataType type : {RAW_FP32, RAW_FP16, RAW_BF16, RAW_INT8}) {
+            std::vector<char> code(raw_data_bytes(type, dim));
+            encode_raw_data(vec.data(), dim, type, code.data());
+            auto decoded = decode(code.data(), dim, type);
+
+            float l2 = select_raw_dist_func(type, METRIC_L2)(query.data(), code.data(), dim);
+            float ip = select_raw_dist_func(type, METRIC_IP)(query.data(), code.data(), dim);
+            EXPECT_NEAR(l2, euclidean_sqr(query.data(), decoded.data(), dim), 1e-4f);
+            EXPECT_NEAR(ip, dot_product_dis(query.data(), decoded.data(), dim), 1e-4f);
+        }
+    }
+}
@@ -0,0 +1,682 @@
+#include <gtest/gtest.h>
+#include "rabitqlib/fastscan/fastscan.hpp"
+#include "rabitqlib/fastscan/highacc_fastscan.hpp"
+#include "rabitqlib/index/estimator.hpp"
+#include "rabitqlib/quantization/pack_excode.hpp"
+#include "rabitqlib/utils/cpu_features.hpp"
+#include "rabitqlib/utils/fht_avx.hpp"
+#include "rabitqlib/utils/rotator.hpp"
+#include "rabitqlib/utils/space.hpp"
+#include "rabitqlib/utils/warmup_space.hpp"
+#include "test_helpers.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Differential tests: every SIMD kernel is compared with its scalar reference on random
+// inputs, bit for bit for integer kernels and within a tolerance for float sums. Kernels
+// of levels the cpu does not support are skipped.
+
+using namespace rabitqlib;
+using namespace rabitq_test;
+
+namespace {
+bool has_level(SimdLevel level) { return simd_level() >= level; }
+
+template <typename T>
+std::vector<T> random_ints(size_t size, uint64_t max, std::mt19937_64& gen) {
+    std::uniform_int_distribution<uint64_t> dist(0, max);
+    std::vector<T> vec(size);
+    for (auto& v : vec) {
+        v = static_cast<T>(dist(gen));
+    }
+    return vec;
+}
+
+std::vector<float> random_floats(size_t size, std::mt19937_64& gen) {
+    std::uniform_real_distribution<float> dist(-1.0F, 1.0F);
+    std::vector<float> vec(size);
+    for (auto& v : vec) {
+        v = dist(gen);
+    }
+    return vec;
+}
+
+// tolerance of float sums of dim terms of magnitude up to scale
+float sum_tolerance(size_t dim, float scale) {
+    return 1e-5F * static_cast<float>(dim) * scale;
+}
+
+template <size_t kWidth>
+void check_accumulate(std::mt19937_64& gen) {
+    // 2048 dims overflow u16 sums, which must wrap around the same way
+    for (size_t dim : {16, 64, 112, 128, 256, 1024, 2048}) {
+        auto codes = random_ints<uint8_t>(dim * kWidth / 8, 255, gen);
+        auto lut = random_ints<uint8_t>(dim * 4, 255, gen);
+
+        std::vector<uint16_t> expected(kWidth);
+        fastscan::accumulate_scalar<kWidth>(codes.data(), lut.data(), expected.data(), dim);
+
+        std::vector<uint16_t> result(kWidth);
+        if (has_level(SimdLevel::AVX2)) {
+            fastscan::accumulate_avx2<kWidth>(codes.data(), lut.data(), result.data(), dim);
+            ASSERT_EQ(result, expected) << "avx2, dim " << dim << ", width " << kWidth;
+        }
+        if (has_level(SimdLevel::AVX512)) {
+            fastscan::accumulate_avx512<kWidth>(
+                codes.data(), lut.data(), result.data(), dim
+            );
+            ASSERT_EQ(result, expected) << "avx512, dim " << dim << ", width " << kWidth;
+        }
+        // through the dispatcher, which has fixed-dim kernels for 128 and 256
+        fastscan::accumulate<kWidth>(codes.data(), lut.data(), result.data(), dim);
+        ASSERT_EQ(result, expected) << "dispatched, dim " << dim << ", width " << kWidth;
+    }
+}
+
+// codes packed by pack_codes give exact sums of the lut, for both fastscan and hacc
+template <size_t kWidth>
+void check_accumulate_packed(std::mt19937_64& gen) {
+    size_t dim = 128;
+    size_t num = 100;  // not a multiple of the batch size
+    size_t num_batch = (num + kWidth - 1) / kWidth;
+    auto codes = random_ints<uint8_t>(num * dim / 8, 255, gen);
+    auto lut = random_ints<uint8_t>(dim * 4, 255, gen);
+    auto lut16 = random_ints<uint16_t>(dim * 4, 255, gen);
+    std::vector<uint8_t> hc_lut(dim * 8);
+    fastscan::transfer_lut_hacc(lut16.data(), dim, hc_lut.data());
+
+    std::vector<uint8_t> packed(num_batch * kWidth * dim / 8);
+    fastscan::pack_codes<kWidth>(dim, codes.data(), num, packed.data());
+
+    std::vector<uint16_t> result(kWidth);
+    std::vector<int32_t> hacc_result(kWidth);
+    for (size_t batch = 0; batch < num_batch; ++batch) {
+        const uint8_t* batch_codes = packed.data() + (batch * dim * kWidth / 8);
+        fastscan::accumulate<kWidth>(batch_codes, lut.data(), result.data(), dim);
+        fastscan::accumulate_hacc<kWidth>(
+            batch_codes, hc_lut.data(), hacc_result.data(), dim
+        );
+        for (size_t v = 0; v < kWidth; ++v) {
+            size_t id = (batch * kWidth) + v;
+            uint16_t expected = 0;
+            int32_t hacc_expected = 0;
+            for (size_t m = 0; m < dim / 4; ++m) {
+                // absent vectors are packed as zeros
+                uint8_t byte = id < num ? codes[(id * dim / 8) + (m / 2)] : 0;
+                uint8_t code = (m % 2 == 0) ? (byte >> 4) : (byte & 15);
+                expected += lut[(m * 16) + code];
+                hacc_expected += lut16[(m * 16) + code];
+            }
+            ASSERT_EQ(result[v], expected) << "vector " << id << ", width " << kWidth;
+            ASSERT_EQ(hacc_result[v], hacc_expected) << "vector " << id;
+        }
+    }
+}
+
+template <size_t kWidth>
+void check_accumulate_hacc(std::mt19937_64& gen) {
+    // sums of the 8-bit halves stay in u16 up to 1024 dims, beyond that the avx512 kernel
+    // keeps carries that the others drop
+    for (size_t dim : {16, 64, 128, 512, 1024}) {
+        auto codes = random_ints<uint8_t>(dim * kWidth / 8, 255, gen);
+        auto lut = random_ints<uint16_t>(dim * 4, 65535, gen);
+        std::vector<uint8_t> hc_lut(dim * 8);
+
+        std::vector<int32_t> expected(kWidth);
+        fastscan::transfer_lut_hacc_scalar(lut.data(), dim, hc_lut.data());
+        fastscan::accumulate_hacc_scalar<kWidth>(
+            codes.data(), hc_lut.data(), expected.data(), dim
+        );
+
+        std::vector<int32_t> result(kWidth);
+        if (has_level(SimdLevel::AVX2)) {
+            fastscan::transfer_lut_hacc_avx2(lut.data(), dim, hc_lut.data());
+            fastscan::accumulate_hacc_avx2<kWidth>(
+                codes.data(), hc_lut.data(), result.data(), dim
+            );
+            ASSERT_EQ(result, expected) << "avx2, dim " << dim << ", width " << kWidth;
+        }
+        if (has_level(SimdLevel::AVX512)) {
+            fastscan::transfer_lut_hacc_avx512(lut.data(), dim, hc_lut.data());
+            fastscan::accumulate_hacc_avx512<kWidth>(
+                codes.data(), hc_lut.data(), result.data(), dim
+            );
+            ASSERT_EQ(result, expected) << "avx512, dim " << dim << ", width " << kWidth;
+        }
+    }
+}
+
+
+template <typename TA>
+void check_fused_estdist(std::mt19937_64& gen) {
+    // 40 leaves a tail for the scalar loop of both SIMD kernels
+    for (size_t num : {32, 40, 64}) {
+        auto accu = random_ints<TA>(num, 60000, gen);
+        auto f_add = random_floats(num, gen);
+        auto f_rescale = random_floats(num, gen);
+        auto f_error = random_floats(num, gen);
+        EstdistConsts consts{0.01F, -3.0F, 1.5F, 2.0F, 0.7F};
+
+        std::vector<float> est(num), low(num), ip(num);
+        uint64_t mask = fused_estdist_scalar(
+            accu.data(),
+            f_add.data(),
+            f_rescale.data(),
+            f_error.data(),
+            num,
+            consts,
+            std::numeric_limits<float>::infinity(),
+            est.data(),
+            low.data(),
+            ip.data()
+        );
+        ASSERT_EQ(mask, num == 64 ? ~0ULL : (1ULL << num) - 1);
+        // about half of the vectors are candidates
+        std::vector<float> sorted_low = low;
+        std::sort(sorted_low.begin(), sorted_low.end());
+        float threshold = sorted_low[num / 2];
+        mask = fused_estdist_scalar(
+            accu.data(),
+            f_add.data(),
+            f_rescale.data(),
+            f_error.data(),
+            num,
+            consts,
+            threshold,
+            est.data(),
+            low.data(),
+            ip.data()
+        );
+
+        auto check = [&](auto kernel, const char* name) {
+            std::vector<float> est_simd(num), low_simd(num), ip_simd(num);
+            uint64_t mask_simd = kernel(
+                accu.data(),
+                f_add.data(),
+                f_rescale.data(),
+                f_error.data(),
+                num,
+                consts,
+                threshold,
+                est_simd.data(),
+                low_simd.data(),
+                ip_simd.data()
+            );
+            for (size_t i = 0; i < num; ++i) {
+                float tol = 1e-5F * std::max(1.0F, std::abs(ip[i]));
+                EXPECT_NEAR(ip_simd[i], ip[i], tol) << name << ", num " << num;
+                EXPECT_NEAR(est_simd[i], est[i], tol * 4) << name << ", num " << num;
+                EXPECT_NEAR(low_simd[i], low[i], tol * 4) << name << ", num " << num;
+                if (std::abs(low[i] - threshold) > 1e-3F) {
+                    EXPECT_EQ((mask_simd >> i) & 1, (mask >> i) & 1) << name << ", " << i;
+                }
+            }
+
+            // without lower bounds nor inner products, est is compared instead
+            std::vector<float> est_only(num);
+            uint64_t est_mask = kernel(
+                accu.data(),
+                f_add.data(),
+                f_rescale.data(),
+                nullptr,
+                num,
+                consts,
+                std::numeric_limits<float>::infinity(),
+                est_only.data(),
+                nullptr,
+                nullptr
+            );
+            EXPECT_EQ(est_mask, num == 64 ? ~0ULL : (1ULL << num) - 1) << name;
+            EXPECT_EQ(est_only, est_simd) << name;
+        };
+        if (has_level(SimdLevel::AVX2)) {
+            check(fused_estdist_avx2<TA>, "avx2");
+        }
+        if (has_level(SimdLevel::AVX512)) {
+            check(fused_estdist_avx512<TA>, "avx512");
+        }
+    }
+}
+}  // namespace
+
+TEST(SimdKernels, accumulate) {
+    std::mt19937_64 gen(1);
+    check_accumulate<fastscan::kBatchSize>(gen);
+    check_accumulate<fastscan::kWideBatchSize>(gen);
+}
+
+TEST(SimdKernels, accumulate_matches_packed_codes) {
+    std::mt19937_64 gen(2);
+    check_accumulate_packed<fastscan::kBatchSize>(gen);
+    check_accumulate_packed<fastscan::kWideBatchSize>(gen);
+}
+
+TEST(SimdKernels, accumulate_hacc) {
+    std::mt19937_64 gen(3);
+    check_accumulate_hacc<fastscan::kBatchSize>(gen);
+    check_accumulate_hacc<fastscan::kWideBatchSize>(gen);
+}
+
+TEST(SimdKernels, accumulate_multi) {
+    std::mt19937_64 gen(10);
+    constexpr size_t kMaxQueries = 9;
+    for (size_t dim : {16, 128, 1024}) {
+        auto codes = random_ints<uint8_t>(dim * fastscan::kBatchSize / 8, 255, gen);
+        std::vector<std::vector<uint8_t>> luts;
+        std::vector<std::vector<uint8_t>> hc_luts;
+        std::vector<const uint8_t*> lut_ptrs;
+        std::vector<const uint8_t*> hc_lut_ptrs;
+        for (size_t q = 0; q < kMaxQueries; ++q) {
+            luts.push_back(random_ints<uint8_t>(dim * 4, 255, gen));
+            auto lut16 = random_ints<uint16_t>(dim * 4, 65535, gen);
+            hc_luts.emplace_back(dim * 8);
+            fastscan::transfer_lut_hacc(lut16.data(), dim, hc_luts.back().data());
+            lut_ptrs.push_back(luts.back().data());
+            hc_lut_ptrs.push_back(hc_luts.back().data());
+        }
+
+        std::vector<uint16_t> expected(kMaxQueries * fastscan::kBatchSize);
+        std::vector<int32_t> hacc_expected(kMaxQueries * fastscan::kBatchSize);
+        for (size_t q = 0; q < kMaxQueries; ++q) {
+            fastscan::accumulate(
+                codes.data(), lut_ptrs[q], expected.data() + (q * fastscan::kBatchSize), dim
+            );
+            fastscan::accumulate_hacc(
+                codes.data(),
+                hc_lut_ptrs[q],
+                hacc_expected.data() + (q * fastscan::kBatchSize),
+                dim
+            );
+        }
+
+        for (size_t nq = 1; nq <= kMaxQueries; ++nq) {
+            size_t size = nq * fastscan::kBatchSize;
+            std::vector<uint16_t> result(size);
+            std::vector<int32_t> hacc_result(size);
+            fastscan::accumulate_multi(
+                codes.data(), lut_ptrs.data(), nq, result.data(), dim
+            );
+            fastscan::accumulate_hacc_multi(
+                codes.data(), hc_lut_ptrs.data(), nq, hacc_result.data(), dim
+            );
+            ASSERT_TRUE(std::equal(result.begin(), result.end(), expected.begin()))
+                << "dim " << dim << ", queries " << nq;
+            bool hacc_equal =
+                std::equal(hacc_result.begin(), hacc_result.end(), hacc_expected.begin());
+            ASSERT_TRUE(hacc_equal) << "hacc, dim " << dim << ", queries " << nq;
+        }
+    }
+}
+
+TEST(SimdKernels, fused_estdist) {
+    std::mt19937_64 gen(11);
+    check_fused_estdist<uint16_t>(gen);
+    check_fused_estdist<int32_t>(gen);
+}
+
+TEST(SimdKernels, warmup_ip_x0_q_512) {
+    std::mt19937_64 gen(4);
+    for (size_t padded_dim : {64, 448, 512, 576, 1024, 1472}) {
+        for (size_t b_query = 1; b_query <= 8; ++b_query) {
+            auto data = random_ints<uint64_t>(padded_dim / 64, ~0ULL, gen);
+            auto query = random_ints<uint64_t>(padded_dim / 64 * b_query, ~0ULL, gen);
+            float delta = 0.25F;
+            float vl = -3.0F;
+
+            float expected = warmup_ip_x0_q_512_scalar(
+                data.data(), query.data(), delta, vl, padded_dim, b_query
+            );
+            if (has_level(SimdLevel::AVX2)) {
+                float result = warmup_ip_x0_q_512_avx2(
+                    data.data(), query.data(), delta, vl, padded_dim, b_query
+                );
+                ASSERT_EQ(result, expected) << "avx2, " << padded_dim << ", " << b_query;
+            }
+            if (has_level(SimdLevel::AVX512Ext)) {
+                float result = warmup_ip_x0_q_512_avx512(
+                    data.data(), query.data(), delta, vl, padded_dim, b_query
+                );
+                ASSERT_EQ(result, expected) << "avx512, " << padded_dim << ", " << b_query;
+            }
+        }
+    }
+}
+
+TEST(SimdKernels, transpose_bin_512_matches_warmup_ip) {
+    std::mt19937_64 gen(5);
+    for (size_t padded_dim : {64, 512, 960}) {
+        size_t b_query = 5;
+        auto query = random_ints<uint8_t>(padded_dim, (1U << b_query) - 1, gen);
+        auto data = random_ints<uint64_t>(padded_dim / 64, ~0ULL, gen);
+
+        std::vector<uint64_t> expected(padded_dim / 64 * b_query);
+        new_transpose_bin_512_scalar(query.data(), expected.data(), padded_dim, b_query);
+        std::vector<uint64_t> result(padded_dim / 64 * b_query);
+        new_transpose_bin_512(query.data(), result.data(), padded_dim, b_query);
+        ASSERT_EQ(result, expected);
+
+        // the transposed query gives the exact inner product with binary data
+        size_t ip = 0;
+        size_t ppc = 0;
+        for (size_t d = 0; d < padded_dim; ++d) {
+            size_t bit = (data[d / 64] >> (63 - (d % 64))) & 1;
+            ip += bit * query[d];
+            ppc += bit;
+        }
+        float ip_est = warmup_ip_x0_q_512_scalar(
+            data.data(), expected.data(), 1.0F, 0.0F, padded_dim, b_query
+        );
+        float ppc_est = warmup_ip_x0_q_512_scalar(
+            data.data(), expected.data(), 0.0F, 1.0F, padded_dim, b_query
+        );
+        ASSERT_EQ(static_cast<size_t>(ip_est), ip);
+        ASSERT_EQ(static_cast<size_t>(ppc_est), ppc);
+    }
+}
+
+TEST(SimdKernels, transpose_bin) {
+    std::mt19937_64 gen(6);
+    for (size_t padded_dim : {64, 256, 832}) {
+        for (size_t b_query : {1, 4, 8, 13}) {
+            auto query = random_ints<uint16_t>(padded_dim, (1U << b_query) - 1, gen);
+            std::vector<uint64_t> expected(padded_dim / 64 * b_query);
+            new_transpose_bin_scalar(query.data(), expected.data(), padded_dim, b_query);
+            std::vector<uint64_t> result(padded_dim / 64 * b_query);
+            new_transpose_bin(query.data(), result.data(), padded_dim, b_query);
+            ASSERT_EQ(result, expected) << padded_dim << ", " << b_query;
+        }
+    }
+}
+
+TEST(SimdKernels, mask_ip_x0_q) {
+    std::mt19937_64 gen(7);
+    for (size_t padded_dim : {64, 128, 704, 2048}) {
+        auto query = random_floats(padded_dim, gen);
+        auto data = random_ints<uint64_t>(padded_dim / 64, ~0ULL, gen);
+
+        float expected = mask_ip_x0_q_scalar(query.data(), data.data(), padded_dim);
+        float tol = sum_tolerance(padded_dim, 1.0F);
+        if (has_level(SimdLevel::AVX2)) {
+            float result = mask_ip_x0_q_avx2(query.data(), data.data(), padded_dim);
+            ASSERT_NEAR(result, expected, tol) << "avx2, " << padded_dim;
+        }
+        if (has_level(SimdLevel::AVX512)) {
+            float result = mask_ip_x0_q_avx512(query.data(), data.data(), padded_dim);
+            ASSERT_NEAR(result, expected, tol) << "avx512, " << padded_dim;
+        }
+    }
+}
+
+TEST(SimdKernels, excode_ip) {
+    using quant::rabitq_impl::ex_bits::packing_rabitqplus_code;
+    using excode_ipimpl::ip_fxu_scalar;
+
+    std::vector<ex_ipfunc> scalar_funcs = {
+        ip_fxu_scalar<1>,
+        ip_fxu_scalar<2>,
+        ip_fxu_scalar<3>,
+        ip_fxu_scalar<4>,
+        ip_fxu_scalar<5>,
+        ip_fxu_scalar<6>,
+        ip_fxu_scalar<7>,
+    };
+    std::vector<ex_ipfunc> avx2_funcs = {
+        excode_ipimpl::ip16_fxu1_avx2,
+        excode_ipimpl::ip64_fxu2_avx2,
+        excode_ipimpl::ip64_fxu3_avx2,
+        excode_ipimpl::ip16_fxu4_avx2,
+        excode_ipimpl::ip64_fxu5_avx2,
+        excode_ipimpl::ip64_fxu6_avx2,
+        excode_ipimpl::ip64_fxu7_avx2,
+    };
+    std::vector<ex_ipfunc> avx512_funcs = {
+        excode_ipimpl::ip16_fxu1_avx512,
+        excode_ipimpl::ip64_fxu2_avx512,
+        excode_ipimpl::ip64_fxu3_avx512,
+        excode_ipimpl::ip16_fxu4_avx512,
+        excode_ipimpl::ip64_fxu5_avx512,
+        excode_ipimpl::ip64_fxu6_avx512,
+        excode_ipimpl::ip64_fxu7_avx512,
+    };
+
+    std::mt19937_64 gen(8);
+    for (size_t dim : {64, 128, 448, 1024}) {
+        for (size_t bits = 1; bits <= 7; ++bits) {
+            auto query = random_floats(dim, gen);
+            auto code = random_ints<uint8_t>(dim, (1U << bits) - 1, gen);
+            std::vector<uint8_t> compact(dim * bits / 8);
+            packing_rabitqplus_code(code.data(), compact.data(), dim, bits);
+
+            double exact = 0;
+            for (size_t i = 0; i < dim; ++i) {
+                exact += static_cast<double>(query[i]) * code[i];
+            }
+            float tol = sum_tolerance(dim, static_cast<float>(1U << bits));
+
+            float expected = scalar_funcs[bits - 1](query.data(), compact.data(), dim);
+            ASSERT_NEAR(expected, exact, tol) << "scalar, " << dim << ", " << bits;
+            if (has_level(SimdLevel::AVX2)) {
+                float result = avx2_funcs[bits - 1](query.data(), compact.data(), dim);
+                ASSERT_NEAR(result, expected, tol) << "avx2, " << dim << ", " << bits;
+            }
+            if (has_level(SimdLevel::AVX512)) {
+                float result = avx512_funcs[bits - 1](query.data(), compact.data(), dim);
+                ASSERT_NEAR(result, expected, tol) << "avx512, " << dim << ", " << bits;
+            }
+        }
+    }
+}
+
+TEST(SimdKernels, excode_ip_i8) {
+    using quant::rabitq_impl::ex_bits::packing_rabitqplus_code;
+    using excode_ipimpl::ip_i8xu_scalar;
+    using excode_ipimpl::ip64_i8xu_vnni;
+
+    std::vector<ex_ipfunc_i8> scalar_funcs = {
+        ip_i8xu_scalar<1>,
+        ip_i8xu_scalar<2>,
+        ip_i8xu_scalar<3>,
+        ip_i8xu_scalar<4>,
+        ip_i8xu_scalar<5>,
+        ip_i8xu_scalar<6>,
+        ip_i8xu_scalar<7>,
+        ip_i8xu_scalar<8>,
+    };
+    std::vector<ex_ipfunc_i8> vnni_funcs = {
+        ip64_i8xu_vnni<1>,
+        ip64_i8xu_vnni<2>,
+        ip64_i8xu_vnni<3>,
+        ip64_i8xu_vnni<4>,
+        ip64_i8xu_vnni<5>,
+        ip64_i8xu_vnni<6>,
+        ip64_i8xu_vnni<7>,
+        ip64_i8xu_vnni<8>,
+    };
+
+    std::mt19937_64 gen(10);
+    for (size_t dim : {64, 128, 448, 1024}) {
+        for (size_t bits = 1; bits <= 8; ++bits) {
+            auto query = random_ints<int8_t>(dim, 255, gen);
+            auto code = random_ints<uint8_t>(dim, (1U << bits) - 1, gen);
+            std::vector<uint8_t> compact(dim * bits / 8);
+            packing_rabitqplus_code(code.data(), compact.data(), dim, bits);
+
+            int32_t exact = 0;
+            for (size_t i = 0; i < dim; ++i) {
+                exact += static_cast<int32_t>(query[i]) * code[i];
+            }
+
+            int32_t expected = scalar_funcs[bits - 1](query.data(), compact.data(), dim);
+            ASSERT_EQ(expected, exact) << "scalar, " << dim << ", " << bits;
+            if (has_level(SimdLevel::AVX512Ext)) {
+                int32_t result = vnni_funcs[bits - 1](query.data(), compact.data(), dim);
+                ASSERT_EQ(result, expected) << "vnni, " << dim << ", " << bits;
+            }
+        }
+    }
+
+    // blocks of 16 dims after the last 64 dims
+    for (size_t bits : {1, 4}) {
+        size_t dim = 80;
+        auto query = random_ints<int8_t>(dim, 255, gen);
+        auto code = random_ints<uint8_t>(dim, (1U << bits) - 1, gen);
+        std::vector<uint8_t> compact(dim * bits / 8);
+        packing_rabitqplus_code(code.data(), compact.data(), dim, bits);
+        int32_t expected = scalar_funcs[bits - 1](query.data(), compact.data(), dim);
+        if (has_level(SimdLevel::AVX512Ext)) {
+            int32_t result = vnni_funcs[bits - 1](query.data(), compact.data(), dim);
+            ASSERT_EQ(result, expected) << "vnni, " << dim << ", " << bits;
+        }
+    }
+}
+
+TEST(SimdKernels, quantize_int8_symmetric) {
+    std::mt19937_64 gen(11);
+    // 100 leaves a tail for the scalar loops
+    for (size_t dim : {64, 100, 256}) {
+        auto vec = random_floats(dim, gen);
+        std::vector<int8_t> expected(dim);
+        float delta = quantize_int8_symmetric_scalar(vec.data(), dim, expected.data());
+        for (size_t i = 0; i < dim; ++i) {
+            ASSERT_NEAR(delta * expected[i], vec[i], delta / 2 + 1e-6F);
+        }
+
+        std::vector<int8_t> result(dim);
+        if (has_level(SimdLevel::AVX2)) {
+            ASSERT_EQ(quantize_int8_symmetric_avx2(vec.data(), dim, result.data()), delta);
+            ASSERT_EQ(result, expected) << "avx2, dim " << dim;
+        }
+        if (has_level(SimdLevel::AVX512)) {
+            float simd_delta =
+                quantize_int8_symmetric_avx512(vec.data(), dim, result.data());
+            ASSERT_EQ(simd_delta, delta);
+            ASSERT_EQ(result, expected) << "avx512, dim " << dim;
+        }
+    }
+
+    std::vector<float> zeros(64, 0.0F);
+    std::vector<int8_t> result(zeros.size(), 1);
+    ASSERT_EQ(quantize_int8_symmetric(zeros.data(), zeros.size(), result.data()), 0.0F);
+    ASSERT_EQ(result[0], 0);
+}
+
+TEST(SimdKernels, quantize_lut) {
+    std::mt19937_64 gen(12);
+    for (size_t dim : {16, 64, 128, 768}) {
+        auto query = random_floats(dim, gen);
+
+        // the previous construction through a float lut
+        std::vector<float> lut_float(dim * 4);
+        fastscan::pack_lut(dim, query.data(), lut_float.data());
+        float vl;
+        float vr;
+        data_range(lut_float.data(), dim * 4, vl, vr);
+
+        for (bool use_hacc : {false, true}) {
+            size_t lut_bytes = dim * (use_hacc ? 8 : 4);
+            float max_code = use_hacc ? 65535.F : 255.F;
+            std::vector<uint8_t> expected(lut_bytes);
+            float delta;
+            float lo = fastscan::quantize_lut_scalar(
+                query.data(), dim, use_hacc, expected.data(), delta
+            );
+            // the library is built with -Ofast, float expressions may be reassociated
+            ASSERT_FLOAT_EQ(lo, vl);
+            ASSERT_FLOAT_EQ(delta, (vr - vl) / max_code);
+
+            // u16 entries of the scalar layout, to be placed in the layouts of SIMD levels
+            std::vector<uint16_t> entries(dim * 4);
+            for (size_t i = 0; i < dim * 4; ++i) {
+                size_t codebook = i / 16;
+                size_t j = i % 16;
+                entries[i] = use_hacc ? static_cast<uint16_t>(
+                                            expected[(codebook * 32) + j] |
+                                            (expected[(codebook * 32) + j + 16] << 8)
+                                        )
+                                      : expected[i];
+                float exact = (lut_float[i] - vl) / delta;
+                ASSERT_NEAR(entries[i], exact, 0.51F) << "dim " << dim << ", entry " << i;
+            }
+
+            // SIMD kernels sum and round in another order, so allow one code of difference
+            std::vector<uint8_t> result(lut_bytes);
+            float simd_delta;
+            auto check = [&](auto kernel, auto slot, size_t hi_offset, const char* name) {
+                float simd_lo =
+                    kernel(query.data(), dim, use_hacc, result.data(), simd_delta);
+                ASSERT_FLOAT_EQ(simd_lo, lo) << name << ", dim " << dim;
+                ASSERT_FLOAT_EQ(simd_delta, delta) << name << ", dim " << dim;
+                for (size_t i = 0; i < dim * 4; ++i) {
+                    int entry = result[i];
+                    if (use_hacc) {
+                        const uint8_t* fill = slot(result.data(), i / 16) + (i % 16);
+                        entry = fill[0] | (fill[hi_offset] << 8);
+                    }
+                    ASSERT_NEAR(entry, entries[i], 1)
+                        << name << ", dim " << dim << ", hacc " << use_hacc << ", entry "
+                        << i;
+                }
+            };
+            if (has_level(SimdLevel::AVX2)) {
+                check(
+                    fastscan::quantize_lut_avx2, fastscan::hacc_lut_slot<256>, 32, "avx2"
+                );
+            }
+            if (has_level(SimdLevel::AVX512)) {
+                check(
+                    fastscan::quantize_lut_avx512,
+                    fastscan::hacc_lut_slot<512>,
+                    64,
+                    "avx512"
+                );
+            }
+        }
+    }
+}
+
+TEST(SimdKernels, kacs_walk_and_flip_sign) {
+    using rotator_impl::FhtKacRotator;
+    std::mt19937_64 gen(9);
+    for (size_t len : {64, 192, 1024}) {
+        auto vec = random_floats(len, gen);
+        auto flip = random_ints<uint8_t>(len / 8, 255, gen);
+
+        std::vector<float> expected = vec;
+        FhtKacRotator::kacs_walk_scalar(expected.data(), len);
+        rotator_impl::flip_sign_scalar(flip.data(), expected.data(), len);
+
+        if (has_level(SimdLevel::AVX2)) {
+            std::vector<float> result = vec;
+            FhtKacRotator::kacs_walk_avx2(result.data(), len);
+            rotator_impl::flip_sign_avx2(flip.data(), result.data(), len);
+            ASSERT_EQ(result, expected) << "avx2, " << len;
+        }
+        if (has_level(SimdLevel::AVX512)) {
+            std::vector<float> result = vec;
+            FhtKacRotator::kacs_walk_avx512(result.data(), len);
+            rotator_impl::flip_sign_avx512(flip.data(), result.data(), len);
+            ASSERT_EQ(result, expected) << "avx512, " << len;
+        }
+    }
+}
+
+TEST(SimdKernels, fht) {
+    if (!has_level(SimdLevel::AVX2)) {
+        GTEST_SKIP() << "helper_float_* need AVX";
+    }
+    std::mt19937_64 gen(10);
+    std::vector<void (*)(float*)> helpers = {
+        helper_float_6, helper_float_7, helper_float_8, helper_float_9, helper_float_10
+    };
+    for (size_t log_len = 6; log_len <= 10; ++log_len) {
+        size_t len = 1ULL << log_len;
+        auto vec = random_floats(len, gen);
+        std::vector<float> expected = vec;
+        rotator_impl::fht_scalar(expected.data(), len);
+        helpers[log_len - 6](vec.data());
+        ASSERT_TRUE(VectorsNearlyEqual(vec.data(), expected.data(), len, 1e-3F)) << len;
+    }
+}